@@ -35,6 +35,7 @@
 	  list_autoload/0,		% list predicates that need autoloading
 	  list_redefined/0,		% list redefinitions
 	  list_void_declarations/0,	% list declarations with no clauses
+	  list_det_guards/0,		% list predicates with exclusive guards
 	  list_trivial_fails/0,		% list goals that trivially fail
 	  list_trivial_fails/1,		% +Options
 	  list_strings/0,		% list string objects in clauses
@@ -271,6 +272,34 @@ list_void_declarations :-
 void_attribute(public).
 void_attribute(volatile).
 
+%%	list_det_guards is det.
+%
+%	List predicates in user modules for which  clauses  commit after
+%	their guard.  The guard of a clause  is the sequence of type tests
+%	and comparisons at the start of its  body.  If the guard of a
+%	clause excludes the guards of all remaining clauses, the clause
+%	does not leave a choicepoint. This optimisation requires the
+%	predicate to be compiled with the Prolog flag =optimise= set to
+%	=true= and is active after the predicate has been called.
+
+list_det_guards :-
+	findall(Pred-Count, det_guard_predicate(Pred, Count), Pairs),
+	(   Pairs == []
+	->  true
+	;   print_message(informational, check(det_guards)),
+	    forall(member(Pred-Count, Pairs),
+		   print_message(informational,
+				 check(det_guard(Pred, Count))))
+	).
+
+det_guard_predicate(M:Name/Arity, Count) :-
+	current_module(M),
+	module_property(M, class(user)),
+	current_predicate(M:Name/Arity),
+	functor(Head, Name, Arity),
+	\+ predicate_property(M:Head, imported_from(_)),
+	'$get_predicate_attribute'(M:Head, det_guards, Count).
+
 %%	list_trivial_fails is det.
 %%	list_trivial_fails(+Options) is det.
 %
@@ -664,6 +693,11 @@ prolog:message(check(string_in_clause(String, Context))) -->
 prolog:message(check(void_declaration(P, Decl))) -->
 	predicate(P),
 	[ ' is declared as ~p, but has no clauses'-[Decl] ].
+prolog:message(check(det_guards)) -->
+	[ 'The clauses below commit after their guard.' ].
+prolog:message(check(det_guard(Pred, Count))) -->
+	predicate(Pred),
+	[ ': ~D clause(s)'-[Count] ].
 
 
 redefined(user, system) -->
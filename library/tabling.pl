@@ -0,0 +1,222 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    As a special exception, if you link this library with other files,
+    compiled with a Free Software compiler, to produce an executable, this
+    library does not by itself cause the resulting executable to be covered
+    by the GNU General Public License. This exception does not however
+    invalidate any other reasons why the executable file might be covered by
+    the GNU General Public License.
+*/
+
+:- module(tabling,
+	  [ (table)/1,			% +PI ...
+	    current_table/2,		% :Variant, -Table
+	    start_tabling/2		% +Wrapper, :Worker
+	  ]).
+:- use_module(library(error)).
+
+:- meta_predicate
+	table(:),
+	current_table(:, -),
+	start_tabling(+, 0).
+
+/** <module> Tabled execution
+
+This library provides tabled  execution   of  predicates.  Tabling
+memoizes the answers of a call and  terminates for left-recursive and
+mutually recursive definitions over finite answer sets, e.g.
+
+    ==
+    :- use_module(library(tabling)).
+    :- table path/2.
+
+    path(X, Y) :- path(X, Z), edge(Z, Y).
+    path(X, Y) :- edge(X, Y).
+    ==
+
+Tables are private to a thread. Each  distinct   call  (up to variable
+renaming) owns a table.  Answers are   added  to the table, removing
+duplicates (again, up to variable renaming).  The built-in
+abolish_all_tables/0 removes all tables of the calling thread.
+
+The VM cannot suspend a call and resume it later. Recursive variant calls
+therefore  consume  the  answers  that   are    known   and  the  oldest
+call of a set of mutually dependent calls  re-evaluates its goal until no
+new answers are found (_linear tabling_). Answers are returned after the
+table is complete, in the order in which they were found.
+*/
+
+%%	table(:PredicateIndicators)
+%
+%	Prepare the given PredicateIndicators for   tabling.  Can only be
+%	used as a directive. The example  below   prepares  the predicate
+%	edge/2 and the non-terminal statement//1 for tabled execution.
+%
+%	  ==
+%	  :- table edge/2, statement//1.
+%	  ==
+
+table(M:PIList) :-
+	table(PIList, M).
+
+table(Var, _) :-
+	var(Var), !,
+	instantiation_error(Var).
+table(M:Spec, _) :- !,
+	table(Spec, M).
+table((A,B), M) :- !,
+	table(A, M),
+	table(B, M).
+table([], _) :- !.
+table([H|T], M) :- !,
+	table(H, M),
+	table(T, M).
+table(Name/Arity, M) :- !,
+	must_be(atom, Name),
+	must_be(nonneg, Arity),
+	functor(Head, Name, Arity),
+	wrappers(M:Head).
+table(Name//Arity0, M) :- !,
+	must_be(nonneg, Arity0),
+	Arity is Arity0+2,
+	table(Name/Arity, M).
+table(Spec, _) :-
+	type_error(predicate_indicator, Spec).
+
+%	wrappers(:Head)
+%
+%	Define Head as the tabling wrapper  and   register  Head  as tabled.
+%	The clauses of Head are renamed by term_expansion/2 below.  Note
+%	that the wrapper must be compiled before '$tabled'/1 is defined.
+
+wrappers(M:Head) :-
+	Head =.. [Name|Args],
+	atom_concat(Name, ' tabled', WrapName),
+	Worker =.. [WrapName|Args],
+	(   prolog_load_context(module, _),
+	    source_location(_, _)
+	->  discontiguous(M:'$tabled'/1),
+	    compile_aux_clauses([ (Head :- tabling:start_tabling(M:Head, M:Worker)),
+				  '$tabled'(Head)
+				])
+	;   dynamic(M:'$tabled'/1),
+	    assertz(M:(Head :- tabling:start_tabling(M:Head, M:Worker))),
+	    assertz(M:'$tabled'(Head))
+	).
+
+%%	start_tabling(+Wrapper, :Worker)
+%
+%	Execute Goal using tabling. This predicate  is called by the wrapper
+%	generated by table/1.
+
+start_tabling(Wrapper, Worker) :-
+	'$tbl_variant_table'(Wrapper, Table, Status),
+	(   Status == complete
+	->  true
+	;   Status == fresh
+	->  '$tbl_push'(Table),
+	    catch(fixpoint(Table, Wrapper, Worker), E,
+		  ( '$tbl_abandon'(Table),
+		    throw(E)
+		  ))
+	;   '$tbl_consume'(Table)
+	),
+	'$tbl_answer'(Table, Wrapper).
+
+fixpoint(Table, Wrapper, Worker) :-
+	'$tbl_iteration'(Table),
+	(   call(Worker),
+	    '$tbl_add_answer'(Table, Wrapper),
+	    fail
+	;   true
+	),
+	(   '$tbl_iterate'(Table)
+	->  fixpoint(Table, Wrapper, Worker)
+	;   '$tbl_pop'(Table)
+	).
+
+%%	current_table(:Variant, -Table) is nondet.
+%
+%	True when Table is the table of a call that is a variant of Variant.
+%	Table is a blob handle that can be  passed to '$tbl_answer'/2 and
+%	'$tbl_table_status'/4.
+
+current_table(M:Variant, Table) :-
+	'$tbl_tables'(Tables),
+	'$member'(Table, Tables),
+	'$tbl_table_status'(Table, _Status, M:Variant, _Answers).
+
+
+		 /*******************************
+		 *	   RENAME CLAUSES	*
+		 *******************************/
+
+%	Clauses of tabled predicates are renamed to <name> tabled, which
+%	is called by the wrapper.
+
+rename(M:Term0, M:Term) :- !,
+	rename(Term0, M, Term).
+rename(Term0, Term) :-
+	prolog_load_context(module, M),
+	rename(Term0, M, Term).
+
+rename((Head0 :- Body), M, (Head :- Body)) :- !,
+	rename_head(Head0, M, Head).
+rename((Head0 --> Body), M, (Head --> Body)) :- !,
+	functor(Head0, Name, Arity0),
+	Arity is Arity0+2,
+	functor(Test, Name, Arity),
+	tabled(M, Test),
+	rename_term(Head0, Head).
+rename(Head0, M, Head) :-
+	rename_head(Head0, M, Head).
+
+rename_head(Head0, M, Head) :-
+	callable(Head0),
+	Head0 \= _:_,
+	functor(Head0, Name, Arity),
+	functor(Test, Name, Arity),
+	tabled(M, Test),
+	rename_term(Head0, Head).
+
+tabled(M, Head) :-
+	current_predicate(M:'$tabled'/1),
+	\+ predicate_property(M:'$tabled'(_), imported_from(_)),
+	M:'$tabled'(Head), !.
+
+rename_term(Compound0, Compound) :-
+	compound(Compound0), !,
+	Compound0 =.. [Name|Args],
+	atom_concat(Name, ' tabled', WrapName),
+	Compound =.. [WrapName|Args].
+rename_term(Name, WrapName) :-
+	atom_concat(Name, ' tabled', WrapName).
+
+
+:- multifile
+	system:term_expansion/2.
+:- dynamic
+	system:term_expansion/2.
+
+system:term_expansion(In, Out) :-
+	\+ current_prolog_flag(xref, true),
+	rename(In, Out).
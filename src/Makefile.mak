@@ -59,7 +59,7 @@ INCSRC=	pl-index.c pl-alloc.c pl-fli.c
 SRC=	$(OBJ:.o=.c) $(DEPOBJ:.o=.c) $(EXT:.o=.c) $(INCSRC)
 HDR=	config.h parms.h pl-buffer.h pl-ctype.h pl-incl.h SWI-Prolog.h \
 	pl-main.h pl-os.h pl-data.h
-VMI=	pl-jumptable.ic pl-codetable.c pl-vmi.h
+VMI=	pl-jumptable.ic pl-codetable.c pl-vmi.h pl-vmi-super.ic
 
 PLSRC=$(PLSRC) ../boot/menu.pl
 PLWINLIBS=dde.pl progman.pl win_menu.pl
@@ -142,7 +142,8 @@ $(STREAMH):	os\SWI-Stream.h $(INCLUDEDIR)
 $(OBJ):		pl-vmi.h
 pl-funct.obj:	pl-funct.ih
 pl-atom.obj:	pl-funct.ih
-pl-wam.obj:	pl-vmi.c pl-alloc.c pl-index.c pl-fli.c pl-jumptable.ic
+pl-wam.obj:	pl-vmi.c pl-alloc.c pl-index.c pl-fli.c pl-jumptable.ic \
+		pl-vmi-super.ic
 pl-prims.obj:	pl-termwalk.c
 pl-rec.obj:	pl-termwalk.c
 pl-stream.obj:	popen.c
@@ -151,7 +152,7 @@ pl-arith.obj:	pl-segstack.h
 
 # this should be pl-vmi.h, but that causes a recompile of everything.
 # Seems NMAKE dependency computation is broken ...
-vmi:		pl-vmi.c mkvmi.exe
+vmi:		pl-vmi.c SUPERVMI mkvmi.exe
 		mkvmi.exe
 		echo "ok" > vmi
 
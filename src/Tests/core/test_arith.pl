@@ -46,6 +46,8 @@ test_arith :-
                     maxint,
                     maxint_promotion,
 		    float_overflow,
+		    float_arith,
+		    int_arith,
 		    arith_misc
 		  ]).
 
@@ -346,6 +348,100 @@ test(div, error(evaluation_error(float_overflow))) :-
 
 :- end_tests(float_overflow).
 
+:- begin_tests(float_arith).
+
+f_expr(X, Y, Z) :-
+	Z is X*0.5 + Y/4.0 - X.
+
+test(float, Z == -1.0) :-
+	f_expr(3.0, 2.0, Z).
+test(mixed, Z == -1.0) :-
+	f_expr(3, 2, Z).
+test(mixed, Z =:= 0.5*(1<<100) + 0.5 - (1<<100)) :-
+	f_expr(1<<100, 2, Z).
+test(int_div, Z == 3) :-
+	Z is 6/2.
+test(zero_div, error(evaluation_error(zero_divisor))) :-
+	X = 0.0,
+	Z is 1.0/X,
+	writeln(Z).
+test(overflow, error(evaluation_error(float_overflow))) :-
+	X = 1.0e308,
+	Z is X*10.0,
+	writeln(Z).
+test(compare, true) :-
+	X = 1.5,
+	Y = 1,
+	X > Y, Y < X, X =\= Y, X >= 1.5, 2 =:= 2.0.
+
+:- end_tests(float_arith).
+
+:- begin_tests(int_arith).
+
+hash(X0, X) :-
+	X1 is ((X0 << 5) + X0) /\ 0xffffffff,
+	X is X1 xor (X1 >> 3) \/ 1.
+ops(X, Y, [S,D,M,Min,Max,A]) :-
+	S is X - Y,
+	D is X // Y,
+	M is X mod Y,
+	Min is min(X, Y),
+	Max is max(X, Y),
+	A is abs(X).
+
+test(hash, H == 3968844355) :-
+	hash(123456789, H).
+test(ops, L == [-23,-2,1,-17,6,17]) :-
+	ops(-17, 6, L).
+test(float, L == [1.5,2.5,4.0]) :-
+	X = 4.0, Y = 2.5,
+	S is X - Y,
+	Min is min(X, Y),
+	Max is max(X, Y),
+	L = [S,Min,Max].
+test(overflow, X == 18446744073709551614) :-
+	Y = 9223372036854775807,
+	X is Y + Y.
+test(overflow, X == -18446744073709551616) :-
+	Y = -9223372036854775808,
+	X is Y - 9223372036854775808.
+test(overflow, X == 85070591730234615847396907784232501249) :-
+	Y = 9223372036854775807,
+	X is Y * Y.
+test(overflow, X == 9223372036854775808) :-
+	Y = 1,
+	X is Y << 63.
+test(overflow, X == 9223372036854775808) :-
+	Y = -9223372036854775808,
+	X is abs(Y).
+test(minint, X == 9223372036854775808) :-
+	Y = -9223372036854775808,
+	X is Y // -1.
+test(shift, X == -1) :-
+	Y = -5,
+	X is Y >> 100.
+test(shift, X == 4) :-
+	Y = 16,
+	X is Y << -2.
+test(mod, X == -3) :-
+	Y = 4,
+	X is Y mod -7.
+test(zero_div, error(evaluation_error(zero_divisor))) :-
+	Y = 7,
+	X is Y mod 0,
+	writeln(X).
+test(type, error(type_error(integer, 1.5))) :-
+	Y = 1.5,
+	X is Y >> 1,
+	writeln(X).
+test(fold, X == 1025) :-
+	X is 2*3 + (1<<10) - 5.
+test(fold, error(evaluation_error(zero_divisor))) :-
+	X is 1 // 0,
+	writeln(X).
+
+:- end_tests(int_arith).
+
 :- begin_tests(arith_misc).
 
 test(string) :-
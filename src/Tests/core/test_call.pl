@@ -101,11 +101,40 @@ test(qe8, true) :-
 test(ae8, true) :-
 	Goal = call(exists, a, b, c, d, e, f, g, h),
 	Goal.
+test(cache, Rs == [a, b, m, a]) :-		% one call site, different closures
+	findall(R, ( member(G, [cached, cached(b), call_cache:cached, cached]),
+		     call_cached(G, R)
+		   ), Rs).
+test(cache, Rs == [super, local]) :-		% definition added to the module
+	assertz(cache_super:cache_late(super)),
+	add_import_module(cache_sub, cache_super, start),
+	call_cached(cache_sub:cache_late, R1),
+	assertz(cache_sub:cache_late(local)),
+	call_cached(cache_sub:cache_late, R2),
+	Rs = [R1,R2].
+test(cache, Rs == [a]) :-			% arity is checked before caching
+	functor(G, cache_wide, 1100),
+	catch(call_cached(G, _), error(representation_error(max_arity), _), true),
+	findall(R, call_cached(cached, R), Rs).
+test(cache, fail) :-
+	assertz(cache_dyn(1)),
+	call_cached(cache_dyn, 1),
+	retract(cache_dyn(1)),
+	call_cached(cache_dyn, _).
 
 call8:exists(a, b, c, d, e, f, g, h).
 exists(a, b, c, d, e, f, g, h).
 exists(a,b).
 
+call_cached(G, R) :-
+	call(G, R).
+
+cached(a).
+cached(X, X).
+call_cache:cached(m).
+
+:- dynamic cache_dyn/1.
+
 :- end_tests(callN).
 
 cm1(X) :- context_module(X).
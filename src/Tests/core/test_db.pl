@@ -65,6 +65,20 @@ test(cut_cond, Body = (! -> fail)) :-
 	clause(f, Body),
 	retractall(f).
 
+test(list, [Xs == [a,b,c], cleanup(retractall(f(_)))]) :-
+	assertz(f(a)),
+	assertz_list([f(b), (f(c):-true)]),
+	findall(X, f(X), Xs).
+test(list_index, [Ys == [700-x], cleanup(retractall(f(_,_)))]) :-
+	forall(between(1, 100, I), assertz(f(I, x))),
+	f(50, _),				% create the index
+	findall(f(I, x), between(101, 1000, I), Clauses),
+	assertz_list(Clauses),
+	findall(I-Y, (I = 700, f(I, Y)), Ys),
+	predicate_property(f(_,_), number_of_clauses(1000)).
+test(list_partial, error(instantiation_error)) :-
+	assertz_list([f(a)|_]).
+
 :- end_tests(assert).
 
 :- begin_tests(retract).
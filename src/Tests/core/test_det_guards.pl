@@ -0,0 +1,128 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_det_guards,
+	  [ test_det_guards/0
+	  ]).
+:- use_module(library(plunit)).
+
+/** <module> Test determinism guards
+
+This module tests that optimised  clauses  whose  guard  excludes  the
+guards of the remaining clauses do not leave a choicepoint and that the
+remaining clauses are still tried if this is not safe.
+*/
+
+test_det_guards :-
+	run_tests([ det_guards
+		  ]).
+
+%%	load(+Id, +Clauses)
+%
+%	Compile Clauses in optimised mode as the source Id.
+
+load(Id, Clauses) :-
+	tmp_file_stream(text, File, Out),
+	forall(member(C, Clauses), portray_clause(Out, C)),
+	close(Out),
+	current_prolog_flag(optimise, Old),
+	setup_call_cleanup(
+	    ( set_prolog_flag(optimise, true),
+	      open(File, read, In)
+	    ),
+	    load_files(Id, [stream(In), silent(true)]),
+	    ( close(In),
+	      set_prolog_flag(optimise, Old),
+	      delete_file(File)
+	    )).
+
+%%	det(:Goal)
+%
+%	True if Goal succeeds without leaving a choicepoint.
+
+det(Goal) :-
+	call_cleanup(Goal, Det=true),
+	(   Det == true
+	->  true
+	;   !, fail
+	).
+
+:- begin_tests(det_guards).
+
+test(compare, Max-Det == 3-true) :-
+	load(guard_max,
+	     [ (max(X, Y, X) :- X >= Y),
+	       (max(X, Y, Y) :- X < Y)
+	     ]),
+	( det(max(3, 2, Max)) -> Det = true ; Det = false ).
+test(compare, Max == 4) :-
+	max(3, 4, Max).
+test(sign, Signs == [neg,zero,pos]) :-
+	load(guard_sign,
+	     [ (sign(X, neg) :- X < 0),
+	       (sign(X, zero) :- X =:= 0),
+	       (sign(X, pos) :- X > 0)
+	     ]),
+	maplist(det_sign, [-3,0,5], Signs).
+test(sign, error(type_error(evaluable, foo/0))) :-
+	sign(foo, _).
+test(type, Kinds == [atom,number,compound]) :-
+	load(guard_type,
+	     [ (kind(X, atom) :- atom(X)),
+	       (kind(X, number) :- number(X)),
+	       (kind(X, compound) :- compound(X))
+	     ]),
+	maplist(det_kind, [a,1,f(x)], Kinds).
+test(report, Count == 2) :-
+	load(guard_type,
+	     [ (kind(X, atom) :- atom(X)),
+	       (kind(X, number) :- number(X)),
+	       (kind(X, compound) :- compound(X))
+	     ]),
+	'$get_predicate_attribute'(kind(_,_), det_guards, Count).
+test(overlap, fail) :-
+	load(guard_overlap,
+	     [ (ov(X, a) :- X > 0),
+	       (ov(X, b) :- X > 5)
+	     ]),
+	det(ov(7, _)).
+test(overlap, fail) :-
+	'$get_predicate_attribute'(ov(_,_), det_guards, _).
+test(bound, Rs == [a,b]) :-
+	load(guard_bound,
+	     [ (bnd(X, X, a) :- atom(X)),
+	       (bnd(X, _, b) :- var(X))
+	     ]),
+	findall(R, bnd(_, c, R), Rs).
+test(debug, Rs == [atom]) :-
+	setup_call_cleanup(
+	    debug,
+	    findall(R, kind(x, R), Rs),
+	    nodebug).
+
+:- end_tests(det_guards).
+
+det_sign(X, S) :-
+	det(sign(X, S)).
+
+det_kind(X, K) :-
+	det(kind(X, K)).
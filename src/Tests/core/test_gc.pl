@@ -23,6 +23,7 @@
 
 :- module(test_gc, [test_gc/0]).
 :- use_module(library(plunit)).
+:- use_module(library(clpfd)).
 
 /** <module> Test garbage collection
 
@@ -35,6 +36,8 @@ test_gc :-
 		    gc_crash,
 		    gc_crash2,
 		    gc_mark,
+		    gc_generational,
+		    gc_parallel,
 		    agc
 		  ]).
 
@@ -240,6 +243,187 @@ a(Y) :- length(Y,_).
 :- end_tests(gc_mark).
 
 
+:- begin_tests(gc_generational).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Create old data using an explicit  GC   and  modify it while automatic
+(minor) collections take place. The trail must  keep the young data that
+is only referenced from the old generation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+minor_collections(N) :-
+	statistics(minor_collections, N).
+
+bind_old(L) :-
+	length(L, 20000),
+	garbage_collect,
+	bind(L, 0),
+	check(L, 0).
+
+bind([], _).
+bind([H|T], I) :-
+	junk,
+	H = g(I, [I], "young"),
+	I2 is I+1,
+	bind(T, I2).
+
+check([], _).
+check([H|T], I) :-
+	H == g(I, [I], "young"),
+	I2 is I+1,
+	check(T, I2).
+
+setarg_old(T) :-
+	functor(T, f, 20000),
+	garbage_collect,
+	forall(between(1, 20000, I),
+	       ( junk,
+		 nb_setarg(I, T, k(I))
+	       )),
+	(   between(1, 20000, I),
+	    arg(I, T, A),
+	    A \== k(I)
+	->  fail
+	;   true
+	).
+
+junk :-
+	numlist(1, 50, L),
+	sum_list(L, _).
+
+test(minor, [condition(current_prolog_flag(gc_generational, true)),
+	     M1 > M0]) :-
+	minor_collections(M0),
+	bind_old(_),
+	minor_collections(M1).
+test(nb_setarg) :-
+	setarg_old(_).
+test(backtrack) :-
+	length(L, 5000),
+	garbage_collect,
+	(   bind(L, 0), fail
+	;   true
+	),
+	bind(L, 0),
+	check(L, 0).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Run goals with the flag `gc_stress`, which  collects as soon as a few
+kilobytes have been allocated.  Old cells are modified by nb_setarg/3,
+setarg/3, read_term/2 and the attribute updates of clpfd.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+gc_stress(Goal) :-
+	current_prolog_flag(gc_stress, Old),
+	setup_call_cleanup(
+	    set_prolog_flag(gc_stress, true),
+	    Goal,
+	    set_prolog_flag(gc_stress, Old)).
+
+setarg_stress(N) :-
+	functor(T, f, N),
+	forall(between(1, N, I), nb_setarg(I, T, [])),
+	forall(between(1, 20, _),
+	       forall(between(1, N, I),
+		      ( arg(I, T, L0),
+			nb_setarg(I, T, [I|L0])
+		      ))),
+	functor(B, b, N),
+	(   between(1, N, I),
+	    setarg(I, B, s(I, "young")),
+	    junk,
+	    fail
+	;   true
+	),
+	setargs(1, N, B),
+	forall(between(1, N, I),
+	       ( arg(I, T, L),
+		 length(L, 20),
+		 L = [I|_],
+		 arg(I, B, A),
+		 A == s(I, "young")
+	       )).
+
+setargs(I, N, B) :-
+	I =< N, !,
+	setarg(I, B, s(I, "young")),
+	junk,
+	I2 is I+1,
+	setargs(I2, N, B).
+setargs(_, _, _).
+
+read_stress(N) :-
+	numlist(1, N, L),
+	format(atom(A), '~q', [t(L, L, _X, _Y)]),
+	term_to_atom(T, A),
+	T = t(L1, L2, _, _),
+	L1 == L,
+	L2 == L.
+
+queens(N, Qs) :-
+	length(Qs, N),
+	Qs ins 1..N,
+	safe_queens(Qs),
+	label(Qs).
+
+safe_queens([]).
+safe_queens([Q|Qs]) :-
+	safe_queens(Qs, Q, 1),
+	safe_queens(Qs).
+
+safe_queens([], _, _).
+safe_queens([Q|Qs], Q0, D0) :-
+	Q0 #\= Q,
+	abs(Q0 - Q) #\= D0,
+	D1 is D0 + 1,
+	safe_queens(Qs, Q0, D1).
+
+test(stress_setarg, M1 > M0) :-
+	minor_collections(M0),
+	gc_stress(setarg_stress(2000)),
+	minor_collections(M1).
+test(stress_read) :-
+	gc_stress(read_stress(20000)).
+test(stress_clpfd, N == 40) :-
+	gc_stress(aggregate_all(count, queens(7, _), N)).
+
+:- end_tests(gc_generational).
+
+:- begin_tests(gc_parallel, [condition(current_prolog_flag(threads, true))]).
+
+tree(0, leaf) :- !.
+tree(D, node(L, D, R, "str", 1.5)) :-
+	D2 is D-1,
+	tree(D2, L),
+	tree(D2, R).
+
+parallel_gc(Threads) :-
+	current_prolog_flag(gc_threads, Old),
+	setup_call_cleanup(
+	    set_prolog_flag(gc_threads, Threads),
+	    parallel_gc,
+	    set_prolog_flag(gc_threads, Old)).
+
+parallel_gc :-
+	tree(16, Tree),
+	numlist(1, 600000, L),
+	copy_term(Tree, Copy),
+	garbage_collect,
+	Tree =@= Copy,
+	sum_list(L, Sum),
+	Sum =:= 600000*600001//2.
+
+test(mark) :-
+	parallel_gc(4).
+test(reuse) :-
+	parallel_gc(4),
+	parallel_gc(2),
+	parallel_gc(3).
+test(domain, error(domain_error(not_less_than_one, 0))) :-
+	set_prolog_flag(gc_threads, 0).
+
+:- end_tests(gc_parallel).
+
 :- begin_tests(agc).
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
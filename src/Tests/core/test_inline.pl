@@ -0,0 +1,159 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_inline,
+	  [ test_inline/0
+	  ]).
+:- use_module(library(plunit)).
+
+/** <module> Test inlining of small predicates
+
+This module tests that optimised compilation inlines calls to small
+static predicates, that clause/2 shows the original call and that
+callers follow a redefinition of the inlined predicate.
+*/
+
+test_inline :-
+	run_tests([ inline
+		  ]).
+
+%%	load(+Id, +Clauses)
+%
+%	Compile Clauses in optimised mode as the source Id.
+
+load(Id, Clauses) :-
+	tmp_file_stream(text, File, Out),
+	forall(member(C, Clauses), portray_clause(Out, C)),
+	close(Out),
+	current_prolog_flag(optimise, Old),
+	setup_call_cleanup(
+	    ( set_prolog_flag(optimise, true),
+	      open(File, read, In)
+	    ),
+	    load_files(Id, [stream(In), silent(true)]),
+	    ( close(In),
+	      set_prolog_flag(optimise, Old),
+	      delete_file(File)
+	    )).
+
+inlined(Head) :-
+	clause(Head, _, Ref),
+	clause_vmi(Ref, 0, i_inlined), !.
+
+%	gc_reload
+%
+%	Collect garbage while the caller of gchk/2 has only passed X1 to
+%	its fallback call and then make the caller use this call.
+
+gc_reload :-
+	garbage_collect,
+	load(inline_gcallee, [ gchk(X, X) ]).
+
+clause_vmi(Ref, PC, Name) :-
+	'$fetch_vm'(Ref, PC, NextPC, VMI),
+	(   functor(VMI, Name, _)
+	;   clause_vmi(Ref, NextPC, Name)
+	).
+
+:- begin_tests(inline).
+
+test(accessor, X-Y == 3-4) :-
+	load(inline_accessor,
+	     [ px(point(X0,_), X0),
+	       py(point(_,Y0), Y0),
+	       (coords(P, X1, Y1) :- px(P, X1), py(P, Y1))
+	     ]),
+	inlined(coords(_,_,_)),
+	coords(point(3,4), X, Y).
+test(accessor, fail) :-
+	load(inline_accessor,
+	     [ px(point(X0,_), X0),
+	       (xof(P, X1) :- px(P, X1))
+	     ]),
+	xof(line(1,2), _).
+test(arith, Ys == [1,4,9]) :-
+	load(inline_arith,
+	     [ (succ_sq(X0, Y0) :- Y1 is X0+1, Y0 is Y1*Y1),
+	       (map([], [])),
+	       (map([H0|T0], [H|T]) :- succ_sq(H0, H), map(T0, T))
+	     ]),
+	inlined(map([_|_], _)),
+	map([0,1,2], Ys0),
+	Ys = Ys0.
+test(arith, error(type_error(evaluable, foo/0))) :-
+	load(inline_arith,
+	     [ (inc(X0, Y0) :- Y0 is X0+1),
+	       (use_inc(X, Y) :- inc(X, Y))
+	     ]),
+	use_inc(foo, _).
+test(shared_head, R == [yes,no]) :-
+	load(inline_shared,
+	     [ same(X0, X0),
+	       (is_same(A, B, R0) :- ( same(A, B) -> R0 = yes ; R0 = no ))
+	     ]),
+	inlined(is_same(_,_,_)),
+	is_same(a, a, R1),
+	is_same(a, b, R2),
+	R = [R1,R2].
+test(clause, Body == px(P, X)) :-
+	load(inline_accessor,
+	     [ px(point(X0,_), X0),
+	       (xof(P1, X1) :- px(P1, X1))
+	     ]),
+	inlined(xof(_,_)),
+	clause(xof(P, X), Body).
+test(reload, X-Y == 1-101) :-
+	load(inline_callee, [ (val(X0, Y0) :- Y0 is X0+1) ]),
+	load(inline_caller, [ (use_val(X1, Y1) :- val(X1, Y1)) ]),
+	inlined(use_val(_,_)),
+	use_val(0, X),
+	load(inline_callee, [ (val(X2, Y2) :- Y2 is X2+100) ]),
+	use_val(1, Y).
+test(debug, Y == 2) :-
+	load(inline_callee, [ (val(X0, Y0) :- Y0 is X0+1) ]),
+	load(inline_caller, [ (use_val(X1, Y1) :- val(X1, Y1)) ]),
+	setup_call_cleanup(
+	    debug,
+	    use_val(1, Y),
+	    nodebug).
+test(gc, Y == f(hello)) :-
+	load(inline_gcallee, [ gchk(_, ok) ]),
+	load(inline_gcaller,
+	     [ (use_gchk(Y1) :- X1 = f(hello), gc_reload, gchk(X1, Y1))
+	     ]),
+	inlined(use_gchk(_)),
+	use_gchk(Y).
+test(abolish, Y == changed) :-
+	load(inline_acallee, [ (aval(X0, Y0) :- Y0 is X0+1) ]),
+	load(inline_acaller, [ (use_aval(X1, Y1) :- aval(X1, Y1)) ]),
+	abolish(aval/2),
+	assertz(aval(_, changed)),
+	use_aval(1, Y).
+test(not_inlined, fail) :-
+	load(inline_multi,
+	     [ color(red),
+	       color(green),
+	       (is_color(C) :- color(C))
+	     ]),
+	inlined(is_color(_)).
+
+:- end_tests(inline).
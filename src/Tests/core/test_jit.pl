@@ -4,7 +4,8 @@
 :- use_module(library(plunit)).
 
 test_jit :-
-	run_tests([ jit
+	run_tests([ jit,
+		    frozen
 		  ]).
 
 /** <module> Test unit for Just-In-Time indexing
@@ -15,16 +16,21 @@ This module tests behaviour of the just-in-time indexes.
 :- begin_tests(jit).
 
 :- dynamic
+	d/1,
 	d/2.
 
-test(remove, [cleanup(retractall(d(_,_)))]) :-
+test(grow, [cleanup(retractall(d(_,_))), Vs == [30,var]]) :-
 	forall(between(1,50,X), assertz(d(X,X))),
 	d(_,30),
-	predicate_property(d(_,_), indexed([2-_])),
+	predicate_property(d(_,_), indexed([2-hash(B0,_,_)])),
 	forall(between(51,125,X), assertz(d(X,X))),
-	\+ predicate_property(d(_,_), indexed(_)),
-	d(30,_),
-	predicate_property(d(_,_), indexed([1-_])).
+	assertz(d(var,_)),
+	forall(between(126,400,X), assertz(d(X,X))),
+	retract(d(31,31)),
+	predicate_property(d(_,_), indexed([2-hash(B1,_,_)])),
+	B1 > B0,
+	findall(V, d(V,30), Vs),
+	\+ d(31,_).
 test(remove, [cleanup(retractall(d(_,_)))]) :-
 	forall(between(1,40,X), assertz(d(X,a))),
 	forall(between(41,50,X), assertz(d(X,X))),
@@ -34,10 +40,100 @@ test(remove, [cleanup(retractall(d(_,_)))]) :-
 	\+ predicate_property(d(_,_), indexed(_)),
 	d(_,45),
 	predicate_property(d(_,_), indexed([2-_])).
+test(composite, [cleanup(retractall(d(_,_)))]) :-
+	forall(between(0,3999,X),
+	       ( A is X mod 20, B is X // 20,
+		 assertz(d(A,B))
+	       )),
+	d(0,102),
+	predicate_property(d(_,_), indexed(Indexes)),
+	memberchk([1,2]-_, Indexes).
+test(deep, [cleanup(retractall(d(_))), Xs == [7,var]]) :-
+	forall(between(1,100,X),
+	       ( T is X mod 3,
+		 assertz(d(event(T,X,data)))
+	       )),
+	assertz(d(event(1,_,var))),
+	findall(X, (d(event(1,7,X0)), (X0 == data -> X = 7 ; X = X0)), Xs),
+	retract(d(event(_,8,_))),
+	\+ d(event(2,8,_)).
 test(retract, [cleanup(retractall(d(_,_))), Xs == Xsok]) :-
 	forall(between(1,10,X), assertz(d(X,X))),
 	forall(between(11,100,X), assertz(d(a,X))),
 	findall(X, retract(d(a,X)), Xs),
 	numlist(11, 100, Xsok).
 
+test(key, [cleanup(retractall(d(_,_))), true(Vs == [30])]) :-
+	forall(between(1,50,X),
+	       ( format(string(S), 'key~w', [X]),
+		 assertz(d(S,X))
+	       )),
+	format(string(K), 'key~w', [30]),
+	findall(V, d(K,V), Vs),
+	predicate_property(d(_,_), indexed([1-_])).
+test(key, [cleanup(retractall(d(_,_))), true(Vs == [30])]) :-
+	forall(between(1,50,X),
+	       ( F is float(X),
+		 assertz(d(F,X))
+	       )),
+	findall(V, d(30.0,V), Vs),
+	predicate_property(d(_,_), indexed([1-_])).
+test(key, [cleanup(retractall(d(_,_))), true(Vs == [30])]) :-
+	forall(between(1,50,X),
+	       ( I is 1<<100 + X,
+		 assertz(d(I,X))
+	       )),
+	K is 1<<100 + 30,
+	findall(V, d(K,V), Vs),
+	predicate_property(d(_,_), indexed([1-_])).
+
 :- end_tests(jit).
+
+:- begin_tests(frozen).
+
+:- dynamic
+	f1/2,
+	f2/2,
+	f3/2.
+
+%%	static_facts(+Head, +Facts)
+%
+%	Define the static predicate Head from the list Facts.
+
+static_facts(Head, Facts) :-
+	forall(member(Head, Facts), assertz(Head)),
+	functor(Head, Name, Arity),
+	compile_predicates([Name/Arity]).
+
+det(G) :-
+	call_cleanup(G, Det=true),
+	(   Det == true
+	->  true
+	;   !, fail
+	).
+
+test(lookup, [cleanup(abolish(f1/2)), Ks == [3,10,17]]) :-
+	findall(f1(K,V), (between(1,20,K), V is K mod 7), Facts),
+	static_facts(f1(_,_), Facts),
+	freeze_indexes([f1/2]),
+	predicate_property(f1(_,_), indexed(Indexes)),
+	memberchk(1-frozen(20), Indexes),
+	memberchk(2-frozen(7), Indexes),
+	det(f1(17, V)),
+	V == 3,
+	\+ f1(21, _),
+	\+ f1(a, _),
+	findall(K, f1(K,3), Ks).
+test(unbound, [cleanup(abolish(f2/2)), All == Facts]) :-
+	Facts = [f2(b,1), f2(a,2), f2(b,3), f2(c,4)],
+	static_facts(f2(_,_), Facts),
+	freeze_indexes([f2/2]),
+	findall(f2(X,Y), f2(X,Y), All).
+test(var, [cleanup(abolish(f3/2)), Indexes == [2-frozen(3)]]) :-
+	static_facts(f3(_,_), [f3(a,1), f3(_,2), f3(b,3)]),
+	freeze_indexes([f3/2]),
+	predicate_property(f3(_,_), indexed(Indexes)).
+test(dynamic, [error(permission_error(freeze, dynamic_procedure, _))]) :-
+	freeze_indexes([d/2]).
+
+:- end_tests(frozen).
@@ -33,7 +33,8 @@ This module is a Unit test for Prolog module oddities.
 */
 
 test_module :-
-	run_tests([ module
+	run_tests([ module,
+		    resolve
 		  ]).
 
 % test resetting the context module after a clause that uses
@@ -88,3 +89,45 @@ test(mqual, [sto(rational_trees),
 	mqual(T).
 
 :- end_tests(module).
+
+% resolving predicates through import modules is cached per module.
+% Check that the cache notices definitions and import changes.
+
+resolve_chain(Top, Mid, Base) :-
+	assert(Base:rp(base)),
+	add_import_module(Mid, Base, start),
+	add_import_module(Top, Mid, start).
+
+:- begin_tests(resolve).
+
+test(shadow, [X-Y == base-mid]) :-
+	resolve_chain(rc_top1, rc_mid1, rc_base1),
+	call(rc_top1:rp, X),
+	assert(rc_mid1:rp(mid)),
+	call(rc_top1:rp, Y).
+test(import, [L == [base,other,base]]) :-
+	resolve_chain(rc_top2, rc_mid2, rc_base2),
+	assert(rc_other2:rp(other)),
+	call(rc_top2:rp, X),
+	add_import_module(rc_top2, rc_other2, start),
+	call(rc_top2:rp, Y),
+	delete_import_module(rc_top2, rc_other2),
+	call(rc_top2:rp, Z),
+	L = [X,Y,Z].
+test(dynamic, [X-Y == base-none]) :-
+	resolve_chain(rc_top3, rc_mid3, rc_base3),
+	call(rc_top3:rp, X),
+	rc_mid3:dynamic(rp/1),
+	(   call(rc_top3:rp, Y)
+	->  true
+	;   Y = none
+	).
+test(imported, [X-Y == base-exp]) :-
+	resolve_chain(rc_top4, rc_mid4, rc_base4),
+	rc_exp4:export(rp/1),
+	@(import(rc_exp4:rp/1), rc_top4),
+	call(rc_top4:rp, X),
+	assert(rc_exp4:rp(exp)),
+	call(rc_top4:rp, Y).
+
+:- end_tests(resolve).
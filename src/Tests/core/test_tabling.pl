@@ -0,0 +1,122 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_tabling,
+	  [ test_tabling/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(tabling)).
+
+/** <module> Test tabled execution
+
+This module tests library(tabling): termination of left-recursive and
+mutually recursive programs, answer duplicate elimination and cleanup
+after exceptions.
+*/
+
+test_tabling :-
+	run_tests([ tabling
+		  ]).
+
+:- table
+	path/2,
+	even/1,
+	odd/1,
+	fib/2,
+	loop/1,
+	pair/2.
+
+edge(a, b).
+edge(b, c).
+edge(c, a).
+edge(c, d).
+
+path(X, Y) :- path(X, Z), edge(Z, Y).
+path(X, Y) :- edge(X, Y).
+
+even(0).
+even(N) :- odd(M), M < 10, N is M+1.
+
+odd(N) :- even(M), M < 10, N is M+1.
+
+fib(0, 0).
+fib(1, 1).
+fib(N, F) :-
+	N > 1,
+	N1 is N-1,
+	N2 is N-2,
+	fib(N1, F1),
+	fib(N2, F2),
+	F is F1+F2.
+
+loop(X) :- loop(X).
+loop(X) :- X == error, throw(loop_error).
+loop(a).
+
+pair(X, Y) :- member(X-Y, [A-A, _-_, a-_, _-a, A-A]).
+
+:- begin_tests(tabling, [cleanup(abolish_all_tables)]).
+
+test(left_recursion, Ys == [a,b,c,d]) :-
+	findall(Y, path(a, Y), Ys0),
+	msort(Ys0, Ys).
+test(all_pairs, N == 12) :-
+	findall(X-Y, path(X, Y), Pairs),
+	sort(Pairs, Set),
+	length(Pairs, N),
+	length(Set, N).
+test(mutual, Evens == [0,2,4,6,8,10]) :-
+	findall(N, even(N), Evens0),
+	msort(Evens0, Evens).
+test(fib, F == 354224848179261915075) :-
+	fib(100, F).
+test(loop, Xs == [a]) :-
+	findall(X, loop(X), Xs).
+test(exception, E-E2 == loop_error-loop_error) :-
+	catch(loop(error), E, true),
+	catch(loop(error), E2, true).
+test(variant_answers, N == 4) :-
+	findall(X-Y, pair(X, Y), Answers),
+	length(Answers, N).
+test(variant_calls, N == 2) :-
+	abolish_all_tables,
+	forall(member(G, [pair(X,X), pair(_,_), pair(Y,Y)]), G),
+	findall(T, current_table(test_tabling:pair(_,_), T), Tables),
+	length(Tables, N).
+test(status, Status == complete) :-
+	path(a, _), !,
+	current_table(test_tabling:path(a, _), Table),
+	'$tbl_table_status'(Table, Status, _, _).
+test(abolish, Tables == []) :-
+	path(a, _), !,
+	abolish_all_tables,
+	findall(T, current_table(_:_, T), Tables).
+test(thread, Status == true) :-
+	thread_create(thread_path, Id, []),
+	thread_join(Id, Status).
+
+thread_path :-
+	findall(Y, path(a, Y), Ys0),
+	msort(Ys0, [a,b,c,d]),
+	current_table(test_tabling:path(a, _), _).
+
+:- end_tests(tabling).
@@ -0,0 +1,108 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_trie,
+	  [ test_trie/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test term tries
+
+This module tests the trie blob: insert, lookup, delete and enumeration
+of variant keys.
+*/
+
+test_trie :-
+	run_tests([ trie
+		  ]).
+
+:- begin_tests(trie).
+
+keys([ a, 1, -7, "string", 3.14, 0.0, 12345678901234567890123,
+       f(_,_), f(X,X), [1,2,3], g(h(i), [x|T], T), _
+     ]).
+
+test(insert_lookup, Values == Expected) :-
+	trie_new(Trie),
+	keys(Keys),
+	forall(nth1(I, Keys, Key), trie_insert(Trie, Key, v(I))),
+	findall(V, (member(Key, Keys), trie_lookup(Trie, Key, V)), Values),
+	length(Keys, N),
+	findall(v(I), between(1, N, I), Expected).
+test(variant, fail) :-
+	trie_new(Trie),
+	trie_insert(Trie, f(A,_,A), x),
+	trie_insert(Trie, f(C,_,C), y).
+test(variant, fail) :-
+	trie_new(Trie),
+	trie_insert(Trie, f(A,_,A), x),
+	trie_lookup(Trie, f(B,B,_), _).
+test(update, V == y) :-
+	trie_new(Trie),
+	trie_insert(Trie, k(1), x),
+	trie_update(Trie, k(1), y),
+	trie_lookup(Trie, k(1), V).
+test(delete, V-Keys == x-[k(2)]) :-
+	trie_new(Trie),
+	trie_insert(Trie, k(1), x),
+	trie_insert(Trie, k(2), y),
+	trie_delete(Trie, k(1), V),
+	findall(K, trie_gen(Trie, K, _), Keys).
+test(gen, true(Sorted =@= Expected)) :-
+	trie_new(Trie),
+	keys(Keys),
+	forall(nth1(I, Keys, Key), trie_insert(Trie, Key, I)),
+	findall(I-K, trie_gen(Trie, K, I), Pairs),
+	keysort(Pairs, Sorted),
+	findall(I-K, nth1(I, Keys, K), Expected).
+test(gen_partial, Vs == [1,2]) :-
+	trie_new(Trie),
+	trie_insert(Trie, f(a, 1), 1),
+	trie_insert(Trie, f(a, 2), 2),
+	trie_insert(Trie, g(a), 3),
+	findall(V, trie_gen(Trie, f(a, _), V), Vs0),
+	msort(Vs0, Vs).
+test(long_key, V == long) :-
+	numlist(1, 100000, L),
+	trie_new(Trie),
+	trie_insert(Trie, L, long),
+	trie_lookup(Trie, L, V),
+	trie_destroy(Trie).
+test(cyclic, error(type_error(acyclic_term, _))) :-
+	X = f(X),
+	trie_new(Trie),
+	trie_insert(Trie, X, cyclic).
+test(destroy, error(existence_error(trie, _))) :-
+	trie_new(Trie),
+	trie_destroy(Trie),
+	\+ is_trie(Trie),
+	trie_insert(Trie, a, b).
+test(agc, V == atom) :-
+	trie_new(Trie),
+	atom_concat(test_trie_, 42, A),
+	trie_insert(Trie, A, atom),
+	garbage_collect_atoms,
+	atom_concat(test_trie_, 42, A2),
+	trie_lookup(Trie, A2, V).
+
+:- end_tests(trie).
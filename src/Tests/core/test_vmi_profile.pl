@@ -0,0 +1,95 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_vmi_profile,
+	  [ test_vmi_profile/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test VMI statistics
+
+This module tests vmi_profiler/2 and friends: counting instructions
+per predicate, merging the counters of finished threads and reset.
+*/
+
+test_vmi_profile :-
+	run_tests([ vmi_profile
+		  ]).
+
+len([], 0).
+len([_|T], N) :-
+	len(T, N0),
+	N is N0+1.
+
+profile(Goal, Mode) :-
+	reset_vmi_profiler,
+	setup_call_cleanup(
+	    vmi_profiler(_, Mode),
+	    once(Goal),
+	    vmi_profiler(_, false)).
+
+pred_count(PI, Count) :-
+	vmi_profile_data(_, Preds),
+	(   memberchk(PI-Count, Preds)
+	->  true
+	;   Count = 0
+	).
+
+:- begin_tests(vmi_profile, [cleanup(reset_vmi_profiler)]).
+
+test(status, Old == false) :-
+	reset_vmi_profiler,
+	vmi_profiler(Old, false).
+test(status, error(domain_error(vmi_profile_status, foo))) :-
+	vmi_profiler(_, foo).
+test(count, Count >= 1000) :-
+	numlist(1, 1000, L),
+	profile(len(L, _), true),
+	pred_count(test_vmi_profile:len/2, Count).
+test(count, Names == [h_nil, i_exitfact, i_enter]) :-
+	numlist(1, 1000, L),
+	profile(len(L, _), true),
+	vmi_profile_data(VMIs, _),
+	findall(Name, ( member(Name, [h_nil, i_exitfact, i_enter]),
+			memberchk(vmi(Name, _, _), VMIs)
+		      ), Names).
+test(cycles, true) :-
+	numlist(1, 10000, L),
+	profile(len(L, _), cycles),
+	vmi_profile_data(VMIs, _),
+	memberchk(vmi(i_enter, Count, Cycles), VMIs),
+	Count >= 10000,
+	integer(Cycles).
+test(thread, Count >= 1000) :-
+	numlist(1, 1000, L),
+	profile(( thread_create(len(L, _), Id, []),
+		  thread_join(Id, true)
+		), true),
+	pred_count(test_vmi_profile:len/2, Count).
+test(reset, Count == 0) :-
+	numlist(1, 1000, L),
+	profile(len(L, _), true),
+	reset_vmi_profiler,
+	pred_count(test_vmi_profile:len/2, Count).
+
+:- end_tests(vmi_profile).
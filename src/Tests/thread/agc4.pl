@@ -0,0 +1,36 @@
+:- module(agc4,
+	  [ agc4/0
+	  ]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+This test has several threads looking  up the same atoms while new atoms
+are created (forcing the atom  table  to   be  rehashed)  and  AGC runs
+concurrently. Existing atoms are found  without   locking  the atom table,
+so this verifies lookups always find the  existing atom and do not race
+with rehashing and atom garbage collection.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+agc4 :-
+	thread_create(agc, AGC, []),
+	findall(Id, (between(1, 4, I),
+		     thread_create(lookup(I, 2000), Id, [])), Ids),
+	maplist(thread_join, Ids, Status),
+	thread_signal(AGC, abort),
+	thread_join(AGC, _),
+	maplist(==(true), Status).
+
+agc :-
+	repeat,
+	sleep(0.01),
+	garbage_collect_atoms,
+	fail.
+
+lookup(I, N) :-
+	forall(between(1, N, J),
+	       ( K is J mod 100,
+		 New is I*100000+J,
+		 atom_concat(agc4_shared_, K, A1),
+		 atom_concat(agc4_new_, New, _),
+		 atom_concat(agc4_shared_, K, A2),
+		 A1 == A2
+	       )).
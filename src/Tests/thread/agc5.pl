@@ -0,0 +1,33 @@
+:- module(agc5,
+	  [ agc5/0
+	  ]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+AGC asks each thread to mark its own stacks at a safe point. Threads that
+are blocked, here in thread_get_message/1,   never reach a safe point and
+must be marked by the collecting  thread.   This  test verifies atoms only
+referenced from the stacks of blocked and running threads survive.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+agc5 :-
+	thread_create(blocked, Blocked, []),
+	findall(Id, (between(1, 3, I), thread_create(busy(I), Id, [])), Ids),
+	forall(between(1, 10, _),
+	       ( garbage_collect_atoms,
+		 sleep(0.01)
+	       )),
+	thread_send_message(Blocked, go),
+	maplist(thread_join, [Blocked|Ids], Status),
+	maplist(==(true), Status).
+
+blocked :-
+	atom_concat(agc5_blocked_, 4242, A),
+	thread_get_message(go),
+	atom_length(A, _),
+	atom_concat(agc5_blocked_, 4242, A).
+
+busy(I) :-
+	atom_concat(agc5_busy_, I, A),
+	forall(between(1, 200000, _), true),
+	atom_length(A, _),
+	atom_concat(agc5_busy_, I, A).
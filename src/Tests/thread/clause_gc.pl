@@ -0,0 +1,69 @@
+:- module(clause_gc,
+	  [ clause_gc/0
+	  ]).
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Clause garbage collection reclaims the erased clauses of reloaded static
+predicates. A thread that is running an erased clause must be able to
+complete it and the clause may only be reclaimed after that. The same
+holds for a thread that has a choicepoint on the erased clauses. A thread
+that runs a clause of the new version does not delay reclaiming.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+clause_gc :-
+	tmp_file_stream(text, File, Out),
+	format(Out, 'cgc_p(1) :- thread_get_message(go), cgc_q.~n', []),
+	format(Out, 'cgc_p(2).~ncgc_q.~n', []),
+	format(Out, 'cgc_r(1).~ncgc_r(2).~ncgc_r(3).~n', []),
+	close(Out),
+	call_cleanup(test(File), delete_file(File)).
+
+test(File) :-
+	load_files(user:File, [silent(true)]),
+	thread_create(user:cgc_p(1), Id, []),
+	thread_create(choice, Id2, []),
+	sleep(0.1),
+	load_files(user:File, [silent(true), if(true)]),
+	garbage_collect_clauses,
+	statistics(clauses, Active),
+	thread_send_message(Id, go),
+	thread_join(Id, true),
+	thread_send_message(Id2, go),
+	thread_join(Id2, true),
+	garbage_collect_clauses,
+	garbage_collect_clauses,
+	statistics(clauses, Done),
+	Done < Active,
+	predicate_property(user:cgc_p(_), number_of_clauses(2)),
+	running(File).
+
+running(File) :-
+	thread_create(user:cgc_p(1), Id, []),
+	sleep(0.1),
+	load_files(user:File, [silent(true), if(true)]),
+	thread_send_message(Id, go),
+	thread_join(Id, true),
+	thread_create(user:cgc_p(1), Id2, []),
+	sleep(0.1),
+	statistics(clauses, Pending),
+	call_cleanup(reclaimed(Pending, 50),
+		     ( thread_send_message(Id2, go),
+		       thread_join(Id2, true))).
+
+reclaimed(Pending, _) :-
+	garbage_collect_clauses,
+	statistics(clauses, Now),
+	Now =< Pending-2, !.
+reclaimed(Pending, N) :-
+	N > 0,
+	sleep(0.05),
+	N2 is N-1,
+	reclaimed(Pending, N2).
+
+choice :-
+	findall(X, (user:cgc_r(X), wait(X)), Xs),
+	Xs == [1,2,3].
+
+wait(1) :- !,
+	thread_get_message(go).
+wait(_).
@@ -0,0 +1,70 @@
+:- module(test_concurrent_jit,
+	  [ test_concurrent_jit/0,
+	    test_concurrent_jit/4
+	  ]).
+:- use_module(library(apply)).
+:- use_module(library(aggregate)).
+
+/** <module> Test building a clause index while the predicate changes
+
+Readers call a large dynamic predicate on its second argument, which
+makes the first of them build an index for it in slices.  Meanwhile a
+writer adds clauses at both ends and retracts some of them.  Readers
+must always find all clauses for the keys that are not changed and in
+the end the indexed lookup must agree with a scan of the predicate.
+*/
+
+:- dynamic(p/2).
+
+test_concurrent_jit :-
+	test_concurrent_jit(5, 3, 20000, 2000).
+
+test_concurrent_jit(Rounds, Readers, N, Writes) :-
+	forall(between(1, Rounds, _),
+	       round(Readers, N, Writes)),
+	retractall(p(_,_)).
+
+round(Readers, N, Writes) :-
+	retractall(p(_,_)),
+	forall(between(1, N, I),
+	       ( K is I mod 100,
+		 assertz(p(I, K))
+	       )),
+	Count is N//100,
+	message_queue_create(Done),
+	findall(Id,
+		( between(1, Readers, _),
+		  thread_create(reader(Count, Done), Id, [])
+		), Ids),
+	thread_create(writer(Writes), Writer, []),
+	thread_join(Writer, WStat),
+	forall(member(_, Ids), thread_send_message(Done, done)),
+	maplist(thread_join, Ids, RStats),
+	message_queue_destroy(Done),
+	maplist(==(true), [WStat|RStats]),
+	forall(between(1000, 1009, K),
+	       ( findall(X, p(X, K), Indexed),
+		 findall(X, (p(X, K0), K0 == K), Scanned),
+		 Indexed == Scanned
+	       )).
+
+writer(Writes) :-
+	forall(between(1, Writes, I),
+	       ( K is 1000 + I mod 10,
+		 (   I mod 2 =:= 0
+		 ->  asserta(p(I, K))
+		 ;   assertz(p(I, K))
+		 ),
+		 (   I mod 3 =:= 0
+		 ->  retract(p(I, K))
+		 ;   true
+		 )
+	       )).
+
+reader(Count, Done) :-
+	K is random(100),
+	aggregate_all(count, p(_, K), Count),
+	(   thread_get_message(Done, done, [timeout(0)])
+	->  true
+	;   reader(Count, Done)
+	).
@@ -0,0 +1,135 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+:- module(test_engines, [test_engines/0]).
+:- use_module(library(plunit)).
+
+/** <module> Test Prolog engines
+
+This module tests engines: answer enumeration, posting terms, exceptions
+and cleanup.
+*/
+
+test_engines :-
+	run_tests([ engines
+		  ]).
+
+:- begin_tests(engines).
+
+test(next, Xs == [1,2,3]) :-
+	engine_create(X, member(X, [1,2,3]), E),
+	findall(X, next_answer(E, X), Xs),
+	engine_destroy(E).
+test(det, fail) :-
+	engine_create(X, X = 1, E),
+	engine_next(E, 1),
+	call_cleanup(engine_next(E, _), engine_destroy(E)).
+test(copy, T =@= a-_) :-
+	engine_create(X-Y, X = a, E),
+	engine_next(E, T),
+	engine_destroy(E),
+	assertion(var(X)),
+	assertion(var(Y)).
+test(module, Xs == [a,b]) :-
+	engine_create(X, local(X), E),
+	findall(X, next_answer(E, X), Xs),
+	engine_destroy(E).
+test(exception, error(type_error(evaluable, foo/0))) :-
+	engine_create(X, X is foo+1, E),
+	call_cleanup(engine_next(E, _), engine_destroy(E)).
+test(post, Sums == [1,3,6]) :-
+	engine_create(S, sum(0, S), E),
+	engine_post(E, 1, S1),
+	engine_post(E, 2, S2),
+	engine_post(E, 3, S3),
+	engine_destroy(E),
+	Sums = [S1,S2,S3].
+test(fetch, error(existence_error(term, E))) :-
+	engine_create(_, engine_fetch(_), E),
+	call_cleanup(engine_next(E, _), engine_destroy(E)).
+test(post, error(permission_error(post_to, engine, E))) :-
+	engine_create(_, engine_fetch(_), E),
+	engine_post(E, 1),
+	call_cleanup(engine_post(E, 2), engine_destroy(E)).
+test(alias, Self == my_engine) :-
+	engine_create(S, engine_self(S), E, [alias(my_engine)]),
+	assertion(E == my_engine),
+	engine_next(my_engine, Self),
+	engine_destroy(my_engine).
+test(self, fail) :-
+	engine_self(_).
+test(current, true) :-
+	engine_create(_, true, E),
+	assertion(current_engine(E)),
+	engine_destroy(E),
+	assertion(\+ current_engine(E)),
+	assertion(\+ is_engine(E)).
+test(destroyed, error(existence_error(engine, E))) :-
+	engine_create(_, true, E),
+	engine_destroy(E),
+	engine_next(E, _).
+test(running, error(permission_error(resume, engine, E))) :-
+	engine_create(X, (engine_self(S), engine_next(S, X)), E),
+	call_cleanup(engine_next(E, _), engine_destroy(E)).
+test(nested, X == 2) :-
+	engine_create(Y, (engine_create(Z, Z = 2, E2),
+			  engine_next(E2, Y),
+			  engine_destroy(E2)), E),
+	engine_next(E, X),
+	engine_destroy(E).
+test(many, true) :-
+	forall(between(1, 100, I),
+	       ( engine_create(I, true, E),
+		 engine_next(E, I),
+		 engine_destroy(E)
+	       )).
+test(thread, Xs == [1,2,3]) :-
+	engine_create(X, between(1, 3, X), E),
+	engine_next(E, X1),
+	thread_self(Me),
+	thread_create(( engine_next(E, X2),
+			thread_send_message(Me, answer(X2))
+		      ), Id, []),
+	thread_join(Id, Status),
+	assertion(Status == true),
+	thread_get_message(answer(X2)),
+	engine_next(E, X3),
+	engine_destroy(E),
+	Xs = [X1,X2,X3].
+
+next_answer(E, X) :-
+	engine_next(E, X0),
+	(   X = X0
+	;   next_answer(E, X)
+	).
+
+local(a).
+local(b).
+
+sum(S0, S) :-
+	engine_fetch(N),
+	S1 is S0+N,
+	(   S = S1
+	;   sum(S1, S)
+	).
+
+:- end_tests(engines).
@@ -0,0 +1,62 @@
+:- module(test_shared_assert,
+	  [ test_shared_assert/0,
+	    test_shared_assert/2
+	  ]).
+:- use_module(library(apply)).
+:- use_module(library(lists)).
+
+/** <module> Test concurrent assert and retract on a shared predicate
+
+Multiple threads append to the same dynamic predicate while another
+thread retracts.  Each writer must find all its clauses, in the order
+it added them.  A second round adds a reader that looks up clauses on
+the second argument, such that an index is created while the writers
+append.
+*/
+
+:- dynamic(ev/2).
+
+test_shared_assert :-
+	test_shared_assert(4, 10000).
+
+test_shared_assert(Threads, N) :-
+	round(Threads, N, []),
+	round(Threads, N, [reader]).
+
+round(Threads, N, Options) :-
+	retractall(ev(_,_)),
+	findall(Id,
+		( between(1, Threads, T),
+		  thread_create(writer(T, N), Id, [])
+		), Ids),
+	thread_create(retracter(N), Retracter, []),
+	(   memberchk(reader, Options)
+	->  thread_create(reader(N), Reader, []),
+	    Others = [Reader]
+	;   Others = []
+	),
+	append([Retracter|Ids], Others, All),
+	maplist(thread_join, All, Stats),
+	maplist(==(true), Stats),
+	forall(between(1, Threads, T),
+	       ( findall(I, ev(T,I), Is),
+		 numlist(1, N, Is)
+	       )),
+	predicate_property(ev(_,_), number_of_clauses(Count)),
+	Count =:= Threads*N,
+	retractall(ev(_,_)).
+
+writer(T, N) :-
+	forall(between(1, N, I),
+	       assertz(ev(T,I))).
+
+retracter(N) :-
+	forall(between(1, N, _),
+	       ( assertz(ev(0,x)),
+		 retract(ev(0,x))
+	       )),
+	\+ ev(0,_).
+
+reader(N) :-
+	forall(between(1, N, I),
+	       ( ev(_, I) -> true ; true )).
@@ -0,0 +1,117 @@
+:- module(test_shared_retract,
+	  [ test_shared_retract/0,
+	    test_shared_retract/3
+	  ]).
+
+/** <module> Test reclaiming clauses of a shared predicate
+
+Readers enumerate a dynamic predicate while a writer rotates its clauses
+by adding a copy and retracting the original.  Every snapshot must hold
+all values.  When the threads are done, the erased clauses must have
+been reclaimed.
+
+Leaving a frame on a predicate that is   static  but was dynamic may not
+allow reclaiming clauses that  are  still   used  by  a choicepoint. A
+thread waiting inside a dynamic predicate  may   not  delay  reclaiming
+clauses of other predicates.
+*/
+
+:- dynamic(item/1).
+:- dynamic(p/2, q/0).
+:- dynamic(hook/1, r/1).
+
+q.
+
+:- compile_predicates([q/0]).
+
+hook(Ready) :-
+	thread_send_message(Ready, parked),
+	thread_get_message(_),
+	atom(a).
+
+test_shared_retract :-
+	test_shared_retract(3, 100, 20000),
+	test_static_frame,
+	test_parked_frame(20000).
+
+test_shared_retract(Readers, N, Rotations) :-
+	retractall(item(_)),
+	forall(between(1, N, I), assertz(item(I))),
+	statistics(clauses, C0),
+	message_queue_create(Done),
+	findall(Id,
+		( between(1, Readers, _),
+		  thread_create(reader(N, Done), Id, [])
+		), Ids),
+	thread_create(writer(N, Rotations), Writer, []),
+	thread_join(Writer, WStat),
+	forall(member(_, Ids), thread_send_message(Done, done)),
+	maplist(thread_join, Ids, RStats),
+	message_queue_destroy(Done),
+	maplist(==(true), [WStat|RStats]),
+	forall(item(_), true),
+	statistics(clauses, C1),
+	C1 - C0 < Rotations//2,		% erased clauses are reclaimed
+	retractall(item(_)).
+
+writer(N, Rotations) :-
+	forall(between(1, Rotations, I),
+	       ( X is I mod N + 1,
+		 assertz(item(X)),
+		 retract(item(X))
+	       )).
+
+reader(N, Done) :-
+	numlist(1, N, All),
+	reader_loop(All, Done).
+
+reader_loop(All, Done) :-
+	findall(X, item(X), Xs),
+	sort(Xs, Sorted),
+	Sorted == All,
+	(   thread_get_message(Done, done, [timeout(0)])
+	->  true
+	;   reader_loop(All, Done)
+	).
+
+%%	test_static_frame
+%
+%	Backtrack into p/2 after q/0, which is static now, has been left
+%	and most clauses of p/2 have been retracted.
+
+test_static_frame :-
+	retractall(p(_,_)),
+	forall(between(1, 20, X), assertz(p(X, x))),
+	findall(X, static_frame(X), Xs),
+	numlist(1, 20, Xs),
+	retractall(p(_,_)).
+
+static_frame(X) :-
+	p(X, _),
+	q,
+	(   X == 1
+	->  forall(between(2, 20, Y), retract(p(Y, _))),
+	    forall(between(1, 2000, Y), assertz(p(0, Y)))
+	;   true
+	).
+
+%%	test_parked_frame(+N)
+%
+%	Assert and retract N clauses while another thread waits inside
+%	hook/1.  The erased clauses must be reclaimed.
+
+test_parked_frame(N) :-
+	message_queue_create(Ready),
+	thread_create(hook(Ready), Id, []),
+	thread_get_message(Ready, parked),
+	statistics(clauses, C0),
+	forall(between(1, N, I),
+	       ( assertz(r(I)),
+		 retract(r(I))
+	       )),
+	statistics(clauses, C1),
+	thread_send_message(Id, done),
+	thread_join(Id, Status),
+	message_queue_destroy(Ready),
+	Status == true,
+	C1 - C0 < N//2.
@@ -20,7 +20,8 @@ OBJ=	pl-atom.o pl-wam.o pl-arith.o pl-bag.o pl-error.o \
 	pl-init.o pl-gmp.o pl-segstack.o pl-hash.o \
 	pl-version.o pl-codetable.o pl-supervisor.o \
 	pl-dbref.o pl-termhash.o pl-variant.o \
-	pl-copyterm.o pl-debug.o pl-ressymbol.o pl-dict.o
+	pl-copyterm.o pl-debug.o pl-ressymbol.o pl-dict.o \
+	pl-tabling.o pl-trie.o
 
 # Prolog library
 
@@ -53,7 +54,7 @@ PLLIBS= MANUAL helpidx.pl help.pl explain.pl sort.pl \
 	prolog_colour.pl varnumbers.pl codesio.pl prolog_codewalk.pl \
 	prolog_pack.pl git.pl prolog_metainference.pl quasi_quotations.pl \
 	sandbox.pl prolog_format.pl prolog_install.pl check_installation.pl \
-	solution_sequences.pl iostream.pl
+	solution_sequences.pl iostream.pl tabling.pl
 
 CLP=	bounds.pl clp_events.pl clp_distinct.pl simplex.pl clpfd.pl clpb.pl
 DCG=	basics.pl
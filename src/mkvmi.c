@@ -38,26 +38,43 @@
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 This program creates pl-codetable.c, pl-jumptable.ic   and pl-vmi.h from
 pl-vmi.c.
+
+It also creates pl-vmi-super.ic, holding  the superinstructions listed in
+SUPERVMI. A superinstruction A__B is a copy  of  the implementation of A
+in which NEXT_INSTRUCTION is replaced by   SUPER_NEXT(B),  which skips
+the opcode of B and jumps directly  to the implementation of B. Longer
+sequences are handled by  jumping  to   the  superinstruction  for the
+remainder of the sequence. The  compiler   replaces  the  opcode of the
+first instruction  of  a  matching  sequence    by  the  opcode  of the
+superinstruction. The remainder of the code is not changed.  See
+pl-comp.c.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 const char *program;
 int verbose = 0;
 const char *vmi_file    = "pl-vmi.c";
+const char *super_file  = "SUPERVMI";
 const char *ctable_file = "pl-codetable.c";
 const char *jump_table  = "pl-jumptable.ic";
 const char *vmi_hdr	= "pl-vmi.h";
+const char *super_ic	= "pl-vmi-super.ic";
 
 #define MAX_VMI 1000
+#define MAX_SUPER_LEN 8
 
 typedef struct				/* VMI( */
 { char *name;				/* Name */
   char *flags;				/* Flags (VIF_*) */
   char *argc;				/* Argument length (or VM_DYNARGC) */
   char *args;				/* Argument types (max 3) */
+  char *body;				/* Implementation */
+  int   first;				/* Superinstruction: first VMI */
+  int   next;				/* Superinstruction: remainder */
 } vmi;					/* ) */
 
 vmi vmi_list[MAX_VMI];
 int vmi_count = 0;
+int super_start = 0;			/* Index of first superinstruction */
 
 char *synopsis;
 size_t syn_size = 0;
@@ -153,6 +170,17 @@ my_strndup(const char *in, size_t len)
 }
 
 
+static char *
+my_strcat(char *s1, const char *s2)	/* s1 is malloc'ed or NULL */
+{ size_t l1 = (s1 ? strlen(s1) : 0);
+  char *s = realloc(s1, l1+strlen(s2)+1);
+
+  strcpy(s+l1, s2);
+
+  return s;
+}
+
+
 static int
 load_vmis(const char *file)
 { FILE *fd = fopen(file, "r");
@@ -160,10 +188,20 @@ load_vmis(const char *file)
   if ( fd )
   { char buf[1024];
     int line = 0;
+    char *body = NULL;
 
     while(fgets(buf, sizeof(buf), fd))
     { line++;
 
+      if ( body )			/* collect body upto } in column 0 */
+      { body = my_strcat(body, buf);
+	if ( buf[0] == '}' )
+	{ vmi_list[vmi_count-1].body = body;
+	  body = NULL;
+	}
+	continue;
+      }
+
       if ( strncmp(buf, "VMI(", 4) == 0 )
       { const char *s1 = skip_ws(buf+4);
 	const char *e1 = skip_id(s1);
@@ -184,6 +222,9 @@ load_vmis(const char *file)
 	vmi_list[vmi_count].flags = my_strndup(s2, e2-s2);
 	vmi_list[vmi_count].argc  = my_strndup(s3, e3-s3);
 	vmi_list[vmi_count].args  = my_strndup(s4, e4-s4);
+	vmi_list[vmi_count].first = -1;
+	vmi_list[vmi_count].next  = -1;
+	body = my_strcat(NULL, "");
 
 	add_synopsis(s1, e1-s1);	/* flags (s2) isn't needed for VM signature */
 	add_synopsis(s3, e3-s3);
@@ -197,6 +238,242 @@ load_vmis(const char *file)
     return 0;
   }
 
+  return -1;
+}
+
+
+		 /*******************************
+		 *	SUPERINSTRUCTIONS	*
+		 *******************************/
+
+static int
+find_vmi(const char *name)
+{ int i;
+
+  for(i=0; i<vmi_count; i++)
+  { if ( strcmp(vmi_list[i].name, name) == 0 )
+      return i;
+  }
+
+  return -1;
+}
+
+
+static int
+is_id_char(int c)
+{ return c == '_' || isalnum(c);
+}
+
+
+static const char *
+skip_c_id(const char *s)
+{ while ( is_id_char(*s) )
+    s++;
+
+  return s;
+}
+
+
+static const char *
+find_token(const char *in, const char *token)
+{ size_t len = strlen(token);
+  const char *s;
+
+  for(s=in; (s=strstr(s, token)); s += len)
+  { if ( !is_id_char(s[len]) && (s == in || !is_id_char(s[-1])) )
+      return s;
+  }
+
+  return NULL;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+super_error() is called if the implementation of  a VMI cannot be copied
+into a superinstruction. This is the case if the implementation  defines
+a label, changes PC other than  by   reading  its  arguments or does not
+continue with the next instruction.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+super_error(const char *name, const char *msg)
+{ fprintf(stderr, "%s: %s: cannot be fused: %s\n", super_file, name, msg);
+  exit(1);
+}
+
+
+static void
+check_fusable(const vmi *v)
+{ const char *s;
+
+  for(s=v->body; *s; s++)
+  { if ( s[0] == 'P' && s[1] == 'C' && !is_id_char(s[2]) &&
+	 s > v->body && !is_id_char(s[-1]) && s[-1] != '.' && s[-1] != '>' )
+    { const char *e = skip_ws(s+2);
+
+      if ( !e )
+	break;
+      if ( (e[0] == '=' && e[1] != '=') ||
+	   ((e[0] == '+' || e[0] == '-') && e[1] == '=') ||
+	   (e[0] == '-' && e[1] == '-') )
+	super_error(v->name, "assigns PC");
+    }
+    if ( s[0] == '\n' )		/* label: at the start of a line */
+    { const char *b = skip_ws(s+1);
+      const char *e = (b ? skip_c_id(b) : NULL);
+
+      if ( e && e > b && e[0] == ':' && e[1] != ':' &&
+	   strncmp(b, "default", 7) != 0 )
+	super_error(v->name, "defines a label");
+    }
+  }
+}
+
+
+static char *
+replace_token(const char *in, const char *token, const char *by)
+{ char *out = my_strcat(NULL, "");
+  const char *s;
+
+  while( (s=find_token(in, token)) )
+  { char *pre = my_strndup(in, s-in);
+
+    out = my_strcat(out, pre);
+    out = my_strcat(out, by);
+    free(pre);
+    in = s+strlen(token);
+  }
+
+  return my_strcat(out, in);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+need_super() returns the index of  the   superinstruction  for  the VMI
+sequence `seq' of length `len', creating it and the superinstructions it
+depends on if needed.  If the first VMI   ends  in VMI_GOTO(Y) we use
+the superinstruction for Y followed by the remainder.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+need_super(int *seq, int len)
+{ char name[256];
+  char by[300];
+  const vmi *first = &vmi_list[seq[0]];
+  int i, next;
+  vmi *v;
+
+  name[0] = '\0';
+  for(i=0; i<len; i++)
+  { if ( i > 0 )
+      strcat(name, "__");
+    if ( strlen(name)+strlen(vmi_list[seq[i]].name) >= sizeof(name)-3 )
+      super_error(vmi_list[seq[0]].name, "sequence too long");
+    strcat(name, vmi_list[seq[i]].name);
+  }
+  if ( (i=find_vmi(name)) >= 0 )
+    return i;
+
+  if ( !first->body )
+    super_error(first->name, "no implementation");
+  check_fusable(first);
+  next = (len == 2 ? seq[1] : need_super(seq+1, len-1));
+
+  if ( find_token(first->body, "NEXT_INSTRUCTION") )
+  { snprintf(by, sizeof(by), "SUPER_NEXT(%s)", vmi_list[next].name);
+    by[sizeof(by)-1] = '\0';
+    v = &vmi_list[vmi_count];
+    v->body = replace_token(first->body, "NEXT_INSTRUCTION", by);
+  } else
+  { const char *g = find_token(first->body, "VMI_GOTO");
+    int gseq[MAX_SUPER_LEN+1];
+    char goto_name[100];
+    char *from;
+    const char *e;
+    int to;
+
+    if ( !g || find_token(g+1, "VMI_GOTO") )
+      super_error(first->name, "does not continue with the next instruction");
+    g = skip_ws(skip_over(g, '('));
+    e = skip_id(g);
+    snprintf(goto_name, sizeof(goto_name), "%.*s", (int)(e-g), g);
+    if ( (gseq[0]=find_vmi(goto_name)) < 0 )
+      super_error(first->name, "unknown VMI_GOTO() target");
+    for(i=1; i<len; i++)
+      gseq[i] = seq[i];
+    to = need_super(gseq, len);
+
+    from = my_strcat(my_strcat(my_strcat(NULL, "VMI_GOTO("), goto_name), ")");
+    snprintf(by, sizeof(by), "VMI_GOTO(%s)", vmi_list[to].name);
+    by[sizeof(by)-1] = '\0';
+    v = &vmi_list[vmi_count];
+    v->body = replace_token(first->body, from, by);
+    free(from);
+  }
+
+  if ( vmi_count >= MAX_VMI )
+  { fprintf(stderr, "Too many VMIs\n");
+    exit(1);
+  }
+  v->name  = strdup(name);
+  v->flags = first->flags;
+  v->argc  = first->argc;
+  v->args  = first->args;
+  v->first = (first->first >= 0 ? first->first : seq[0]);
+  v->next  = next;
+
+  return vmi_count++;
+}
+
+
+static int
+load_supers(const char *file)
+{ FILE *fd = fopen(file, "r");
+
+  if ( fd )
+  { char buf[1024];
+    int line = 0;
+
+    while(fgets(buf, sizeof(buf), fd))
+    { int seq[MAX_SUPER_LEN];
+      int len = 0;
+      char *s = buf;
+
+      line++;
+      for(;;)
+      { char *e;
+	char *id;
+
+	s = skip_ws(s);
+	if ( !s || !*s || *s == '\n' || *s == '#' )
+	  break;
+	e = skip_id(s);
+	if ( e == s || len == MAX_SUPER_LEN )
+	{ fprintf(stderr, "Syntax error at %s:%d\n", file, line);
+	  exit(1);
+	}
+	id = my_strndup(s, e-s);
+	if ( (seq[len] = find_vmi(id)) < 0 || seq[len] >= super_start )
+	{ fprintf(stderr, "%s:%d: unknown VMI %s\n", file, line, id);
+	  exit(1);
+	}
+	free(id);
+	len++;
+	s = e;
+      }
+
+      if ( len == 1 )
+      { fprintf(stderr, "%s:%d: need at least two VMIs\n", file, line);
+	exit(1);
+      } else if ( len > 1 )
+      { need_super(seq, len);
+      }
+    }
+
+    fclose(fd);
+    return 0;
+  }
+
   return -1;
 }
 
@@ -288,6 +565,17 @@ emit_code_table(const char *to)
   }
 
   fprintf(out, "  { NULL, 0, 0, 0, {0} }\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const super_info superTable[] = {\n");
+  fprintf(out, "  /* {ID, first, next} */\n");
+  for(i=super_start; i<vmi_count; i++)
+  { fprintf(out, "  {%s, %s, %s},\n",
+	    vmi_list[i].name,
+	    vmi_list[vmi_list[i].first].name,
+	    vmi_list[vmi_list[i].next].name);
+  }
+  fprintf(out, "  { 0, 0, 0 }\n");
   fprintf(out, "};\n");
   fclose(out);
 
@@ -350,6 +638,7 @@ emit_code_defs(const char *to)
   fprintf(out, "  VMI_END_LIST\n");
   fprintf(out, "} vmi;\n\n");
   fprintf(out, "#define I_HIGHEST ((int)VMI_END_LIST)\n");
+  fprintf(out, "#define I_SUPER_FIRST %d\n", super_start);
   fprintf(out, "#define VM_SIGNATURE 0x%x\n", MurmurHashAligned2(synopsis, syn_size, 0x12345678));
 
   fclose(out);
@@ -357,6 +646,32 @@ emit_code_defs(const char *to)
   return update_file(tmp, to);
 }
 
+static int
+emit_supers(const char *to)
+{ const char *tmp = "vmi.tmp";
+  FILE *out = fopen(tmp, "w");
+  int i;
+
+  fprintf(out, "/*  File: %s\n\n", to);
+  fprintf(out, "    This file provides the superinstructions from %s.\n", super_file);
+  fprintf(out, "\n");
+  fprintf(out, "    Note: this file is generated by %s from %s and %s.  DO NOT EDIT", program, vmi_file, super_file);
+  fprintf(out, "    \n");
+  fprintf(out, "*/\n");
+
+  for(i=super_start; i<vmi_count; i++)
+  { const vmi *v = &vmi_list[i];
+
+    fprintf(out, "\nVMI(%s, %s, %s, (%s))\n%s",
+	    v->name, v->flags, v->argc, v->args, v->body);
+  }
+
+  fclose(out);
+
+  return update_file(tmp, to);
+}
+
+
 int
 main(int argc, char **argv)
 { program = argv[0];
@@ -378,12 +693,16 @@ main(int argc, char **argv)
   }
 
   load_vmis(vmi_file);
+  super_start = vmi_count;
+  load_supers(super_file);
   if ( verbose )
-    fprintf(stderr, "Found %d VMs\n", vmi_count);
+    fprintf(stderr, "Found %d VMs and %d superinstructions\n",
+	    super_start, vmi_count-super_start);
 
   if ( emit_code_table(ctable_file) == 0 &&
        emit_jump_table(jump_table) == 0 &&
-       emit_code_defs(vmi_hdr) == 0 )
+       emit_code_defs(vmi_hdr) == 0 &&
+       emit_supers(super_ic) == 0 )
     return 0;
   else
     return 1;
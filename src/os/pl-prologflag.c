@@ -670,6 +670,14 @@ set_prolog_flag_unlocked(term_t key, term_t value, int flags)
 
       if ( !PL_get_int64_ex(value, &i) )
 	return FALSE;
+#ifdef O_PLMT
+      if ( k == ATOM_gc_threads )
+      { if ( i < 1 )
+	  return PL_error(NULL, 0, NULL, ERR_DOMAIN,
+			  ATOM_not_less_than_one, value);
+	GD->gc.threads = (int)i;
+      }
+#endif
       f->value.i = i;
 #ifdef O_ATOMGC
       if ( k == ATOM_agc_margin )
@@ -1166,7 +1174,13 @@ initPrologFlags(void)
 #endif
   setPrologFlag("unload_foreign_libraries", FT_BOOL, FALSE, 0);
   setPrologFlag("gc",	  FT_BOOL,	       TRUE,  PLFLAG_GC);
+  setPrologFlag("gc_generational", FT_BOOL,     TRUE,  PLFLAG_GC_GENERATIONAL);
+  setPrologFlag("gc_stress", FT_BOOL,	       FALSE, PLFLAG_GC_STRESS);
   setPrologFlag("trace_gc",  FT_BOOL,	       FALSE, PLFLAG_TRACE_GC);
+#ifdef O_PLMT
+  GD->gc.threads = 1;
+  setPrologFlag("gc_threads", FT_INTEGER,	       GD->gc.threads);
+#endif
 #ifdef O_ATOMGC
   setPrologFlag("agc_margin",FT_INTEGER,	       GD->atoms.margin);
 #endif
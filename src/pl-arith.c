@@ -100,7 +100,6 @@ problem.
 #endif
 #endif
 
-static int		ar_minus(Number n1, Number n2, Number r);
 static int		mul64(int64_t x, int64_t y, int64_t *r);
 
 		/********************************
@@ -1242,7 +1241,7 @@ pl_ar_add(Number n1, Number n2, Number r)
 }
 
 
-static int
+int
 ar_minus(Number n1, Number n2, Number r)
 { if ( !same_type_numbers(n1, n2) )
     return FALSE;
@@ -1320,7 +1319,7 @@ mod(int64_t x, int64_t y)
 }
 
 
-static int
+int
 ar_mod(Number n1, Number n2, Number r)
 { if ( !toIntegerNumber(n1, 0) )
     return PL_error("mod", 2, NULL, ERR_AR_TYPE, ATOM_integer, n1);
@@ -1494,13 +1493,13 @@ ar_shift(Number n1, Number n2, Number r, int dir)
 }
 
 
-static int
+int
 ar_shift_left(Number n1, Number n2, Number r)
 { return ar_shift(n1, n2, r, -1);
 }
 
 
-static int
+int
 ar_shift_right(Number n1, Number n2, Number r)
 { return ar_shift(n1, n2, r, 1);
 }
@@ -1580,7 +1579,7 @@ ar_gcd(Number n1, Number n2, Number r)
 
 #ifdef O_GMP
 #define BINAIRY_INT_FUNCTION(name, plop, op, mpop) \
-  static int \
+  int \
   name(Number n1, Number n2, Number r) \
   { if ( !toIntegerNumber(n1, 0) ) \
       return PL_error(plop, 2, NULL, ERR_AR_TYPE, ATOM_integer, n1); \
@@ -1607,7 +1606,7 @@ ar_gcd(Number n1, Number n2, Number r)
 #else /*O_GMP*/
 
 #define BINAIRY_INT_FUNCTION(name, plop, op, mpop) \
-  static int \
+  int \
   name(Number n1, Number n2, Number r) \
   { if ( !toIntegerNumber(n1, 0) ) \
       return PL_error(plop, 2, NULL, ERR_AR_TYPE, ATOM_integer, n1); \
@@ -1898,7 +1897,7 @@ need C99 for the wide-character  support   anyway,  we  should be fairly
 safe.
 */
 
-static int
+int
 ar_tdiv(Number n1, Number n2, Number r)
 { if ( !toIntegerNumber(n1, 0) )
     return PL_error("//", 2, NULL, ERR_AR_TYPE, ATOM_integer, n1);
@@ -2275,7 +2274,7 @@ ar_rdiv(Number n1, Number n2, Number r)
 #endif /*O_GMP*/
 
 
-static int
+int
 ar_divide(Number n1, Number n2, Number r)
 { GET_LD
 
@@ -2446,7 +2445,7 @@ ar_mul(Number n1, Number n2, Number r)
 }
 
 
-static int
+int
 ar_max(Number n1, Number n2, Number r)
 { int diff = cmpNumbers(n1, n2);
 
@@ -2459,7 +2458,7 @@ ar_max(Number n1, Number n2, Number r)
 }
 
 
-static int
+int
 ar_min(Number n1, Number n2, Number r)
 { int diff = cmpNumbers(n1, n2);
 
@@ -2760,7 +2759,7 @@ ar_eval(Number n1, Number r)
 }
 
 
-static int
+int
 ar_abs(Number n1, Number r)
 { switch(n1->type)
   { case V_INTEGER:
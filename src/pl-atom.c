@@ -40,6 +40,20 @@ Next, there is a hash-table, which is a normal `open' hash-table mapping
 char * to the atom structure. This   thing is dynamically rehashed. This
 table is used by lookupAtom() below.
 
+Looking up an existing atom does not  lock L_ATOM. Only adding an atom,
+rehashing the table and AGC lock.  This is safe because:
+
+  - New atoms are fully initialised before they are linked to the head
+    of their chain.
+  - rehashAtoms() builds a complete new table before publishing it and
+    publishes the table before the new number of buckets.  A reader
+    that combines an old bucket count with the new table may miss the
+    atom, after which it retries while holding L_ATOM.  The old table
+    is kept until the next AGC as readers may still be walking it.
+  - Atoms are only removed by AGC.  Before touching the table, AGC sets
+    GD->atoms.gc_active, which stops new lock-free lookups, and waits
+    for running lookups to finish (see waitForAtomLookups()).
+
 Atom garbage collection
 -----------------------
 
@@ -97,12 +111,13 @@ normal GC because the pointer relocation makes it extremely hard to find
 referenced atoms. Otherwise, ask all  threads   to  mark their reachable
 atoms and run collectAtoms() to reclaim the unreferenced atoms.
 
-On Unix, we signal all threads. Upon receiving the signal, they mark all
-accessible atoms and continue.  On  Windows,   we  have  no asynchronous
-signals, so we silence the threads one-by-one   and do the marking. This
-is realised by forThreadLocalData().  Note  that   this  means  only one
-thread is collecting  in  Windows.  This   could  be  enhanced  by using
-multiple threads during the collection phase.
+We do not stop the world. AGC raises SIG_ATOM_MARK in all threads. Each
+thread marks the atoms on  its  own  stacks   at  the  next  safe  point
+(markAtomsAtSafePoint()) and continues. Threads that  do not reach a safe
+point quickly are marked by the collecting thread, while they may resume
+running. See markAtomsThreads(). Once all  threads checked in, AGC calls
+collectAtoms() to reclaim the unmarked atoms. As threads mark in parallel,
+the time AGC needs does not grow with the number of threads.
 
 Note that threads can mark their atoms and continue execution because:
 
@@ -133,10 +148,21 @@ Note that threads can mark their atoms and continue execution because:
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static void	rehashAtoms(void);
+static void	freeOldAtomTables(void);
 
 #define atom_buckets GD->atoms.buckets
 #define atomTable    GD->atoms.table
 
+#if defined(O_PLMT) && defined(O_ATOMGC) && defined(ATOMIC_REFERENCES)
+#define O_LOCKFREE_ATOMS 1
+#endif
+
+typedef struct old_atom_table
+{ Atom *	table;			/* the replaced table */
+  unsigned int	buckets;		/* its size */
+  struct old_atom_table *next;		/* next one */
+} old_atom_table;
+
 #if O_DEBUG
 #define lookups GD->atoms.lookups
 #define	cmps	GD->atoms.cmps
@@ -367,6 +393,86 @@ PL_handle_signals() decides on the actual invocation of atom-gc and will
 treat the signal as bogus if agc has already been performed.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static inline void
+acquireFoundAtom(Atom a)
+{
+#ifdef O_ATOMGC
+  if ( indexAtom(a->atom) >= GD->atoms.builtin )
+  {
+#ifdef ATOMIC_REFERENCES
+    if ( ATOMIC_INC(&a->references) == 1 )
+      ATOMIC_DEC(&GD->atoms.unregistered);
+#else
+    if ( ++a->references == 1 )
+      GD->atoms.unregistered--;
+#endif
+  }
+#endif
+}
+
+
+static Atom
+findBlob(Atom a, const char *s, size_t length, PL_blob_t *type)
+{ if ( false(type, PL_BLOB_NOCOPY) )
+  { for(; a; a = a->next)
+    { DEBUG(MSG_HASH_STAT, cmps++);
+      if ( length == a->length &&
+	   type == a->type &&
+	   memcmp(s, a->name, length) == 0 )
+	return a;
+    }
+  } else
+  { for(; a; a = a->next)
+    { DEBUG(MSG_HASH_STAT, cmps++);
+      if ( length == a->length &&
+	   type == a->type &&
+	   s == a->name )
+	return a;
+    }
+  }
+
+  return NULL;
+}
+
+
+#ifdef O_LOCKFREE_ATOMS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+lookupBlobNoLock() searches for an existing  atom without locking L_ATOM.
+The thread announces  the  lookup  in   LD->atoms.lookup_active  and then
+verifies AGC is not running. AGC  does   the  reverse, so either we back
+off or AGC waits for us. See also the comments at the start of the file.
+The reference count is incremented  before   the  announcement  ends, so
+AGC cannot reclaim the atom we found.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Atom
+lookupBlobNoLock(const char *s, size_t length, PL_blob_t *type,
+		 unsigned int v0)
+{ GET_LD
+  Atom a = NULL;
+
+  if ( !HAS_LD )
+    return NULL;
+
+  LD->atoms.lookup_active = TRUE;
+  MemoryBarrier();
+  if ( !GD->atoms.gc_active )
+  { unsigned int buckets = atom_buckets;
+    Atom *table;
+
+    MemoryBarrier();			/* see rehashAtoms() */
+    table = atomTable;
+    if ( (a = findBlob(table[v0 & (buckets-1)], s, length, type)) )
+      acquireFoundAtom(a);
+  }
+  MemoryBarrier();
+  LD->atoms.lookup_active = FALSE;
+
+  return a;
+}
+#endif /*O_LOCKFREE_ATOMS*/
+
+
 word
 lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
 { unsigned int v0, v;
@@ -376,58 +482,28 @@ lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
     PL_register_blob_type(type);
   v0 = MurmurHashAligned2(s, length, MURMUR_SEED);
 
-  LOCK();
-  v  = v0 & (atom_buckets-1);
-  DEBUG(MSG_HASH_STAT, lookups++);
-
   if ( true(type, PL_BLOB_UNIQUE) )
-  { if ( false(type, PL_BLOB_NOCOPY) )
-    { for(a = atomTable[v]; a; a = a->next)
-      { DEBUG(MSG_HASH_STAT, cmps++);
-	if ( length == a->length &&
-	     type == a->type &&
-	     memcmp(s, a->name, length) == 0 )
-	{
-#ifdef O_ATOMGC
-	  if ( indexAtom(a->atom) >= GD->atoms.builtin )
-	  {
-#ifdef ATOMIC_REFERENCES
-	    if ( ATOMIC_INC(&a->references) == 1 )
-	      ATOMIC_DEC(&GD->atoms.unregistered);
-#else
-	    if ( ++a->references == 1 )
-	      GD->atoms.unregistered--;
-#endif
-	  }
+  {
+#ifdef O_LOCKFREE_ATOMS
+    if ( (a = lookupBlobNoLock(s, length, type, v0)) )
+    { *new = FALSE;
+      return a->atom;
+    }
 #endif
-          UNLOCK();
-	  *new = FALSE;
-	  return a->atom;
-	}
-      }
-    } else
-    { for(a = atomTable[v]; a; a = a->next)
-      { DEBUG(MSG_HASH_STAT, cmps++);
 
-	if ( length == a->length &&
-	     type == a->type &&
-	     s == a->name )
-	{
-#ifdef O_ATOMGC
-#ifdef ATOMIC_REFERENCES
-	  if ( ATOMIC_INC(&a->references) == 1 )
-	    ATOMIC_DEC(&GD->atoms.unregistered);
-#else
-	  if ( a->references++ == 0 )
-	    GD->atoms.unregistered--;
-#endif
-#endif
-          UNLOCK();
-	  *new = FALSE;
-	  return a->atom;
-	}
-      }
+    LOCK();
+    v = v0 & (atom_buckets-1);
+    DEBUG(MSG_HASH_STAT, lookups++);
+
+    if ( (a = findBlob(atomTable[v], s, length, type)) )
+    { acquireFoundAtom(a);
+      UNLOCK();
+      *new = FALSE;
+      return a->atom;
     }
+  } else
+  { LOCK();
+    v = v0 & (atom_buckets-1);
   }
 
   a = allocHeapOrHalt(sizeof(struct atom));
@@ -458,6 +534,7 @@ lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
   registerAtom(a);
   if ( true(type, PL_BLOB_UNIQUE) )
   { a->next       = atomTable[v];
+    MemoryBarrier();			/* lock-free readers */
     atomTable[v]  = a;
   }
   GD->statistics.atoms++;
@@ -819,12 +896,17 @@ pl_garbage_collect_atoms(void)
   PL_LOCK(L_STOPTHEWORLD);
   LOCK();
   GD->atoms.gc_active = TRUE;
+#ifdef O_LOCKFREE_ATOMS
+  MemoryBarrier();
+  waitForAtomLookups();
+  freeOldAtomTables();
+#endif
   blockSignals(&set);
   t = CpuTime(CPU_USER);
   unmarkAtoms();
   markAtomsOnStacks(LD);
 #ifdef O_PLMT
-  forThreadLocalDataUnsuspended(markAtomsOnStacks, 0);
+  markAtomsThreads();
   markAtomsMessageQueues();
 #endif
   oldcollected = GD->atoms.collected;
@@ -1002,7 +1084,9 @@ PL_unregister_atom(atom_t a)
 static void
 rehashAtoms(void)
 { Atom *oldtab   = atomTable;
-  int   oldbucks = atom_buckets;
+  unsigned int oldbucks = atom_buckets;
+  unsigned int newbucks = oldbucks*2;
+  Atom *newtab;
   uintptr_t mask;
   size_t index;
   int i, last=FALSE;
@@ -1010,13 +1094,12 @@ rehashAtoms(void)
   if ( GD->cleaning != CLN_NORMAL )
     return;				/* no point anymore and foreign ->type */
 					/* pointers may have gone */
-  atom_buckets *= 2;
-  mask = atom_buckets-1;
-  atomTable = allocHeapOrHalt(atom_buckets * sizeof(Atom));
-  memset(atomTable, 0, atom_buckets * sizeof(Atom));
+  mask = newbucks-1;
+  newtab = allocHeapOrHalt(newbucks * sizeof(Atom));
+  memset(newtab, 0, newbucks * sizeof(Atom));
 
   DEBUG(MSG_HASH_STAT,
-	Sdprintf("rehashing atoms (%d --> %d)\n", oldbucks, atom_buckets));
+	Sdprintf("rehashing atoms (%d --> %d)\n", oldbucks, newbucks));
 
   for(index=1, i=0; !last; i++)
   { size_t upto = (size_t)2<<i;
@@ -1033,13 +1116,47 @@ rehashAtoms(void)
       if ( a && true(a->type, PL_BLOB_UNIQUE) )
       { size_t v = a->hash_value & mask;
 
-	a->next = atomTable[v];
-	atomTable[v] = a;
+	a->next = newtab[v];
+	newtab[v] = a;
       }
     }
   }
 
+  MemoryBarrier();			/* table before the bucket count */
+  atomTable = newtab;
+  MemoryBarrier();
+  atom_buckets = newbucks;
+
+#ifdef O_LOCKFREE_ATOMS
+  { old_atom_table *old = allocHeapOrHalt(sizeof(*old));
+
+    old->table   = oldtab;
+    old->buckets = oldbucks;
+    old->next    = GD->atoms.old_tables;
+    GD->atoms.old_tables = old;
+  }
+#else
   freeHeap(oldtab, oldbucks * sizeof(Atom));
+#endif
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+freeOldAtomTables() discards the tables replaced   by rehashAtoms(). This
+is only safe if no thread  can  be   walking  them,  i.e., from AGC after
+waitForAtomLookups() and at shutdown.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+freeOldAtomTables(void)
+{ old_atom_table *old, *next;
+
+  for(old = GD->atoms.old_tables; old; old = next)
+  { next = old->next;
+    freeHeap(old->table, old->buckets * sizeof(Atom));
+    freeHeap(old, sizeof(*old));
+  }
+  GD->atoms.old_tables = NULL;
 }
 
 
@@ -1244,6 +1361,7 @@ cleanupAtoms(void)
   { freeHeap(atomTable, atom_buckets * sizeof(Atom));
     atomTable = NULL;
   }
+  freeOldAtomTables();
 }
 
 
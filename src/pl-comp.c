@@ -47,6 +47,9 @@
 #define valHandleP(h)		valTermRef(h)
 
 static void	initVMIMerge(void);
+#if VMCODE_IS_ADDRESS
+static void	initSuperInstructions(void);
+#endif
 
 static void
 checkCodeTable(void)
@@ -139,6 +142,7 @@ initWamTable(void)
   checkCodeTable();
   initSupervisors();
   initVMIMerge();
+  initSuperInstructions();
 }
 
 #else /* VMCODE_IS_ADDRESS */
@@ -153,6 +157,129 @@ initWamTable()
 #endif /* VMCODE_IS_ADDRESS */
 
 
+		 /*******************************
+		 *	SUPERINSTRUCTIONS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The superinstructions from SUPERVMI  (see   mkvmi.c)  are introduced
+after a clause has been  compiled  or   loaded.  fuseClause()  replaces
+the opcode of the first instruction of the longest matching sequence by
+the opcode of the superinstruction.  The   arguments  and the remaining
+instructions of the sequence are not   changed  and decode() maps the
+superinstruction to its first instruction.  Code   that  walks  the VM
+code therefore sees the  plain  instructions,   while  the  VM executes
+the sequence using a single dispatch.
+
+A superinstruction jumps directly to the implementation of the next
+instruction and thus ignores a break-point  on   it.  setBreak()  uses
+unfuseClause() to restore the plain instructions when the first break
+point is set on a clause.
+
+Superinstructions are not used if  VM   codes  are not addresses because
+decode() cannot map them.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if VMCODE_IS_ADDRESS
+static char starts_super[I_HIGHEST];	/* op starts a superinstruction */
+
+static void
+initSuperInstructions(void)
+{ const super_info *si;
+
+  for(si = superTable; si->code; si++)
+  { assert(si == &superTable[si->code-I_SUPER_FIRST]);
+
+    dewam_table[wam_table[si->code]-dewam_table_offset] =
+	(unsigned char)si->first;
+    starts_super[si->first] = TRUE;
+  }
+}
+
+
+/* super_length() returns the number of instructions matched by the
+   superinstruction op at PC or 0 if op does not match.
+*/
+
+static int
+super_length(vmi op, Code PC, Code end)
+{ int len = 0;
+
+  for(;;)
+  { const super_info *si = &superTable[op-I_SUPER_FIRST];
+
+    if ( decode(*PC) != si->first )
+      return 0;
+    len++;
+    if ( (PC = stepPC(PC)) >= end )
+      return 0;
+
+    if ( (int)si->next < I_SUPER_FIRST )
+      return decode(*PC) == si->next ? len+1 : 0;
+    op = si->next;
+  }
+}
+
+
+void
+fuseClause(Clause clause)
+{ Code PC  = clause->codes;
+  Code end = &PC[clause->code_size];
+
+  for( ; PC < end; PC = stepPC(PC) )
+  { vmi op = decode(*PC);
+
+    if ( starts_super[op] )
+    { const super_info *si;
+      int best_len = 0;
+      vmi best = op;
+
+      for(si = superTable; si->code; si++)
+      { if ( si->first == op )
+	{ int len = super_length(si->code, PC, end);
+
+	  if ( len > best_len )
+	  { best_len = len;
+	    best = si->code;
+	  }
+	}
+      }
+
+      if ( best_len )
+	*PC = encode(best);
+    }
+  }
+}
+
+
+void
+unfuseClause(Clause clause)
+{ Code PC  = clause->codes;
+  Code end = &PC[clause->code_size];
+
+  for( ; PC < end; PC = stepPC(PC) )
+  { code c = encode(decode(*PC));
+
+    if ( *PC != c )
+      *PC = c;
+  }
+}
+
+#else /*VMCODE_IS_ADDRESS*/
+
+void
+fuseClause(Clause clause)
+{
+}
+
+void
+unfuseClause(Clause clause)
+{
+}
+
+#endif /*VMCODE_IS_ADDRESS*/
+
+
 		 /*******************************
 		 *     WARNING DECLARATIONS	*
 		 *******************************/
@@ -1041,6 +1168,9 @@ Variable table operations.
 forwards int	compileBody(Word, code, compileInfo * ARG_LD);
 forwards int	compileArgument(Word, int, compileInfo * ARG_LD);
 forwards int	compileSubClause(Word, code, compileInfo *);
+#ifdef O_INLINE_CALLS
+forwards int	compileInlined(Word, code, compileInfo * ARG_LD);
+#endif
 forwards bool	isFirstVarSet(VarTable vt, int n);
 forwards int	balanceVars(VarTable, VarTable, compileInfo *);
 forwards void	orVars(VarTable, VarTable);
@@ -1488,6 +1618,166 @@ Output_0(CompileInfo ci, vmi c)
 		 *	CODE GENERATION		*
 		 *******************************/
 
+#ifdef O_DET_GUARDS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Determinism guards.  If we are optimising, the  leading  type  tests and
+comparisons of a clause body form its guard.  The guard is compiled as
+usual, followed by
+
+	I_GUARD <generation> <literal1> <literal2>
+
+where the literals  describe  up  to  two  guard  goals  whose operands
+are head arguments or small integers (see GL_* in pl-incl.h). When the
+supervisor is created,  markGuardCommits()  in  pl-supervisor.c  sets the
+generation of clauses whose guard excludes  all  remaining  clauses.  If
+the generation is still valid, I_GUARD cuts the clause choicepoint.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_GUARD_GOALS 16
+
+static int
+guardTest(functor_t fd)
+{ switch(fd)
+  { case FUNCTOR_var1:		   return GL_VAR;
+    case FUNCTOR_nonvar1:	   return GL_NONVAR;
+    case FUNCTOR_atom1:		   return GL_ATOM;
+    case FUNCTOR_atomic1:	   return GL_ATOMIC;
+    case FUNCTOR_number1:	   return GL_NUMBER;
+    case FUNCTOR_integer1:	   return GL_INTEGER;
+    case FUNCTOR_float1:	   return GL_FLOAT;
+    case FUNCTOR_string1:	   return GL_STRING;
+    case FUNCTOR_compound1:	   return GL_COMPOUND;
+    case FUNCTOR_is_list1:	   return GL_IS_LIST;
+    case FUNCTOR_strict_equal2:	   return GL_EQ;
+    case FUNCTOR_not_strict_equal2: return GL_NEQ;
+    case FUNCTOR_smaller2:	   return GL_AR_LT;
+    case FUNCTOR_smaller_equal2:   return GL_AR_LE;
+    case FUNCTOR_larger2:	   return GL_AR_GT;
+    case FUNCTOR_larger_equal2:	   return GL_AR_GE;
+    case FUNCTOR_ar_equals2:	   return GL_AR_EQ;
+    case FUNCTOR_ar_not_equal2:	   return GL_AR_NE;
+    default:			   return 0;
+  }
+}
+
+
+static int
+isSystemGoal(functor_t fd, Module m)
+{ Procedure proc;
+
+  if ( (proc = isCurrentProcedure(fd, m)) &&
+       ( isDefinedProcedure(proc) ||
+	 true(proc->definition, P_REDEFINED) ) )
+    return proc->definition->module == MODULE_system;
+
+  return TRUE;
+}
+
+
+static int
+guardOperand(Word p, Word head, size_t arity ARG_LD)
+{ deRef(p);
+
+  if ( isVar(*p) )
+  { size_t i;
+
+    for(i=0; i<arity && i<GL_ISARG; i++)
+    { Word a = argTermP(*head, i);
+
+      deRef(a);
+      if ( a == p )
+	return (int)(GL_ISARG|i);
+    }
+  } else if ( isTaggedInt(*p) )
+  { intptr_t v = valInt(*p);
+
+    if ( v >= -GL_MAXINT-1 && v <= GL_MAXINT )
+      return (int)(v & 0x7ff);
+  }
+
+  return -1;
+}
+
+
+/* guardLiterals() returns the number of goals in the guard of body and
+   fills lits with the literals for I_GUARD.  It is called before
+   analyse_variables() replaces the variables of the clause.
+*/
+
+static int
+guardLiterals(Word head, Word body, Module m, code *lits ARG_LD)
+{ size_t arity;
+  int ngoals = 0, nlits = 0, raise = FALSE;
+
+  lits[0] = lits[1] = 0;
+  if ( !isTerm(*head) )
+    return 0;
+  arity = arityTerm(*head);
+
+  for(;;)
+  { Word goal;
+    functor_t fd;
+    int op, a1, a2 = 0;
+
+    deRef(body);
+    if ( hasFunctor(*body, FUNCTOR_comma2) )
+    { goal = argTermP(*body, 0);
+      deRef(goal);
+    } else
+      goal = body;
+
+    if ( ngoals == MAX_GUARD_GOALS || !isTerm(*goal) ||
+	 !(op = guardTest((fd=functorTerm(*goal)))) ||
+	 !isSystemGoal(fd, m) )
+      break;
+
+    ngoals++;
+    if ( nlits < 2 &&
+	 (a1 = guardOperand(argTermP(*goal, 0), head, arity PASS_LD)) >= 0 &&
+	 ( op <= GL_IS_LIST
+	     ? (a1&GL_ISARG)
+	     : (a2 = guardOperand(argTermP(*goal, 1), head, arity PASS_LD)) >= 0 ) )
+      lits[nlits++] = GL_LITERAL(op, a1, a2)|(raise ? GL_RAISE : 0);
+    if ( op >= GL_AR_LT )		/* arithmetic may raise */
+      raise = TRUE;
+
+    if ( goal == body )
+      break;
+    body = argTermP(*body, 1);
+  }
+
+  return nlits > 0 ? ngoals : 0;
+}
+
+
+static int
+compileGuardedBody(Word body, int ngoals, const code *lits,
+		   compileInfo *ci ARG_LD)
+{ int rc;
+
+  for(; ngoals > 0; ngoals--)
+  { deRef(body);
+    if ( hasFunctor(*body, FUNCTOR_comma2) )
+    { if ( (rc=compileBody(argTermP(*body, 0), I_CALL, ci PASS_LD)) != TRUE )
+	return rc;
+      body = argTermP(*body, 1);
+    } else
+    { if ( (rc=compileBody(body, I_CALL, ci PASS_LD)) != TRUE )
+	return rc;
+      body = NULL;
+      break;
+    }
+  }
+
+  Output_3(ci, I_GUARD, (code)0, lits[0], lits[1]);
+  if ( body )
+    return compileBody(body, I_DEPART, ci PASS_LD);
+
+  return TRUE;
+}
+#endif /*O_DET_GUARDS*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Clause	compileClause(Word head, Word body, Procedure proc, Module module)
 
@@ -1532,6 +1822,10 @@ compileClause(Clause *cp, Word head, Word body,
   struct clause clause;
   Clause cl;
   int rc;
+#ifdef O_DET_GUARDS
+  int nguards = 0;
+  code guards[2];
+#endif
 
   if ( head )
   { ci.islocal      = FALSE;
@@ -1565,6 +1859,13 @@ compileClause(Clause *cp, Word head, Word body,
   ci.warning_list    = warnings;
   ci.warnings        = NULL;
 
+#ifdef O_DET_GUARDS
+  if ( head && body && *body != ATOM_true &&
+       truePrologFlag(PLFLAG_OPTIMISE) &&
+       false(proc->definition, P_DYNAMIC|P_THREAD_LOCAL|P_MULTIFILE) )
+    nguards = guardLiterals(head, body, module, guards PASS_LD);
+#endif
+
   if ( (rc=analyse_variables(head, body, &ci PASS_LD)) < 0 )
   { switch ( rc )
     { case CYCLIC_HEAD:
@@ -1638,7 +1939,13 @@ that have an I_CONTEXT because we need to reset the context.
     }
 
     bi = PC(&ci);
-    if ( (rc=compileBody(body, I_DEPART, &ci PASS_LD)) != TRUE )
+#ifdef O_DET_GUARDS
+    if ( nguards > 0 )
+      rc = compileGuardedBody(body, nguards, guards, &ci PASS_LD);
+    else
+#endif
+      rc = compileBody(body, I_DEPART, &ci PASS_LD);
+    if ( rc != TRUE )
     { if ( rc == NOT_CALLABLE )
       {	resetVars(PASS_LD1);
 	rc = PL_error(NULL, 0, NULL, ERR_TYPE,
@@ -1681,6 +1988,7 @@ Finish up the clause.
     ATOMIC_ADD(&m->code_size, clsize);
     memcpy(cl, &clause, sizeofClause(0));
     memcpy(cl->codes, baseBuffer(&ci.codes, code), sizeOfBuffer(&ci.codes));
+    fuseClause(cl);
 
     GD->statistics.codes += clause.code_size;
   } else
@@ -1720,6 +2028,7 @@ Finish up the clause.
     cref->value.clause = cl = (Clause)p;
     memcpy(cl, &clause, sizeofClause(0));
     memcpy(cl->codes, baseBuffer(&ci.codes, code), sizeOfBuffer(&ci.codes));
+    fuseClause(cl);
     p = addPointer(p, sizeofClause(clause.code_size));
     cl->variables += (int)(p-p0);
 
@@ -1827,6 +2136,11 @@ right_argument:
   { functor_t fd = functorTerm(*body);
     FunctorDef fdef = valueFunctor(fd);
 
+#ifdef O_INLINE_CALLS
+    if ( fd == FUNCTOR_dinline3 )		/* see inlineCalls() */
+      return compileInlined(body, call, ci PASS_LD);
+#endif
+
     if ( true(fdef, CONTROL_F) )
     { if ( fd == FUNCTOR_comma2 )			/* A , B */
       { int rv;
@@ -2014,6 +2328,71 @@ right_argument:
 }
 
 
+#ifdef O_INLINE_CALLS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compileInlined() compiles '$inline'(Goal, Generation, Inlined) as created
+by inlineCalls() into
+
+	I_INLINED <proc> <generation> <jmp1> <Inlined> C_JMP <jmp2> <Goal>
+
+For the variable administration this is the same as (Inlined ; Goal). If
+the term is not what inlineCalls() creates, we simply compile Goal.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+compileInlined(Word arg, code call, compileInfo *ci ARG_LD)
+{ Word goal = argTermP(*arg, 0);
+  Word gen  = argTermP(*arg, 1);
+  Word exp  = argTermP(*arg, 2);
+  Procedure proc = NULL;
+  VarTable vsave, valt1, valt2;
+  size_t tc_skip, tc_jmp;
+  int rv;
+
+  deRef(goal);
+  deRef(gen);
+  if ( !ci->islocal &&
+       ci->colon_context.type == TM_NONE &&
+#ifdef O_CALL_AT_MODULE
+       ci->at_context.type == TM_NONE &&
+#endif
+       isTaggedInt(*gen) )
+  { if ( isTerm(*goal) )
+      proc = isCurrentProcedure(functorTerm(*goal), ci->module);
+    else if ( isTextAtom(*goal) )
+      proc = isCurrentProcedure(lookupFunctorDef(*goal, 0), ci->module);
+  }
+  if ( !proc )
+    return compileBody(goal, call, ci PASS_LD);
+
+  vsave = mkCopiedVarTable(ci->used_var);
+  valt1 = mkCopiedVarTable(ci->used_var);
+  valt2 = mkCopiedVarTable(ci->used_var);
+  setVars(exp, valt1 PASS_LD);
+  setVars(goal, valt2 PASS_LD);
+
+  Output_3(ci, I_INLINED, (code)proc, (code)valInt(*gen), (code)0);
+  tc_skip = PC(ci);
+  if ( (rv=compileBody(exp, I_CALL, ci PASS_LD)) != TRUE )
+    return rv;
+  balanceVars(valt1, valt2, ci);
+  Output_1(ci, C_JMP, (code)0);
+  tc_jmp = PC(ci);
+  OpCode(ci, tc_skip-1) = (code)(PC(ci) - tc_skip);
+  copyVarTable(ci->used_var, vsave);
+  if ( (rv=compileBody(goal, call, ci PASS_LD)) != TRUE )
+    return rv;
+  balanceVars(valt2, valt1, ci);
+  OpCode(ci, tc_jmp-1) = (code)(PC(ci) - tc_jmp);
+
+  orVars(valt1, valt2);
+  copyVarTable(ci->used_var, valt1);
+
+  succeed;
+}
+#endif /*O_INLINE_CALLS*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 compileArgument() is the key function of the compiler.  Its function  is
 to   generate  the  term  matching/construction  instructions  both  for
@@ -2589,7 +2968,7 @@ appropriate calling instruction.
       { if ( fdef->arity == 1 )
 	  Output_0(ci, I_USERCALL0);
 	else
-	  Output_1(ci, I_USERCALLN, (code)(fdef->arity - 1));
+	  Output_2(ci, I_USERCALLN, (code)(fdef->arity - 1), (code)0);
 	return TRUE;
       }
     }
@@ -2761,6 +3140,242 @@ compileArith(Word arg, compileInfo *ci ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+isFloatArith() is true if the arithmetic expression  arg  is known to
+evaluate to a float: a float constant, a function that always returns a
+float or +, -, * or / where one of the operands is a float expression.
+Such operations are compiled to A_FADD, etc., which implement the float
+case without calling the  generic  functions.   These  instructions are
+correct for any type of operand, so this is a heuristic.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+isFloatArith(Word arg ARG_LD)
+{ functor_t fdef;
+
+  deRef(arg);
+  if ( isFloat(*arg) )
+    return TRUE;
+  if ( isTextAtom(*arg) )
+    fdef = lookupFunctorDef(*arg, 0);
+  else if ( isTerm(*arg) )
+    fdef = functorTerm(*arg);
+  else
+    return FALSE;
+
+  switch(fdef)
+  { case FUNCTOR_plus2:
+    case FUNCTOR_minus2:
+    case FUNCTOR_star2:
+    case FUNCTOR_divide2:
+      return ( isFloatArith(argTermP(*arg, 0) PASS_LD) ||
+	       isFloatArith(argTermP(*arg, 1) PASS_LD) );
+    case FUNCTOR_minus1:
+    case FUNCTOR_plus1:
+    case FUNCTOR_abs1:
+      return isFloatArith(argTermP(*arg, 0) PASS_LD);
+    case FUNCTOR_float1:
+    case FUNCTOR_sqrt1:
+    case FUNCTOR_sin1:
+    case FUNCTOR_cos1:
+    case FUNCTOR_tan1:
+    case FUNCTOR_asin1:
+    case FUNCTOR_acos1:
+    case FUNCTOR_atan1:
+    case FUNCTOR_atan2:
+    case FUNCTOR_atan22:
+    case FUNCTOR_sinh1:
+    case FUNCTOR_cosh1:
+    case FUNCTOR_tanh1:
+    case FUNCTOR_asinh1:
+    case FUNCTOR_acosh1:
+    case FUNCTOR_atanh1:
+    case FUNCTOR_log1:
+    case FUNCTOR_log101:
+    case FUNCTOR_exp1:
+    case FUNCTOR_erf1:
+    case FUNCTOR_erfc1:
+    case FUNCTOR_lgamma1:
+    case FUNCTOR_copysign2:
+    case FUNCTOR_pi0:
+    case FUNCTOR_e0:
+    case FUNCTOR_epsilon0:
+    case FUNCTOR_random_float0:
+    case FUNCTOR_cputime0:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+floatArithVMI() and intArithVMI() map an arithmetic function to the
+instruction that implements it with a fast path for floats or 64-bit
+integers.  If constarg is TRUE, intArithVMI() returns the A_*_C variant
+that takes its right operand from the code.  Both return I_HIGHEST if
+there is no such instruction.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static vmi
+floatArithVMI(functor_t fdef)
+{ switch(fdef)
+  { case FUNCTOR_plus2:   return A_FADD;
+    case FUNCTOR_minus2:  return A_FSUB;
+    case FUNCTOR_star2:   return A_FMUL;
+    case FUNCTOR_divide2: return A_FDIV;
+    default:		  return I_HIGHEST;
+  }
+}
+
+
+static vmi
+intArithVMI(functor_t fdef, int constarg)
+{ switch(fdef)
+  { case FUNCTOR_plus2:   return constarg ? A_ADD_C  : A_ADD;
+    case FUNCTOR_minus2:  return constarg ? A_SUB_C  : A_SUB;
+    case FUNCTOR_star2:   return constarg ? A_MUL_C  : A_MUL;
+    case FUNCTOR_gdiv2:   return constarg ? A_IDIV_C : A_IDIV;
+    case FUNCTOR_mod2:    return constarg ? A_MOD_C  : A_MOD;
+    case FUNCTOR_rshift2: return constarg ? A_SHR_C  : A_SHR;
+    case FUNCTOR_lshift2: return constarg ? A_SHL_C  : A_SHL;
+    case FUNCTOR_and2:    return constarg ? A_AND_C  : A_AND;
+    case FUNCTOR_bitor2:  return constarg ? A_OR_C   : A_OR;
+    case FUNCTOR_xor2:    return constarg ? A_XOR_C  : A_XOR;
+    case FUNCTOR_min2:    return constarg ? I_HIGHEST : A_MIN;
+    case FUNCTOR_max2:    return constarg ? I_HIGHEST : A_MAX;
+    default:		  return I_HIGHEST;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+arithConstant() is true if the code from pc to end is a single A_INTEGER
+or A_DOUBLE instruction, filling n with its value.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+arithConstant(compileInfo *ci, size_t pc, size_t end, Number n)
+{ if ( end == pc+2 && OpCode(ci, pc) == encode(A_INTEGER) )
+  { n->value.i = (intptr_t)OpCode(ci, pc+1);
+    n->type    = V_INTEGER;
+    return TRUE;
+  }
+  if ( end == pc+1+WORDS_PER_DOUBLE && OpCode(ci, pc) == encode(A_DOUBLE) )
+  { Word p = &n->value.w[0];
+    Code c = &OpCode(ci, pc+1);
+
+    cpDoubleData(p, c);
+    n->type = V_FLOAT;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+foldArithConstants() folds  constant  sub-expressions.  It  is  called
+after the arguments of fdef have been  compiled,  the first starting at
+pc0 and the second at pc1.  If all   arguments  compiled to a constant,
+the function is evaluated now and the  code is replaced by the result.
+We only fold functions whose result is   fully  determined by the
+arguments: not / and ** that depend on   flags, nor random/1, etc. If
+the function raises an error we do  not  fold,  such  that the error is
+raised at runtime.  Results that  are  not   a  float  or a word-sized
+integer are not folded either.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+foldableArithFunction(functor_t fdef)
+{ switch(fdef)
+  { case FUNCTOR_plus2:
+    case FUNCTOR_minus2:
+    case FUNCTOR_star2:
+    case FUNCTOR_gdiv2:
+    case FUNCTOR_div2:
+    case FUNCTOR_mod2:
+    case FUNCTOR_rem2:
+    case FUNCTOR_min2:
+    case FUNCTOR_max2:
+    case FUNCTOR_rshift2:
+    case FUNCTOR_lshift2:
+    case FUNCTOR_and2:
+    case FUNCTOR_bitor2:
+    case FUNCTOR_xor2:
+    case FUNCTOR_minus1:
+    case FUNCTOR_plus1:
+    case FUNCTOR_abs1:
+    case FUNCTOR_sign1:
+    case FUNCTOR_backslash1:
+    case FUNCTOR_integer1:
+    case FUNCTOR_float1:
+    case FUNCTOR_truncate1:
+    case FUNCTOR_floor1:
+    case FUNCTOR_ceiling1:
+    case FUNCTOR_sqrt1:
+    case FUNCTOR_sin1:
+    case FUNCTOR_cos1:
+    case FUNCTOR_tan1:
+    case FUNCTOR_exp1:
+    case FUNCTOR_log1:
+    case FUNCTOR_pi0:
+    case FUNCTOR_e0:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+
+static int
+foldArithConstants(functor_t fdef, int index, int ar, size_t pc0, size_t pc1,
+		   compileInfo *ci ARG_LD)
+{ number argv[2];
+  Number r;
+  int n, rc = FALSE;
+
+  if ( !foldableArithFunction(fdef) )
+    return FALSE;
+  if ( ar > 0 &&
+       !arithConstant(ci, pc0, ar == 1 ? PC(ci) : pc1, &argv[0]) )
+    return FALSE;
+  if ( ar > 1 &&
+       !arithConstant(ci, pc1, PC(ci), &argv[1]) )
+    return FALSE;
+
+  for(n=0; n<ar; n++)
+    pushArithStack(&argv[n] PASS_LD);
+  if ( !ar_func_n(index, ar PASS_LD) )
+  { PL_clear_exception();
+    return FALSE;
+  }
+
+  r = argvArithStack(1 PASS_LD);
+  switch(r->type)
+  { case V_INTEGER:
+#if SIZEOF_VOIDP < 8
+      if ( r->value.i < LONG_MIN || r->value.i > LONG_MAX )
+	break;
+#endif
+      seekBuffer(&ci->codes, pc0, code);
+      Output_1(ci, A_INTEGER, (code)r->value.i);
+      rc = TRUE;
+      break;
+    case V_FLOAT:
+      seekBuffer(&ci->codes, pc0, code);
+      Output_n(ci, A_DOUBLE, r->value.w, WORDS_PER_DOUBLE);
+      rc = TRUE;
+      break;
+    default:
+      break;
+  }
+  popArgvArithStack(1 PASS_LD);
+
+  return rc;
+}
+
+
 static int
 compileArithArgument(Word arg, compileInfo *ci ARG_LD)
 { int index;
@@ -2846,6 +3461,7 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
 
   { functor_t fdef;
     int n, ar;
+    size_t pc0, pc1;
     Word a;
 
     if ( isTextAtom(*arg) )
@@ -2880,15 +3496,38 @@ compileArithArgument(Word arg, compileInfo *ci ARG_LD)
       return FALSE;
     }
 
+    pc0 = pc1 = PC(ci);
     for(n=0; n<ar; a++, n++)
+    { if ( n == 1 )
+	pc1 = PC(ci);
       TRY( compileArithArgument(a, ci PASS_LD) );
+    }
 
-    if ( fdef == FUNCTOR_plus2 )
-    { Output_0(ci, A_ADD);
+    if ( ar <= 2 &&
+	 foldArithConstants(fdef, index, ar, pc0, pc1, ci PASS_LD) )
       succeed;
-    }
-    if ( fdef == FUNCTOR_star2 )
-    { Output_0(ci, A_MUL);
+
+    if ( ar == 2 )
+    { vmi op;
+      number c;
+
+      if ( (op=floatArithVMI(fdef)) != I_HIGHEST &&
+	   isFloatArith(arg PASS_LD) )
+      { Output_0(ci, op);
+	succeed;
+      }
+      if ( (op=intArithVMI(fdef, TRUE)) != I_HIGHEST &&
+	   arithConstant(ci, pc1, PC(ci), &c) && c.type == V_INTEGER )
+      { seekBuffer(&ci->codes, pc1, code);
+	Output_1(ci, op, (code)c.value.i);
+	succeed;
+      }
+      if ( (op=intArithVMI(fdef, FALSE)) != I_HIGHEST )
+      { Output_0(ci, op);
+	succeed;
+      }
+    } else if ( fdef == FUNCTOR_abs1 )
+    { Output_0(ci, A_ABS);
       succeed;
     }
 
@@ -3369,6 +4008,230 @@ stepDynPC(Code PC, const code_info *ci)
 }
 
 
+#ifdef O_INLINE_CALLS
+
+		 /*******************************
+		 *	      INLINING		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If the optimise flag is set, inlineCalls() replaces calls to small static
+predicates of the same module by the single clause of the callee:
+
+	Goal  -->  '$inline'(Goal, Generation, (HeadUnifications, Body))
+
+Generation is the inline_generation of the callee.  compileInlined() turns
+this into I_INLINED, which runs the inlined code as long as the callee
+keeps this generation and calls Goal otherwise.  This way, redefining or
+reloading the callee does not require recompiling its callers.
+
+Only bodies that consist of unification,  comparison, type tests and
+arithmetic are inlined (see inlineSafeBody()).  Such bodies cannot cut,
+call back into user code or depend on the module context. Head arguments
+that are fresh variables are bound to the argument of Goal if this is a
+variable or atomic.  Other head arguments are unified explicitly.  Calls
+to the predicate being compiled are not inlined as more clauses are
+likely to follow.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_INLINE_CODE  32		/* max code_size of an inlined clause */
+#define MAX_INLINE_DEPTH 1000		/* do not inline deeper in the body */
+
+static int
+inlineSafeBody(Word body ARG_LD)
+{
+right_argument:
+  deRef(body);
+
+  if ( *body == ATOM_true )
+    return TRUE;
+  if ( isTerm(*body) )
+  { functor_t fd = functorTerm(*body);
+
+    if ( fd == FUNCTOR_comma2 )
+    { if ( !inlineSafeBody(argTermP(*body, 0) PASS_LD) )
+	return FALSE;
+      body = argTermP(*body, 1);
+      goto right_argument;
+    }
+
+    return ( fd == FUNCTOR_equals2 ||
+	     fd == FUNCTOR_strict_equal2 ||
+	     fd == FUNCTOR_not_strict_equal2 ||
+	     fd == FUNCTOR_var1 ||
+	     fd == FUNCTOR_nonvar1 ||
+	     true(valueFunctor(fd), ARITH_F) );
+  }
+
+  return FALSE;
+}
+
+
+static Clause
+inlineClause(Procedure proc, Module m)
+{ Definition def = proc->definition;
+  ClauseRef cref;
+
+  if ( def->module != m ||
+       true(def, P_FOREIGN|P_DYNAMIC|P_THREAD_LOCAL|P_MULTIFILE|
+		 P_TRANSPARENT|P_META|SPY_ME) ||
+       def->impl.clauses.number_of_clauses != 1 ||
+       def->inline_generation == 0 )
+    return NULL;
+
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( visibleClause(cl, GD->generation) )
+    { if ( cl->code_size > MAX_INLINE_CODE ||
+	   true(cl, CL_BODY_CONTEXT) )
+	return NULL;
+      return cl;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* inlineGoal() returns TRUE if `into` is the inlined version of `goal`,
+   FALSE if `goal` cannot be inlined and -1 on an exception.
+*/
+
+static int
+inlineGoal(term_t goal, term_t into, Module m, Procedure self ARG_LD)
+{ functor_t f;
+  Procedure proc;
+  Clause cl;
+  unsigned int gen;
+  term_t t, head, body, exp, tail, a, h, g;
+  size_t mark;
+  int i, arity, rc;
+
+  if ( !PL_get_functor(goal, &f) ||
+       !(proc = isCurrentProcedure(f, m)) ||
+       proc == self )			/* more clauses may follow */
+    return FALSE;
+  gen = proc->definition->inline_generation;
+  startClauseWalk(proc->definition);	/* see markPredicatesInEnvironments() */
+  if ( !(cl = inlineClause(proc, m)) )
+  { endClauseWalk();
+    return FALSE;
+  }
+
+  mark = gTop - gBase;			/* callee variables are above */
+  if ( !(t = PL_new_term_refs(8)) )
+  { endClauseWalk();
+    return -1;
+  }
+  head = t+1; body = t+2; exp = t+3; tail = t+4; a = t+5; h = t+6; g = t+7;
+  rc = decompile(cl, t, 0);
+  endClauseWalk();
+  if ( rc != TRUE )
+    return PL_exception(0) ? -1 : FALSE;
+  if ( true(cl, UNIT_CLAUSE) )
+  { PL_put_term(head, t);
+    PL_put_atom(body, ATOM_true);
+  } else
+  { _PL_get_arg(1, t, head);
+    _PL_get_arg(2, t, body);
+  }
+  if ( !inlineSafeBody(valTermRef(body) PASS_LD) )
+    return FALSE;
+
+  PL_put_variable(exp);
+  PL_put_term(tail, exp);
+  arity = (int)arityFunctor(f);
+  for(i=1; i<=arity; i++)
+  { Word hp, ap;
+
+    _PL_get_arg(i, goal, a);
+    _PL_get_arg(i, head, h);
+    hp = valTermRef(h); deRef(hp);
+    ap = valTermRef(a); deRef(ap);
+
+    if ( isVar(*hp) && (size_t)(hp - gBase) >= mark &&
+	 (isVar(*ap) || isAtomic(*ap)) )
+    { if ( !PL_unify(h, a) )
+	return -1;
+    } else
+    { if ( !PL_unify_term(tail,
+			  PL_FUNCTOR, FUNCTOR_comma2,
+			    PL_FUNCTOR, FUNCTOR_equals2,
+			      PL_TERM, a,
+			      PL_TERM, h,
+			    PL_VARIABLE) )
+	return -1;
+      _PL_get_arg(2, tail, tail);
+    }
+  }
+  if ( !PL_unify(tail, body) ||
+       !PL_put_int64(g, gen) ||
+       !PL_cons_functor(into, FUNCTOR_dinline3, goal, g, exp) )
+    return -1;
+
+  return TRUE;
+}
+
+
+static int
+inlineBody(term_t body, term_t into, Module m, Procedure self, int depth ARG_LD)
+{ functor_t f;
+
+  if ( !PL_get_functor(body, &f) || ++depth > MAX_INLINE_DEPTH )
+    return FALSE;
+
+  if ( f == FUNCTOR_comma2 ||
+       f == FUNCTOR_semicolon2 ||
+       f == FUNCTOR_bar2 ||
+       f == FUNCTOR_ifthen2 ||
+       f == FUNCTOR_softcut2 )
+  { term_t a = PL_new_term_refs(4);
+    int rc0, rc1;
+
+    if ( !a )
+      return -1;
+    _PL_get_arg(1, body, a+0);
+    _PL_get_arg(2, body, a+1);
+    if ( (rc0=inlineBody(a+0, a+2, m, self, depth PASS_LD)) < 0 ||
+	 (rc1=inlineBody(a+1, a+3, m, self, depth PASS_LD)) < 0 )
+      return -1;
+    if ( !rc0 && !rc1 )
+      return FALSE;
+
+    return PL_cons_functor(into, f, rc0 ? a+2 : a+0,
+				    rc1 ? a+3 : a+1) ? TRUE : -1;
+  } else if ( f == FUNCTOR_not_provable1 )
+  { term_t a = PL_new_term_refs(2);
+    int rc;
+
+    if ( !a )
+      return -1;
+    _PL_get_arg(1, body, a+0);
+    if ( (rc=inlineBody(a+0, a+1, m, self, depth PASS_LD)) != TRUE )
+      return rc;
+
+    return PL_cons_functor(into, f, a+1) ? TRUE : -1;
+  }
+
+  return inlineGoal(body, into, m, self PASS_LD);
+}
+
+
+static int
+inlineCalls(term_t body, term_t into, Module m, Procedure self ARG_LD)
+{ if ( !truePrologFlag(PLFLAG_OPTIMISE) ||
+       debugstatus.debugging ||
+       GD->bootsession ||
+       !PL_is_acyclic(body) )
+    return FALSE;
+
+  return inlineBody(body, into, m, self, 0 PASS_LD);
+}
+
+#endif /*O_INLINE_CALLS*/
+
+
 		/********************************
 		*  PROLOG DATA BASE MANAGEMENT  *
 		*********************************/
@@ -3451,6 +4314,41 @@ assert_term(term_t term, int where, atom_t owner, SourceLoc loc ARG_LD)
   DEBUG(2, Sdprintf("ok\n"));
   def = getProcDefinition(proc);
 
+#ifdef O_INLINE_CALLS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If calls in a clause loaded from a file can be inlined, the clause is
+compiled again. The first clause is only used for the compiler warnings,
+which must refer to the body as written.  If compiling the inlined body
+fails (e.g., arithmetic that cannot be compiled) we keep the first one.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+  if ( loc && *b != ATOM_true )
+  { fid_t fid;
+
+    if ( (fid = PL_open_foreign_frame()) )
+    { term_t ibody = PL_new_term_ref();
+      Clause iclause;
+
+      if ( inlineCalls(body, ibody, module, proc PASS_LD) == TRUE )
+      { h = valTermRef(head);
+	b = valTermRef(ibody);
+	deRef(h);
+	deRef(b);
+	if ( compileClause(&iclause, h, b, proc, module, 0 PASS_LD) == TRUE )
+	{ ATOMIC_SUB(&def->module->code_size,
+		     sizeofClause(clause->code_size) + SIZEOF_CREF_CLAUSE);
+	  GD->statistics.clauses++;	/* freeClause() decrements */
+	  freeClause(clause);
+	  clause = iclause;
+	}
+      }
+      PL_clear_exception();
+      PL_discard_foreign_frame(fid);
+    } else
+      PL_clear_exception();
+  }
+#endif
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 If loc is defined, we  are   called  from  '$record_clause'/2. This code
 takes care of reconsult, redefinition, etc.
@@ -3598,6 +4496,66 @@ PRED_IMPL("asserta", 2, asserta2, PL_FA_TRANSPARENT)
 }
 
 
+/** assertz_list(:Clauses) is det.
+
+Add the clauses of the list Clauses as  assertz/1. Before the first clause
+of a predicate is added, indexes that   would be resized by the clauses
+are discarded (see prepareClauseIndexes()). If  a clause cannot be added
+the preceding clauses remain in the database.
+*/
+
+static
+PRED_IMPL("assertz_list", 1, assertz_list, PL_FA_TRANSPARENT)
+{ PRED_LD
+  Module m = NULL;
+  term_t tail = PL_new_term_ref();
+  term_t head = PL_new_term_ref();
+  term_t mt   = PL_new_term_ref();
+  Definition last = NULL;
+  size_t len;
+
+  if ( !PL_strip_module_ex(A1, &m, tail) )
+    return FALSE;
+  switch( PL_skip_list(tail, 0, &len) )
+  { case PL_LIST:
+      break;
+    case PL_PARTIAL_LIST:
+      return PL_error(NULL, 0, NULL, ERR_INSTANTIATION);
+    default:
+      return PL_type_error("list", tail);
+  }
+  PL_put_atom(mt, m->name);
+
+  while( PL_get_list(tail, head, tail) )
+  { fid_t fid;
+    term_t cl;
+    Clause clause;
+
+    if ( !(fid = PL_open_foreign_frame()) ||
+	 !(cl = PL_new_term_ref()) ||
+	 !PL_cons_functor(cl, FUNCTOR_colon2, mt, head) )
+      return FALSE;
+    if ( !(clause = assert_term(cl, CL_END, NULL_ATOM, NULL PASS_LD)) )
+    { PL_close_foreign_frame(fid);
+      return FALSE;
+    }
+    PL_discard_foreign_frame(fid);	/* reclaim the term and its refs */
+
+    if ( clause != (Clause)-1 )		/* not handled by a hook */
+    { Definition def = getProcDefinition(clause->procedure);
+
+      if ( def != last )
+      { prepareClauseIndexes(def, len);
+	last = def;
+      }
+    }
+    len--;
+  }
+
+  return TRUE;
+}
+
+
 /** '$record_clause'(+Term, +Owner, +Source)
     '$record_clause'(+Term, +Owner, +Source, -Ref)
 
@@ -3753,6 +4711,7 @@ PRED_IMPL("$predefine_foreign",  1, predefine_foreign, PL_FA_TRANSPARENT)
   if ( !get_procedure(A1, &proc, 0, GP_NAMEARITY|GP_DEFINE) )
     return FALSE;
   set(proc->definition, P_FOREIGN);
+  updateResolveGenerationDefinition(proc->definition);
 
   return TRUE;
 }
@@ -3954,26 +4913,15 @@ argKey(Code PC, int skip, word *key)
 	  *key = k;
 	  succeed;
 	}
-      case H_FLOAT:			/* tbd */
-      { word k;
-	switch(WORDS_PER_DOUBLE)
-	{ case 2:
-	    k = (word)PC[0] ^ (word)PC[1];
-	    break;
-	  case 1:
-	    k = (word)PC[0];
-	    break;
-	  default:
-	    assert(0);
-	}
-
-	if ( !k )
-	  k++;
-	*key = k;
+      case H_FLOAT:
+	*key = indexOfIndirect(PC, WORDS_PER_DOUBLE, TAG_FLOAT);
         succeed;
-      }
       case H_STRING:
+	*key = indexOfIndirect(PC+1, wsizeofInd(PC[0]), TAG_STRING);
+        succeed;
       case H_MPZ:
+	*key = indexOfIndirect(PC+1, wsizeofInd(PC[0]), TAG_INTEGER);
+        succeed;
       case H_FIRSTVAR:
       case H_VAR:
       case H_VOID:
@@ -4061,6 +5009,47 @@ arg1Key(Code PC, word *key)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+deepArgKey() determines the indexing key  of   argument  `sub' of the
+compound that appears as argument `arg' of the clause head (both 0-based).
+It fails if the head argument is not a compound or the sub-argument is
+not indexable. This is used for deep indexing by pl-index.c.
+
+Note that trailing void arguments of a compound are optimised away, so
+skipping may end at the H_POP of the compound.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+deepArgKey(Code PC, int arg, int sub, word *key)
+{ if ( arg > 0 )
+    PC = skipArgs(PC, arg);
+
+  switch(fetchop(PC))
+  { case H_FUNCTOR:
+    case H_RFUNCTOR:
+    case H_LIST:
+    case H_RLIST:
+      PC = stepPC(PC);
+      break;
+    default:
+      *key = 0;
+      fail;
+  }
+
+  if ( sub > 0 )
+    PC = skipArgs(PC, sub);
+
+  switch(fetchop(PC))
+  { case H_POP:
+    case H_VOID_N:
+      *key = 0;
+      fail;
+    default:
+      return argKey(PC, 0, key);
+  }
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Return the context module  in  which  the   body  of  a  clause  will be
 executed. This can  be  different  from   the  predicate's  module  when
@@ -4842,11 +5831,71 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
 #endif
 #if O_COMPILE_ARITH
       case A_ADD:
+      case A_FADD:
 			    BUILD_TERM(FUNCTOR_plus2);
 			    continue;
+      case A_SUB:
+      case A_FSUB:
+			    BUILD_TERM(FUNCTOR_minus2);
+			    continue;
       case A_MUL:
+      case A_FMUL:
 			    BUILD_TERM(FUNCTOR_star2);
 			    continue;
+      case A_FDIV:
+			    BUILD_TERM(FUNCTOR_divide2);
+			    continue;
+      case A_IDIV:
+			    BUILD_TERM(FUNCTOR_gdiv2);
+			    continue;
+      case A_MOD:
+			    BUILD_TERM(FUNCTOR_mod2);
+			    continue;
+      case A_MIN:
+			    BUILD_TERM(FUNCTOR_min2);
+			    continue;
+      case A_MAX:
+			    BUILD_TERM(FUNCTOR_max2);
+			    continue;
+      case A_SHR:
+			    BUILD_TERM(FUNCTOR_rshift2);
+			    continue;
+      case A_SHL:
+			    BUILD_TERM(FUNCTOR_lshift2);
+			    continue;
+      case A_AND:
+			    BUILD_TERM(FUNCTOR_and2);
+			    continue;
+      case A_OR:
+			    BUILD_TERM(FUNCTOR_bitor2);
+			    continue;
+      case A_XOR:
+			    BUILD_TERM(FUNCTOR_xor2);
+			    continue;
+      case A_ABS:
+			    BUILD_TERM(FUNCTOR_abs1);
+			    continue;
+      { functor_t f;
+
+	case A_ADD_C:	    f = FUNCTOR_plus2;		goto a_c_common;
+	case A_SUB_C:	    f = FUNCTOR_minus2;		goto a_c_common;
+	case A_MUL_C:	    f = FUNCTOR_star2;		goto a_c_common;
+	case A_IDIV_C:	    f = FUNCTOR_gdiv2;		goto a_c_common;
+	case A_MOD_C:	    f = FUNCTOR_mod2;		goto a_c_common;
+	case A_SHR_C:	    f = FUNCTOR_rshift2;	goto a_c_common;
+	case A_SHL_C:	    f = FUNCTOR_lshift2;	goto a_c_common;
+	case A_AND_C:	    f = FUNCTOR_and2;		goto a_c_common;
+	case A_OR_C:	    f = FUNCTOR_bitor2;		goto a_c_common;
+	case A_XOR_C:	    f = FUNCTOR_xor2;		a_c_common:
+			  { int rc;
+
+			    if ( (rc=put_int64(ARGP++, (intptr_t)*PC++,
+					       0 PASS_LD)) != TRUE )
+			      return rc;
+			    BUILD_TERM(f);
+			    continue;
+			  }
+      }
       case A_FUNC0:
       case A_FUNC1:
       case A_FUNC2:
@@ -4891,7 +5940,8 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
 #if O_CATCHTHROW
 	case B_THROW:	    f = FUNCTOR_dthrow1;	goto f_common;
 #endif
-        case I_USERCALLN:   f = lookupFunctorDef(ATOM_call, (int)*PC++ + 1);
+        case I_USERCALLN:   f = lookupFunctorDef(ATOM_call, (int)*PC + 1);
+			    PC += 2;		/* skip call cache */
 							f_common:
 			    BUILD_TERM(f);
 			    pushed++;
@@ -5002,6 +6052,16 @@ decompileBody(decompileInfo *di, code end, Code until ARG_LD)
       case C_JMP:
 			    PC++;
 			    continue;
+#ifdef O_INLINE_CALLS
+      case I_INLINED:			/* decompile the original call */
+			    PC += 3 + PC[2];
+			    continue;
+#endif
+#ifdef O_DET_GUARDS
+      case I_GUARD:
+			    PC += 3;
+			    continue;
+#endif
       case C_VAR_N:
 			    PC += 2;
 			    continue;
@@ -5299,13 +6359,20 @@ unify_head(term_t h, term_t d ARG_LD)
 */
 
 
+typedef struct
+{ struct clause_choice chp;		/* first/next clause */
+  int shared;				/* result of enterDefinition() */
+} clause_context;
+
 static
 PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
 { PRED_LD
   Procedure proc;
   Definition def;
-  struct clause_choice chp_buf;
+  clause_context ctx_buf;
+  clause_context *ctx = NULL;
   ClauseChoice chp;
+  int shared;
   ClauseRef cref;
   Word argv;
   Module module = NULL;
@@ -5363,20 +6430,22 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
 			ATOM_access, ATOM_private_procedure, proc);
 
       chp = NULL;
-      enterDefinition(def);		/* reference the predicate */
+      shared = enterDefinition(def);	/* reference the predicate */
       break;
     }
     case FRG_REDO:
-      chp  = CTX_PTR;
-      proc = chp->cref->value.clause->procedure;
-      def  = getProcDefinition(proc);
+      ctx    = CTX_PTR;
+      chp    = &ctx->chp;
+      shared = ctx->shared;
+      proc   = chp->cref->value.clause->procedure;
+      def    = getProcDefinition(proc);
       break;
     case FRG_CUTTED:
-      chp = CTX_PTR;
-      proc = chp->cref->value.clause->procedure;
+      ctx  = CTX_PTR;
+      proc = ctx->chp.cref->value.clause->procedure;
       def  = getProcDefinition(proc);
-      leaveDefinition(def);
-      freeForeignState(chp, sizeof(*chp));
+      leaveDefinition(def, ctx->shared);
+      freeForeignState(ctx, sizeof(*ctx));
       succeed;
     default:
       assert(0);
@@ -5393,7 +6462,7 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
     argv = NULL;
 
   if ( !chp )
-  { chp = &chp_buf;
+  { chp = &ctx_buf.chp;
     cref = firstClause(argv, environment_frame, def, chp PASS_LD);
   } else
   { cref = nextClause(chp, argv, environment_frame, def);
@@ -5410,22 +6479,23 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
 	   PL_unify(b, body) &&
 	   (!ref || PL_unify_clref(ref, cref->value.clause)) )
       { if ( !chp->cref )
-	{ leaveDefinition(def);
+	{ leaveDefinition(def, shared);
 	  succeed;
 	}
-	if ( chp == &chp_buf )
-	{ chp = allocForeignState(sizeof(*chp));
-	  *chp = chp_buf;
+	if ( !ctx )
+	{ ctx = allocForeignState(sizeof(*ctx));
+	  ctx->chp    = ctx_buf.chp;
+	  ctx->shared = shared;
 	}
 
-	ForeignRedoPtr(chp);
+	ForeignRedoPtr(ctx);
       } else
       { PL_put_variable(h);		/* otherwise they point into */
 	PL_put_variable(b);		/* term, which is removed */
       }
     } else if ( exception_term )
     { PL_discard_foreign_frame(fid);
-      return FALSE;
+      break;
     }
 
     PL_rewind_foreign_frame(fid);
@@ -5437,9 +6507,9 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
     cref = nextClause(chp, argv, environment_frame, def);
   }
 
-  if ( chp != &chp_buf )
-    freeForeignState(chp, sizeof(*chp));
-  leaveDefinition(def);
+  if ( ctx )
+    freeForeignState(ctx, sizeof(*ctx));
+  leaveDefinition(def, shared);
   fail;
 }
 
@@ -5447,6 +6517,7 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
 typedef struct
 { ClauseRef clause;			/* pointer to the clause */
   int       index;			/* nth-1 index */
+  int	    shared;			/* result of enterDefinition() */
 } *Cref;
 
 
@@ -5467,7 +6538,7 @@ pl_nth_clause(term_t p, term_t n, term_t ref, control_t h)
 
     if ( cr )
     { def = getProcDefinition(cr->clause->value.clause->procedure);
-      leaveDefinition(def);
+      leaveDefinition(def, cr->shared);
       freeForeignState(cr, sizeof(*cr));
     }
     succeed;
@@ -5531,7 +6602,7 @@ pl_nth_clause(term_t p, term_t n, term_t ref, control_t h)
     cr = allocForeignState(sizeof(*cr));
     cr->clause = cref;
     cr->index  = 1;
-    enterDefinition(def);
+    cr->shared = enterDefinition(def);
   } else
   { cr = ForeignContextPtr(h);
     def = getProcDefinition(cr->clause->value.clause->procedure);
@@ -5550,8 +6621,8 @@ pl_nth_clause(term_t p, term_t n, term_t ref, control_t h)
     ForeignRedoPtr(cr);
   }
 
+  leaveDefinition(def, cr->shared);
   freeForeignState(cr, sizeof(*cr));
-  leaveDefinition(def);
 
   succeed;
 }
@@ -6553,6 +7624,22 @@ PRED_IMPL("$clause_term_position", 3, clause_term_position, 0)
 
 	goto after_construct;
       }
+#ifdef O_INLINE_CALLS
+      case I_INLINED:			/* I_INLINED <proc> <gen> <jmp1> */
+      { Code jmploc;			/* <Inlined> C_JMP <jmp2> <Goal> */
+
+	jmploc = nextpc + PC[3];
+	endloc = jmploc + jmploc[-1];
+
+	if ( loc <= endloc )		/* loc is in the inlined call */
+	{ add_1_if_not_at_end(endloc, end, tail PASS_LD);
+
+	  return PL_unify_nil(tail);
+	}
+
+	goto after_construct;
+      }
+#endif
       }					/* closes the special constructs */
       case I_CONTEXT:			/* used to compile m:head :- body */
 	PC = nextpc;
@@ -6625,6 +7712,10 @@ PRED_IMPL("$break_pc", 3, break_pc, PL_FA_NONDETERMINISTIC)
   { code op = fetchop(PC);
     Code nextpc = stepPC(PC);
 
+#ifdef O_INLINE_CALLS
+    if ( op == I_INLINED )		/* only the call can have a break */
+      nextpc += PC[3];
+#endif
     if ( (codeTable[op].flags & VIF_BREAK) )
     { switch(op)
       { case B_UNIFY_FIRSTVAR:
@@ -6702,6 +7793,11 @@ setBreak(Clause clause, int offset)	/* offset is already verified */
   if ( (codeTable[dop].flags & VIF_BREAK) || dop == B_UNIFY_EXIT )
   { BreakPoint bp = allocHeapOrHalt(sizeof(break_point));
 
+    if ( false(clause, HAS_BREAKPOINTS) )
+    { unfuseClause(clause);		/* stepPC() cannot pass D_BREAK */
+      op = *PC;				/* while we hold L_BREAK */
+    }
+
     bp->clause = clause;
     bp->offset = offset;
     bp->saved_instruction = op;
@@ -6903,6 +7999,7 @@ BeginPredDefs(comp)
   PRED_DEF("assert",  2, assertz2, META)
   PRED_DEF("assertz", 2, assertz2, META)
   PRED_DEF("asserta", 2, asserta2, META)
+  PRED_DEF("assertz_list", 1, assertz_list, META)
   PRED_DEF("redefine_system_predicate", 1, redefine_system_predicate, META)
   PRED_DEF("compile_predicates",  1, compile_predicates, META)
   PRED_DEF("$predefine_foreign",  1, predefine_foreign, PL_FA_TRANSPARENT)
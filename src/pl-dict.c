@@ -1540,7 +1540,7 @@ retry:
     if ( (vp=dict_lookup_ptr(m, k PASS_LD)) )
     { if ( (flags&SETDICT_BACKTRACKABLE) )
 	TrailAssignment(vp);
-      unify_vp(vp, val PASS_LD);
+      unify_vp(vp, val, (flags&SETDICT_BACKTRACKABLE) PASS_LD);
       return TRUE;
     }
 
@@ -138,9 +138,6 @@ static const PL_extension foreigns[] = {
   FRG("$visible",		2, pl_visible,		  NOTRACE),
   FRG("$debuglevel",		2, pl_debuglevel,		0),
 
-#if COUNTING
-  FRG("$count",			0, pl_count,			0),
-#endif /* COUNTING */
 
   FRG("prolog_current_frame",	1, pl_prolog_current_frame,	0),
 
@@ -382,6 +379,8 @@ DECL_PLIST(term);
 DECL_PLIST(debug);
 DECL_PLIST(locale);
 DECL_PLIST(dict);
+DECL_PLIST(tabling);
+DECL_PLIST(trie);
 
 void
 initBuildIns(void)
@@ -441,6 +440,8 @@ initBuildIns(void)
 #endif
   REG_PLIST(debug);
   REG_PLIST(dict);
+  REG_PLIST(tabling);
+  REG_PLIST(trie);
 
 #define LOOKUPPROC(name) \
 	{ GD->procedures.name = lookupProcedure(FUNCTOR_ ## name, m); \
@@ -497,6 +498,9 @@ initBuildIns(void)
 #endif
   PL_meta_predicate(PL_predicate("prolog_frame_attribute", 3, "system"), "++:");
   PL_meta_predicate(PL_predicate("compile_predicates", 1, "system"), ":");
+#ifdef O_FROZEN_INDEX
+  PL_meta_predicate(PL_predicate("freeze_indexes",     1, "system"), ":");
+#endif
 
   for( ecell = ext_head; ecell; ecell = ecell->next )
     bindExtensions(ecell->module, ecell->extensions);
@@ -3840,6 +3840,7 @@ bindForeign(Module m, const char *name, int arity, Func f, int flags)
   def->impl.function = f;
   def->flags &= ~(P_DYNAMIC|P_THREAD_LOCAL|P_TRANSPARENT|P_NONDET|P_VARARG);
   def->flags |= (P_FOREIGN|TRACE_ME);
+  updateResolveGenerationDefinition(def);
 
   if ( m == MODULE_system || SYSTEM_MODE )
     set(def, P_LOCKED|HIDE_CHILDS);
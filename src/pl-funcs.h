@@ -45,7 +45,6 @@ COMMON(void)		freezeGlobal(ARG1_LD);
 COMMON(int)		gvar_value__LD(atom_t name, Word p ARG_LD);
 
 /* pl-wam.c */
-COMMON(word)		pl_count(void);
 COMMON(void)		TrailAssignment__LD(Word p ARG_LD);
 COMMON(void)		do_undo(mark *m);
 COMMON(Definition)	getProcDefinition__LD(Definition def ARG_LD);
@@ -73,6 +72,7 @@ COMMON(int)		createForeignSupervisor(Definition def, Func f);
 COMMON(int)		createUndefSupervisor(Definition def);
 COMMON(int)		createSupervisor(Definition def);
 COMMON(size_t)		supervisorLength(Code base);
+COMMON(int)		guardCommitsDefinition(Definition def);
 COMMON(void)		initSupervisors(void);
 
 /* pl-atom.c */
@@ -103,6 +103,18 @@ COMMON(int)		ar_compare(Number n1, Number n2, int what);
 COMMON(int)		ar_compare_eq(Number n1, Number n2);
 COMMON(int)		pl_ar_add(Number n1, Number n2, Number r);
 COMMON(int)		ar_mul(Number n1, Number n2, Number r);
+COMMON(int)		ar_minus(Number n1, Number n2, Number r);
+COMMON(int)		ar_divide(Number n1, Number n2, Number r);
+COMMON(int)		ar_tdiv(Number n1, Number n2, Number r);
+COMMON(int)		ar_mod(Number n1, Number n2, Number r);
+COMMON(int)		ar_min(Number n1, Number n2, Number r);
+COMMON(int)		ar_max(Number n1, Number n2, Number r);
+COMMON(int)		ar_abs(Number n1, Number r);
+COMMON(int)		ar_shift_left(Number n1, Number n2, Number r);
+COMMON(int)		ar_shift_right(Number n1, Number n2, Number r);
+COMMON(int)		ar_conjunct(Number n1, Number n2, Number r);
+COMMON(int)		ar_disjunct(Number n1, Number n2, Number r);
+COMMON(int)		ar_xor(Number n1, Number n2, Number r);
 COMMON(word)		pl_current_arithmetic_function(term_t f, control_t h);
 COMMON(void)		initArith(void);
 COMMON(void)		cleanupArith(void);
@@ -139,12 +151,15 @@ COMMON(int)		compileClause(Clause *cp, Word head, Word body,
 				      term_t warnings ARG_LD);
 COMMON(Clause)		assert_term(term_t term, int where, atom_t owner,
 				    SourceLoc loc ARG_LD);
+COMMON(void)		fuseClause(Clause clause);
+COMMON(void)		unfuseClause(Clause clause);
 COMMON(void)		forAtomsInClause(Clause clause, void (func)(atom_t a));
 COMMON(Code)		stepDynPC(Code PC, const code_info *ci);
 COMMON(bool)		decompileHead(Clause clause, term_t head);
 COMMON(Code)		skipArgs(Code PC, int skip);
 COMMON(int)		argKey(Code PC, int skip, word *key);
 COMMON(int)		arg1Key(Code PC, word *key);
+COMMON(int)		deepArgKey(Code PC, int arg, int sub, word *key);
 COMMON(bool)		decompile(Clause clause, term_t term, term_t bindings);
 COMMON(word)		pl_nth_clause(term_t p, term_t n, term_t ref,
 				      control_t h);
@@ -170,13 +185,20 @@ COMMON(word)		parseSaveProgramOptions(term_t args,
 
 /* pl-index.c */
 COMMON(word)		getIndexOfTerm(term_t t);
+COMMON(word)		indexOfIndirect(const word *p, size_t n, int t);
 COMMON(ClauseRef)	firstClause(Word argv, LocalFrame fr, Definition def,
 				    ClauseChoice next ARG_LD);
 COMMON(ClauseRef)	nextClause(ClauseChoice chp, Word argv, LocalFrame fr,
 				   Definition def);
+COMMON(ClauseRef)	firstFrozenClause(Word argv, LocalFrame fr,
+					  Definition def,
+					  ClauseChoice chp ARG_LD);
 COMMON(void)		addClauseToIndexes(Definition def, Clause cl, int where);
+COMMON(void)		prepareClauseIndexes(Definition def, size_t count);
 COMMON(void)		delClauseFromIndex(Definition def, Clause cl);
 COMMON(void)		cleanClauseIndexes(Definition def);
+COMMON(ClauseIndexList)	retireClauseIndexes(Definition def);
+COMMON(void)		freeClauseIndexList(ClauseIndexList li);
 COMMON(void)		clearTriedIndexes(Definition def);
 COMMON(void)		unallocClauseIndexes(Definition def);
 COMMON(void)		unallocClauseIndexTable(ClauseIndex ci);
@@ -379,7 +401,7 @@ COMMON(int)		Pause(double time);
 
 /* pl-prims.c */
 COMMON(int)		unify_ptrs(Word t1, Word t2, int flags ARG_LD);
-COMMON(void)		unify_vp(Word vp, Word val ARG_LD);
+COMMON(void)		unify_vp(Word vp, Word val, int trailed ARG_LD);
 COMMON(bool)		can_unify(Word t1, Word t2, term_t ex);
 COMMON(int)		compareStandard(Word t1, Word t2, int eq ARG_LD);
 COMMON(int)		compareAtoms(atom_t a1, atom_t a2);
@@ -437,6 +459,9 @@ COMMON(atom_t)		accessLevel(void);
 COMMON(Procedure)	lookupProcedure(functor_t f, Module m) WUNUSED;
 COMMON(void)		unallocProcedure(Procedure proc);
 COMMON(Procedure)	isCurrentProcedure(functor_t f, Module m);
+COMMON(void)		updateInlineGeneration(Definition def);
+COMMON(void)		updateResolveGeneration(Module m);
+COMMON(void)		updateResolveGenerationDefinition(Definition def);
 COMMON(int)		importDefinitionModule(Module m,
 					       Definition def, int flags);
 COMMON(Procedure)	lookupProcedureToDefine(functor_t def, Module m);
@@ -467,6 +492,13 @@ COMMON(void)		freeClauseList(ClauseRef cref);
 COMMON(ClauseRef)	newClauseRef(Clause cl, word key);
 COMMON(void)		gcClausesDefinition(Definition def);
 COMMON(void)		gcClausesDefinitionAndUnlock(Definition def);
+#ifdef O_EPOCH_RECLAIM
+COMMON(void)		reclaimDefinition(Definition def);
+COMMON(void)		waitReclaimDefinition(void);
+COMMON(unsigned int *)	claimSharedFrames(Definition def ARG_LD);
+COMMON(void)		freeSharedFrames(PL_local_data_t *ld);
+#endif
+COMMON(int)		referencedDefinition(Definition def);
 COMMON(int)		removeClausesProcedure(Procedure proc,
 					       int sfindex, int fromfile);
 COMMON(ClauseRef)	cleanDefinition(Definition def, ClauseRef garbage);
@@ -740,3 +772,12 @@ COMMON(void)	cpNumber(Number to, Number from);
 
 /* pl-version.h */
 COMMON(void)	setGITVersion(void);
+
+/* pl-termhash.c */
+COMMON(int)	variantHashValue(term_t t, unsigned int *hval ARG_LD);
+
+/* pl-variant.c */
+COMMON(int)	is_variant_ptr(Word p1, Word p2 ARG_LD);
+
+/* pl-tabling.c */
+COMMON(void)	clearThreadTablingData(PL_local_data_t *ld);
@@ -96,6 +96,27 @@ performance degradation, but for the moment is worth this I think.
 If the CHK_SECURE prolog_debug flag  is set  some  additional  expensive
 consistency checks that need considerable amounts of memory and cpu time
 are added. Garbage collection gets about 3-4 times as slow.
+
+			    GENERATIONS
+
+All data that survives a collection  forms   the  *old* generation, the
+area [gBase, LD->gen_bar). Data created   after the collection is *young*.
+A *minor* collection only marks and compacts  the young generation. Old
+cells are considered marked and are never moved, so marking stops if it
+reaches an old cell and references to old cells are not relocated.
+
+Old cells may be modified after  the   last  collection  to refer young
+data. LD->mark_bar is never below  LD->gen_bar   and  therefore all such
+bindings are trailed: the trail  acts   as  remembered set. Before the
+mark phase the old cells on the   trail that refer young data are copied
+to term references, which are marked and relocated by the normal machinery,
+and written back after compaction.  Untrailed assignments into the old
+generation set LD->gc.major_request. See setUntrailed().
+
+A *major* collection processes the whole stack as before. It is used if
+explicitly requested, if the old   generation  has grown substantially
+since the last major collection, if we  are short of global stack or if
+the Prolog flag `gc_generational` is false.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -163,6 +184,9 @@ recordMark__LD(Word p ARG_LD)
 #define val_ptr2(w, s)	((Word)((uintptr_t)valPtr2((w), (s)) & ~(uintptr_t)0x3))
 #define val_ptr(w)	val_ptr2((w), storage(w))
 
+#define is_old(p)	((p) < LD->gen_bar && (p) >= gBase)
+#define is_marked_or_old(p) (is_old(p) || is_marked(p))
+
 #define inShiftedArea(area, shift, ptr) \
 	((char *)ptr >= (char *)LD->stacks.area.base + shift && \
 	 (char *)ptr <  (char *)LD->stacks.area.max + shift )
@@ -207,6 +231,10 @@ typedef struct vm_state
 		 *******************************/
 
 forwards void		mark_variable(Word ARG_LD);
+#ifdef O_PLMT
+static void		mark_root(Word start ARG_LD);
+static void		mark_flush(ARG1_LD);
+#endif
 static void		mark_local_variable(Word p ARG_LD);
 forwards void		sweep_foreign(void);
 static void		sweep_global_mark(Word *m ARG_LD);
@@ -631,6 +659,13 @@ mark_variable(Word start ARG_LD)
   word val;				/* old value of current cell */
   Word next;				/* cell to be examined */
 
+#ifdef O_PLMT
+  if ( LD->gc.mark_pool )
+  { mark_root(start PASS_LD);
+    return;
+  }
+#endif
+
   DEBUG(MSG_GC_MARK_VAR,
 	char b[64];
 	Sdprintf("marking %p (=%s)\n", start, print_val(*start, b)));
@@ -656,6 +691,8 @@ forward:				/* Go into the tree */
   { case TAG_REFERENCE:
     { next = unRef(val);		/* address pointing to */
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( is_old(next) )		/* minor GC: old data is alive */
+	BACKWARD;
       needsRelocation(current);
       if ( is_first(next) )		/* ref to choice point. we will */
         BACKWARD;			/* get there some day anyway */
@@ -671,6 +708,8 @@ forward:				/* Go into the tree */
     { DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       next = valPtr2(val, STG_GLOBAL);
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( is_old(next) )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )
 	BACKWARD;			/* term has already been marked */
@@ -689,6 +728,8 @@ forward:				/* Go into the tree */
       DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       next = valPtr2(val, STG_GLOBAL);
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( is_old(next) )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )
 	BACKWARD;			/* term has already been marked */
@@ -720,6 +761,8 @@ forward:				/* Go into the tree */
 
       DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( is_old(next) )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )		/* can be referenced from multiple */
         BACKWARD;			/* places */
@@ -774,6 +817,502 @@ backward:				/* reversing backwards */
 }
 
 
+		 /*******************************
+		 *	  PARALLEL MARKING	*
+		 *******************************/
+
+#ifdef O_PLMT
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If the Prolog flag gc_threads is more   than one and the area to collect
+is large, the global stack is  marked   by  the collecting thread and
+gc_threads-1 helper threads.  Pointer  reversal   cannot  be  shared by
+multiple threads and therefore parallel marking   uses  an explicit mark
+stack per worker and sets the mark bit using an atomic OR.
+
+The collecting thread walks the environments and choicepoints as usual.
+If mark_variable() is called, it marks the  root cell and pushes it on
+its own mark stack.  The marking is  completed by mark_flush(), which
+must be called before the marks are inspected,  notably by the early
+reset of the trail.  A worker whose  mark stack grows hands a chunk of
+it to the shared pool if there are idle workers.  Marking is completed
+if no worker is active and the pool is empty.
+
+The helper threads are created  on  first  use and kept for subsequent
+collections, waiting on the pool  condition   for  the next round. There
+is only one pool. A thread  that   collects  while  another thread owns
+the pool marks sequentially.  After fork() the  helpers do not exist in
+the child and we start a fresh pool.
+
+Only marking the global cells is   parallel.  The walk over environments
+and choicepoints remains sequential:  early   reset  processes the trail
+per choicepoint from the newest  to  the   oldest  and relies on all
+marks of the younger choicepoints,  while   frames  shared  by multiple
+choicepoints are marked using non-atomic  flags.   Compaction  uses
+Morris-style relocation chains that thread  through the whole stack and
+remains sequential as well.  A  collection   that  is dominated by a
+deep local stack therefore gains little from gc_threads.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MARK_CHUNK	 256		/* Cells handed over at once */
+#define MARK_PAR_MIN_CELLS (1024*1024)	/* Do not bother below this */
+
+typedef struct mark_chunk
+{ struct mark_chunk *next;		/* Next in pool */
+  size_t	size;			/* # cells in chunk */
+  Word		cells[MARK_CHUNK];	/* cells to scan */
+} mark_chunk;
+
+typedef struct mark_worker
+{ struct mark_pool *pool;		/* Pool I belong to */
+  Word	       *base;			/* Private mark stack */
+  Word	       *top;
+  Word	       *max;
+  intptr_t	marked;			/* # marked global cells */
+  intptr_t	relocations;		/* # cells that need relocation */
+  int		index;			/* Index in pool->workers */
+  unsigned int	round;			/* Last round seen by helper */
+  pthread_t	thread;			/* Helper thread */
+} mark_worker;
+
+typedef struct mark_pool
+{ PL_local_data_t *ld;			/* Thread we collect */
+  pthread_mutex_t mutex;		/* Guards the fields below */
+  pthread_cond_t  cond;			/* Work or completion */
+  mark_chunk   *chunks;			/* Shared work */
+  mark_chunk   *free_chunks;		/* Reuse chunks */
+  int		active;			/* # workers with work */
+  int		running;		/* # helpers in this round */
+  int		stop;			/* Helpers must leave the round */
+  unsigned int	round;			/* Incremented for each collection */
+  int		size;			/* # workers (incl. collector) */
+  int		allocated;		/* # created workers */
+  pid_t		pid;			/* Process that created the helpers */
+  mark_worker **workers;		/* workers[0] is the collector */
+} mark_pool;
+
+static mark_pool *gc_mark_pool;		/* The pool */
+static int	  gc_mark_pool_busy;	/* A collector owns gc_mark_pool */
+
+
+static inline word
+try_mark(Word p)
+{ word old;
+
+  if ( is_marked(p) )
+    return 0;
+  old = ATOMIC_OR(p, MARK_MASK);
+
+  return (old & MARK_MASK) ? 0 : (old|MARK_MASK);
+}
+
+
+static void
+grow_marks(mark_worker *w, size_t cells)
+{ size_t top = w->top - w->base;
+  size_t nsize = w->max - w->base;
+  Word *nbase;
+
+  if ( nsize == 0 )
+    nsize = 1024;
+  while( nsize - top < cells )
+    nsize *= 2;
+  if ( !(nbase = realloc(w->base, nsize*sizeof(Word))) )
+    outOfCore();
+  w->base = nbase;
+  w->top  = nbase+top;
+  w->max  = nbase+nsize;
+}
+
+
+static inline void
+push_mark(mark_worker *w, Word p)
+{ if ( w->top == w->max )
+    grow_marks(w, 1);
+
+  *w->top++ = p;
+}
+
+
+static void
+share_marks(mark_worker *w)
+{ mark_pool *pool = w->pool;
+  mark_chunk *c;
+
+  pthread_mutex_lock(&pool->mutex);
+  if ( (c=pool->free_chunks) )
+    pool->free_chunks = c->next;
+  else if ( !(c = malloc(sizeof(*c))) )
+  { pthread_mutex_unlock(&pool->mutex);
+    return;
+  }
+  memcpy(c->cells, w->base, MARK_CHUNK*sizeof(Word));
+  memmove(w->base, w->base+MARK_CHUNK,
+	  (w->top-w->base-MARK_CHUNK)*sizeof(Word));
+  w->top -= MARK_CHUNK;
+  c->size = MARK_CHUNK;
+  c->next = pool->chunks;
+  pool->chunks = c;
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+scan_marks() processes the mark stack of   a worker. Cells on the stack
+are marked and counted. This mirrors mark_variable(), pushing the first
+argument last such that walking a list does not grow the stack.
+
+Whether to share is decided without   the  pool mutex. We read `active'
+and `chunks' using an atomic load;   share_marks()  takes the mutex, so
+a stale decision only costs a chunk that is shared too early or late.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+scan_marks(mark_worker *w ARG_LD)
+{ mark_pool *pool = w->pool;
+
+  while( w->top > w->base )
+  { Word p = *--w->top;
+    word val = get_value(p);
+    Word next;
+
+    switch(tag(val))
+    { case TAG_REFERENCE:
+	next = unRef(val);
+	goto ref;
+      case TAG_ATTVAR:
+	next = valPtr2(val, STG_GLOBAL);
+      ref:
+	if ( is_old(next) )
+	  break;
+	w->relocations++;
+	if ( try_mark(next) )
+	{ w->marked++;
+	  push_mark(w, next);
+	}
+	break;
+      case TAG_COMPOUND:
+      { word f;
+
+	next = valPtr2(val, STG_GLOBAL);
+	if ( is_old(next) )
+	  break;
+	w->relocations++;
+	if ( (f=try_mark(next)) )
+	{ int arity = arityFunctor(f & VALUE_MASK);
+	  Word a;
+
+	  w->marked++;
+	  for(a = next+arity; a > next; a--)
+	  { if ( try_mark(a) )
+	    { w->marked++;
+	      push_mark(w, a);
+	    }
+	  }
+	}
+	break;
+      }
+      case TAG_INTEGER:
+	if ( storage(val) == STG_INLINE )
+	  break;
+      /*FALLTHROUGH*/
+      case TAG_STRING:
+      case TAG_FLOAT:
+	next = valPtr2(val, STG_GLOBAL);
+	if ( is_old(next) )
+	  break;
+	w->relocations++;
+	if ( try_mark(next) )
+	  w->marked += offset_cell(next) + 1;
+	break;
+    }
+
+    if ( w->top - w->base >= 2*MARK_CHUNK &&
+	 ATOMIC_ADD(&pool->active, 0) < pool->size &&
+	 !ATOMIC_ADD(&pool->chunks, 0) )
+      share_marks(w);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+get_marks() is called by a worker that   ran out of work. It waits for a
+shared chunk and returns FALSE if marking  is complete (collector) or the
+round ends (helper).  The last worker  that becomes idle wakes up the
+collector.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+get_marks(mark_worker *w, int collector)
+{ mark_pool *pool = w->pool;
+  int rc;
+
+  pthread_mutex_lock(&pool->mutex);
+  if ( --pool->active == 0 )
+    pthread_cond_broadcast(&pool->cond);
+  for(;;)
+  { mark_chunk *c;
+
+    if ( (c=pool->chunks) )
+    { pool->chunks = c->next;
+      if ( (size_t)(w->max - w->top) < c->size )
+	grow_marks(w, c->size);
+      memcpy(w->top, c->cells, c->size*sizeof(Word));
+      w->top += c->size;
+      c->next = pool->free_chunks;
+      pool->free_chunks = c;
+      pool->active++;
+      rc = TRUE;
+      break;
+    }
+    if ( pool->active == 0 && collector )
+    { rc = FALSE;
+      break;
+    }
+    if ( pool->stop && !collector )
+    { rc = FALSE;
+      break;
+    }
+    pthread_cond_wait(&pool->cond, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return rc;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+mark_helper() is the body of a helper thread.  It waits for the next
+round and joins it if  the  round   uses  this  helper,  i.e., gc_threads
+may have been lowered since the helper was created.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void *
+mark_helper(void *closure)
+{ mark_worker *w = closure;
+  mark_pool *pool = w->pool;
+
+  for(;;)
+  { PL_local_data_t *__PL_ld;
+    int join;
+
+    pthread_mutex_lock(&pool->mutex);
+    while( pool->round == w->round )
+      pthread_cond_wait(&pool->cond, &pool->mutex);
+    w->round = pool->round;
+    join = (w->index < pool->size);
+    __PL_ld = pool->ld;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if ( join )
+    { while( get_marks(w, FALSE) )
+	scan_marks(w PASS_LD);
+
+      pthread_mutex_lock(&pool->mutex);
+      if ( --pool->running == 0 )
+	pthread_cond_broadcast(&pool->cond);
+      pthread_mutex_unlock(&pool->mutex);
+    }
+  }
+
+  return NULL;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+mark_flush() completes marking all  cells   pushed  by mark_variable().
+Afterwards all workers are idle and  we   collect  their statistics such
+that total_marked and needs_relocation are exact.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+mark_flush(ARG1_LD)
+{ mark_pool *pool = LD->gc.mark_pool;
+  mark_worker *w;
+  int i;
+
+  if ( !pool || pool->workers[0]->top == pool->workers[0]->base )
+    return;
+
+  w = pool->workers[0];
+  pthread_mutex_lock(&pool->mutex);
+  pool->active++;
+  pthread_mutex_unlock(&pool->mutex);
+  do
+  { scan_marks(w PASS_LD);
+  } while( get_marks(w, TRUE) );
+
+  for(i=0; i<pool->size; i++)
+  { w = pool->workers[i];
+    total_marked     += w->marked;
+    needs_relocation += w->relocations;
+    w->marked = w->relocations = 0;
+  }
+}
+
+
+static void
+mark_root(Word start ARG_LD)
+{ mark_pool *pool = LD->gc.mark_pool;
+
+  if ( is_marked(start) )
+    sysError("Attempt to mark twice");
+
+  if ( onStackArea(local, start) )
+  { markLocal(start);
+    ldomark(start);
+  } else
+  { domark(start);
+  }
+  push_mark(pool->workers[0], start);
+}
+
+
+static mark_worker *
+new_mark_worker(mark_pool *pool)
+{ mark_worker *w;
+
+  if ( !(w = calloc(1, sizeof(*w))) )
+    return NULL;
+  w->pool  = pool;
+  w->index = pool->allocated;
+  w->round = pool->round;
+
+  return w;
+}
+
+
+static mark_pool *
+new_mark_pool(int threads)
+{ mark_pool *pool;
+
+  if ( !(pool = calloc(1, sizeof(*pool))) ||
+       !(pool->workers = calloc(threads, sizeof(mark_worker*))) ||
+       !(pool->workers[0] = new_mark_worker(pool)) )
+  { if ( pool )
+    { free(pool->workers);
+      free(pool);
+    }
+    return NULL;
+  }
+  pool->allocated = 1;
+  pool->pid = getpid();
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+
+  return pool;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+add_mark_helpers() creates helpers until the  pool has `threads` workers.
+Must be called by the owner of the pool outside a round.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+add_mark_helpers(mark_pool *pool, int threads)
+{ mark_worker **workers;
+
+  if ( !(workers = realloc(pool->workers, threads*sizeof(mark_worker*))) )
+    return;
+  pool->workers = workers;
+
+  while( pool->allocated < threads )
+  { mark_worker *w;
+
+    if ( !(w = new_mark_worker(pool)) )
+      return;
+    if ( pthread_create(&w->thread, NULL, mark_helper, w) != 0 )
+    { free(w);
+      return;
+    }
+    pthread_detach(w->thread);
+    pool->workers[pool->allocated++] = w;
+  }
+}
+
+
+static void
+mark_pool_start(ARG1_LD)
+{ mark_pool *pool;
+  int threads = GD->gc.threads;
+
+  if ( threads <= 1 || gTop - LD->gen_bar < MARK_PAR_MIN_CELLS )
+    return;
+#if O_DEBUG
+  if ( DEBUGGING(CHK_SECURE) )
+    return;				/* recordMark() is not thread-safe */
+#endif
+
+  if ( !COMPARE_AND_SWAP(&gc_mark_pool_busy, FALSE, TRUE) )
+    return;				/* in use by another thread */
+
+  if ( (pool=gc_mark_pool) && pool->pid != getpid() )
+    pool = NULL;			/* forked: helpers are gone */
+  if ( !pool && !(pool = gc_mark_pool = new_mark_pool(threads)) )
+  { gc_mark_pool_busy = FALSE;
+    return;
+  }
+  if ( pool->allocated < threads )
+    add_mark_helpers(pool, threads);
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->ld      = LD;
+  pool->size    = (threads < pool->allocated ? threads : pool->allocated);
+  pool->active  = pool->size-1;
+  pool->running = pool->size-1;
+  pool->stop    = FALSE;
+  pool->round++;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  LD->gc.mark_pool = pool;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+mark_pool_stop() completes marking, waits  for   the  helpers to leave the
+round and releases the pool. The mark  stacks are freed as a collection
+of a huge stack may have made them large.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+mark_pool_stop(ARG1_LD)
+{ mark_pool *pool = LD->gc.mark_pool;
+  int i;
+
+  if ( !pool )
+    return;
+
+  mark_flush(PASS_LD1);
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = TRUE;
+  pthread_cond_broadcast(&pool->cond);
+  while( pool->running > 0 )
+    pthread_cond_wait(&pool->cond, &pool->mutex);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for(i=0; i<pool->size; i++)
+  { mark_worker *w = pool->workers[i];
+
+    free(w->base);
+    w->base = w->top = w->max = NULL;
+  }
+
+  LD->gc.mark_pool = NULL;
+  MemoryBarrier();
+  gc_mark_pool_busy = FALSE;
+}
+
+#else /*O_PLMT*/
+
+#define mark_flush(ld)		(void)0
+#define mark_pool_start(ld)	(void)0
+#define mark_pool_stop(ld)	(void)0
+
+#endif /*O_PLMT*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 References from foreign code.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -949,6 +1488,109 @@ term_refs_to_gvars(fid_t fid, Word *saved_bar_at)
 
 #endif /*O_GVAR*/
 
+
+		 /*******************************
+		 *	    GENERATIONS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+minor_gc() decides whether the next   collection can be restricted to the
+young generation. See GENERATIONS at the start of this file.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+minor_gc(ARG1_LD)
+{ Stack s = (Stack)&LD->stacks.global;
+  size_t old = (char*)LD->gen_bar - (char*)gBase;
+
+  if ( !truePrologFlag(PLFLAG_GC_GENERATIONAL) ||
+       LD->gc.major_request ||
+       LD->exception.processing )
+    return FALSE;
+  if ( LD->gen_bar <= gBase || LD->gen_bar >= gTop )
+    return FALSE;			/* no old or no young data */
+  if ( old > s->factor*LD->gc.old_size + s->small )
+    return FALSE;			/* old generation has grown */
+  if ( usedStackP(s) > (size_t)limitStackP(s)/2 )
+    return FALSE;			/* short of global stack */
+
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The remembered set of a minor collection are   the cells of the old
+generation on the trail  that  refer  to   the  young  generation.  We
+copy them into term  references  that   are  marked  and relocated like
+other term references and copy them back after the collection. `cells'
+holds the addresses of the  old  cells.   As  a  cell  may  be trailed
+multiple times we use the  FIRST  mark   to  copy  it only once.  The
+marks are removed before the mark phase starts.
+
+count_remembered() returns an upper bound used to reserve local stack.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+count_remembered(ARG1_LD)
+{ TrailEntry te;
+  size_t count = 0;
+
+  for(te = tBase; te < tTop; te++)
+  { Word p = te->address;
+
+    if ( !isTrailVal(p) && is_old(p) )
+      count++;
+  }
+
+  return count;
+}
+
+
+static fid_t
+remembered_to_term_refs(Word *cells, size_t *count ARG_LD)
+{ fid_t fid = PL_open_foreign_frame();
+  TrailEntry te;
+  size_t i, n = 0;
+
+  for(te = tBase; te < tTop; te++)
+  { Word p = te->address;
+
+    if ( !isTrailVal(p) && is_old(p) && !is_first(p) &&
+	 isGlobalRef(*p) && !is_old(val_ptr(*p)) )
+    { term_t t = PL_new_term_ref_noshift();
+
+      assert(t && n < *count);
+      *valTermRef(t) = *p;
+      mark_first(p);
+      cells[n++] = p;
+    }
+  }
+
+  for(i=0; i<n; i++)
+    unmark_first(cells[i]);
+
+  DEBUG(MSG_GC_PROGRESS,
+	Sdprintf("Remembered set: %ld cells\n", (long)n));
+  *count = n;
+
+  return fid;
+}
+
+
+static void
+term_refs_to_remembered(fid_t fid, Word *cells, size_t count ARG_LD)
+{ FliFrame fr = (FliFrame) valTermRef(fid);
+  Word fp = (Word)(fr+1);
+  size_t i;
+
+  assert((size_t)fr->size == count);
+  for(i=0; i<count; i++)
+    *cells[i] = fp[i];
+
+  PL_close_foreign_frame(fid);
+}
+
+
 #define UWRITE 0x1
 #define LARGP  0x2
 
@@ -1027,6 +1669,33 @@ term_refs_to_argument_stack(vm_state *state, fid_t fid)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+building_term() is true if the VM is filling the arguments of a term on
+the global stack, i.e., ARGP or a saved  ARGP on the argument stack points
+into a global structure.  These arguments are written without trailing.
+If the structure became part of the old generation, the young data stored
+in it would not be in the remembered set.  Therefore garbageCollect() does
+not create an old generation in this case and the next collection is a
+major one.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+building_term(vm_state *state ARG_LD)
+{ if ( state->save_argp )
+  { Word *ap;
+
+    if ( onGlobal(LD->query->registers.argp) )
+      return TRUE;
+    for(ap=aBase; ap<aTop; ap++)
+    { if ( onGlobal((Word)((word)*ap & ~UWRITE)) )
+	return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
 #ifdef O_CALL_RESIDUE
 static size_t
 count_need_protection_attvars(ARG1_LD)
@@ -1084,19 +1753,20 @@ clearUninitialisedVarsFrame(LocalFrame fr, Code PC);
 Assuming the clause associated will resume   execution  at PC, determine
 the variables that are not yet initialised and set them to be variables.
 This  avoids  the  garbage  collector    considering  the  uninitialised
-variables.
+variables.  Both the inlined code and the normal call of I_INLINED are
+walked as it is not known which of the two will run.
 
 [Q] wouldn't it be better to track  the variables that *are* initialised
 and consider the others to be not?  Might   take more time, but might be
 more reliable and simpler.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-void
-clearUninitialisedVarsFrame(LocalFrame fr, Code PC)
+static void
+clearUninitialisedVars(LocalFrame fr, Code PC, Code until)
 { if ( PC != NULL )
   { code c;
 
-    for( ; ; PC = stepPC(PC))
+    for( ; PC != until; PC = stepPC(PC))
     { c = fetchop(PC);
 
     again:
@@ -1114,9 +1784,22 @@ clearUninitialisedVarsFrame(LocalFrame fr, Code PC)
 
 	case C_JMP:			/* jumps */
 	  PC += (int)PC[1]+2;
+	  if ( PC == until )
+	    return;
 	  c = fetchop(PC);
 	  goto again;
 
+#ifdef O_INLINE_CALLS
+	case I_INLINED:			/* I_INLINED <proc> <gen> <jmp1> */
+	{ Code alt = PC+PC[3]+4;	/* the normal call */
+
+	  clearUninitialisedVars(fr, PC+4, alt-2);
+	  PC = alt;
+	  c = fetchop(PC);
+	  goto again;
+	}
+#endif
+
 	case H_FIRSTVAR:		/* Firstvar assignments */
 	case B_FIRSTVAR:
 	case B_ARGFIRSTVAR:
@@ -1158,6 +1841,12 @@ clearUninitialisedVarsFrame(LocalFrame fr, Code PC)
 }
 
 
+void
+clearUninitialisedVarsFrame(LocalFrame fr, Code PC)
+{ clearUninitialisedVars(fr, PC, NULL);
+}
+
+
 static inline int
 slotsInFrame(LocalFrame fr, Code PC)
 { Definition def = fr->predicate;
@@ -1276,6 +1965,7 @@ early_reset_vars(mark *m, Word top, GCTrailEntry te ARG_LD)
   int assignments = 0;
   Word gKeep = (LD->frozen_bar > m->globaltop ? LD->frozen_bar : m->globaltop);
 
+  mark_flush(PASS_LD1);
   for( ; te >= tm; te-- )		/* early reset of vars */
   {
 #if O_DESTRUCTIVE_ASSIGNMENT
@@ -1287,12 +1977,12 @@ early_reset_vars(mark *m, Word top, GCTrailEntry te ARG_LD)
 	te--;
 	te->address = 0;
 	trailcells_deleted += 2;
-      } else if ( is_marked(tard) )
+      } else if ( is_marked_or_old(tard) )
       { Word gp = val_ptr(te->address);
 
 	assert(onGlobal(gp));
 	assert(!is_first(gp));
-	if ( !is_marked(gp) )
+	if ( !is_marked_or_old(gp) )
 	{ DEBUG(MSG_GC_ASSIGNMENTS_MARK,
 		char b1[64]; char b2[64]; char b3[64];
 		Sdprintf("Marking assignment at %s (%s --> %s)\n",
@@ -1301,6 +1991,7 @@ early_reset_vars(mark *m, Word top, GCTrailEntry te ARG_LD)
 			 print_val(*tard, b3)));
 
 	  mark_variable(gp PASS_LD);
+	  mark_flush(PASS_LD1);
 	  assert(is_marked(gp));
 	}
 
@@ -1336,7 +2027,7 @@ early_reset_vars(mark *m, Word top, GCTrailEntry te ARG_LD)
       } else if ( tard > gKeep && tard < gMax )
       { te->address = 0;
 	trailcells_deleted++;
-      } else if ( !is_marked(tard) )
+      } else if ( !is_marked_or_old(tard) )
       { DEBUG(MSG_GC_RESET,
 	      char b1[64]; char b2[64];
 	      Sdprintf("Early reset at %s (%s)\n",
@@ -1671,6 +2362,18 @@ walk_and_mark(walk_state *state, Code PC, code end ARG_LD)
 	op = decode(*PC++);
         goto again;
       }
+#ifdef O_INLINE_CALLS
+      case I_INLINED:			/* I_INLINED <proc> <gen> <jmp1> */
+	if ( (state->flags & GCM_ALTCLAUSE) )
+	  break;
+      { Code alt = PC+PC[2]+3;		/* the normal call */
+	DEBUG(MSG_GC_WALK, Sdprintf("I_INLINED at %d\n", PC-state->c0-1));
+	walk_and_mark(state, PC+3, C_JMP PASS_LD);
+	PC = alt;
+	op = decode(*PC++);
+        goto again;
+      }
+#endif
 
 					/* variable access */
 
@@ -2110,8 +2813,10 @@ mark_phase(vm_state *state)
   total_marked = 0;
 
   DEBUG(CHK_SECURE, check_marked("Before mark_term_refs()"));
+  mark_pool_start(PASS_LD1);
   mark_term_refs();
   mark_stacks(state);
+  mark_pool_stop(PASS_LD1);
 
   DEBUG(CHK_SECURE,
 	{ if ( !scan_global(TRUE) )
@@ -2447,6 +3152,10 @@ sweep_global_mark(Word *m ARG_LD)
 
   DEBUG(CHK_SECURE, assert(onStack(local, m)));
   gm = *m;
+  if ( gm <= LD->gen_bar )		/* old generation does not move */
+  { *m = (Word)consPtr(gm, STG_GLOBAL);
+    return;
+  }
   if ( is_marked_or_first(gm-1) )
     goto done;				/* quit common easy case */
 
@@ -2523,8 +3232,10 @@ sweep_foreign()
       {	unmark(sp);
 	if ( isGlobalRef(get_value(sp)) )
 	{ processLocal(sp);
-	  check_relocation(sp);
-	  into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	  if ( !is_old(val_ptr(get_value(sp))) )
+	  { check_relocation(sp);
+	    into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	  }
 	}
       }
     }
@@ -2596,7 +3307,8 @@ sweep_trail(void)
 
   for( ; te >= (GCTrailEntry)tBase; te-- )
   { if ( te->address )
-    {
+    { if ( is_old(val_ptr((word)te->address)) )
+	continue;			/* minor GC: old cell */
 #ifdef O_DESTRUCTIVE_ASSIGNMENT
       if ( ttag(te->address) == TAG_TRAILVAL )
       { needsRelocation(&te->address);
@@ -2625,8 +3337,10 @@ sweep_frame(LocalFrame fr, int slots ARG_LD)
     { unmark(sp);
       if ( isGlobalRef(get_value(sp)) )
       { processLocal(sp);
-	check_relocation(sp);
-	into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	if ( !is_old(val_ptr(get_value(sp))) )
+	{ check_relocation(sp);
+	  into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	}
       }
     } else
     { if ( isGlobalRef(*sp) )
@@ -2697,8 +3411,10 @@ sweep_new_arguments(vm_state *state ARG_LD)
       unmark(sp);
       if ( isGlobalRef(get_value(sp)) )
       { processLocal(sp);
-	check_relocation(sp);
-	into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	if ( !is_old(val_ptr(get_value(sp))) )
+	{ check_relocation(sp);
+	  into_relocation_chain(sp, STG_LOCAL PASS_LD);
+	}
       }
     }
   }
@@ -2795,7 +3511,7 @@ is_downward_ref(Word p ARG_LD)
 
       DEBUG(CHK_SECURE, assert(d >= gBase));
 
-      return d < p;
+      return d < p && !is_old(d);
     }
   }
 
@@ -2837,7 +3553,8 @@ check_marked(const char *s)
   Word current;
   intptr_t cells = 0;
 
-  for( current = gBase; current < gTop; current += (offset_cell(current)+1) )
+  for( current = LD->gen_bar; current < gTop;
+       current += (offset_cell(current)+1) )
   { cells++;
     if ( is_marked(current) )
     { m += (offset_cell(current)+1);
@@ -2912,7 +3629,7 @@ static void
 compact_global(void)
 { GET_LD
   Word dest, current;
-  Word base = gBase, top;
+  Word base = LD->gen_bar, top;		/* gBase for a major GC */
 #if O_DEBUG
   Word *v = mark_top;
 #endif
@@ -2970,8 +3687,8 @@ compact_global(void)
 	});
 
   if ( dest != base )
-    sysError("Mismatch in down phase: dest = %p, gBase = %p\n",
-	     dest, gBase);
+    sysError("Mismatch in down phase: dest = %p, base = %p\n",
+	     dest, base);
   if ( relocation_cells != relocated_cells )
   { DEBUG(CHK_SECURE, printNotRelocated());
     sysError("After down phase: relocation_cells = %ld; relocated_cells = %ld",
@@ -2984,7 +3701,7 @@ compact_global(void)
 
   dest = base;
   top = gTop;
-  for(current = gBase; current < top; )
+  for(current = base; current < top; )
   { if ( is_marked(current) )
     { intptr_t l, n;
 
@@ -3023,9 +3740,9 @@ compact_global(void)
     }
   }
 
-  if ( dest != gBase + total_marked )
-    sysError("Mismatch in up phase: dest = %p, gBase+total_marked = %p\n",
-	     dest, gBase + total_marked );
+  if ( dest != base + total_marked )
+    sysError("Mismatch in up phase: dest = %p, base+total_marked = %p\n",
+	     dest, base + total_marked );
 
   DEBUG(CHK_SECURE,
 	{ Word p = dest;		/* clear top of stack */
@@ -3310,8 +4027,15 @@ If s == NULL, consider all stacks
 repetetive GC calls while building large   structures  from foreign code
 that calls PL_handle_signals() from time to   time  to enable interrupts
 and call GC.
+
+If the Prolog flag `gc_stress` is true we  collect as soon as a stack grew
+GC_STRESS_SPACE bytes since the last collection. This keeps the young
+generation tiny and is used to test the write barrier of the generational
+collector. See setUntrailed().
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#define GC_STRESS_SPACE (4096*sizeof(word))
+
 int
 considerGarbageCollect(Stack s)
 { GET_LD
@@ -3335,7 +4059,11 @@ considerGarbageCollect(Stack s)
 	  return FALSE;
 	}
 
-	if ( used > s->factor*s->gced_size + s->small )
+	if ( truePrologFlag(PLFLAG_GC_STRESS) &&
+	     used > s->gced_size + GC_STRESS_SPACE )
+	{ DEBUG(MSG_GC_SCHEDULE, Sdprintf("GC: stress request\n"));
+	  return PL_raise(SIG_GC);
+	} else if ( used > s->factor*s->gced_size + s->small )
 	{ DEBUG(MSG_GC_SCHEDULE,
 		Sdprintf("GC: request on %s, factor=%d, last=%ld, small=%ld\n",
 			 s->name, s->factor, s->gced_size, s->small));
@@ -3777,10 +4505,13 @@ given vm-state.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
-gcEnsureSpace(vm_state *state ARG_LD)
+gcEnsureSpace(vm_state *state, size_t remembered ARG_LD)
 { int rc = TRUE;
   size_t lneeded = 0;
 
+  if ( remembered )
+    lneeded += sizeof(struct fliFrame) + remembered*sizeof(word);
+
   if ( LD->gvar.grefs )
     lneeded += sizeof(struct fliFrame) + LD->gvar.grefs*sizeof(word);
   if ( LD->frozen_bar )
@@ -3843,8 +4574,11 @@ garbageCollect(void)
   int verbose = truePrologFlag(PLFLAG_TRACE_GC);
   int no_mark_bar;
   int rc;
-  fid_t gvars, astack, attvars;
+  int minor;
+  fid_t gvars, astack, attvars, remembered = 0;
   Word *saved_bar_at;
+  Word *rcells = NULL;
+  size_t rcount = 0;
 #ifdef O_PROFILE
   struct call_node *prof_node = NULL;
 #endif
@@ -3859,10 +4593,22 @@ garbageCollect(void)
   save_backtrace("GC");
 #endif
 
+  if ( (minor=minor_gc(PASS_LD1)) )
+  { if ( (rcount=count_remembered(PASS_LD1)) &&
+	 !(rcells = malloc(rcount*sizeof(Word))) )
+      minor = FALSE;
+  }
+  if ( !minor )
+  { LD->gen_bar = gBase;
+    rcount = 0;
+  }
+
   get_vmi_state(LD->query, &state);
   safeLTop = lTop;
-  if ( (rc=gcEnsureSpace(&state PASS_LD)) < 0 )
-  { return rc;
+  if ( (rc=gcEnsureSpace(&state, rcount PASS_LD)) < 0 )
+  { if ( rcells )
+      free(rcells);
+    return rc;
   } else if ( rc == FALSE )		/* shifted; reload */
   { get_vmi_state(LD->query, &state);
   }
@@ -3926,25 +4672,46 @@ garbageCollect(void)
   attvars = link_attvars(PASS_LD1);
   astack = argument_stack_to_term_refs(&state);
   gvars = gvars_to_term_refs(&saved_bar_at);
+  if ( rcount )
+    remembered = remembered_to_term_refs(rcells, &rcount PASS_LD);
   save_grefs(PASS_LD1);
   DEBUG(CHK_SECURE, check_foreign());
   tag_trail(PASS_LD1);
   mark_phase(&state);
   tgar = trailcells_deleted * sizeof(struct trail_entry);
-  ggar = (gTop - gBase - total_marked) * sizeof(word);
+  ggar = (gTop - LD->gen_bar - total_marked) * sizeof(word);
   gc_status.global_gained += ggar;
   gc_status.trail_gained  += tgar;
   gc_status.collections++;
+  if ( minor )
+    gc_status.minor_collections++;
 
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Compacting trail\n"));
   compact_trail();
+  if ( minor )				/* stop downward scans */
+    set_marked(LD->gen_bar-1);
   collect_phase(&state, saved_bar_at);
+  if ( minor )
+  { clear_marked(LD->gen_bar-1);
+    if ( remembered )
+      term_refs_to_remembered(remembered, rcells, rcount PASS_LD);
+    if ( rcells )
+      free(rcells);
+  } else
+  { LD->gc.old_size = usedStack(global);
+    LD->gc.major_request = FALSE;
+  }
+  LD->gen_bar = (truePrologFlag(PLFLAG_GC_GENERATIONAL) ? gTop : gBase);
   restore_grefs(PASS_LD1);
   untag_trail(PASS_LD1);
   clean_attvar_chain(PASS_LD1);
 
   term_refs_to_gvars(gvars, saved_bar_at);
   term_refs_to_argument_stack(&state, astack);
+  if ( building_term(&state PASS_LD) )
+    LD->gen_bar = gBase;
+  if ( LD->mark_bar < LD->gen_bar )	/* trail all bindings of old cells */
+    LD->mark_bar = LD->gen_bar;
   restore_attvars(attvars PASS_LD);
 
   assert(LD->mark_bar <= gTop);
@@ -4013,7 +4780,7 @@ garbageCollect(void)
 
 word
 pl_garbage_collect(term_t d)
-{
+{ GET_LD
 #if O_DEBUG
   int ol = GD->debug_level;
   int nl;
@@ -4024,6 +4791,7 @@ pl_garbage_collect(term_t d)
     GD->debug_level = nl;
   }
 #endif
+  LD->gc.major_request = TRUE;		/* explicit GC collects all */
   garbageCollect();
 #if O_DEBUG
   GD->debug_level = ol;
@@ -4570,6 +5338,8 @@ update_stacks(vm_state *state, void *lb, void *gb, void *tb)
   if ( gs && LD->mark_bar != NO_MARK_BAR )
   { update_pointer(&LD->mark_bar, gs);
   }
+  if ( gs )
+    update_pointer(&LD->gen_bar, gs);
 }
 
 
@@ -5089,19 +5859,35 @@ markAtomsOnStacks(PL_local_data_t *ld)
 
 #ifdef O_CLAUSEGC
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+markPredicatesInEnvironments() is called  by   garbage_collect_clauses/0
+for each thread. The thread publishes  two   things  and  then continues
+running:
+
+  - The oldest generation of a frame running a static predicate with
+    erased clauses in ld->clauses.oldest_generation. A clause erased at
+    generation E cannot be visible for frames of generation E or later.
+  - Marks (clause_gc_mark) on the registered dirty predicates that may
+    hold a reference to one of their clauses outside the clause chain:
+    a CHP_CLAUSE choicepoint, a  foreign  clause  choicepoint  or a
+    clause walk in progress.  Such a walk  is  either done from C (see
+    ld->clauses.walking) or by the  VM   for  the  current frame of one
+    of the queries.  Frames that just run  a clause only reference this
+    clause, which is still visible to them.
+
 This is much like  check_environments(),  but   as  we  might  be called
 asynchronously, we have to be a bit careful about the first frame (if PC
 == NULL). The interpreter will  set  the   clause  field  to NULL before
-opening the frame, and we only have   to  consider the arguments. If the
-frame has a clause we must consider all variables of this clause.
-
-This  routine  is  used   by    garbage_collect_clauses/0   as  well  as
-start_consult/1. In the latter case, only  predicates in this sourcefile
-are marked.
+opening the frame.  If the thread is   in the middle of a garbage
+collection or stack shift its stacks   are not consistent and we publish
+generation 0, which makes garbage_collect_clauses/0 skip this round.
 
 Predicates marked with P_FOREIGN_CREF are   foreign  predicates that use
 the frame->clause choicepoint info for  storing the clause-reference for
-the next clause. Amoung these are retract/1, clause/2, etc.
+the next clause. Amoung these are retract/1, clause/2, etc. If such a
+predicate is the current frame of a query it may be updating or freeing
+this context, so we do not look at it and mark all predicates with
+retired clauses instead.  discardForeignFrame() clears frame->clause
+before the context is freed.
 
 (*) we must *not* use  getProcDefinition()  here   because  we  are in a
 signal handler and thus the locking there for thread-local predicates is
@@ -5109,14 +5895,29 @@ not safe. That is no problem however,  because we are only interested in
 static predicates. Note that clause/2,  etc.   use  the choice point for
 searching clauses and thus chp->cref may become NULL if all clauses have
 been searched.
-
-(**) This avoids duplicate marks. Note that we   have no option if we do
-not have atomic instructions because we  cannot   use  mutexes as we are
-inside a signal handler.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static inline void
+mark_clause_walk(Definition def)
+{ if ( def && true(def, P_DIRTYREG) )
+  { DEBUG(MSG_CLAUSE_GC, Sdprintf("Marking %s\n", predicateName(def)));
+    def->clause_gc_mark = TRUE;
+  }
+}
+
+
+static void
+mark_retired_definitions(void)
+{ RetiredClauses rc;
+
+  for(rc = GD->procedures.retired; rc; rc = rc->next)
+    rc->definition->clause_gc_mark = TRUE;
+}
+
+
 static QueryFrame
-mark_predicates_in_environments(PL_local_data_t *ld, LocalFrame fr)
+mark_predicates_in_environments(PL_local_data_t *ld, LocalFrame fr,
+				int running, gen_t *oldest)
 { if ( fr == NULL )
     return NULL;
 
@@ -5130,49 +5931,38 @@ mark_predicates_in_environments(PL_local_data_t *ld, LocalFrame fr)
 
 				/* P_FOREIGN_CREF: clause, etc. choicepoints */
 
-    if ( true(fr->predicate, P_FOREIGN_CREF) && fr->clause )
+    if ( running && true(fr->predicate, P_FOREIGN_CREF) )
+    { gen_t gen = generationFrame(fr);
+
+      mark_retired_definitions();
+      if ( gen < *oldest )
+	*oldest = gen;
+      def = NULL;
+    } else if ( true(fr->predicate, P_FOREIGN_CREF) && fr->clause )
     { ClauseChoice chp = (ClauseChoice)fr->clause;
       ClauseRef cref;
 
       if ( chp && (cref=chp->cref) )
-	def = cref->value.clause->procedure->definition; /* See (*) above */
-      else
+      { def = cref->value.clause->procedure->definition; /* See (*) above */
+	mark_clause_walk(def);
+      } else
 	def = NULL;
     } else
       def = fr->predicate;
 
     if ( def &&
 	 false(def, P_DYNAMIC) &&
-	 def->references == 0 )		/* already done */
-    { if ( GD->procedures.reloading )
-      { ListCell cell;			/* startConsult() */
-
-	for(cell=GD->procedures.reloading->procedures; cell; cell=cell->next)
-	{ Procedure proc = cell->value;
-
-	  if ( proc->definition == def )
-	  { DEBUG(MSG_CLAUSE_GC, Sdprintf("Marking %s\n", predicateName(def)));
-#ifdef COMPARE_AND_SWAP			/* See (**) above */
-	    if ( COMPARE_AND_SWAP(&def->references, 0, 1) )
-	      ATOMIC_INC(&GD->procedures.active_marked);
-#else
-	    if ( ++def->references == 1 )
-	      GD->procedures.active_marked++;
-#endif
-	    break;
-	  }
-	}
-      } else				/* pl_garbage_collect_clauses() */
-      { if ( true(def, NEEDSCLAUSEGC) )
-	{ DEBUG(MSG_CLAUSE_GC, Sdprintf("Marking %s\n", predicateName(def)));
-	  def->references = 1;
-	}
-      }
+	 true(def, NEEDSCLAUSEGC) )
+    { gen_t gen = generationFrame(fr);
+
+      if ( gen < *oldest )
+	*oldest = gen;
     }
 
     if ( fr->parent )
-      fr = fr->parent;
-    else
+    { fr = fr->parent;
+      running = FALSE;
+    } else
       return queryOfFrame(fr);
   }
 }
@@ -5183,8 +5973,17 @@ markPredicatesInEnvironments(PL_local_data_t *ld)
 { QueryFrame qf;
   LocalFrame fr;
   Choice ch;
+  gen_t oldest = ~(gen_t)0;
+
+#ifdef O_PLMT
+  if ( ld->gc.active )
+  { ld->clauses.oldest_generation = 0;
+    return;
+  }
+#endif
 
   ld->gc._local_frames = 0;
+  mark_clause_walk(ld->clauses.walking);
 
   for( fr = ld->environment,
        ch = ld->choicepoints
@@ -5192,17 +5991,22 @@ markPredicatesInEnvironments(PL_local_data_t *ld)
      ; fr = qf->saved_environment,
        ch = qf->saved_bfr
      )
-  { qf = mark_predicates_in_environments(ld, fr);
+  { mark_clause_walk(fr->predicate);	/* may be walking its clauses */
+    qf = mark_predicates_in_environments(ld, fr, TRUE, &oldest);
     assert(qf->magic == QID_MAGIC);
 
     for(; ch; ch = ch->parent)
-    { mark_predicates_in_environments(ld, ch->frame);
+    { if ( ch->type == CHP_CLAUSE )
+	mark_clause_walk(ch->frame->predicate);
+      mark_predicates_in_environments(ld, ch->frame, FALSE, &oldest);
     }
   }
 
   unmark_stacks(ld, ld->environment, ld->choicepoints, FR_MARKED_PRED);
 
   assert(ld->gc._local_frames == 0);
+
+  ld->clauses.oldest_generation = oldest;
 }
 
 
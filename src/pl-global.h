@@ -59,6 +59,9 @@ typedef struct
     code thread_local[3];		/* S_THREAD_LOCAL */
     code multifile[3];			/* S_MULTIFILE */
     code staticp[3];			/* S_STATIC */
+#ifdef O_FROZEN_INDEX
+    code frozen[3];			/* S_FROZEN */
+#endif
   } supervisors;
 } PL_code_data_t;
 
@@ -135,6 +138,14 @@ struct PL_global_data
   } profile;
 #endif
 
+#ifdef O_VMI_STATISTICS
+  struct
+  { int		active;			/* VMI_STAT_* */
+    struct vmi_stat_block *blocks;	/* Per-thread counters */
+    struct vmi_stat_block *retired;	/* Counters of finished threads */
+  } vmi_stat;
+#endif
+
   struct
   { Module	user;			/* user module */
     Module	system;			/* system predicate module */
@@ -160,6 +171,7 @@ struct PL_global_data
     atom_array	array;
     unsigned int buckets;		/* # buckets in char * --> atom */
     Atom *	table;			/* hash-table */
+    struct old_atom_table *old_tables;	/* Replaced tables (see rehashAtoms()) */
     Atom	builtin_array;		/* Builtin atoms */
     int		lookups;		/* # atom lookups */
     int		cmps;			/* # string compares for lookup */
@@ -183,6 +195,7 @@ struct PL_global_data
   struct
   { int		active;			/* #GC active */
     int		agc_waiting;		/* AGC is waiting for us */
+    int		threads;		/* gc_threads flag */
   } gc;
 #endif
 
@@ -274,12 +287,15 @@ struct PL_global_data
 #endif
     Procedure   comment_hook3;		/* prolog:comment_hook/3 */
 
-    SourceFile  reloading;		/* source file we are re-loading */
-    int		active_marked;		/* #prodedures marked active */
     int		static_dirty;		/* #static dirty procedures */
+    unsigned int inline_generation;	/* see updateInlineGeneration() */
 
 #ifdef O_CLAUSEGC
     DefinitionChain dirty;		/* List of dirty static procedures */
+    RetiredClauses retired;		/* Unlinked, not yet freed clauses */
+#endif
+#ifdef O_EPOCH_RECLAIM
+    Definition	reclaiming;		/* See reclaimDefinition() */
 #endif
   } procedures;
 
@@ -339,6 +355,7 @@ struct PL_local_data
 #ifdef O_GVAR
   Word		frozen_bar;		/* Frozen part of the global stack */
 #endif
+  Word		gen_bar;		/* Start of the young generation */
   pl_stacks_t   stacks;			/* Prolog runtime stacks */
   uintptr_t	bases[STG_MASK+1];	/* area base addresses */
   int		alerted;		/* Special mode. See updateAlerted() */
@@ -421,6 +438,10 @@ struct PL_local_data
   } gvar;
 #endif
 
+  struct
+  { struct tbl_data *data;		/* Thread tables, see pl-tabling.c */
+  } tabling;
+
   struct
   { int64_t	inferences;		/* inferences in this thread */
     uintptr_t	last_cputime;		/* milliseconds last CPU time */
@@ -459,14 +480,33 @@ struct PL_local_data
   } profile;
 #endif /* O_PROFILE */
 
+#ifdef O_VMI_STATISTICS
+  struct vmi_stat_block *vmi_stat;	/* VMI counters (see pl-prof.c) */
+#endif
+
   struct
   { Module	typein;			/* module for type in goals */
     Module	source;			/* module we are reading clauses in */
   } modules;
 
+#ifdef O_EPOCH_RECLAIM
+  struct
+  { shared_frames frames;		/* See enterSharedDefinition() */
+  } dynamic;
+#endif
+
+#ifdef O_CLAUSEGC
+  struct
+  { gen_t	oldest_generation;	/* See markPredicatesInEnvironments() */
+    Definition	walking;		/* C code walks its clauses */
+  } clauses;
+#endif
+
   struct
   { intptr_t	generator;		/* See PL_atom_generator() */
     atom_t	unregistering;		/* See PL_unregister_atom() */
+    volatile int lookup_active;		/* See lookupBlob() */
+    volatile int gc_mark;		/* AGC_MARK_*, see markAtomsThreads() */
   } atoms;
 
   struct
@@ -608,11 +648,16 @@ struct PL_local_data
     int  *_start_map;			/* bitmap with legal global starts */
     sigset_t saved_sigmask;		/* Saved signal mask */
     int64_t inferences;			/* #inferences at last GC */
+    size_t old_size;			/* Old generation after major GC */
+    int major_request;			/* Next GC must be a major one */
     pl_gc_status_t	status;		/* Garbage collection status */
 #ifdef O_CALL_RESIDUE
     int			marked_attvars;	/* do not GC attvars */
 #endif
     int active;				/* GC is running in this thread */
+#ifdef O_PLMT
+    struct mark_pool *mark_pool;	/* Parallel marking (pl-gc.c) */
+#endif
 					/* These must be at the end to be */
 					/* able to define O_DEBUG in only */
 					/* some modules */
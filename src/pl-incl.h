@@ -129,6 +129,49 @@ handy for it someone wants to add a data type to the system.
       Provide locale support on streams.
   O_GMP
       Use GNU gmp library for infinite precision arthmetic
+  O_DEEP_INDEX
+      Use clause-lists for popular functor keys  in  JIT hash indexes
+      and create secondary (deep) indexes  on  the  arguments  of  the
+      compound.  See pl-index.c.
+  O_VMI_STATISTICS
+      Allow counting the executed  virtual  machine  instructions  at
+      runtime.  See vmi_profiler/2 in pl-prof.c.
+  O_INLINE_CALLS
+      When optimising, inline calls to small static  predicates  of  the
+      same module.  See inlineCalls() in pl-comp.c.
+  O_DET_GUARDS
+      When optimising, compile the leading type tests and comparisons
+      of a clause into an I_GUARD instruction that cuts if the guards
+      of the remaining clauses are exclusive.  See pl-supervisor.c.
+  O_CALL_CACHE
+      Cache the definition found by call/N  in the I_USERCALLN
+      instruction.  See callCacheDefinition() in pl-wam.c.
+  O_RESOLVE_CACHE
+      Cache the procedures found by resolveProcedure() per module, so
+      calls through import modules need not search the module chain.
+      See resolveProcedure() in pl-proc.c.
+  O_FROZEN_INDEX
+      Allow for freezing the clause indexes of static predicates into
+      compact perfect hash tables.  See freeze_indexes/1 in pl-index.c.
+  O_EPOCH_RECLAIM
+      Track the use of shared dynamic predicates by per-thread frame
+      counts for each predicate rather than a reference count on the
+      definition.  This option
+      requires O_PLMT.  See reclaimDefinition() in pl-proc.c.
+  O_GROW_INDEX
+      Grow a clause index that has become too small by copying a few
+      buckets into a twice as large index on each assert, rather than
+      rebuilding it at once.  See growClauseIndex() in pl-index.c.
+  O_CONCURRENT_JIT
+      Build a new clause index for a dynamic or multifile predicate in
+      slices, releasing the predicate lock between slices.  Other calls
+      keep using the existing indexes until the new index is published.
+      This option requires O_PLMT.  See buildClauseIndex() in pl-index.c.
+  O_CONCURRENT_APPEND
+      Let assertz/1 on a shared dynamic predicate without clause indexes
+      link the clause at the end with compare-and-swap instead of taking
+      the predicate lock.  This option requires O_PLMT.  See
+      appendClauseDefinition() in pl-proc.c.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define O_COMPILE_OR		1
@@ -155,6 +198,21 @@ handy for it someone wants to add a data type to the system.
 #define O_CALL_RESIDUE		1
 #define O_GVAR			1
 #define O_CYCLIC		1
+#define O_DEEP_INDEX		1
+#define O_VMI_STATISTICS	1
+#define O_INLINE_CALLS		1
+#define O_DET_GUARDS		1
+#define O_CALL_CACHE		1
+#define O_RESOLVE_CACHE		1
+#define O_FROZEN_INDEX		1
+#ifdef O_PLMT
+#define O_EPOCH_RECLAIM		1
+#endif
+#define O_GROW_INDEX		1
+#ifdef O_PLMT
+#define O_CONCURRENT_JIT	1
+#define O_CONCURRENT_APPEND	1
+#endif
 
 #ifdef HAVE_GMP_H
 #define O_GMP			1
@@ -495,6 +553,7 @@ sizes  of  the  hash  tables are defined.  Note that these should all be
 #define MODULEPROCEDUREHASHSIZE 16	/* predicates in other modules */
 #define MODULEHASHSIZE		16	/* global module table */
 #define PUBLICHASHSIZE		8	/* Module export table */
+#define RESOLVECACHESIZE	32	/* Module resolveProcedure() cache */
 #define FLAGHASHSIZE		16	/* global flag/3 table */
 
 #include "os/pl-table.h"
@@ -651,10 +710,12 @@ typedef struct functorDef *	FunctorDef;	/* name/arity pair */
 typedef struct procedure *	Procedure;	/* predicate */
 typedef struct definition *	Definition;	/* predicate definition */
 typedef struct definition_chain *DefinitionChain; /* linked list of defs */
+typedef struct retired_clauses *RetiredClauses; /* see clause-GC */
 typedef struct clause *		Clause;		/* compiled clause */
 typedef struct clause_ref *	ClauseRef;      /* reference to a clause */
 typedef struct clause_index *	ClauseIndex;    /* Clause indexing table */
 typedef struct clause_bucket *	ClauseBucket;   /* Bucked in clause-index table */
+typedef struct frozen_index *	FrozenIndex;	/* Frozen (perfect hash) index */
 typedef struct operator *	Operator;	/* see pl-op.c, pl-read.c */
 typedef struct record *		Record;		/* recorda/3, etc. */
 typedef struct recordRef *	RecordRef;      /* reference to a record */
@@ -810,6 +871,7 @@ with one operation, it turns out to be faster as well.
 
 /* Flags on predicates (packed in unsigned int */
 
+#define P_SHARED		(0x00000002) /* See enterSharedDefinition() */
 #define P_QUASI_QUOTATION_SYNTAX	(0x00000004) /* <![Type[Quasi Quote]]> */
 #define P_NON_TERMINAL		(0x00000008) /* Grammar rule (Name//Arity) */
 #define P_SHRUNKPOW2		(0x00000010) /* See reconsider_index() */
@@ -903,6 +965,7 @@ Macros for environment frames (local stack frames)
 #define FR_INBOX		(0x0040) /* Inside box (for REDO in built-in) */
 #define FR_CONTEXT		(0x0080) /* fr->context is set */
 #define FR_CLEANUP		(0x0100) /* setup_call_cleanup/4: marked for cleanup */
+#define FR_SHARED_DEF		(0x0200) /* Counted on shared dynamic predicate */
 
 #define ARGOFFSET		((int)sizeof(struct localFrame))
 #define VAROFFSET(var)		((var)+(ARGOFFSET/(int)sizeof(word)))
@@ -965,7 +1028,8 @@ typedef uint64_t lgen_t;
 #define setNextFrameFlags(next, fr) \
 	do \
 	{ (next)->level = (fr)->level+1; \
-	  (next)->flags = ((fr)->flags) & ~(FR_CLEAR_NEXT|FR_CONTEXT); \
+	  (next)->flags = ((fr)->flags) & \
+			  ~(FR_CLEAR_NEXT|FR_CONTEXT|FR_SHARED_DEF); \
 	} while(0)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -974,15 +1038,49 @@ modifying the predicate structure while  it   has  choicepoints  or (MT)
 other threads running the predicate. For dynamic  code we allow to clean
 the predicate as the reference-count drops to   zero. For static code we
 introduce a garbage collector (TBD).
+
+enterDefinition() returns TRUE if the call was counted as a frame on a
+shared dynamic predicate. This value must be passed to leaveDefinition(),
+such that a predicate that changes between   dynamic and static while
+running is left the same way it was  entered. Frames keep it in the flag
+FR_SHARED_DEF (see enterFrameDefinition()).
+
+With O_EPOCH_RECLAIM, shared dynamic predicates   (P_SHARED) are not
+reference counted. Instead, each thread counts  its active frames on each
+such predicate in LD->dynamic, so calls do   not write to the shared
+definition. Erased clauses of a predicate are   reclaimed when no thread
+counts a frame on it. See enterSharedDefinition() and reclaimDefinition().
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#ifdef O_EPOCH_RECLAIM
+#define SHARED_FRAMES_BLOCK 8		/* entries per shared_frames block */
+
+typedef struct shared_frames
+{ struct shared_frames *next;		/* next block */
+  struct
+  { Definition	definition;		/* shared dynamic predicate */
+    unsigned int frames;		/* # frames of this thread on it */
+  } entries[SHARED_FRAMES_BLOCK];
+} shared_frames;
+
 #define enterDefinition(def) \
-	if ( unlikely(true(def, P_DYNAMIC)) ) \
-	{ LOCKDYNDEF(def); \
-	  def->references++; \
-	  UNLOCKDYNDEF(def); \
+	( unlikely(true(def, P_DYNAMIC)) ? \
+	  enterDynamicDefinition(def PASS_LD) : FALSE )
+#define leaveDefinition(def, shared) \
+	if ( unlikely(shared) ) \
+	{ leaveSharedDefinition(def PASS_LD); \
+	} else if ( unlikely(true(def, P_DYNAMIC)) && \
+		    false(def, P_SHARED) ) \
+	{ if ( --def->references == 0 && \
+	       true(def, NEEDSCLAUSEGC) ) \
+	  { gcClausesDefinition(def); \
+	  } \
 	}
-#define leaveDefinition(def) \
+#else
+#define enterDefinition(def) \
+	( unlikely(true(def, P_DYNAMIC)) ? \
+	  enterDynamicDefinition(def) : FALSE )
+#define leaveDefinition(def, shared) \
 	if ( unlikely(true(def, P_DYNAMIC)) ) \
 	{ LOCKDYNDEF(def); \
 	  if ( --def->references == 0 && \
@@ -992,6 +1090,19 @@ introduce a garbage collector (TBD).
 	  { UNLOCKDYNDEF(def); \
 	  } \
 	}
+#endif
+
+#define enterFrameDefinition(fr, def) \
+	do \
+	{ if ( enterDefinition(def) ) \
+	    set(fr, FR_SHARED_DEF); \
+	} while(0)
+#define leaveFrameDefinition(fr, def) \
+	do \
+	{ int _shared = true(fr, FR_SHARED_DEF); \
+	  clear(fr, FR_SHARED_DEF); \
+	  leaveDefinition(def, _shared); \
+	} while(0)
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1153,9 +1264,13 @@ typedef struct clause_list
 { ClauseRef	first_clause;		/* clause list of procedure */
   ClauseRef	last_clause;		/* last clause of list */
   ClauseIndex	clause_indexes;		/* Hash index(es) */
+#ifdef O_CONCURRENT_JIT
+  ClauseIndex	building;		/* Index under construction */
+#endif
   unsigned int	number_of_clauses;	/* number of associated clauses */
   unsigned int	erased_clauses;		/* number of erased clauses in set */
   unsigned int	number_of_rules;	/* number of real rules */
+  unsigned int	deep_tried;		/* Sub-args tried for deep index */
 } clause_list, *ClauseList;
 
 typedef struct clause_ref
@@ -1192,6 +1307,50 @@ typedef struct clause_ref
 
 #define VIF_BREAK      0x01	/* Can be a breakpoint */
 
+		 /*******************************
+		 *	  GUARD LITERALS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The arguments of I_GUARD describe up to two goals of the clause's guard
+(see guardLiterals() in pl-comp.c).  A literal holds the test in the low
+6 bits and two 12-bit operands.  An operand is either a head argument or
+a small integer.  GL_RAISE is set if an earlier goal of the guard may
+raise an exception.  The supervisor sets GL_USED on the literals used to
+decide that the clause commits.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define GL_VAR		1		/* var/1 */
+#define GL_NONVAR	2		/* nonvar/1 */
+#define GL_ATOM		3		/* atom/1 */
+#define GL_ATOMIC	4		/* atomic/1 */
+#define GL_NUMBER	5		/* number/1 */
+#define GL_INTEGER	6		/* integer/1 */
+#define GL_FLOAT	7		/* float/1 */
+#define GL_STRING	8		/* string/1 */
+#define GL_COMPOUND	9		/* compound/1 */
+#define GL_IS_LIST	10		/* is_list/1 */
+#define GL_EQ		11		/* ==/2 */
+#define GL_NEQ		12		/* \==/2 */
+#define GL_AR_LT	13		/* </2 */
+#define GL_AR_LE	14		/* =</2 */
+#define GL_AR_GT	15		/* >/2 */
+#define GL_AR_GE	16		/* >=/2 */
+#define GL_AR_EQ	17		/* =:=/2 */
+#define GL_AR_NE	18		/* =\=/2 */
+
+#define GL_RAISE	0x40		/* earlier guard goal may raise */
+#define GL_USED		0x80		/* literal decides the commit */
+#define GL_ISARG	0x800		/* operand is a head argument */
+#define GL_MAXINT	0x3ff		/* max small integer operand */
+
+#define GL_OP(l)	((int)((l)&0x3f))
+#define GL_ARG1(l)	((int)(((l)>>8)&0xfff))
+#define GL_ARG2(l)	((int)(((l)>>20)&0xfff))
+#define GL_INTVAL(a)	((a)&0x400 ? (int)(a)-0x800 : (int)(a))
+#define GL_LITERAL(op, a1, a2) \
+	((code)(op)|((code)(a1)<<8)|((code)(a2)<<20))
+
 typedef enum
 { VMI_REPLACE,
   VMI_STEP_ARGUMENT
@@ -1213,6 +1372,12 @@ typedef struct
   char		argtype[4];	/* Argument type(s) code takes */
 } code_info;
 
+typedef struct
+{ vmi		code;		/* the superinstruction */
+  vmi		first;		/* instruction it replaces */
+  vmi		next;		/* (super)instruction that follows */
+} super_info;
+
 struct mark
 { TrailEntry	trailtop;	/* top of the trail stack */
   Word		globaltop;	/* top of the global stack */
@@ -1230,7 +1395,7 @@ struct clause_bucket
   unsigned int	dirty;			/* # of garbage clauses */
 };
 
-#define MAX_MULTI_INDEX 1
+#define MAX_MULTI_INDEX 4		/* max args in a composite index */
 
 struct clause_index
 { unsigned int	 buckets;		/* # entries */
@@ -1238,16 +1403,47 @@ struct clause_index
   unsigned int	 resize_above;		/* consider resize > #clauses */
   unsigned int	 resize_below;		/* consider resize < #clauses */
   unsigned int	 dirty;			/* # chains that are dirty */
-  unsigned short args[MAX_MULTI_INDEX];	/* Indexed arguments */
+  unsigned short args[MAX_MULTI_INDEX];	/* Indexed arguments (0-terminated) */
   unsigned	 is_list : 1;		/* Index with lists */
   float		 speedup;		/* Estimated speedup */
   struct bit_vector *tried_better;	/* We tried to access for better hash */
   ClauseIndex	 next;			/* Next index */
   ClauseBucket	 entries;		/* chains holding the clauses */
+#ifdef O_GROW_INDEX
+  ClauseIndex	 grow;			/* See growClauseIndex() */
+  unsigned int	 grown;			/* # buckets copied to grow */
+#endif
+};
+
+#ifdef O_FROZEN_INDEX
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A frozen index holds a copy of the clause references of a static
+predicate, where the references with the  same key for one argument are
+linked into a chain. The chain for a  key is found using a perfect hash:
+the key selects a displacement and the  key and displacement select the
+slot that holds the first reference  of   the  chain.  The header is
+followed by the slots, the other references  (SIZEOF_CREF_CLAUSE each)
+and the displacements. See pl-index.c.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+struct frozen_index
+{ unsigned int	 size;			/* # clauses */
+  unsigned int	 keys;			/* # distinct keys */
+  unsigned int	 buckets;		/* # displacements */
+  unsigned int	 slots;			/* # hash slots */
+  unsigned short arg;			/* Indexed argument */
+  size_t	 bytes;			/* Allocated size */
+  char		*crefs;			/* Slots and chains */
+  unsigned int	*displacement;		/* Displacement per bucket */
+  FrozenIndex	 next;			/* Index on another argument */
 };
+#endif
 
 typedef struct clause_index_list
 { ClauseIndex index;
+#ifdef O_FROZEN_INDEX
+  FrozenIndex frozen;			/* or a discarded frozen index */
+#endif
   struct clause_index_list *next;
 } clause_index_list, *ClauseIndexList;
 
@@ -1276,13 +1472,24 @@ struct definition
   } impl;
 #ifdef O_PLMT
   counting_mutex  *mutex;		/* serialize access to dynamic pred */
+#endif
+#ifdef O_CONCURRENT_APPEND
+  unsigned int	appending;		/* #lock-free appends in progress */
+  unsigned int	append_blocked;		/* #LOCKDEF() holders */
 #endif
   ClauseIndexList old_clause_indexes;	/* Outdated hash indexes */
+#ifdef O_FROZEN_INDEX
+  FrozenIndex	frozen_index;		/* See freeze_indexes/1 */
+#endif
   struct bit_vector *tried_index;	/* Arguments on which we tried to index */
   meta_mask	meta_info;		/* meta-predicate info */
   int		references;		/* reference count */
   unsigned int  flags;			/* booleans (P_*) */
   unsigned int  shared;			/* #procedures sharing this def */
+  unsigned int  inline_generation;	/* see updateInlineGeneration() */
+#ifdef O_CLAUSEGC
+  unsigned int	clause_gc_mark;		/* see markPredicatesInEnvironments() */
+#endif
 #ifdef O_PROF_PENTIUM
   int		prof_index;		/* index in profiling */
   char	       *prof_name;		/* name in profiling */
@@ -1294,6 +1501,24 @@ struct definition_chain
   DefinitionChain	next;		/* next in chain */
 };
 
+#ifdef O_CLAUSEGC
+struct retired_clauses
+{ RetiredClauses	next;		/* next set */
+  Definition		definition;	/* predicate they were unlinked from */
+  ClauseIndexList	indexes;	/* retired clause indexes */
+  size_t		count;		/* # entries in clauses */
+  ClauseRef		clauses[1];	/* the unlinked clauses */
+};
+
+#define startClauseWalk(def) \
+	do { LD->clauses.walking = (def); MemoryBarrier(); } while(0)
+#define endClauseWalk() \
+	do { MemoryBarrier(); LD->clauses.walking = NULL; } while(0)
+#else
+#define startClauseWalk(def)	(void)0
+#define endClauseWalk()		(void)0
+#endif
+
 #define	PROC_WEAK	 (0x0001)	/* implicit import */
 #define	PROC_MULTISOURCE (0x0002)	/* Assigned to multiple sources */
 
@@ -1501,6 +1726,13 @@ struct list_cell
 };
 
 
+#ifdef O_RESOLVE_CACHE
+typedef struct resolve_cache_entry
+{ Procedure	procedure;	/* Procedure found by resolveProcedure() */
+  unsigned int	generation;	/* resolve_generation it was found in */
+} resolve_cache_entry;
+#endif
+
 struct module
 { atom_t	name;		/* name of module */
   atom_t	class;		/* class of the module */
@@ -1517,6 +1749,10 @@ struct module
 #endif
 #ifdef O_PROLOG_HOOK
   Procedure	hook;		/* Hooked module */
+#endif
+#ifdef O_RESOLVE_CACHE
+  resolve_cache_entry *resolve_cache; /* See resolveProcedure() */
+  unsigned int	resolve_generation; /* See updateResolveGeneration() */
 #endif
   int		level;		/* Distance to root (root=0) */
   unsigned int	line_no;	/* Source line-number */
@@ -1571,6 +1807,8 @@ struct gc_trail_entry
 			     tTop = tt; \
 			     gTop = (LD->frozen_bar > (b).globaltop ? \
 			             LD->frozen_bar : (b).globaltop); \
+			     if ( gTop < LD->gen_bar ) \
+			       LD->gen_bar = gTop; \
 			    } while(0)
 #endif /*O_DESTRUCTIVE_ASSIGNMENT*/
 
@@ -1584,6 +1822,8 @@ struct gc_trail_entry
 			   } while(0)
 #define DiscardMark(b)	do { LD->mark_bar = (LD->frozen_bar > (b).saved_bar ? \
 					     LD->frozen_bar : (b).saved_bar); \
+			     if ( LD->mark_bar < LD->gen_bar ) \
+			       LD->mark_bar = LD->gen_bar; \
 			   } while(0)
 #define NOT_A_MARK	(TrailEntry)(~(word)0)
 #define NoMark(b)	do { (b).trailtop = NOT_A_MARK; \
@@ -1610,6 +1850,23 @@ at least one free cell on the trail-stack.
          (tTop++)->address = p; \
      } while(0)
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The trail is the remembered set of the generational garbage collector:
+LD->mark_bar is never below LD->gen_bar and thus all bindings of cells in
+the old generation are trailed.  Any other  store into an existing cell
+of the global stack that is *not* trailed (nb_setarg/3, nb_set_dict/3, the
+list builder of read_term/2) must  use setUntrailed(), which makes the
+next collection a major one if p is in the old generation.  Stores into
+fresh cells above gTop and into term references need no barrier.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define setUntrailed(p, w) \
+  do { Word _ua = (p); \
+       if ( _ua < LD->gen_bar && _ua >= gBase ) \
+	 LD->gc.major_request = TRUE; \
+       *_ua = (w); \
+     } while(0)
+
 
 		 /*******************************
 		 *	    SUPERVISORS		*
@@ -1685,6 +1942,9 @@ typedef struct
 #endif
 #define SIG_FREECLAUSES	  (SIG_PROLOG_OFFSET+4)
 #define SIG_PLABORT	  (SIG_PROLOG_OFFSET+5)
+#if defined(O_ATOMGC) && defined(O_PLMT)
+#define SIG_ATOM_MARK	  (SIG_PROLOG_OFFSET+6)
+#endif
 
 
 		 /*******************************
@@ -1955,6 +2215,7 @@ typedef struct
 { int		blocked;		/* GC is blocked now */
   bool		active;			/* Currently running? */
   long		collections;		/* # garbage collections */
+  long		minor_collections;	/* # young generation collections */
   int64_t	global_gained;		/* global stack bytes collected */
   int64_t	trail_gained;		/* trail stack bytes collected */
   int64_t	global_left;		/* global stack bytes left after GC */
@@ -2000,6 +2261,7 @@ typedef struct
 #define PROCEDURE_dc_call_prolog	(GD->procedures.dc_call_prolog0)
 
 extern const code_info codeTable[]; /* Instruction info (read-only) */
+extern const super_info superTable[]; /* Superinstructions (read-only) */
 
 		 /*******************************
 		 *	  TEXT PROCESSING	*
@@ -2095,13 +2357,14 @@ typedef struct debuginfo
 #define PLFLAG_AUTOLOAD		    0x004000 /* do autoloading */
 #define PLFLAG_CHARCONVERSION	    0x008000 /* do character-conversion */
 #define PLFLAG_LASTCALL		    0x010000 /* Last call optimization enabled? */
-//				    0x020000 /* not used */
+#define PLFLAG_GC_GENERATIONAL	    0x020000 /* generational GC */
 #define PLFLAG_SIGNALS		    0x040000 /* Handle signals */
 #define PLFLAG_DEBUGINFO	    0x080000 /* generate debug info */
 #define PLFLAG_FILEERRORS	    0x100000 /* Edinburgh file errors */
 #define PLFLAG_WARN_OVERRIDE_IMPLICIT_IMPORT 0x200000 /* Warn overriding weak symbols */
 #define PLFLAG_QUASI_QUOTES	    0x400000 /* Support quasi quotes */
 #define PLFLAG_DOT_IN_ATOM	    0x800000 /* Allow atoms a.b.c */
+#define PLFLAG_GC_STRESS	   0x1000000 /* collect very frequently */
 
 typedef struct
 { unsigned int flags;		/* Fast access to some boolean Prolog flags */
@@ -25,7 +25,8 @@
 #include <math.h>
 
 typedef struct hash_hints
-{ unsigned int	buckets;		/* # buckets to use */
+{ unsigned short args[MAX_MULTI_INDEX];	/* Arguments to hash on */
+  unsigned int	buckets;		/* # buckets to use */
   float		speedup;		/* Expected speedup */
   unsigned	list : 1;		/* Use a list per key */
 } hash_hints;
@@ -33,9 +34,34 @@ typedef struct hash_hints
 static int		bestHash(Word av, Definition def,
 				 float minbest, struct bit_vector *tried,
 				 hash_hints *hints);
-static ClauseIndex	hashDefinition(Definition def, int arg, hash_hints *h);
+static ClauseIndex	hashDefinition(Definition def, hash_hints *h);
 static void		replaceIndex(Definition def,
 				     ClauseIndex old, ClauseIndex ci);
+static void		retireClauseIndex(Definition def, ClauseIndex ci);
+static void		addClauseToIndex(Definition def, ClauseIndex ci,
+					 Clause cl, int where);
+#ifdef O_DEEP_INDEX
+static int		deepIndexClauseList(Definition def, ClauseIndex ci,
+					    ClauseList cl, Word argv,
+					    ClauseChoice chp ARG_LD);
+static void		addClauseToDeepIndexes(Definition def, ClauseIndex ci,
+					       ClauseList cl, Clause clause,
+					       int where);
+static void		freeDeepIndexes(ClauseList cl);
+static void		retireDeepIndexes(Definition def, ClauseList cl);
+#endif
+#ifdef O_FROZEN_INDEX
+static void		discardFrozenIndexes(Definition def, int linger);
+static void		freeFrozenIndex(FrozenIndex fi);
+#endif
+#ifdef O_GROW_INDEX
+static void		discardGrowIndex(ClauseIndex ci);
+static void		deleteActiveClauseFromGrowIndex(ClauseIndex ci,
+							word key);
+#endif
+#ifdef O_CONCURRENT_JIT
+static void		abortClauseIndexBuild(Definition def);
+#endif
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -47,6 +73,15 @@ deterministic.
 
 #define MAXSEARCH 100
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+An index is considered `poor' if, on average, a key still selects more
+than 10 clauses. In that case we try to find a better index, either on
+another argument or on a combination of arguments.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define POOR_INDEX(nclauses, speedup) \
+	((nclauses) > 10 && (float)(nclauses)/(speedup) > 10.0)
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Compute the index in the hash-array from   a machine word and the number
 of buckets. This used to be simple, but now that our tag bits are on the
@@ -68,19 +103,42 @@ hashIndex(word key, int buckets)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+indexOfIndirect() computes the key for the  data words of an indirect: a
+string, float or GMP number. Using the raw  bits is not good enough: the
+low bits of common floats such as 1.0 or 2.5 are all zero and the first
+word of a GMP number only holds its size. We therefore hash the complete
+value, seeding with the tag such that e.g., a string and a number with
+the same bit pattern get different keys.
+
+NOTE: argKey() in pl-comp.c uses this function for the same indirects.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+word
+indexOfIndirect(const word *p, size_t n, int t)
+{ word key = MurmurHashAligned2(p, n*sizeof(word), MURMUR_SEED^t);
+
+  return key ? key : 1;
+}
+
+
 static inline word
 indexOfWord(word w ARG_LD)
 { for(;;)
   { switch(tag(w))
     { case TAG_VAR:
       case TAG_ATTVAR:
-      case TAG_STRING:
 	return 0L;
+      case TAG_STRING:
+	return indexOfIndirect(valIndirectP(w), wsizeofIndirect(w), TAG_STRING);
       case TAG_INTEGER:
 	if ( storage(w) != STG_INLINE )
 	{ Word p = valIndirectP(w);
 	  word key;
 
+	  if ( wsizeofIndirect(w) != WORDS_PER_INT64 )
+	    return indexOfIndirect(p, wsizeofIndirect(w), TAG_INTEGER);
+
 #if SIZEOF_VOIDP == 4
           DEBUG(9, Sdprintf("Index for " INT64_FORMAT " = 0x%x\n",
 			    valBignum(w), p[0]^p[1]));
@@ -96,25 +154,7 @@ indexOfWord(word w ARG_LD)
       case TAG_ATOM:
 	break;				/* atom_t */
       case TAG_FLOAT:
-      { Word p = valIndirectP(w);
-	word key;
-
-	switch(WORDS_PER_DOUBLE)
-	{ case 2:
-	    key = p[0]^p[1];
-	    break;
-	  case 1:
-	    key = p[0];
-	    break;
-	  default:
-	    assert(0);
-	    return 0L;
-	}
-
-	if ( !key )
-	  key++;
-	return key;
-      }
+	return indexOfIndirect(valIndirectP(w), WORDS_PER_DOUBLE, TAG_FLOAT);
       case TAG_COMPOUND:
 	w = *valPtr(w);			/* functor_t */
 	break;
@@ -175,15 +215,19 @@ this functor, in which case we can use   this or we don't. In the latter
 case we must still perform the traditional   search as clauses without a
 key may match.
 
+If we found the clause-list for a functor, we  may be able to use a deep
+index on one of the arguments of the compound. See deepIndexClauseList().
+
 TBD: Keep a flag telling is whether there are non-indexable clauses.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static ClauseRef
-nextClauseFromBucket(ClauseChoice chp, gen_t generation, int is_list)
+nextClauseFromBucket(Definition def, ClauseIndex ci, Word argv,
+		     ClauseChoice chp, gen_t generation ARG_LD)
 { ClauseRef cref;
   word key = chp->key;
 
-  if ( is_list )
+  if ( ci->is_list )
   { DEBUG(MSG_INDEX_FIND, Sdprintf("Searching for %s\n", keyName(key)));
 
   non_indexed:
@@ -192,6 +236,11 @@ nextClauseFromBucket(ClauseChoice chp, gen_t generation, int is_list)
       { ClauseList cl = &cref->value.clauses;
 	ClauseRef cr;
 
+#ifdef O_DEEP_INDEX
+	if ( key && deepIndexClauseList(def, ci, cl, argv, chp PASS_LD) )
+	  return nextClauseArg1(chp, generation);
+#endif
+
 	for(cr=cl->first_clause; cr; cr=cr->next)
 	{ if ( visibleClause(cr->value.clause, generation) )
 	  { chp->cref = cr->next;
@@ -239,9 +288,61 @@ nextClauseFromBucket(ClauseChoice chp, gen_t generation, int is_list)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Composite indexes hash on the combination of  the keys of two or more
+arguments. The combined key is a hash of  the individual keys, so it is
+imprecise: two different key  tuples  may  share  a  combined key. This
+merely weakens the filter; head unification  still decides. A composite
+key is 0 (not indexable) if any of the component keys is 0.
+
+NOTE: compositeKey() must be used  consistently by indexKeyFromArgv(),
+indexKeyFromClause() and the assessment code.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline word
+compositeKey(const word *keys, int count)
+{ word key = MurmurHashAligned2(keys, count*sizeof(word), MURMUR_SEED);
+
+  return key ? key : 1;
+}
+
+
+static inline int
+isCompositeIndex(ClauseIndex ci)
+{ return ci->args[1] != 0;
+}
+
+
 static inline word
 indexKeyFromArgv(ClauseIndex ci, Word argv ARG_LD)
-{ return indexOfWord(argv[ci->args[0]-1] PASS_LD);
+{ if ( likely(!isCompositeIndex(ci)) )
+  { return indexOfWord(argv[ci->args[0]-1] PASS_LD);
+  } else
+  { word keys[MAX_MULTI_INDEX];
+    int i;
+
+    for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+    { if ( !(keys[i] = indexOfWord(argv[ci->args[i]-1] PASS_LD)) )
+	return 0;
+    }
+
+    return compositeKey(keys, i);
+  }
+}
+
+
+static void
+setIndexArgBits(struct bit_vector *v, ClauseIndex ci)
+{ int i;
+
+  for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+    set_bit(v, ci->args[i]-1);
+}
+
+
+static int
+sameIndexArgs(const unsigned short *a1, const unsigned short *a2)
+{ return memcmp(a1, a2, sizeof(unsigned short)*MAX_MULTI_INDEX) == 0;
 }
 
 
@@ -261,7 +362,6 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 { ClauseRef cref;
   ClauseIndex ci;
   hash_hints hints;
-  int best;
 
   if ( def->functor->arity == 0 )
     goto simple;				/* TBD: alt supervisor */
@@ -285,8 +385,8 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
     if ( best_index )
     { int hi;
 
-      if ( def->impl.clauses.number_of_clauses > 10 &&
-	   def->impl.clauses.number_of_clauses/best_index->speedup > 10 )
+      if ( POOR_INDEX(def->impl.clauses.number_of_clauses,
+		      best_index->speedup) )
       { DEBUG(MSG_JIT,
 	      Sdprintf("Poor index in arg %d of %s (try to find better)\n",
 		       best_index->args[0], predicateName(def)));
@@ -296,16 +396,18 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 
 	  for(ci=def->impl.clauses.clause_indexes; ci; ci=ci->next)
 	  { if ( indexKeyFromArgv(ci, argv PASS_LD) )
-	      set_bit(best_index->tried_better, ci->args[0]-1);
+	      setIndexArgBits(best_index->tried_better, ci);
 	  }
 	}
 
-	if ( (best=bestHash(argv, def,
-			    best_index->speedup, best_index->tried_better,
-			    &hints)) >= 0 )
-	{ DEBUG(MSG_JIT, Sdprintf("Found better at arg %d\n", best+1));
+	if ( bestHash(argv, def,
+		      best_index->speedup, best_index->tried_better,
+		      &hints) )
+	{ DEBUG(MSG_JIT, Sdprintf("Found better at arg %d%s\n",
+				  hints.args[0],
+				  hints.args[1] ? " (composite)" : ""));
 
-	  if ( (ci=hashDefinition(def, best+1, &hints)) )
+	  if ( (ci=hashDefinition(def, &hints)) )
 	  { chp->key = indexKeyFromArgv(ci, argv PASS_LD);
 	    assert(chp->key);
 	    best_index = ci;
@@ -315,7 +417,8 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 
       hi = hashIndex(chp->key, best_index->buckets);
       chp->cref = best_index->entries[hi].head;
-      return nextClauseFromBucket(chp, generationFrame(fr), best_index->is_list);
+      return nextClauseFromBucket(def, best_index, argv,
+				  chp, generationFrame(fr) PASS_LD);
     }
   }
 
@@ -329,15 +432,16 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
   }
 
 
-  if ( (best=bestHash(argv, def, 0.0, NULL, &hints)) >= 0 )
-  { if ( (ci=hashDefinition(def, best+1, &hints)) )
+  if ( bestHash(argv, def, 0.0, NULL, &hints) )
+  { if ( (ci=hashDefinition(def, &hints)) )
     { int hi;
 
       chp->key = indexKeyFromArgv(ci, argv PASS_LD);
       assert(chp->key);
       hi = hashIndex(chp->key, ci->buckets);
       chp->cref = ci->entries[hi].head;
-      return nextClauseFromBucket(chp, generationFrame(fr), ci->is_list);
+      return nextClauseFromBucket(def, ci, argv,
+				  chp, generationFrame(fr) PASS_LD);
     }
   }
 
@@ -385,7 +489,7 @@ nextClause(ClauseChoice chp, Word argv, LocalFrame fr, Definition def)
 		 *******************************/
 
 static ClauseIndex
-newClauseIndexTable(int arg, hash_hints *hints)
+newClauseIndexTable(hash_hints *hints)
 { ClauseIndex ci = allocHeapOrHalt(sizeof(struct clause_index));
   unsigned int m = 4;
   size_t bytes;
@@ -396,7 +500,7 @@ newClauseIndexTable(int arg, hash_hints *hints)
   bytes = sizeof(struct clause_bucket) * hints->buckets;
 
   memset(ci, 0, sizeof(*ci));
-  ci->args[0] = arg;
+  memcpy(ci->args, hints->args, sizeof(ci->args));
   ci->buckets = hints->buckets;
   ci->is_list = hints->list;
   ci->speedup = hints->speedup;
@@ -413,6 +517,9 @@ freeClauseListRef(ClauseRef cref)
 { ClauseList cl = &cref->value.clauses;
   ClauseRef cr, next;
 
+#ifdef O_DEEP_INDEX
+  freeDeepIndexes(cl);
+#endif
   for(cr=cl->first_clause; cr; cr=next)
   { next = cr->next;
     freeClauseRef(cr);
@@ -445,7 +552,11 @@ unallocClauseIndexTableEntries(ClauseIndex ci)
 
 void
 unallocClauseIndexTable(ClauseIndex ci)
-{ unallocClauseIndexTableEntries(ci);
+{
+#ifdef O_GROW_INDEX
+  discardGrowIndex(ci);
+#endif
+  unallocClauseIndexTableEntries(ci);
   freeHeap(ci, sizeof(struct clause_index));
 }
 
@@ -462,7 +573,8 @@ newClauseListRef(word key)
 
 
 static void
-addClauseList(ClauseRef cref, Clause clause, int where)
+addClauseList(Definition def, ClauseIndex ci,
+	      ClauseRef cref, Clause clause, int where)
 { ClauseList cl = &cref->value.clauses;
   ClauseRef cr = newClauseRef(clause, 0); /* TBD: key? */
 
@@ -480,7 +592,13 @@ addClauseList(ClauseRef cref, Clause clause, int where)
     cl->number_of_clauses = 1;
   }
 
-  /* TBD: Add to sub-indexes */
+#ifdef O_DEEP_INDEX
+  if ( cl->clause_indexes )
+    addClauseToDeepIndexes(def, ci, cl, clause, where);
+#else
+  (void)def;
+  (void)ci;
+#endif
 }
 
 
@@ -501,17 +619,18 @@ must be used if none of the indexes matches.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
-addClauseBucket(ClauseBucket ch, Clause cl, word key, int where, int is_list)
+addClauseBucket(Definition def, ClauseIndex ci,
+		ClauseBucket ch, Clause cl, word key, int where)
 { ClauseRef cr;
 
-  if ( is_list )
+  if ( ci->is_list )
   { ClauseRef cref;
     ClauseList vars = NULL;
 
     if ( key )
     { for(cref=ch->head; cref; cref=cref->next)
       { if ( cref->key == key )
-	{ addClauseList(cref, cl, where);
+	{ addClauseList(def, ci, cref, cl, where);
 	  DEBUG(MSG_INDEX_UPDATE,
 		Sdprintf("Adding to existing %s\n", keyName(key)));
 	  return 0;
@@ -523,7 +642,7 @@ addClauseBucket(ClauseBucket ch, Clause cl, word key, int where, int is_list)
     { for(cref=ch->head; cref; cref=cref->next)
       { if ( !cref->key )
 	  vars = &cref->value.clauses;
-	addClauseList(cref, cl, where);
+	addClauseList(def, ci, cref, cl, where);
       }
       if ( vars )
 	return 0;
@@ -533,7 +652,7 @@ addClauseBucket(ClauseBucket ch, Clause cl, word key, int where, int is_list)
     cr = newClauseListRef(key);
     if ( vars )				/* (**) */
     { for(cref=vars->first_clause; cref; cref=cref->next)
-      { addClauseList(cr, cref->value.clause, CL_END);
+      { addClauseList(def, ci, cr, cref->value.clause, CL_END);
 	if ( true(cref->value.clause, CL_ERASED) )	/* or do not add? */
 	{ cr->value.clauses.number_of_clauses--;
 	  cr->value.clauses.erased_clauses++;
@@ -544,7 +663,7 @@ addClauseBucket(ClauseBucket ch, Clause cl, word key, int where, int is_list)
       if ( cr->value.clauses.erased_clauses )
 	ch->dirty++;
     }
-    addClauseList(cr, cl, where);
+    addClauseList(def, ci, cr, cl, where);
   } else
   { cr = newClauseRef(cl, key);
   }
@@ -566,9 +685,13 @@ addClauseBucket(ClauseBucket ch, Clause cl, word key, int where, int is_list)
 
 
 static void
-deleteClauseList(ClauseList cl, Clause clause)
+deleteClauseList(Definition def, ClauseList cl, Clause clause)
 { ClauseRef cr, prev=NULL;
 
+#ifdef O_DEEP_INDEX
+  retireDeepIndexes(def, cl);
+#endif
+
   for(cr=cl->first_clause; cr; prev=cr, cr=cr->next)
   { if ( cr->value.clause == clause )
     { if ( !prev )
@@ -601,7 +724,8 @@ number of such clauses.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
-deleteClauseBucket(ClauseBucket ch, Clause clause, word key, int is_list)
+deleteClauseBucket(Definition def, ClauseBucket ch, Clause clause,
+		   word key, int is_list)
 { ClauseRef prev = NULL;
   ClauseRef c;
 
@@ -611,7 +735,7 @@ deleteClauseBucket(ClauseBucket ch, Clause clause, word key, int is_list)
       { if ( c->key == key )
 	{ ClauseList cl = &c->value.clauses;
 
-	  deleteClauseList(cl, clause);
+	  deleteClauseList(def, cl, clause);
 	  if ( !cl->first_clause )
 	    goto delete;		/* will return 1 */
 	}
@@ -624,7 +748,7 @@ deleteClauseBucket(ClauseBucket ch, Clause clause, word key, int is_list)
       for(c = ch->head; c;)
       { ClauseList cl = &c->value.clauses;
 
-	deleteClauseList(cl, clause);
+	deleteClauseList(def, cl, clause);
 	if ( !cl->first_clause )
 	{ ClauseRef d;
 
@@ -679,9 +803,13 @@ deleteClauseBucket(ClauseBucket ch, Clause clause, word key, int is_list)
 
 
 static void
-gcClauseList(ClauseList cl)
+gcClauseList(Definition def, ClauseList cl)
 { ClauseRef cref=cl->first_clause, prev = NULL;
 
+#ifdef O_DEEP_INDEX
+  retireDeepIndexes(def, cl);
+#endif
+
   while(cref && cl->erased_clauses)
   { if ( true(cref->value.clause, CL_ERASED) )
     { ClauseRef c = cref;
@@ -722,7 +850,8 @@ the number of indexable entries that have been removed from the bucket.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
-gcClauseBucket(ClauseBucket ch, unsigned int dirty, int is_list)
+gcClauseBucket(Definition def, ClauseBucket ch, unsigned int dirty,
+	       int is_list)
 { ClauseRef cref = ch->head, prev = NULL;
   int deleted = 0;
 
@@ -731,7 +860,7 @@ gcClauseBucket(ClauseBucket ch, unsigned int dirty, int is_list)
     { ClauseList cl = &cref->value.clauses;
 
       if ( cl->erased_clauses )
-      { gcClauseList(cl);
+      { gcClauseList(def, cl);
 	dirty--;
 
 	if ( cl->first_clause == NULL )
@@ -791,24 +920,34 @@ See also deleteActiveClauseFromIndexes() comment
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static void
-cleanClauseIndex(Definition def, ClauseIndex ci)
-{ if ( ci->size - def->impl.clauses.erased_clauses < ci->resize_below )
-  { replaceIndex(def, ci, NULL);
-  } else
-  { if ( ci->dirty )
-    { ClauseBucket ch = ci->entries;
-      int n = ci->buckets;
+cleanDirtyBuckets(Definition def, ClauseIndex ci)
+{ if ( ci->dirty )
+  { ClauseBucket ch = ci->entries;
+    int n = ci->buckets;
 
-      for(; n; n--, ch++)
-      { if ( ch->dirty )
-	{ ci->size -= gcClauseBucket(ch, ch->dirty, ci->is_list);
-	  if ( --ci->dirty == 0 )
-	    break;
-	}
+    for(; n; n--, ch++)
+    { if ( ch->dirty )
+      { ci->size -= gcClauseBucket(def, ch, ch->dirty, ci->is_list);
+	if ( --ci->dirty == 0 )
+	  break;
       }
     }
+  }
+
+  assert((int)ci->size >= 0);
+}
+
 
-    assert((int)ci->size >= 0);
+static void
+cleanClauseIndex(Definition def, ClauseIndex ci)
+{ if ( ci->size - def->impl.clauses.erased_clauses < ci->resize_below )
+  { replaceIndex(def, ci, NULL);
+  } else
+  { cleanDirtyBuckets(def, ci);
+#ifdef O_GROW_INDEX
+    if ( ci->grow )			/* holds the same erased clauses */
+      cleanDirtyBuckets(def, ci->grow);
+#endif
   }
 }
 
@@ -817,27 +956,41 @@ cleanClauseIndex(Definition def, ClauseIndex ci)
 cleanClauseIndexes() is called from cleanDefinition(),   which is called
 either locked or otherwise safe for  concurrency while the definition is
 not referenced. This is the time that we can remove cells from the index
-chains and can reclaim old indexes.
+chains and can reclaim old indexes.  We  reclaim  the  indexes retired
+before this call first.  Indexes retired while cleaning, such as the
+deep indexes of cleaned clause-lists,  are  kept until the next call as
+lookups that started earlier may still walk them.
 
 If we reclaim old  indexes,  there   apparently  have  been  significant
 changes to the predicate  and  therefore   we  also  delete  the `tried'
 bitvector to force reevaluation.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+void
+freeClauseIndexList(ClauseIndexList li)
+{ ClauseIndexList next;
+
+  for(; li; li=next)
+  { next = li->next;
+
+    if ( li->index )
+      unallocClauseIndexTable(li->index);
+#ifdef O_FROZEN_INDEX
+    if ( li->frozen )
+      freeFrozenIndex(li->frozen);
+#endif
+    freeHeap(li, sizeof(*li));
+  }
+}
+
+
 static void
 unallocOldClauseIndexes(Definition def)
 { if ( def->old_clause_indexes )
   { ClauseIndexList li = def->old_clause_indexes;
-    ClauseIndexList next;
 
     def->old_clause_indexes = NULL;
-
-    for(; li; li=next)
-    { next = li->next;
-
-      unallocClauseIndexTable(li->index);
-      freeHeap(li, sizeof(*li));
-    }
+    freeClauseIndexList(li);
 
     if ( def->tried_index )
       clear_bitvector(def->tried_index);
@@ -849,10 +1002,44 @@ void
 cleanClauseIndexes(Definition def)
 { ClauseIndex ci;
 
+#ifdef O_CONCURRENT_JIT
+  abortClauseIndexBuild(def);		/* we may unlink its position */
+#endif
+  unallocOldClauseIndexes(def);
+
   for(ci=def->impl.clauses.clause_indexes; ci; ci=ci->next)
     cleanClauseIndex(def, ci);
 
-  unallocOldClauseIndexes(def);
+  if ( def->old_clause_indexes && def->tried_index )
+    clear_bitvector(def->tried_index);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+retireClauseIndexes() is used by  garbage_collect_clauses/0 to remove the
+erased clauses of a static predicate   while other threads may walk its
+indexes. Instead of cleaning  the  buckets,   all  indexes  are retired
+and returned together with the indexes  retired earlier. The caller
+frees them using freeClauseIndexList() if no   thread can walk them
+anymore. New indexes are created on demand.  Caller must have def locked.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+ClauseIndexList
+retireClauseIndexes(Definition def)
+{ ClauseIndexList li;
+
+#ifdef O_CONCURRENT_JIT
+  abortClauseIndexBuild(def);
+#endif
+  while( def->impl.clauses.clause_indexes )
+    replaceIndex(def, def->impl.clauses.clause_indexes, NULL);
+
+  li = def->old_clause_indexes;
+  def->old_clause_indexes = NULL;
+  if ( def->tried_index )
+    clear_bitvector(def->tried_index);
+
+  return li;
 }
 
 
@@ -860,6 +1047,9 @@ void
 unallocClauseIndexes(Definition def)
 { ClauseIndex ci, next;
 
+#ifdef O_CONCURRENT_JIT
+  abortClauseIndexBuild(def);
+#endif
   for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
   { next = ci->next;
     unallocClauseIndexTable(ci);
@@ -868,6 +1058,9 @@ unallocClauseIndexes(Definition def)
   unallocOldClauseIndexes(def);
   if ( def->tried_index )
     free_bitvector(def->tried_index);
+#ifdef O_FROZEN_INDEX
+  discardFrozenIndexes(def, FALSE);
+#endif
 }
 
 
@@ -981,7 +1174,19 @@ static inline word
 indexKeyFromClause(ClauseIndex ci, Clause cl)
 { word key;
 
-  argKey(cl->codes, ci->args[0]-1, &key);
+  if ( likely(!isCompositeIndex(ci)) )
+  { argKey(cl->codes, ci->args[0]-1, &key);
+  } else
+  { word keys[MAX_MULTI_INDEX];
+    int i;
+
+    for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+    { if ( !argKey(cl->codes, ci->args[i]-1, &keys[i]) )
+	return 0;
+    }
+    key = compositeKey(keys, i);
+  }
+
   return key;
 }
 
@@ -1028,6 +1233,11 @@ deleteActiveClauseFromIndex(ClauseIndex ci, Clause cl)
       cb->dirty++;
     assert(cb->dirty>0);
   }
+
+#ifdef O_GROW_INDEX
+  if ( ci->grow )
+    deleteActiveClauseFromGrowIndex(ci, key);
+#endif
 }
 
 
@@ -1048,6 +1258,12 @@ deleteActiveClauseFromIndexes(Definition def, Clause cl)
 { ClauseIndex ci, next;
 
   shrunkpow2(def);
+#ifdef O_FROZEN_INDEX
+  discardFrozenIndexes(def, TRUE);
+#endif
+#ifdef O_CONCURRENT_JIT
+  abortClauseIndexBuild(def);
+#endif
 
   for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
   { next = ci->next;
@@ -1074,40 +1290,212 @@ indexed. This is needed for resizing the index.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static void
-addClauseToIndex(ClauseIndex ci, Clause cl, int where)
+addClauseKeyToIndex(Definition def, ClauseIndex ci,
+		    Clause cl, word key, int where)
 { ClauseBucket ch = ci->entries;
-  word key = indexKeyFromClause(ci, cl);
 
   if ( key == 0 )			/* a non-indexable field */
   { int n = ci->buckets;
 
     for(; n; n--, ch++)
-      addClauseBucket(ch, cl, key, where, ci->is_list);
+      addClauseBucket(def, ci, ch, cl, key, where);
   } else
   { int hi = hashIndex(key, ci->buckets);
 
     DEBUG(MSG_INDEX_UPDATE, Sdprintf("Storing in bucket %d\n", hi));
-    ci->size += addClauseBucket(&ch[hi], cl, key, where, ci->is_list);
+    ci->size += addClauseBucket(def, ci, &ch[hi], cl, key, where);
+  }
+}
+
+
+static void
+addClauseToIndex(Definition def, ClauseIndex ci, Clause cl, int where)
+{ addClauseKeyToIndex(def, ci, cl, indexKeyFromClause(ci, cl), where);
+}
+
+
+#ifdef O_GROW_INDEX
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Growing a clause index. If an index exceeds  its resize_above, we used to
+discard it, after which the next call   rehashed  all clauses at once. A
+plain (non-list) index instead gets  a   twice  as large ci->grow. Each
+assert copies GROW_STEP buckets of the  old   index  into ci->grow and
+when all buckets are copied,  ci->grow   replaces  the  old index using
+replaceIndex(). Until then, lookups use the old index, which remains
+complete.
+
+As hashIndex() uses the low bits of the key, bucket `i` of the old index
+is split into the buckets `i` and `i+buckets`   of  ci->grow. A bucket
+of ci->grow is thus complete if the  old   bucket  it comes from is
+copied, i.e., (i & (buckets-1)) < ci->grown.   New clauses are added to
+the old index and to the complete  buckets   of  ci->grow, and clauses
+erased later are marked dirty in both,   such  that cleanClauseIndex()
+can remove them from both.
+
+All this is done with the predicate locked and ci->grow is not visible
+to other threads before it is published by replaceIndex().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define GROW_STEP 8			/* buckets copied per assert */
+
+#define grownBucket(ci, i) (((i) & ((ci)->buckets-1)) < (ci)->grown)
+
+static void
+discardGrowIndex(ClauseIndex ci)
+{ ClauseIndex g;
+
+  if ( (g=ci->grow) )
+  { ci->grow = NULL;
+    ci->grown = 0;
+    unallocClauseIndexTable(g);
+  }
+}
+
+
+static void
+deleteActiveClauseFromGrowIndex(ClauseIndex ci, word key)
+{ ClauseIndex g = ci->grow;
+  ClauseBucket cb;
+
+  if ( key == 0 )
+  { unsigned int i;
+
+    for(i=0, cb=g->entries; i<g->buckets; i++, cb++)
+    { if ( grownBucket(ci, i) )
+      { if ( cb->dirty++ == 0 )
+	  g->dirty++;
+      }
+    }
+  } else
+  { int hi = hashIndex(key, g->buckets);
+
+    if ( grownBucket(ci, hi) )
+    { cb = &g->entries[hi];
+      if ( cb->dirty++ == 0 )
+	g->dirty++;
+    }
+  }
+}
+
+
+static void
+addClauseToGrowIndex(Definition def, ClauseIndex ci,
+		     Clause cl, word key, int where)
+{ ClauseIndex g = ci->grow;
+
+  if ( key == 0 )
+  { unsigned int i;
+
+    for(i=0; i<g->buckets; i++)
+    { if ( grownBucket(ci, i) )
+	addClauseBucket(def, g, &g->entries[i], cl, key, where);
+    }
+  } else
+  { int hi = hashIndex(key, g->buckets);
+
+    if ( grownBucket(ci, hi) )
+      g->size += addClauseBucket(def, g, &g->entries[hi], cl, key, where);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+growClauseIndex() copies  up  to  `count`   buckets  from  ci  into
+ci->grow and replaces ci if all buckets are copied.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+growClauseIndex(Definition def, ClauseIndex ci, int count)
+{ ClauseIndex g = ci->grow;
+
+  for( ; count > 0 && ci->grown < ci->buckets; count--, ci->grown++ )
+  { unsigned int i = ci->grown;
+    ClauseRef cref;
+
+    for(cref=ci->entries[i].head; cref; cref=cref->next)
+    { Clause cl = cref->value.clause;
+
+      if ( true(cl, CL_ERASED) )
+	continue;
+      if ( cref->key )
+      { int hi = hashIndex(cref->key, g->buckets);
+
+	g->size += addClauseBucket(def, g, &g->entries[hi],
+				   cl, cref->key, CL_END);
+      } else
+      { addClauseBucket(def, g, &g->entries[i], cl, 0, CL_END);
+	addClauseBucket(def, g, &g->entries[i+ci->buckets], cl, 0, CL_END);
+      }
+    }
+  }
+
+  if ( ci->grown == ci->buckets )
+  { DEBUG(MSG_JIT, Sdprintf("Grown index for %s to %d buckets\n",
+			    predicateName(def), g->buckets));
+    g->resize_above = g->size*2;
+    g->resize_below = g->size/4;
+    ci->grow = NULL;
+    replaceIndex(def, ci, g);
+  }
+}
+
+
+static void
+addClauseToIndexGrow(Definition def, ClauseIndex ci, Clause cl, int where)
+{ word key = indexKeyFromClause(ci, cl);
+
+  addClauseKeyToIndex(def, ci, cl, key, where);
+  if ( ci->grow )
+  { addClauseToGrowIndex(def, ci, cl, key, where);
+  } else if ( ci->size >= ci->resize_above )
+  { hash_hints hints;
+
+    memcpy(hints.args, ci->args, sizeof(hints.args));
+    hints.buckets = ci->buckets*2;
+    hints.speedup = ci->speedup;
+    hints.list    = FALSE;
+    ci->grow  = newClauseIndexTable(&hints);
+    ci->grown = 0;
+  } else
+  { return;
   }
+
+  growClauseIndex(def, ci, GROW_STEP);
 }
+#endif /*O_GROW_INDEX*/
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 addClauseToIndexes() is called (only) by   assertProcedure(),  which has
-the definition locked.
+the definition locked.  The lock-free append of assertProcedure() skips
+this: it is only used if there are no  indexes and leaves a number of
+clauses that is a power of two to us (see reconsider_index()).
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 void
 addClauseToIndexes(Definition def, Clause cl, int where)
 { ClauseIndex ci, next;
 
+#ifdef O_FROZEN_INDEX
+  discardFrozenIndexes(def, TRUE);
+#endif
+#ifdef O_CONCURRENT_JIT
+  if ( def->impl.clauses.building && where == CL_START )
+    addClauseToIndex(def, def->impl.clauses.building, cl, CL_START);
+#endif
   for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
   { next = ci->next;
 
+#ifdef O_GROW_INDEX
+    if ( !ci->is_list )
+    { addClauseToIndexGrow(def, ci, cl, where);
+      continue;
+    }
+#endif
     if ( ci->size >= ci->resize_above )
       replaceIndex(def, ci, NULL);
     else
-      addClauseToIndex(ci, cl, where);
+      addClauseToIndex(def, ci, cl, where);
   }
 
   reconsider_index(def);
@@ -1116,6 +1504,32 @@ addClauseToIndexes(Definition def, Clause cl, int where)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+prepareClauseIndexes() is called by assertz_list/1 before adding up to
+count clauses to def. Indexes that would be  resized while adding these
+clauses are discarded, such that the   clauses are added without index
+maintenance and the JIT indexer builds  the   index  once for the new
+clause count on the next call.   Smaller  additions keep the indexes.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+prepareClauseIndexes(Definition def, size_t count)
+{ ClauseIndex ci, next;
+
+  if ( !def->impl.clauses.clause_indexes )
+    return;
+
+  LOCKDEF(def);
+  for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
+  { next = ci->next;
+
+    if ( ci->size + count >= ci->resize_above )
+      replaceIndex(def, ci, NULL);
+  }
+  UNLOCKDEF(def);
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Called from unlinkClause(), which is called for retracting a clause from
 a dynamic predicate which is not  referenced   and  has  few clauses. In
@@ -1127,96 +1541,219 @@ delClauseFromIndex(Definition def, Clause cl)
 { ClauseIndex ci;
 
   shrunkpow2(def);
+#ifdef O_FROZEN_INDEX
+  discardFrozenIndexes(def, TRUE);
+#endif
+#ifdef O_CONCURRENT_JIT
+  abortClauseIndexBuild(def);
+#endif
 
   for(ci=def->impl.clauses.clause_indexes; ci; ci=ci->next)
   { ClauseBucket ch = ci->entries;
     word key = indexKeyFromClause(ci, cl);
 
+#ifdef O_GROW_INDEX
+    discardGrowIndex(ci);		/* rare: start again on next assert */
+#endif
+
     if ( key == 0 )			/* a non-indexable field */
     { int n = ci->buckets;
 
       for(; n; n--, ch++)
-	deleteClauseBucket(ch, cl, key, ci->is_list);
+	deleteClauseBucket(def, ch, cl, key, ci->is_list);
     } else
     { int hi = hashIndex(key, ci->buckets);
 
-      ci->size -= deleteClauseBucket(&ch[hi], cl, key, ci->is_list);
+      ci->size -= deleteClauseBucket(def, &ch[hi], cl, key, ci->is_list);
     }
   }
 }
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Create a hash-index on def for  arg.  It   is  ok  to do so unlocked for
-static predicates, but if another thread  did   the  job, we discard our
-result. For dynamic  or  multifile  predicates,   we  need  to  keep the
-predicate locked while building the  hash-table   because  we  will miss
-clauses that are added while building.
+publishClauseIndex() adds a new index  ci  to   def,  replacing  an old
+index on the same arguments if there is one.  Caller must have def locked.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-static ClauseIndex
-hashDefinition(Definition def, int arg, hash_hints *hints)
-{ ClauseRef cref;
-  ClauseIndex ci, old;
+static void
+publishClauseIndex(Definition def, ClauseIndex ci)
+{ ClauseIndex old;
   ClauseIndex *cip;
-  int dyn_or_multi;
-
-  DEBUG(MSG_JIT, Sdprintf("hashDefinition(%s, %d, %d) (%s)\n",
-			  predicateName(def), arg, hints->buckets,
-			  hints->list ? "lists" : "clauses"));
-
-  ci = newClauseIndexTable(arg, hints);
 
-  if ( (dyn_or_multi=true(def, P_DYNAMIC|P_MULTIFILE)) )
-    LOCKDEF(def);
-  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
-  { if ( false(cref->value.clause, CL_ERASED) )
-      addClauseToIndex(ci, cref->value.clause, CL_END);
-  }
   ci->resize_above = ci->size*2;
   ci->resize_below = ci->size/4;
 
-  if ( !dyn_or_multi )
-    LOCKDEF(def);
   for(old=def->impl.clauses.clause_indexes; old; old=old->next)
-  { if ( old->args[0] == arg )
+  { if ( sameIndexArgs(old->args, ci->args) )
       break;
   }
 
   if ( !old )				/* this is a new table */
-  { ClauseIndex conc;
-
-    for(conc=def->impl.clauses.clause_indexes; conc; conc=conc->next)
-    { if ( conc->args[0] == arg )
-      { UNLOCKDEF(def);
-	unallocClauseIndexTable(ci);
-	return conc;
-      }
-    }
-					/* insert at the end */
+  {					/* insert at the end */
     for(cip=&def->impl.clauses.clause_indexes; *cip; cip = &(*cip)->next)
       ;
+    MemoryBarrier();			/* lock only synchronizes updates */
     *cip = ci;
   } else				/* replace (resize) old */
   { replaceIndex(def, old, ci);
   }
-  UNLOCKDEF(def);
-
-  return ci;
 }
 
 
-/* Caller must have the predicate locked */
+#ifdef O_CONCURRENT_JIT
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Building an index for a large dynamic predicate  in one go keeps the
+predicate locked for the whole  scan,  blocking   all  asserts  and all
+threads that want to build the  same   index.  buildClauseIndex() adds
+BUILD_STEP clauses at a time and releases   the lock between the slices.
+The index under construction is registered  as def->impl.clauses.building,
+such that only one thread builds an index for def at any time. Others do
+not wait for it: hashDefinition() returns  NULL   and  they use the old
+indexes or a linear scan until the new index is published.
+
+Clauses added at the  end  while  we  are   building  are  found by the
+scan.   Clauses  added  at  the  start  are  added  to  the  index  by
+addClauseToIndexes().  Removing a clause  or  cleaning  the  definition
+calls abortClauseIndexBuild(), after which our   position in the clause
+list may be gone.  In that case the caller builds the index at once.
+
+Returns TRUE if the index is  published   or  another thread is building
+one, in which case *cip is set to  NULL.   Returns  FALSE if the build was
+aborted.  In both cases ci is published or freed.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-static void				/* definition must be locked */
-replaceIndex(Definition def, ClauseIndex old, ClauseIndex ci)
-{ ClauseIndex *cip;
-  ClauseIndexList c = allocHeapOrHalt(sizeof(*c));
+#define BUILD_STEP 1024
 
-  for(cip=&def->impl.clauses.clause_indexes;
-      *cip && *cip != old;
-      cip = &(*cip)->next)
-    ;
+static void
+abortClauseIndexBuild(Definition def)
+{ def->impl.clauses.building = NULL;	/* builder frees it */
+}
+
+
+static int
+buildClauseIndex(Definition def, ClauseIndex *cip)
+{ ClauseIndex ci = *cip;
+  ClauseRef cref = NULL;
+
+  LOCKDEF(def);
+  if ( def->impl.clauses.building )
+  { UNLOCKDEF(def);
+    unallocClauseIndexTable(ci);
+    *cip = NULL;
+    return TRUE;
+  }
+  def->impl.clauses.building = ci;
+
+  for(;;)
+  { int n;
+
+    for(n=BUILD_STEP; n > 0; n--)
+    { ClauseRef next = cref ? cref->next : def->impl.clauses.first_clause;
+
+      if ( !next )
+      { def->impl.clauses.building = NULL;
+	publishClauseIndex(def, ci);
+	UNLOCKDEF(def);
+	return TRUE;
+      }
+      cref = next;
+      if ( false(cref->value.clause, CL_ERASED) )
+	addClauseToIndex(def, ci, cref->value.clause, CL_END);
+    }
+
+    UNLOCKDEF(def);			/* let asserts and readers proceed */
+    LOCKDEF(def);
+
+    if ( def->impl.clauses.building != ci )
+    { UNLOCKDEF(def);
+      DEBUG(MSG_JIT, Sdprintf("Aborted building index for %s\n",
+			      predicateName(def)));
+      unallocClauseIndexTable(ci);
+      *cip = NULL;
+      return FALSE;
+    }
+  }
+}
+#endif /*O_CONCURRENT_JIT*/
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Create a hash-index on def for  arg.  It   is  ok  to do so unlocked for
+static predicates, but if another thread  did   the  job, we discard our
+result. For dynamic  or  multifile  predicates,   we  need  to  keep the
+predicate locked while building the  hash-table   because  we  will miss
+clauses that are added while building.  Large  dynamic or multifile
+predicates are indexed in slices using buildClauseIndex().  This returns
+NULL if another thread is building an index for def.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static ClauseIndex
+hashDefinition(Definition def, hash_hints *hints)
+{ ClauseRef cref;
+  ClauseIndex ci;
+  int dyn_or_multi;
+
+  DEBUG(MSG_JIT, Sdprintf("hashDefinition(%s, %d%s, %d) (%s)\n",
+			  predicateName(def), hints->args[0],
+			  hints->args[1] ? "+" : "", hints->buckets,
+			  hints->list ? "lists" : "clauses"));
+
+  ci = newClauseIndexTable(hints);
+
+  if ( (dyn_or_multi=true(def, P_DYNAMIC|P_MULTIFILE)) )
+  {
+#ifdef O_CONCURRENT_JIT
+    if ( def->impl.clauses.number_of_clauses > BUILD_STEP &&
+	 buildClauseIndex(def, &ci) )
+      return ci;
+    if ( !ci )				/* aborted: build at once */
+      ci = newClauseIndexTable(hints);
+#endif
+    LOCKDEF(def);
+  }
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { if ( false(cref->value.clause, CL_ERASED) )
+      addClauseToIndex(def, ci, cref->value.clause, CL_END);
+  }
+
+  if ( !dyn_or_multi )
+    LOCKDEF(def);
+  publishClauseIndex(def, ci);
+  UNLOCKDEF(def);
+
+  return ci;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+retireClauseIndex() adds an index that is  no longer reachable for new
+lookups to def->old_clause_indexes. Running   lookups  may still use it.
+It is freed by cleanClauseIndexes().  Caller must have def locked.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+retireClauseIndex(Definition def, ClauseIndex ci)
+{ ClauseIndexList c = allocHeapOrHalt(sizeof(*c));
+
+  c->index = ci;
+#ifdef O_FROZEN_INDEX
+  c->frozen = NULL;
+#endif
+  c->next = def->old_clause_indexes;
+  def->old_clause_indexes = c;
+}
+
+
+/* Caller must have the predicate locked */
+
+static void				/* definition must be locked */
+replaceIndex(Definition def, ClauseIndex old, ClauseIndex ci)
+{ ClauseIndex *cip;
+
+  for(cip=&def->impl.clauses.clause_indexes;
+      *cip && *cip != old;
+      cip = &(*cip)->next)
+    ;
 
   DEBUG(MSG_JIT, Sdprintf("%d: replaceIndex(%s) %p-->%p\n",
 			  PL_thread_self(),
@@ -1231,9 +1768,7 @@ replaceIndex(Definition def, ClauseIndex old, ClauseIndex ci)
   { *cip = old->next;
   }
 
-  c->index = old;
-  c->next = def->old_clause_indexes;
-  def->old_clause_indexes = c;
+  retireClauseIndex(def, old);
 }
 
 
@@ -1268,6 +1803,9 @@ typedef struct key_asm
 
 typedef struct hash_assessment
 { int		arg;			/* arg for which to assess */
+  unsigned short args[MAX_MULTI_INDEX];	/* args of a composite key */
+  int		indexable;		/* Assessment is usable */
+  int		tried;			/* Only consider for composite */
   size_t	allocated;		/* allocated size of array */
   size_t	size;			/* keys in array */
   size_t	var_count;		/* # non-indexable cases */
@@ -1351,8 +1889,9 @@ assess_remove_duplicates(hash_assessment *a, size_t clause_count)
 		 a->size * a->var_count * SIZEOF_CREF_CLAUSE );
 
 #ifdef O_DEEP_INDEX
-    if ( clause_count/a->size > 10 ||
-	 a->stdev > 3 )
+    if ( a->funct_count > 0 &&		/* only functors have deep indexes */
+	 ( clause_count/a->size > 10 ||
+	   a->stdev > 3 ) )
     { a->list = TRUE;
       a->space += a->size * SIZEOF_CREF_LIST;
     }
@@ -1396,6 +1935,100 @@ assessAddKey(hash_assessment *a, word key)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assessComposite() assesses hashing  on  a   combination  of  arguments.
+This is used if no  single  argument  provides   a  good  index,  for
+example if a fact table is  queried  on   (arg1,  arg3)  and  there are
+many clauses for each value of arg1. We  select the (at most 4) most
+selective indexable arguments and assess the composite keys  of the 2,
+3, ... most selective of them, returning the best in `best'.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+assessComposite(Definition def, hash_assessment *assessments, int count,
+		int clause_count, hash_assessment *best)
+{ hash_assessment *top[MAX_MULTI_INDEX];
+  hash_assessment composites[MAX_MULTI_INDEX-1];
+  hash_assessment *c;
+  int ntop = 0;
+  int i, j, n;
+  int found = FALSE;
+  ClauseRef cref;
+
+  for(i=0; i<count; i++)		/* select the most selective args */
+  { hash_assessment *a = &assessments[i];
+
+    if ( !a->indexable )
+      continue;
+
+    for(j=ntop; j>0 && top[j-1]->speedup < a->speedup; j--)
+    { if ( j < MAX_MULTI_INDEX )
+	top[j] = top[j-1];
+    }
+    if ( j < MAX_MULTI_INDEX )
+    { top[j] = a;
+      if ( ntop < MAX_MULTI_INDEX )
+	ntop++;
+    }
+  }
+
+  if ( ntop < 2 )
+    return FALSE;
+
+  memset(composites, 0, sizeof(composites));
+  for(n=2, c=composites; n<=ntop; n++, c++)
+  { c->arg = -1;
+    for(i=0; i<n; i++)			/* keep the args sorted */
+    { unsigned short arg = (unsigned short)(top[i]->arg+1);
+
+      for(j=i; j>0 && c->args[j-1] > arg; j--)
+	c->args[j] = c->args[j-1];
+      c->args[j] = arg;
+    }
+  }
+
+  for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( true(cl, CL_ERASED) )
+      continue;
+
+    for(n=2, c=composites; n<=ntop; n++, c++)
+    { word keys[MAX_MULTI_INDEX];
+
+      for(i=0; i<n; i++)
+      { if ( !argKey(cl->codes, c->args[i]-1, &keys[i]) )
+	  break;
+      }
+      if ( i == n )
+	assessAddKey(c, compositeKey(keys, n));
+      else
+	c->var_count++;
+    }
+  }
+
+  for(n=2, c=composites; n<=ntop; n++, c++)
+  { if ( assess_remove_duplicates(c, clause_count) )
+    { c->list = FALSE;			/* hashed keys are not functors */
+      DEBUG(MSG_JIT,
+	    Sdprintf("Assess %d args of %s: speedup %f, stdev=%f\n",
+		     n, predicateName(def), c->speedup, c->stdev));
+
+      if ( !found || c->speedup > best->speedup )
+      { *best = *c;
+	found = TRUE;
+      }
+    }
+
+    if ( c->keys )
+      free(c->keys);
+  }
+
+  best->keys = NULL;
+  return found;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bestHash() finds the best argument for creating a hash, given a concrete
 argument vector and a list of  clauses.   To  do  so, it establishes the
@@ -1413,6 +2046,11 @@ expected speedup is
 	       #clauses * #distinct
 	----------------------------------
 	#clauses - #var + #var * #distinct
+
+If the best we can find still is a poor index, we try assessComposite().
+Arguments in `tried' are not candidates on their own, but they may be
+part of a composite key.  On success, the arguments are stored in
+hints->args and bestHash() returns TRUE.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define ASSESS_BUFSIZE 10
@@ -1427,23 +2065,22 @@ bestHash(Word av, Definition def,
   ClauseRef cref;
   hash_assessment assess_buf[ASSESS_BUFSIZE];
   hash_assessment *assessments = assess_buf;
+  hash_assessment composite;
   int assess_allocated = ASSESS_BUFSIZE;
   int assess_count = 0;
+  int untried_count = 0;
   int clause_count = 0;
   hash_assessment *a;
   hash_assessment *best = NULL;		/* argument */
-  int best_arg = -1;
+  int found = FALSE;
 
   if ( !def->tried_index )
     def->tried_index = new_bitvector(def->functor->arity);
 
 					/* Step 1: allocate assessments */
   for(i=0; i<(int)def->functor->arity; i++)
-  { word k;
-
-    if ( !true_bit(def->tried_index, i) &&	/* non-indexable */
-	 !(tried && true_bit(tried, i)) &&	/* already tried, not better */
-	 (k=indexOfWord(av[i] PASS_LD)) )
+  { if ( !true_bit(def->tried_index, i) &&	/* non-indexable */
+	 indexOfWord(av[i] PASS_LD) )
     { if ( assess_count	>= assess_allocated )
       { size_t newbytes = sizeof(*assessments)*2*assess_allocated;
 
@@ -1458,11 +2095,18 @@ bestHash(Word av, Definition def,
       a = &assessments[assess_count++];
       memset(a, 0, sizeof(*a));
       a->arg = i;
+      if ( tried && true_bit(tried, i) )	/* already tried, not better */
+	a->tried = TRUE;
+      else
+	untried_count++;
     }
   }
 
-  if ( assess_count == 0 )
-    return -1;				/* no luck */
+  if ( untried_count == 0 )
+  { if ( assessments != assess_buf )
+      free(assessments);
+    return FALSE;			/* no luck */
+  }
 
 					/* Step 2: assess */
   for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
@@ -1497,7 +2141,10 @@ bestHash(Word av, Definition def,
 	    Sdprintf("Assess arg %d of %s: speedup %f, stdev=%f\n",
 		     a->arg+1, predicateName(def), a->speedup, a->stdev));
 
-      if ( a->speedup > minbest )
+      a->indexable = TRUE;
+      if ( a->tried )
+      { ;				/* only for composite */
+      } else if ( a->speedup > minbest )
       { best = a;
 	minbest = a->speedup;
       } else if ( tried )
@@ -1510,23 +2157,753 @@ bestHash(Word av, Definition def,
     }
 
     if ( a->keys )
-      free(a->keys);
+    { free(a->keys);
+      a->keys = NULL;
+    }
+  }
+
+					/* Step 3: consider composite keys */
+  if ( POOR_INDEX(clause_count, minbest) &&
+       assessComposite(def, assessments, assess_count, clause_count,
+		       &composite) &&
+       composite.speedup > minbest*MIN_SPEEDUP )
+  { best = &composite;
+    if ( tried )
+    { for(i=0, a=assessments; i<assess_count; i++, a++)
+	set_bit(tried, a->arg);
+    }
   }
 
   if ( best )
-  { best_arg       = best->arg;
+  { memset(hints->args, 0, sizeof(hints->args));
+    if ( best == &composite )
+      memcpy(hints->args, composite.args, sizeof(hints->args));
+    else
+      hints->args[0] = (unsigned short)(best->arg+1);
     hints->buckets = (unsigned int)best->size;
     hints->speedup = best->speedup;
     hints->list    = best->list;
+    found = TRUE;
   }
 
   if ( assessments != assess_buf )
     free(assessments);
 
-  return best_arg;
+  return found;
 }
 
 
+#ifdef O_DEEP_INDEX
+
+		 /*******************************
+		 *	   DEEP INDEXING	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Deep indexing. If a list-index  is  created   on  an  argument  that is
+dominated by a few functors (e.g., all  clauses are of the form
+fact(event(Type, Id, ...), ...)), the clause-list   for a functor key may
+be long. In that case we create  secondary   (deep)  indexes  on the
+arguments of the compound, stored in   the  `clause_indexes' of the
+ClauseList. These are plain (non-list) indexes whose  args[0] denotes the
+argument inside the compound rather than the argument of the head. Keys
+are obtained using deepArgKey().
+
+Deep indexes are created just-in-time by deepIndexClauseList(). They are
+maintained by addClauseList() for new  clauses,   but  discarded if
+clauses are removed from the clause-list. This  happens from
+cleanDefinition() or unlinkClause().  As  other threads may still walk
+the discarded indexes, they are moved  to the predicate's
+old_clause_indexes (see retireDeepIndexes()). `deep_tried' is a
+bit-mask of arguments of the compound for which we assessed or built an
+index.
+
+If a deep index grows  too  large,   it  is  moved  to the predicate's
+old_clause_indexes and will be recreated.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_DEEP_ARGS (sizeof(unsigned int)*8)
+#define MIN_DEEP_CLAUSES 10
+
+static inline int
+isFunctorKey(word key)
+{ return tagex(key) == (TAG_ATOM|STG_GLOBAL);
+}
+
+
+static inline word
+deepKeyFromClause(ClauseIndex ci, ClauseIndex sub, Clause cl)
+{ word key;
+
+  deepArgKey(cl->codes, ci->args[0]-1, sub->args[0]-1, &key);
+  return key;
+}
+
+
+static void
+freeDeepIndexes(ClauseList cl)
+{ ClauseIndex sub, next;
+
+  for(sub=cl->clause_indexes; sub; sub=next)
+  { next = sub->next;
+    unallocClauseIndexTable(sub);
+  }
+  cl->clause_indexes = NULL;
+  cl->deep_tried = 0;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+retireDeepIndexes() discards the deep indexes of  cl if clauses are
+removed from it.  Other threads may still  walk these indexes without
+locks, so they are added to def->old_clause_indexes and freed by a later
+cleanClauseIndexes() rather than freed here.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+retireDeepIndexes(Definition def, ClauseList cl)
+{ ClauseIndex sub, next;
+
+  for(sub=cl->clause_indexes; sub; sub=next)
+  { next = sub->next;
+    retireClauseIndex(def, sub);
+  }
+  cl->clause_indexes = NULL;
+  cl->deep_tried = 0;
+}
+
+
+static void
+retireDeepIndex(Definition def, ClauseList cl, ClauseIndex sub)
+{ ClauseIndex *sp;
+
+  for(sp=&cl->clause_indexes; *sp != sub; sp = &(*sp)->next)
+    ;
+  *sp = sub->next;
+  cl->deep_tried &= ~((unsigned int)1 << (sub->args[0]-1));
+
+  retireClauseIndex(def, sub);
+}
+
+
+/* Called from addClauseList(), which has the definition locked */
+
+static void
+addClauseToDeepIndexes(Definition def, ClauseIndex ci, ClauseList cl,
+		       Clause clause, int where)
+{ ClauseIndex sub, next;
+
+  for(sub=cl->clause_indexes; sub; sub=next)
+  { next = sub->next;
+
+    if ( sub->size >= sub->resize_above )
+      retireDeepIndex(def, cl, sub);
+    else
+      addClauseKeyToIndex(def, sub, clause,
+			  deepKeyFromClause(ci, sub, clause), where);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+createDeepIndex() assesses the arguments of  the compound `term' that
+are instantiated and not yet tried and,  if one provides a sufficient
+speedup, builds a deep index for it.   Locking follows hashDefinition():
+dynamic and multifile predicates are locked while  building, for static
+predicates we only lock to publish the result.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static ClauseIndex
+createDeepIndex(Definition def, ClauseIndex ci, ClauseList cl, Word term,
+		word *keyp ARG_LD)
+{ size_t arity = arityTerm(*term);
+  hash_assessment *assessments, *a, *best = NULL;
+  int assess_count = 0;
+  size_t clause_count = 0;
+  float minbest = MIN_SPEEDUP;
+  unsigned int tried = 0;
+  ClauseIndex sub = NULL;
+  ClauseRef cref;
+  int dyn_or_multi;
+  size_t i;
+
+  if ( arity > MAX_DEEP_ARGS )
+    arity = MAX_DEEP_ARGS;
+  for(i=0; i<arity; i++)
+  { if ( !(cl->deep_tried & ((unsigned int)1<<i)) &&
+	 indexOfWord(*argTermP(*term, i) PASS_LD) )
+    { tried |= (unsigned int)1<<i;
+      assess_count++;
+    }
+  }
+
+  if ( !assess_count ||
+       !(assessments = malloc(assess_count*sizeof(*assessments))) )
+    return NULL;
+
+  assess_count = 0;
+  for(i=0; i<arity; i++)
+  { if ( (tried & ((unsigned int)1<<i)) )
+    { a = &assessments[assess_count++];
+      memset(a, 0, sizeof(*a));
+      a->arg = (int)i;
+    }
+  }
+
+  if ( (dyn_or_multi=true(def, P_DYNAMIC|P_MULTIFILE)) )
+    LOCKDEF(def);
+
+  for(cref=cl->first_clause; cref; cref=cref->next)
+  { Clause clause = cref->value.clause;
+
+    if ( true(clause, CL_ERASED) )
+      continue;
+
+    for(a=assessments; a<&assessments[assess_count]; a++)
+    { word k;
+
+      if ( deepArgKey(clause->codes, ci->args[0]-1, a->arg, &k) )
+	assessAddKey(a, k);
+      else
+	a->var_count++;
+    }
+    clause_count++;
+  }
+
+  for(a=assessments; a<&assessments[assess_count]; a++)
+  { if ( assess_remove_duplicates(a, clause_count) )
+    { DEBUG(MSG_JIT,
+	    Sdprintf("Assess deep arg %d.%d of %s: speedup %f, stdev=%f\n",
+		     ci->args[0], a->arg+1, predicateName(def),
+		     a->speedup, a->stdev));
+
+      if ( a->speedup > minbest )
+      { best = a;
+	minbest = a->speedup;
+      }
+    }
+    if ( a->keys )
+    { free(a->keys);
+      a->keys = NULL;
+    }
+  }
+
+  if ( best )
+  { hash_hints hints;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.args[0] = (unsigned short)(best->arg+1);
+    hints.buckets = (unsigned int)best->size;
+    hints.speedup = best->speedup;
+    hints.list    = FALSE;
+
+    sub = newClauseIndexTable(&hints);
+    for(cref=cl->first_clause; cref; cref=cref->next)
+    { Clause clause = cref->value.clause;
+
+      if ( false(clause, CL_ERASED) )
+	addClauseKeyToIndex(def, sub, clause,
+			    deepKeyFromClause(ci, sub, clause), CL_END);
+    }
+    sub->resize_above = sub->size*2;
+    sub->resize_below = sub->size/4;
+  }
+
+  if ( !dyn_or_multi )
+    LOCKDEF(def);
+  if ( sub )
+  { ClauseIndex *sp, conc;
+
+    for(conc=cl->clause_indexes; conc; conc=conc->next)
+    { if ( conc->args[0] == sub->args[0] )
+	break;
+    }
+
+    if ( conc )				/* concurrently created */
+    { unallocClauseIndexTable(sub);
+      sub = conc;
+    } else
+    { for(sp=&cl->clause_indexes; *sp; sp = &(*sp)->next)
+	;
+      MemoryBarrier();
+      *sp = sub;
+    }
+    *keyp = indexOfWord(*argTermP(*term, sub->args[0]-1) PASS_LD);
+  }
+  cl->deep_tried |= tried;
+  UNLOCKDEF(def);
+
+  free(assessments);
+
+  return sub;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+deepIndexClauseList() is called if  the  key   of  a  list-index  is
+found. If the key is a functor, the clause-list is large enough and we
+have (or can create) a deep index on an instantiated argument of the
+compound, we setup `chp' to enumerate the deep index bucket and return
+TRUE.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+deepIndexClauseList(Definition def, ClauseIndex ci, ClauseList cl,
+		    Word argv, ClauseChoice chp ARG_LD)
+{ ClauseIndex sub, best = NULL;
+  float speedup = 0.0;
+  word key = 0;
+  Word p;
+
+  if ( isCompositeIndex(ci) || !isFunctorKey(chp->key) )
+    return FALSE;
+
+  p = &argv[ci->args[0]-1];
+  deRef(p);
+  if ( !isTerm(*p) )
+    return FALSE;
+
+  for(sub=cl->clause_indexes; sub; sub=sub->next)
+  { word k;
+
+    if ( sub->speedup > speedup &&
+	 (k=indexOfWord(*argTermP(*p, sub->args[0]-1) PASS_LD)) )
+    { best = sub;
+      key = k;
+      speedup = sub->speedup;
+    }
+  }
+
+  if ( !best && cl->number_of_clauses > MIN_DEEP_CLAUSES )
+    best = createDeepIndex(def, ci, cl, p, &key PASS_LD);
+
+  if ( best )
+  { DEBUG(MSG_INDEX_FIND,
+	  Sdprintf("Using deep index on arg %d.%d for %s\n",
+		   ci->args[0], best->args[0], keyName(key)));
+
+    chp->key  = key;
+    chp->cref = best->entries[hashIndex(key, best->buckets)].head;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+#endif /*O_DEEP_INDEX*/
+
+
+#ifdef O_FROZEN_INDEX
+
+		 /*******************************
+		 *	   FROZEN INDEXES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+freeze_indexes/1 gives static predicates  whose  clauses  will no longer
+change compact indexes that need  no  maintenance.   An  argument gets a
+frozen index (see struct frozen_index) if all clauses have an indexable
+key for it and there are at least  two distinct keys. At most
+FROZEN_MAX_ARGS indexes are kept, ordered on   the number of distinct
+keys. S_FROZEN uses the first index for which the argument is
+instantiated and continues as S_STATIC if there is none.
+
+The chain of a key holds exactly the  clauses with that key, so walking
+it using nextClauseArg1() needs no   lookahead and detects determinism
+on the last clause. Adding or removing a  clause discards the frozen
+indexes. As choicepoints may still refer to their chains, discarded
+indexes are freed with the outdated JIT indexes by cleanClauseIndexes().
+
+The slots hold the first clause reference   of each chain, such that a
+lookup costs a displacement and a slot.  The perfect hash is built using
+hash and displace: the keys are  spread   over  buckets of about four
+keys and, starting with the largest bucket,  we search for each bucket a
+displacement that maps all its keys on free slots. There are 1.25 slots
+per key, which keeps this search short.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FROZEN_MAX_ARGS	 4		/* Max # frozen indexes */
+#define FROZEN_MAX_TRIES 100000		/* Max displacements per bucket */
+
+#define frozenCref(fi, i) \
+	((ClauseRef)((fi)->crefs + (size_t)(i)*SIZEOF_CREF_CLAUSE))
+#define frozenRange(h, n) \
+	((unsigned int)(((uint64_t)(h) * (n)) >> 32))
+
+typedef struct frozen_key
+{ word		key;			/* Key of the argument */
+  unsigned int	nth;			/* Clause position */
+} frozen_key;
+
+typedef struct frozen_bucket
+{ unsigned int	size;			/* # keys in bucket */
+  unsigned int	bucket;			/* Bucket index */
+} frozen_bucket;
+
+
+static inline unsigned int
+frozenHash(word key, unsigned int displacement)
+{ uint64_t h = ((uint64_t)key + displacement*0x9e3779b97f4a7c15ULL) *
+	       0xff51afd7ed558ccdULL;
+
+  return (unsigned int)(h ^ (h>>32));
+}
+
+
+static inline unsigned int
+frozenSlot(FrozenIndex fi, word key)
+{ unsigned int b = frozenRange(frozenHash(key, 0), fi->buckets);
+
+  return frozenRange(frozenHash(key, fi->displacement[b]), fi->slots);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+firstFrozenClause() is called by S_FROZEN. If   no frozen argument is
+instantiated it returns NULL with chp->key set to 0.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+ClauseRef
+firstFrozenClause(Word argv, LocalFrame fr, Definition def,
+		  ClauseChoice chp ARG_LD)
+{ FrozenIndex fi;
+
+  for(fi=def->frozen_index; fi; fi=fi->next)
+  { word key;
+
+    if ( (key=indexOfWord(argv[fi->arg-1] PASS_LD)) )
+    { ClauseRef cref = frozenCref(fi, frozenSlot(fi, key));
+
+      chp->key = key;
+      if ( cref->key != key )
+	return NULL;
+      chp->cref = cref;
+
+      return nextClauseArg1(chp, generationFrame(fr));
+    }
+  }
+
+  chp->key = 0;
+  return NULL;
+}
+
+
+static int
+compar_frozen_keys(const void *p1, const void *p2)
+{ const frozen_key *k1 = p1;
+  const frozen_key *k2 = p2;
+
+  if ( k1->key != k2->key )
+    return k1->key < k2->key ? -1 : 1;
+
+  return k1->nth < k2->nth ? -1 : k1->nth > k2->nth;
+}
+
+
+static int
+compar_frozen_buckets(const void *p1, const void *p2)
+{ const frozen_bucket *b1 = p1;
+  const frozen_bucket *b2 = p2;
+
+  return b1->size > b2->size ? -1 : b1->size < b2->size;
+}
+
+
+static void
+freeFrozenIndex(FrozenIndex fi)
+{ freeHeap(fi, fi->bytes);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+placeFrozenKeys() finds a displacement for the  keys of a bucket and
+claims their slots by setting the key of  the slot. Returns the
+displacement or 0 if there is none within FROZEN_MAX_TRIES.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static unsigned int
+placeFrozenKeys(FrozenIndex fi, const word *keys, unsigned int count)
+{ unsigned int d;
+
+  for(d=1; d<=FROZEN_MAX_TRIES; d++)
+  { unsigned int i;
+
+    for(i=0; i<count; i++)
+    { ClauseRef cref = frozenCref(fi, frozenRange(frozenHash(keys[i], d),
+						   fi->slots));
+
+      if ( cref->key )
+	break;
+      cref->key = keys[i];
+    }
+
+    if ( i == count )
+      return d;
+
+    while(i-- > 0)			/* undo */
+      frozenCref(fi, frozenRange(frozenHash(keys[i], d), fi->slots))->key = 0;
+  }
+
+  return 0;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+buildFrozenIndex() builds a frozen index on   arg for the n clauses. fk
+is scratch space for n keys. Returns NULL   if  the argument is not
+suitable.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static FrozenIndex
+buildFrozenIndex(Clause *clauses, unsigned int n, int arg, frozen_key *fk)
+{ unsigned int i, nkeys, buckets, slots, overflow;
+  unsigned int *offset;
+  word *keys, *members;
+  frozen_bucket *order;
+  size_t cbytes, bytes;
+  FrozenIndex fi;
+
+  for(i=0; i<n; i++)
+  { if ( !argKey(clauses[i]->codes, arg-1, &fk[i].key) )
+      return NULL;			/* not indexable */
+    fk[i].nth = i;
+  }
+  qsort(fk, n, sizeof(*fk), compar_frozen_keys);
+
+  for(nkeys=1, i=1; i<n; i++)
+  { if ( fk[i].key != fk[i-1].key )
+      nkeys++;
+  }
+  if ( nkeys < 2 )
+    return NULL;
+
+  buckets  = (nkeys+3)/4;
+  slots    = nkeys + nkeys/4 + 1;
+  overflow = n - nkeys;
+  cbytes   = ((size_t)slots+overflow)*SIZEOF_CREF_CLAUSE;
+  bytes    = sizeof(*fi) + cbytes + (size_t)buckets*sizeof(unsigned int);
+  fi = allocHeapOrHalt(bytes);
+  memset(fi, 0, bytes);
+  fi->size	   = n;
+  fi->keys	   = nkeys;
+  fi->buckets	   = buckets;
+  fi->slots	   = slots;
+  fi->arg	   = (unsigned short)arg;
+  fi->bytes	   = bytes;
+  fi->crefs	   = (char*)(fi+1);
+  fi->displacement = (unsigned int*)(fi->crefs + cbytes);
+
+  keys    = allocHeapOrHalt(nkeys*sizeof(*keys));
+  members = allocHeapOrHalt(nkeys*sizeof(*members));
+  offset  = allocHeapOrHalt((buckets+1)*sizeof(*offset));
+  order   = allocHeapOrHalt(buckets*sizeof(*order));
+  memset(offset, 0, (buckets+1)*sizeof(*offset));
+
+  for(nkeys=0, i=0; i<n; i++)		/* distinct keys */
+  { if ( i == 0 || fk[i].key != fk[i-1].key )
+      keys[nkeys++] = fk[i].key;
+  }
+					/* sort the keys on their bucket */
+  for(i=0; i<nkeys; i++)
+    offset[frozenRange(frozenHash(keys[i], 0), buckets) + 1]++;
+  for(i=0; i<buckets; i++)
+  { order[i].bucket = i;
+    order[i].size   = offset[i+1];
+    offset[i+1]    += offset[i];
+  }
+  for(i=0; i<nkeys; i++)
+  { unsigned int b = frozenRange(frozenHash(keys[i], 0), buckets);
+
+    members[offset[b] + --order[b].size] = keys[i];
+  }
+  for(i=0; i<buckets; i++)
+    order[i].size = offset[i+1] - offset[i];
+  qsort(order, buckets, sizeof(*order), compar_frozen_buckets);
+
+  for(i=0; i<buckets && order[i].size > 0; i++)
+  { unsigned int b = order[i].bucket;
+    unsigned int d = placeFrozenKeys(fi, &members[offset[b]], order[i].size);
+
+    if ( !d )
+    { DEBUG(MSG_JIT, Sdprintf("No perfect hash for arg %d\n", arg));
+      freeFrozenIndex(fi);
+      fi = NULL;
+      break;
+    }
+    fi->displacement[b] = d;
+  }
+
+  if ( fi )				/* fill the chains */
+  { ClauseRef prev = NULL;
+    unsigned int next = slots;
+
+    for(i=0; i<n; i++)
+    { ClauseRef cref;
+
+      if ( i == 0 || fk[i].key != fk[i-1].key )
+	cref = frozenCref(fi, frozenSlot(fi, fk[i].key));
+      else
+	prev->next = cref = frozenCref(fi, next++);
+
+      cref->key		 = fk[i].key;
+      cref->value.clause = clauses[fk[i].nth];
+      prev = cref;
+    }
+  }
+
+  freeHeap(keys,    nkeys*sizeof(*keys));
+  freeHeap(members, nkeys*sizeof(*members));
+  freeHeap(offset,  (buckets+1)*sizeof(*offset));
+  freeHeap(order,   buckets*sizeof(*order));
+
+  return fi;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+discardFrozenIndexes() is called if the clauses of def change. The
+definition is locked.  If linger is TRUE, choicepoints may still walk the
+chains and the indexes are added to def->old_clause_indexes, such that
+cleanClauseIndexes() frees them together with the outdated JIT indexes.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+discardFrozenIndexes(Definition def, int linger)
+{ FrozenIndex fi, next;
+
+  if ( (fi=def->frozen_index) )
+  { DEBUG(MSG_JIT, Sdprintf("Discarding frozen indexes of %s\n",
+			    predicateName(def)));
+
+    def->frozen_index = NULL;
+    for(; fi; fi=next)
+    { next = fi->next;
+      if ( linger )
+      { ClauseIndexList c = allocHeapOrHalt(sizeof(*c));
+
+	c->index  = NULL;
+	c->frozen = fi;
+	c->next   = def->old_clause_indexes;
+	def->old_clause_indexes = c;
+      } else
+      { freeFrozenIndex(fi);
+      }
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+freezeDefinition() replaces the frozen indexes of def and retires the JIT
+indexes on the frozen arguments. Returns the number of frozen indexes.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+freezeDefinition(Definition def)
+{ FrozenIndex best[FROZEN_MAX_ARGS];
+  int nbest = 0;
+  unsigned int n = 0;
+  int arity = def->functor->arity;
+  ClauseRef cref;
+
+  LOCKDEF(def);
+  discardFrozenIndexes(def, TRUE);
+
+  for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+  { if ( false(cref->value.clause, CL_ERASED) )
+      n++;
+  }
+
+  if ( arity > 0 && n > 1 )
+  { Clause *clauses = allocHeapOrHalt(n*sizeof(*clauses));
+    frozen_key *fk = allocHeapOrHalt(n*sizeof(*fk));
+    ClauseIndex ci, next;
+    unsigned int i = 0;
+    int arg, j;
+
+    for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+    { if ( false(cref->value.clause, CL_ERASED) )
+	clauses[i++] = cref->value.clause;
+    }
+
+    for(arg=1; arg<=arity; arg++)
+    { FrozenIndex fi = buildFrozenIndex(clauses, n, arg, fk);
+
+      if ( !fi )
+	continue;
+      if ( nbest == FROZEN_MAX_ARGS )
+      { if ( fi->keys <= best[nbest-1]->keys )
+	{ freeFrozenIndex(fi);
+	  continue;
+	}
+	freeFrozenIndex(best[--nbest]);
+      }
+      for(j=nbest++; j > 0 && best[j-1]->keys < fi->keys; j--)
+	best[j] = best[j-1];
+      best[j] = fi;
+    }
+
+    for(j=nbest-1; j >= 0; j--)
+    { best[j]->next = def->frozen_index;
+      def->frozen_index = best[j];
+    }
+
+    for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
+    { next = ci->next;
+
+      if ( !isCompositeIndex(ci) )
+      { for(j=0; j<nbest; j++)
+	{ if ( best[j]->arg == ci->args[0] )
+	  { replaceIndex(def, ci, NULL);
+	    break;
+	  }
+	}
+      }
+    }
+
+    freeHeap(clauses, n*sizeof(*clauses));
+    freeHeap(fk, n*sizeof(*fk));
+  }
+
+  freeCodesDefinition(def, TRUE);	/* install S_FROZEN */
+  UNLOCKDEF(def);
+
+  return nbest;
+}
+
+
+static
+PRED_IMPL("freeze_indexes", 1, freeze_indexes, PL_FA_TRANSPARENT)
+{ PRED_LD
+  term_t tail = PL_new_term_ref();
+  term_t head = PL_new_term_ref();
+  Module m = NULL;
+
+  if ( !PL_strip_module_ex(A1, &m, tail) )
+    return FALSE;
+
+  while( PL_get_list(tail, head, tail) )
+  { Procedure proc;
+    Definition def;
+
+    if ( !get_procedure(head, &proc, 0,
+			GP_NAMEARITY|GP_FINDHERE|GP_EXISTENCE_ERROR) )
+      return FALSE;
+    def = getProcDefinition(proc);
+
+    if ( true(def, P_DYNAMIC|P_THREAD_LOCAL) )
+      return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		      ATOM_freeze, ATOM_dynamic_procedure, proc);
+    if ( false(def, P_FOREIGN) )
+      freezeDefinition(def);
+  }
+
+  return PL_get_nil_ex(tail);
+}
+
+#endif /*O_FROZEN_INDEX*/
+
+
 		 /*******************************
 		 *  PREDICATE PROPERTY SUPPORT	*
 		 *******************************/
@@ -1534,30 +2911,77 @@ bestHash(Word av, Definition def,
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Index info is
 
-	Arg - hash(Buckets, Speedup, IsList)
+	ArgSpec - hash(Buckets, Speedup, IsList)
+
+Where ArgSpec is an integer for  a   single  argument index or a list of
+integers for a composite index. Frozen indexes are reported as
+
+	Arg - frozen(Keys)
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static int
+unify_index_args(term_t t, ClauseIndex ci)
+{ GET_LD
+
+  if ( !isCompositeIndex(ci) )
+  { return PL_unify_integer(t, ci->args[0]);
+  } else
+  { term_t tail = PL_copy_term_ref(t);
+    term_t head = PL_new_term_ref();
+    int i;
+
+    for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_integer(head, ci->args[i]) )
+	return FALSE;
+    }
+
+    return PL_unify_nil(tail);
+  }
+}
+
+
 static int
 unify_clause_index(term_t t, ClauseIndex ci)
-{ return PL_unify_term(t,
-		       PL_FUNCTOR, FUNCTOR_minus2,
-			 PL_INT, (int)ci->args[0],
-			 PL_FUNCTOR_CHARS, "hash", 3,
-			   PL_INT, (int)ci->buckets,
-			   PL_DOUBLE, (double)ci->speedup,
-		           PL_BOOL, ci->is_list);
+{ GET_LD
+  term_t argspec = PL_new_term_ref();
+
+  return ( unify_index_args(argspec, ci) &&
+	   PL_unify_term(t,
+			 PL_FUNCTOR, FUNCTOR_minus2,
+			   PL_TERM, argspec,
+			   PL_FUNCTOR_CHARS, "hash", 3,
+			     PL_INT, (int)ci->buckets,
+			     PL_DOUBLE, (double)ci->speedup,
+			     PL_BOOL, ci->is_list) );
 }
 
 bool
 unify_index_pattern(Procedure proc, term_t value)
 { GET_LD
   Definition def = getProcDefinition__LD(proc->definition PASS_LD);
-  ClauseIndex ci;
+  ClauseIndex ci = def->impl.clauses.clause_indexes;
+#ifdef O_FROZEN_INDEX
+  FrozenIndex fi = def->frozen_index;
+#else
+  void *fi = NULL;
+#endif
 
-  if ( (ci=def->impl.clauses.clause_indexes) )
+  if ( ci || fi )
   { term_t tail = PL_copy_term_ref(value);
     term_t head = PL_new_term_ref();
 
+#ifdef O_FROZEN_INDEX
+    for(; fi; fi=fi->next)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_term(head,
+			  PL_FUNCTOR, FUNCTOR_minus2,
+			    PL_INT, (int)fi->arg,
+			    PL_FUNCTOR_CHARS, "frozen", 1,
+			      PL_INT, (int)fi->keys) )
+	return FALSE;
+    }
+#endif
     for(; ci; ci=ci->next)
     { if ( !PL_unify_list(tail, head, tail) ||
 	   !unify_clause_index(head, ci) )
@@ -1576,4 +3000,7 @@ unify_index_pattern(Procedure proc, term_t value)
 		 *******************************/
 
 BeginPredDefs(index)
+#ifdef O_FROZEN_INDEX
+  PRED_DEF("freeze_indexes", 1, freeze_indexes, PL_FA_TRANSPARENT)
+#endif
 EndPredDefs
@@ -330,4 +330,112 @@ register_attvar(Word gp ARG_LD)
   LD->attvar.attvars = gp;
 }
 
+
+#ifdef O_EPOCH_RECLAIM
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+enterSharedDefinition() and leaveSharedDefinition() implement enter/leave
+for shared dynamic predicates. Instead of   counting references on the
+definition, which makes all threads  write   to  the same cache line, we
+count the frames on each shared dynamic predicate in the thread, using a
+small table in LD->dynamic.frames. Only   the  0->1 transition for a
+predicate needs to synchronise with  reclaimDefinition()   on  it:  we
+refresh the generation of the frame after  the count is visible, such
+that a clause reclaimed concurrently can never be visible to this frame.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline unsigned int *
+sharedFramesCount(Definition def ARG_LD)
+{ shared_frames *b = &LD->dynamic.frames;
+
+  do
+  { int i;
+
+    for(i=0; i<SHARED_FRAMES_BLOCK; i++)
+    { if ( b->entries[i].definition == def )
+	return &b->entries[i].frames;
+    }
+  } while( (b=b->next) );
+
+  return NULL;
+}
+
+
+static inline void
+enterSharedDefinition(Definition def ARG_LD)
+{ unsigned int *count;
+
+  if ( !(count = sharedFramesCount(def PASS_LD)) )
+    count = claimSharedFrames(def PASS_LD);
+
+  if ( (*count)++ == 0 )
+  { MemoryBarrier();
+    if ( unlikely(GD->procedures.reclaiming == def) )
+      waitReclaimDefinition();
+#ifdef O_LOGICAL_UPDATE
+    if ( environment_frame )
+      setGenerationFrame(environment_frame, GD->generation);
+#endif
+  }
+}
+
+
+static inline int
+enterDynamicDefinition(Definition def ARG_LD)
+{ if ( true(def, P_SHARED) )
+  { enterSharedDefinition(def PASS_LD);
+    return TRUE;
+  }
+
+  def->references++;
+  return FALSE;
+}
+
+
+static inline void
+leaveSharedDefinition(Definition def ARG_LD)
+{ unsigned int *count = sharedFramesCount(def PASS_LD);
+
+  assert(count && *count > 0);
+  if ( *count == 1 )
+    MemoryBarrier();			/* complete our walks first */
+  if ( --(*count) == 0 &&
+       unlikely(true(def, NEEDSCLAUSEGC)) )
+    reclaimDefinition(def);
+}
+
+#else /*O_EPOCH_RECLAIM*/
+
+static inline int
+enterDynamicDefinition(Definition def)
+{ LOCKDYNDEF(def);
+  def->references++;
+  UNLOCKDYNDEF(def);
+
+  return FALSE;
+}
+#endif /*O_EPOCH_RECLAIM*/
+
+#ifdef O_CONCURRENT_APPEND
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+blockAppendDefinition() is called by LOCKDEF()   after  locking the mutex
+of a dynamic predicate. It stops new lock-free appends and waits for the
+ones in progress (see waitAppendDefinition()).  Both sides raise their
+own counter before reading the other, so  one of them always sees the
+other.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline void
+blockAppendDefinition(Definition def)
+{ ATOMIC_INC(&def->append_blocked);
+  if ( unlikely(def->appending) )
+    waitAppendDefinition(def);
+}
+
+
+static inline void
+unblockAppendDefinition(Definition def)
+{ ATOMIC_DEC(&def->append_blocked);
+}
+#endif /*O_CONCURRENT_APPEND*/
+
 #endif /*PL_INLINE_H_INCLUDED*/
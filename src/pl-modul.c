@@ -65,6 +65,9 @@ _lookupModule(atom_t name)
   m->name = name;
 #ifdef O_PLMT
   m->mutex = allocSimpleMutex(PL_atom_chars(m->name));
+#endif
+#ifdef O_RESOLVE_CACHE
+  m->resolve_generation = 1;		/* 0 marks a claimed cache entry */
 #endif
   set(m, M_CHARESCAPE);
   if ( !GD->options.traditional )
@@ -192,6 +195,11 @@ unallocModule(Module m)
   if ( m->mutex )      freeSimpleMutex(m->mutex);
 #endif
   if ( m->lingering )  freeLingeringDefinitions(m->lingering);
+#ifdef O_RESOLVE_CACHE
+  if ( m->resolve_cache )
+    freeHeap(m->resolve_cache,
+	     RESOLVECACHESIZE*sizeof(resolve_cache_entry));
+#endif
 
   freeHeap(m, sizeof(*m));
 }
@@ -249,6 +257,7 @@ destroyModule(Module m)
   if ( (s=lookupHTable(GD->tables.modules, (void*)m->name)) )
     deleteSymbolHTable(GD->tables.modules, s);
   UNLOCK();
+  updateResolveGeneration(m);
 
   unlinkSourceFilesModule(m);
   PL_unregister_atom(m->name);
@@ -388,6 +397,7 @@ addSuperModule_no_lock(Module m, Module s, int where)
   }
 
   updateLevelModule(m);
+  updateResolveGeneration(m);
   succeed;
 }
 
@@ -416,6 +426,7 @@ delSuperModule(Module m, Module s)
       freeHeap(c, sizeof(*c));
 
       updateLevelModule(m);
+      updateResolveGeneration(m);
       succeed;
     }
   }
@@ -436,6 +447,7 @@ clearSupersModule_no_lock(Module m)
   }
 
   m->level = 0;
+  updateResolveGeneration(m);
 }
 
 void
@@ -455,6 +467,7 @@ setSuperModule(Module m, Module s)
   { if ( (Module)m->supers->value != s )
     { m->supers->value = s;
       m->level = s->level+1;
+      updateResolveGeneration(m);
 
       succeed;
     }
@@ -1391,6 +1404,7 @@ import(term_t pred, term_t strength ARG_LD)
       { lingerDefinition(odef);
       }
       set(old, pflags);
+      updateResolveGeneration(destination);
 
       succeed;
     }
@@ -1449,6 +1463,7 @@ import(term_t pred, term_t strength ARG_LD)
     addHTable(destination->procedures,
 	      (void *)proc->definition->functor->functor, nproc);
     UNLOCKMODULE(destination);
+    updateResolveGeneration(destination);
   }
 
   succeed;
@@ -2119,26 +2119,34 @@ PRED_IMPL("arg", 3, arg, PL_FA_NONDETERMINISTIC)
 
 
 /* unify_vp() assumes *vp is a variable and binds it to val.
-   The assignment is *not* trailed. As no allocation takes
-   place, there are no error conditions.
+   The assignment is *not* trailed.  If `trailed' is FALSE the
+   caller did not trail vp either and we must use setUntrailed().
+   As no allocation takes place, there are no error conditions.
 */
 
 void
-unify_vp(Word vp, Word val ARG_LD)
-{ deRef(val);
+unify_vp(Word vp, Word val, int trailed ARG_LD)
+{ word w;
+
+  deRef(val);
 
   if ( isVar(*val) )
   { if ( val < vp )
-    { *vp = makeRef(val);
+    { w = makeRef(val);
     } else if ( vp < val )
-    { setVar(*vp);
+    { setVar(w);
       *val = makeRef(vp);
     } else
-      setVar(*vp);
+      setVar(w);
   } else if ( isAttVar(*val) )
-  { *vp = makeRef(val);
+  { w = makeRef(val);
   } else
-    *vp = *val;
+    w = *val;
+
+  if ( trailed )
+    *vp = w;
+  else
+    setUntrailed(vp, w);
 }
 
 
@@ -2207,7 +2215,7 @@ setarg(term_t n, term_t term, term_t value, int flags)
 					/* this is unify(), but the */
 					/* assignment must *not* be trailed */
   v = valTermRef(value);
-  unify_vp(a, v PASS_LD);
+  unify_vp(a, v, (flags & SETARG_BACKTRACKABLE) PASS_LD);
 
   return TRUE;
 }
@@ -4964,6 +4972,8 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
     v->value.f = gc_status.time;
   } else if (key == ATOM_collections)
     v->value.i = gc_status.collections;
+  else if (key == ATOM_minor_collections)
+    v->value.i = gc_status.minor_collections;
   else if (key == ATOM_collected)
     v->value.i = gc_status.trail_gained + gc_status.global_gained;
 #ifdef HAVE_BOEHM_GC
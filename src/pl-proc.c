@@ -190,6 +190,7 @@ importDefinitionModule(Module m, Definition def, int flags)
 	proc->definition = def;
 	if ( unshareDefinition(odef) == 0 )
 	  lingerDefinition(odef);
+	updateResolveGeneration(m);
       } else
       { if ( !(flags&PROC_WEAK) )
 	  rc = warning("Failed to import %s into %s",
@@ -203,6 +204,7 @@ importDefinitionModule(Module m, Definition def, int flags)
     proc->source_no  = 0;
     addHTable(m->procedures, (void *)functor, proc);
     shareDefinition(def);
+    updateResolveGeneration(m);
   }
 
   UNLOCKMODULE(m);
@@ -229,11 +231,12 @@ static void
 resetProcedure(Procedure proc, bool isnew)
 { Definition def = proc->definition;
 
-  if ( (true(def, P_DYNAMIC) && def->references == 0) ||
+  if ( (true(def, P_DYNAMIC) && false(def, P_SHARED) &&
+	def->references == 0) ||
        !def->impl.any )
     isnew = TRUE;
 
-  def->flags ^= def->flags & ~(SPY_ME|NEEDSCLAUSEGC|P_DIRTYREG);
+  def->flags ^= def->flags & ~(SPY_ME|NEEDSCLAUSEGC|P_DIRTYREG|P_SHARED);
   if ( stringAtom(def->functor->name)[0] != '$' )
     set(def, TRACE_ME);
   def->impl.clauses.number_of_clauses = 0;
@@ -254,6 +257,83 @@ resetProcedure(Procedure proc, bool isnew)
     freeCodesDefinition(def, FALSE);
   } else
     freeCodesDefinition(def, TRUE);	/* carefully sets to S_VIRGIN */
+
+  updateInlineGeneration(def);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+updateInlineGeneration() must be called if the clauses or  properties of
+a predicate change. The compiler  saves   the  generation with the code
+that inlines the predicate (see  I_INLINED)   and  this  code falls back
+to calling the predicate if the  generation   no  longer  matches. The
+supervisor uses the same generation to enable the cut of I_GUARD. The
+generations come from a global counter, so they are never 0 and never
+shared by two definitions.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+updateInlineGeneration(Definition def)
+{ unsigned int gen;
+
+  do
+  { gen = ATOMIC_INC(&GD->procedures.inline_generation);
+  } while ( gen == 0 );
+
+  def->inline_generation = gen;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+updateResolveGeneration() must be called after a  change to m that may
+make resolveProcedure() find a different   defined  procedure: an import
+into m or a change to the import modules of m.  It invalidates the resolve
+caches of m and of all modules that  import   from  m,  as these search m
+too.  If m is NULL, all resolve caches are invalidated.
+
+updateResolveGenerationDefinition() must be called if def becomes defined.
+This affects the module of def and, if   def is imported, the modules it
+is imported into. As we do not  know   the  latter,  we invalidate all
+caches if the definition is shared. Predicates that become undefined need
+not call this as a cached procedure is only used if it is still defined.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_RESOLVE_CACHE
+static void
+nextResolveGeneration(Module m)
+{ while( ATOMIC_INC(&m->resolve_generation) == 0 )
+    ;					/* 0 marks a claimed entry */
+}
+#endif
+
+void
+updateResolveGeneration(Module m)
+{
+#ifdef O_RESOLVE_CACHE
+  TableEnum e;
+  Symbol s;
+
+  if ( !GD->tables.modules )
+    return;
+
+  e = newTableEnum(GD->tables.modules);
+  while( (s = advanceTableEnum(e)) )
+  { Module sub = s->value;
+
+    if ( !m || isSuperModule(m, sub) )
+      nextResolveGeneration(sub);
+  }
+  freeTableEnum(e);
+#endif
+}
+
+
+void
+updateResolveGenerationDefinition(Definition def)
+{
+#ifdef O_RESOLVE_CACHE
+  updateResolveGeneration(def->shared > 1 ? NULL : def->module);
+#endif
 }
 
 
@@ -948,6 +1028,112 @@ freeClauseRef(ClauseRef cref)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+nextGeneration() advances the  database  generation   and  returns  the
+new generation. Using an atomic  increment  rather   than  L_MISC  means
+that assert and retract on  different  predicates   do  not  share a
+global lock, while the generations remain unique and ordered.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_LOGICAL_UPDATE
+static inline gen_t
+nextGeneration(void)
+{ return ATOMIC_INC(&GD->generation);
+}
+#endif
+
+
+#ifdef O_CONCURRENT_APPEND
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+appendClauseDefinition() links cref at the end  of a dynamic predicate
+without taking its mutex.  Appends swap   the  `next` of the last clause
+from NULL to cref and then move  last_clause,   as  in a lock-free queue.
+Another append that finds a lagging  last_clause moves it on first.
+
+The generation of the clause must   be  above  that  of the clause it is
+linked to, or a reader could see a  clause without the one before it. If
+a concurrent append with a later  generation   linked  first, we take a
+new generation before trying again. Clauses of one thread keep their
+order.
+
+The number of clauses is claimed  before   linking.  If it would become a
+power of two we use the locked path,  which reconsiders the indexes (see
+reconsider_index() in pl-index.c). All other  changes to the clause list
+are made with the mutex held  and   LOCKDEF()  waits for appends in
+progress (see blockAppendDefinition()), so  they   never  see  a half
+linked clause.
+
+The append is only tried if the predicate  has clauses and no indexes.
+Clause index buckets must be in the  order   of  the clause list, so we
+do not update them without the mutex.   Returns FALSE if the caller must
+use the locked path.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+claimClauseCount(Definition def)
+{ for(;;)
+  { unsigned int nc = def->impl.clauses.number_of_clauses;
+
+    if ( nc == 0 || (nc & (nc+1)) == 0 )	/* nc+1 is a power of two */
+      return FALSE;
+    if ( COMPARE_AND_SWAP(&def->impl.clauses.number_of_clauses, nc, nc+1) )
+      return TRUE;
+  }
+}
+
+
+static int
+appendClauseDefinition(Definition def, Clause clause, ClauseRef cref)
+{ int rc = FALSE;
+
+  ATOMIC_INC(&def->appending);
+  if ( def->append_blocked == 0 &&
+       def->mutex &&
+       true(def, P_DYNAMIC) &&
+       !def->impl.clauses.clause_indexes &&
+#ifdef O_FROZEN_INDEX
+       !def->frozen_index &&
+#endif
+       claimClauseCount(def) )
+  {
+#ifdef O_LOGICAL_UPDATE
+    clause->generation.created = nextGeneration();
+    clause->generation.erased  = ~(gen_t)0;	/* infinite */
+#endif
+    for(;;)
+    { ClauseRef last = def->impl.clauses.last_clause;
+      ClauseRef next = last->next;
+
+      if ( next )			/* help a lagging append */
+      { COMPARE_AND_SWAP(&def->impl.clauses.last_clause, last, next);
+	continue;
+      }
+#ifdef O_LOGICAL_UPDATE
+      if ( clause->generation.created <=
+	   last->value.clause->generation.created )
+      { clause->generation.created = nextGeneration();
+	continue;
+      }
+#endif
+      if ( COMPARE_AND_SWAP(&last->next, NULL, cref) )
+      { COMPARE_AND_SWAP(&def->impl.clauses.last_clause, last, cref);
+	break;
+      }
+    }
+
+    if ( false(clause, UNIT_CLAUSE) )
+      ATOMIC_INC(&def->impl.clauses.number_of_rules);
+    ATOMIC_INC(&GD->statistics.clauses);
+    updateInlineGeneration(def);
+    rc = TRUE;
+  }
+  ATOMIC_DEC(&def->appending);
+
+  return rc;
+}
+#endif /*O_CONCURRENT_APPEND*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Assert a clause to a procedure. Where askes to assert either at the head
 or at the tail of the clause list.
@@ -957,6 +1143,12 @@ procedure, it deletes the supervisor. This is  probably a bit rough, but
 deals with -for example- clauses for   term_expansion/2. After the first
 definition this will be  called  and   an  S_TRUSTME  supervisor will be
 installed, causing further clauses to have no effect.
+
+Readers walk the clause list and indexes without locking; the definition
+lock only serialises writers. The clause is therefore fully initialised,
+including its generation, before the barrier that precedes linking it.
+Appending to a shared predicate without indexes does not take the lock
+at all; see appendClauseDefinition().
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 ClauseRef
@@ -968,13 +1160,25 @@ assertProcedure(Procedure proc, Clause clause, int where ARG_LD)
   argKey(clause->codes, 0, &key);
   cref = newClauseRef(clause, key);
 
-  if ( def->references && (debugstatus.styleCheck & DYNAMIC_STYLE) )
+  if ( (debugstatus.styleCheck & DYNAMIC_STYLE) &&
+       referencedDefinition(def) )
     printMessage(ATOM_informational,
 		 PL_FUNCTOR_CHARS, "modify_active_procedure", 2,
 		   PL_CHARS, "assert",
 		   _PL_PREDICATE_INDICATOR, proc);
 
+#ifdef O_CONCURRENT_APPEND
+  if ( where != CL_START && GD->thread.enabled &&
+       appendClauseDefinition(def, clause, cref) )
+    return cref;
+#endif
+
   LOCKDEF(def);
+#ifdef O_LOGICAL_UPDATE
+  clause->generation.created = nextGeneration();
+  clause->generation.erased  = ~(gen_t)0;	/* infinite */
+#endif
+  MemoryBarrier();			/* publish clause before linking */
   if ( !def->impl.clauses.last_clause )
   { def->impl.clauses.first_clause = def->impl.clauses.last_clause = cref;
   } else if ( where == CL_START )
@@ -991,17 +1195,15 @@ assertProcedure(Procedure proc, Clause clause, int where ARG_LD)
   if ( false(clause, UNIT_CLAUSE) )
     def->impl.clauses.number_of_rules++;
   GD->statistics.clauses++;
-#ifdef O_LOGICAL_UPDATE
-  PL_LOCK(L_MISC);
-  clause->generation.created = ++GD->generation;
-  PL_UNLOCK(L_MISC);
-  clause->generation.erased  = ~(gen_t)0;	/* infinite */
-#endif
 
   if ( false(def, P_DYNAMIC) )		/* see (*) above */
     freeCodesDefinition(def, TRUE);
 
   addClauseToIndexes(def, clause, where);
+  updateInlineGeneration(def);
+  if ( def->impl.clauses.number_of_clauses == 1 &&
+       false(def, PROC_DEFINED) )
+    updateResolveGenerationDefinition(def); /* became defined */
 
   UNLOCKDEF(def);
 
@@ -1048,7 +1250,17 @@ abolishProcedure(Procedure proc, Module module)
   { removeClausesProcedure(proc, 0, FALSE);
 
     if ( true(def, P_DYNAMIC) )
-    { if ( def->references == 0 )
+    {
+#ifdef O_EPOCH_RECLAIM
+      if ( true(def, P_SHARED) )	/* other threads may run it */
+      { resetProcedure(proc, FALSE);
+	if ( true(def, NEEDSCLAUSEGC) )
+	  registerDirtyDefinition(def);
+	detachMutexAndUnlock(def);
+	reclaimDefinition(def);
+      } else
+#endif
+      if ( def->references == 0 )
       { ClauseRef cref;
 
 	resetProcedure(proc, FALSE);
@@ -1088,9 +1300,8 @@ removeClausesProcedure(Procedure proc, int sfindex, int fromfile)
 { Definition def = proc->definition;
   ClauseRef c;
   int deleted = 0;
-
 #ifdef O_LOGICAL_UPDATE
-  GD->generation++;
+  gen_t generation = nextGeneration();
 #endif
 
   if ( true(def, P_THREAD_LOCAL) )
@@ -1111,7 +1322,7 @@ removeClausesProcedure(Procedure proc, int sfindex, int fromfile)
 	set(def, NEEDSCLAUSEGC);
 
 #ifdef O_LOGICAL_UPDATE
-      cl->generation.erased = GD->generation;
+      cl->generation.erased = generation;
 #endif
       def->impl.clauses.number_of_clauses--;
       def->impl.clauses.erased_clauses++;
@@ -1119,6 +1330,8 @@ removeClausesProcedure(Procedure proc, int sfindex, int fromfile)
 	def->impl.clauses.number_of_rules--;
     }
   }
+  if ( deleted )
+    updateInlineGeneration(def);
 
   return deleted;
 }
@@ -1188,6 +1401,9 @@ retractClauseDefinition(Definition def, Clause clause)
   ATOMIC_SUB(&def->module->code_size, size);
 
   if ( def->references ||
+#ifdef O_EPOCH_RECLAIM
+       true(def, P_SHARED) ||
+#endif
        def->impl.clauses.number_of_clauses > 16 )
   { deleteActiveClauseFromIndexes(def, clause);
 
@@ -1198,14 +1414,22 @@ retractClauseDefinition(Definition def, Clause clause)
     { set(def, NEEDSCLAUSEGC);
     }
 #ifdef O_LOGICAL_UPDATE
-    PL_LOCK(L_MISC);
-    clause->generation.erased = ++GD->generation;
-    PL_UNLOCK(L_MISC);
+    clause->generation.erased = nextGeneration();
 #endif
 
     DEBUG(CHK_SECURE, checkDefinition(def));
     UNLOCKDYNDEF(def);
 
+#ifdef O_EPOCH_RECLAIM			/* erase/1 outside a frame on it */
+    if ( true(def, P_SHARED) && true(def, NEEDSCLAUSEGC) )
+    { GET_LD
+      unsigned int *count = sharedFramesCount(def PASS_LD);
+
+      if ( !count || *count == 0 )
+	reclaimDefinition(def);
+    }
+#endif
+
     succeed;
   }
 
@@ -1401,6 +1625,116 @@ gcClausesDefinitionAndUnlock(Definition def)
 }
 
 
+#ifdef O_EPOCH_RECLAIM
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+reclaimDefinition() removes the erased clauses   from a shared dynamic
+predicate. This is safe if no thread has   a frame running this predicate
+(see enterSharedDefinition()). We announce our   intent in
+GD->procedures.reclaiming before checking the   threads:  a thread that
+enters the predicate either shows up in the  check, or waits until we
+are done. Clauses that cannot be reclaimed   now  are reclaimed by the
+next call, which happens when the last frame on this predicate is left.
+Frames on other shared dynamic predicates do not delay reclaiming.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+reclaimDefinition(Definition def)
+{ ClauseRef garbage = NULL;
+
+  PL_LOCK(L_RECLAIM);
+  GD->procedures.reclaiming = def;
+  MemoryBarrier();
+  if ( !sharedDynamicFramesThreads(def) )
+  { LOCKDEF(def);
+    if ( true(def, NEEDSCLAUSEGC) )
+      garbage = cleanDefinition(def, NULL);
+    UNLOCKDEF(def);
+  }
+  GD->procedures.reclaiming = NULL;
+  PL_UNLOCK(L_RECLAIM);
+
+  if ( garbage )
+    freeClauseList(garbage);
+}
+
+
+void
+waitReclaimDefinition(void)
+{ while ( GD->procedures.reclaiming )
+  { PL_LOCK(L_RECLAIM);
+    PL_UNLOCK(L_RECLAIM);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+claimSharedFrames() finds an  entry   for  def  in LD->dynamic.frames
+without frames. Entries are never removed, so reclaimDefinition() can scan
+the table of another thread  without   locking.  We  only  reuse entries
+whose count is zero and add a block if all entries are in use. The new
+block is linked after it is initialised.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+unsigned int *
+claimSharedFrames(Definition def ARG_LD)
+{ shared_frames *b = &LD->dynamic.frames;
+
+  for(;;)
+  { int i;
+
+    for(i=0; i<SHARED_FRAMES_BLOCK; i++)
+    { if ( b->entries[i].frames == 0 )
+      { b->entries[i].definition = def;
+	return &b->entries[i].frames;
+      }
+    }
+    if ( !b->next )
+      break;
+    b = b->next;
+  }
+
+  { shared_frames *nb = allocHeapOrHalt(sizeof(*nb));
+
+    memset(nb, 0, sizeof(*nb));
+    nb->entries[0].definition = def;
+    MemoryBarrier();
+    b->next = nb;
+
+    return &nb->entries[0].frames;
+  }
+}
+
+
+void
+freeSharedFrames(PL_local_data_t *ld)
+{ shared_frames *b, *next;
+
+  for(b=ld->dynamic.frames.next; b; b=next)
+  { next = b->next;
+    freeHeap(b, sizeof(*b));
+  }
+  ld->dynamic.frames.next = NULL;
+}
+#endif /*O_EPOCH_RECLAIM*/
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+referencedDefinition() is true if  some  frame   may  be  running def.
+Shared dynamic predicates are not reference   counted; we ask the threads
+whether they count frames on def.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+referencedDefinition(Definition def)
+{
+#ifdef O_EPOCH_RECLAIM
+  if ( true(def, P_SHARED) )
+    return sharedDynamicFramesThreads(def);
+#endif
+  return def->references != 0;
+}
+
+
 #ifdef O_PLMT
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Discard an entire definition. This can  only   be  used if we *know* the
@@ -1527,6 +1861,7 @@ meta_declaration(term_t spec)
   else
     clear(def, P_TRANSPARENT);
   set(def, P_META);
+  updateInlineGeneration(def);
 
   if ( false(def, FILE_ASSIGNED) && ReadingSource )
     addProcedureSourceFile(lookupSourceFile(source_file_name, TRUE), proc);
@@ -1660,6 +1995,7 @@ PL_meta_predicate(predicate_t proc, const char *spec_s)
   else
     clear(def, P_TRANSPARENT);
   set(def, P_META);
+  updateInlineGeneration(def);
 
   return TRUE;
 }
@@ -1693,56 +2029,207 @@ registerDirtyDefinition(Definition def)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+pl_garbage_collect_clauses() reclaims  the  erased   clauses  of  dirty
+static predicates without suspending  the  other   threads.  It uses two
+rounds of markPredicatesInEnvironments() over all threads:
+
+  1. Frames that are older than the generation at which a clause was
+     erased may still run it.  If all erased clauses of a predicate are
+     erased at or before the oldest generation published (and before we
+     started), retireClausesDefinition() unlinks  them from the clause
+     chain and retires the clause indexes.  New frames cannot see them.
+  2. Choicepoints and clause walks that were in progress may still hold
+     an unlinked clause or a retired index.  After the second round, the
+     clauses retired from a predicate that is not marked are freed.
+     Others stay in GD->procedures.retired and are tried by the next
+     call.
+
+The unlinked clauses keep their `next' pointer, so a thread holding one
+can continue its walk.  It cannot get hold of a retired clause  in  any
+other way.  If a thread cannot answer (e.g., it is garbage collecting)
+the round yields generation 0 and we retire or free nothing.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define sizeofRetiredClauses(n) \
+	(sizeof(struct retired_clauses) + ((n)-1)*sizeof(ClauseRef))
+
+static gen_t
+markPredicatesAllThreads(ARG1_LD)
+{ gen_t oldest;
+  sigset_t set;
+
+  PL_LOCK(L_THREAD);
+  PL_LOCK(L_STOPTHEWORLD);
+  blockSignals(&set);
+
+  markPredicatesInEnvironments(LD);
+  oldest = LD->clauses.oldest_generation;
+#ifdef O_PLMT
+  { gen_t gen = markPredicatesThreads();
+
+    if ( gen < oldest )
+      oldest = gen;
+  }
+#endif
+
+  unblockSignals(&set);
+  PL_UNLOCK(L_STOPTHEWORLD);
+  PL_UNLOCK(L_THREAD);
+
+  return oldest;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+retireClausesDefinition() unlinks the erased clauses  of the static def
+if all of them are erased at or  before   `oldest'.  Returns the set of
+unlinked clauses or NULL if there is nothing to do (yet).
+
+MT: Caller must hold L_PREDICATE
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static RetiredClauses
+retireClausesDefinition(Definition def, gen_t oldest)
+{ ClauseRef cref, prev = NULL;
+  RetiredClauses rc;
+  size_t count = 0;
+
+  if ( false(def, NEEDSCLAUSEGC) )
+    return NULL;
+
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { Clause cl = cref->value.clause;
+
+    if ( true(cl, CL_ERASED) )
+    {
+#ifdef O_LOGICAL_UPDATE
+      if ( cl->generation.erased > oldest )
+	return NULL;
+#endif
+      count++;
+    }
+  }
+
+  if ( count == 0 )
+  { clear(def, NEEDSCLAUSEGC);
+    return NULL;
+  }
+
+  DEBUG(MSG_PROC, Sdprintf("retireClausesDefinition(%s): %d clauses\n",
+			   predicateName(def), (int)count));
+
+  rc = allocHeapOrHalt(sizeofRetiredClauses(count));
+  rc->definition = def;
+  rc->count = 0;
+  for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+  { if ( true(cref->value.clause, CL_ERASED) )
+    { if ( prev )			/* leave cref->next alone */
+	prev->next = cref->next;
+      else
+	def->impl.clauses.first_clause = cref->next;
+      rc->clauses[rc->count++] = cref;
+      def->impl.clauses.erased_clauses--;
+    } else
+      prev = cref;
+  }
+  def->impl.clauses.last_clause = prev;
+  assert(rc->count == count);
+  assert(def->impl.clauses.erased_clauses == 0);
+
+  rc->indexes = retireClauseIndexes(def);
+  clear(def, NEEDSCLAUSEGC);
+
+  return rc;
+}
+
+
+static void
+freeRetiredClauses(RetiredClauses rc)
+{ ClauseRef garbage = NULL;
+  size_t i;
+
+  for(i=rc->count; i-- > 0; )
+  { rc->clauses[i]->next = garbage;
+    garbage = rc->clauses[i];
+  }
+  freeClauseIndexList(rc->indexes);
+  freeHeap(rc, sizeofRetiredClauses(rc->count));
+
+  freeClauseList(garbage);
+}
+
+
+static int
+hasRetiredClauses(Definition def)
+{ RetiredClauses rc;
+
+  for(rc = GD->procedures.retired; rc; rc = rc->next)
+  { if ( rc->definition == def )
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
 foreign_t
 pl_garbage_collect_clauses(void)
 { GET_LD
 
-  if ( GD->procedures.dirty && !gc_status.blocked )
-  { DefinitionChain c, cell, next, last;
-    sigset_t set;
-    ClauseRef garbage = NULL;
+  if ( (GD->procedures.dirty || GD->procedures.retired) &&
+       !gc_status.blocked )
+  { DefinitionChain cell, next, last;
+    RetiredClauses rc, *rcp, garbage = NULL;
+    gen_t start, oldest;
 
     DEBUG(MSG_PROC, Sdprintf("pl_garbage_collect_clauses()\n"));
 
-    LOCK();
-    PL_LOCK(L_GC);
-    PL_LOCK(L_THREAD);
-    PL_LOCK(L_STOPTHEWORLD);
-    blockSignals(&set);
-
-					/* sanity-check */
-    for(c=GD->procedures.dirty; c; c=c->next)
-    { Definition def = c->definition;
+    PL_LOCK(L_CLAUSEGC);		/* one collector at a time */
+    start  = GD->generation;
+    oldest = markPredicatesAllThreads(PASS_LD1);
+    if ( start < oldest )
+      oldest = start;
 
-      assert(true(def, P_DIRTYREG));
-      if ( false(def, P_DYNAMIC) )
-	assert(def->references == 0);
+    LOCK();
+    if ( oldest > 0 )
+    { for(cell = GD->procedures.dirty; cell; cell = cell->next)
+      { Definition def = cell->definition;
+
+	if ( false(def, P_DYNAMIC|P_FOREIGN) &&
+	     (rc = retireClausesDefinition(def, oldest)) )
+	{ rc->next = GD->procedures.retired;
+	  GD->procedures.retired = rc;
+	}
+      }
     }
+    for(rc = GD->procedures.retired; rc; rc = rc->next)
+      rc->definition->clause_gc_mark = FALSE;
+    UNLOCK();
 
-    markPredicatesInEnvironments(LD);
-#ifdef O_PLMT
-    forThreadLocalData(markPredicatesInEnvironments,
-		       PL_THREAD_SUSPEND_AFTER_WORK);
-#endif
-
-    DEBUG(MSG_PROC, Sdprintf("Marking complete; cleaning predicates\n"));
+    if ( GD->procedures.retired &&
+	 markPredicatesAllThreads(PASS_LD1) > 0 )
+    { for(rcp = &GD->procedures.retired; (rc = *rcp); )
+      { if ( !rc->definition->clause_gc_mark )
+	{ *rcp = rc->next;
+	  rc->next = garbage;
+	  garbage = rc;
+	} else
+	  rcp = &rc->next;
+      }
+    }
 
+    LOCK();
     last = NULL;
     for(cell = GD->procedures.dirty; cell; cell = next)
     { Definition def = cell->definition;
 
       next = cell->next;
 
-      if ( false(def, P_DYNAMIC|P_FOREIGN) )
-      { if ( def->references )
-	{ assert(def->references == 1);
-	  def->references = 0;
-	  last = cell;
-	  continue;
-	} else
-	{ DEBUG(MSG_PROC, Sdprintf("cleanDefinition(%s)\n", predicateName(def)));
-	  garbage = cleanDefinition(def, garbage);
-	}
+      if ( (false(def, P_DYNAMIC|P_FOREIGN) && true(def, NEEDSCLAUSEGC)) ||
+	   hasRetiredClauses(def) )
+      { last = cell;
+	continue;
       }
 
       clear(def, P_DIRTYREG);
@@ -1752,19 +2239,13 @@ pl_garbage_collect_clauses(void)
       else
 	GD->procedures.dirty = next;
     }
-
-#ifdef O_PLMT
-    resumeThreads();
-#endif
-
-    unblockSignals(&set);
-    PL_UNLOCK(L_STOPTHEWORLD);
-    PL_UNLOCK(L_THREAD);
-    PL_UNLOCK(L_GC);
     UNLOCK();
+    PL_UNLOCK(L_CLAUSEGC);
 
-    if ( garbage )
-      freeClauseList(garbage);
+    while( (rc = garbage) )
+    { garbage = rc->next;
+      freeRetiredClauses(rc);
+    }
   }
 
   succeed;
@@ -1837,12 +2318,92 @@ will later call trapUndefined() to generate   an  error message (or link
 the procedure from the library via autoload).
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+resolveProcedure() returns the  defined  procedure  for  f  visible  from
+module or, if there is none, the (undefined) procedure in module itself.
+
+Module-sensitive calls (call/N, calls  to   undefined  procedures)  call
+this on each call, which requires a hash lookup for each module on the
+import chain. With O_RESOLVE_CACHE, each module keeps a small direct
+mapped cache of defined procedures found.  Each  entry  is tagged with
+the resolve_generation of the module  read   before  the  search. It is
+only used while the module has  this   generation,  so an entry stored
+by a thread that searched before   updateResolveGeneration() is never
+used.
+
+The procedure and generation of an entry   are two words. A store first
+claims the entry by setting its generation  to   0  and a hit reads the
+generation before and after the procedure, so a  hit never combines the
+procedure of one store with the generation of another.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_RESOLVE_CACHE
+#define resolveCacheKey(f) (indexFunctor(f) & (RESOLVECACHESIZE-1))
+
+static resolve_cache_entry *
+resolveCacheModule(Module m)
+{ resolve_cache_entry *cache;
+
+  if ( !(cache = m->resolve_cache) )
+  { int i;
+
+    cache = allocHeapOrHalt(RESOLVECACHESIZE*sizeof(*cache));
+    for(i=0; i<RESOLVECACHESIZE; i++)
+    { cache[i].procedure  = NULL;
+      cache[i].generation = 1;		/* empty, not claimed */
+    }
+    if ( !COMPARE_AND_SWAP(&m->resolve_cache, NULL, cache) )
+    { freeHeap(cache, RESOLVECACHESIZE*sizeof(*cache));
+      cache = m->resolve_cache;
+    }
+  }
+
+  return cache;
+}
+
+
+static void
+storeResolveCache(Module m, functor_t f, Procedure proc, unsigned int gen)
+{ resolve_cache_entry *e = &resolveCacheModule(m)[resolveCacheKey(f)];
+  unsigned int old = e->generation;
+
+  if ( old != 0 && COMPARE_AND_SWAP(&e->generation, old, 0) )
+  { e->procedure = proc;
+    MemoryBarrier();
+    e->generation = gen;
+  }
+}
+#endif /*O_RESOLVE_CACHE*/
+
 Procedure
 resolveProcedure(functor_t f, Module module)
 { Procedure proc;
+#ifdef O_RESOLVE_CACHE
+  unsigned int gen = module->resolve_generation;
+  resolve_cache_entry *cache = module->resolve_cache;
+
+  if ( cache )
+  { resolve_cache_entry *e = &cache[resolveCacheKey(f)];
+
+    if ( e->generation == gen )
+    { proc = e->procedure;
+      MemoryBarrier();
+      if ( e->generation == gen && proc &&
+	   proc->definition->functor->functor == f &&
+	   isDefinedProcedure(proc) )
+	return proc;
+    }
+  }
+  MemoryBarrier();			/* read gen before searching */
+#endif
 
   if ( (proc = visibleProcedure(f, module)) )
+  {
+#ifdef O_RESOLVE_CACHE
+    storeResolveCache(module, f, proc, gen);
+#endif
     return proc;
+  }
 
   return lookupProcedure(f, module);
 }
@@ -2046,6 +2607,7 @@ pl_require(term_t pred)
 typedef struct
 { Definition def;
   struct clause_choice chp;
+  int shared;				/* result of enterDefinition() */
 } retract_context;
 
 static
@@ -2060,7 +2622,7 @@ PRED_IMPL("retract", 1, retract,
   if ( CTX_CNTRL == FRG_CUTTED )
   { ctx = CTX_PTR;
 
-    leaveDefinition(ctx->def);
+    leaveDefinition(ctx->def, ctx->shared);
     freeHeap(ctx, sizeof(*ctx));
 
     return TRUE;
@@ -2109,17 +2671,18 @@ PRED_IMPL("retract", 1, retract,
 	fail;				/* no clauses */
       }
 
-      if ( def->references && (debugstatus.styleCheck & DYNAMIC_STYLE) )
+      if ( (debugstatus.styleCheck & DYNAMIC_STYLE) &&
+	   referencedDefinition(def) )
 	printMessage(ATOM_informational,
 		     PL_FUNCTOR_CHARS, "modify_active_procedure", 2,
 		       PL_CHARS, "retract",
 		       _PL_PREDICATE_INDICATOR, proc);
 
       startCritical;
-      enterDefinition(def);			/* reference the predicate */
+      ctxbuf.shared = enterDefinition(def);	/* reference the predicate */
       cref = firstClause(argv, environment_frame, def, &ctxbuf.chp PASS_LD);
       if ( !cref )
-      { leaveDefinition(def);
+      { leaveDefinition(def, ctxbuf.shared);
 	if ( !endCritical )
 	  fail;
 	fail;
@@ -2134,7 +2697,7 @@ PRED_IMPL("retract", 1, retract,
     }
 
     if ( !(fid = PL_open_foreign_frame()) )
-    { leaveDefinition(ctx->def);
+    { leaveDefinition(ctx->def, ctx->shared);
       if ( ctx != &ctxbuf )
 	freeHeap(ctx, sizeof(*ctx));
 
@@ -2149,7 +2712,7 @@ PRED_IMPL("retract", 1, retract,
       { retractClauseDefinition(ctx->def, cref->value.clause);
 
 	if ( !endCritical )
-	{ leaveDefinition(ctx->def);
+	{ leaveDefinition(ctx->def, ctx->shared);
 	  if ( ctx != &ctxbuf )
 	    freeHeap(ctx, sizeof(*ctx));
 	  PL_close_foreign_frame(fid);
@@ -2158,7 +2721,7 @@ PRED_IMPL("retract", 1, retract,
 	}
 
 	if ( !ctx->chp.cref )		/* deterministic last one */
-	{ leaveDefinition(ctx->def);
+	{ leaveDefinition(ctx->def, ctx->shared);
 	  if ( ctx != &ctxbuf )
 	    freeHeap(ctx, sizeof(*ctx));
 	  PL_close_foreign_frame(fid);
@@ -2180,7 +2743,7 @@ PRED_IMPL("retract", 1, retract,
     }
 
     PL_close_foreign_frame(fid);
-    leaveDefinition(ctx->def);
+    leaveDefinition(ctx->def, ctx->shared);
     if ( ctx != &ctxbuf )
       freeForeignState(ctx, sizeof(*ctx));
     if ( !endCritical )
@@ -2224,6 +2787,7 @@ pl_retractall(term_t head)
   ClauseRef cref;
   Word argv;
   int allvars = TRUE;
+  int shared;
   fid_t fid;
 
   if ( !get_procedure(head, &proc, thehead, GP_CREATE) )
@@ -2253,7 +2817,7 @@ pl_retractall(term_t head)
   }
 
   startCritical;
-  enterDefinition(def);
+  shared = enterDefinition(def);
   fid = PL_open_foreign_frame();
 
   DEBUG(CHK_SECURE, checkDefinition(def));
@@ -2270,7 +2834,7 @@ pl_retractall(term_t head)
 
     if ( !(cref = firstClause(argv, environment_frame, def, &chp PASS_LD)) )
     { int rc = endCritical;
-      leaveDefinition(def);
+      leaveDefinition(def, shared);
       return rc;
     }
 
@@ -2281,7 +2845,7 @@ pl_retractall(term_t head)
       PL_rewind_foreign_frame(fid);
 
       if ( !chp.cref )
-      { leaveDefinition(def);
+      { leaveDefinition(def, shared);
 	return endCritical;
       }
 
@@ -2293,7 +2857,7 @@ pl_retractall(term_t head)
       cref = nextClause(&chp, argv, environment_frame, def);
     }
   }
-  leaveDefinition(def);
+  leaveDefinition(def, shared);
   return endCritical;
 }
 
@@ -2485,6 +3049,18 @@ pl_get_predicate_attribute(term_t pred,
     if ( def->impl.clauses.number_of_clauses == 0 && false(def, P_DYNAMIC) )
       fail;
     return PL_unify_integer(value, def->impl.clauses.number_of_rules);
+#ifdef O_DET_GUARDS
+  } else if ( key == ATOM_det_guards )
+  { int count;
+
+    if ( def->flags & P_FOREIGN )
+      fail;
+
+    def = getProcDefinition(proc);
+    if ( (count = guardCommitsDefinition(def)) == 0 )
+      fail;
+    return PL_unify_integer(value, count);
+#endif
   } else if ( (att = attribute_mask(key)) )
   { return PL_unify_integer(value, (def->flags & att) ? 1 : 0);
   } else
@@ -2518,6 +3094,9 @@ detachMutexAndUnlock(Definition def)
 
   if ( m )
   { def->mutex = NULL;
+#ifdef O_CONCURRENT_APPEND
+    unblockAppendDefinition(def);	/* appends now see no mutex */
+#endif
     countingMutexUnlock(m);
     freeSimpleMutex(m);
   }
@@ -2578,12 +3157,17 @@ setDynamicProcedure(Procedure proc, bool isdyn)
 
   ok:
     freeCodesDefinition(def, TRUE);	/* reset to S_VIRGIN */
+#ifdef O_EPOCH_RECLAIM
+    if ( false(def, P_THREAD_LOCAL) )
+      set(def, P_SHARED);
+#endif
     set(def, P_DYNAMIC);
+    updateResolveGenerationDefinition(def);
 
     UNLOCKDEF(def);
   } else				/* dynamic --> static */
   { clear(def, P_DYNAMIC);
-    if ( def->references )
+    if ( def->references || true(def, P_SHARED) )
     { if ( true(def, NEEDSCLAUSEGC) )
 	registerDirtyDefinition(def);
       def->references = 0;
@@ -2619,10 +3203,12 @@ set_thread_local_procedure(Procedure proc, bool val)
     { UNLOCKDEF(def);
       return PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
     }
+    clear(def, P_SHARED);		/* no clauses, so not running */
     set(def, P_DYNAMIC|P_VOLATILE|P_THREAD_LOCAL);
 
     def->codes = SUPERVISOR(thread_local);
     def->impl.local = new_ldef_vector();
+    updateResolveGenerationDefinition(def);
 
     UNLOCKDEF(def);
     succeed;
@@ -2679,10 +3265,13 @@ pl_set_predicate_attribute(term_t pred,
     { clear(def, att);
     } else
     { set(def, att);
+      if ( (att & PROC_DEFINED) )
+	updateResolveGenerationDefinition(def);
     }
 
     rc = TRUE;
   }
+  updateInlineGeneration(def);
 
   if ( rc && val &&
        (att & PROC_DEFINED) &&
@@ -2820,7 +3409,7 @@ redefineProcedure(Procedure proc, SourceFile sf, unsigned int suppress)
     { if ( true(def, P_THREAD_LOCAL) )
 	return PL_error(NULL, 0, NULL, ERR_MODIFY_THREAD_LOCAL_PROC, proc);
 
-      if ( def->references )
+      if ( referencedDefinition(def) )
       { printMessage(ATOM_informational,
 		     PL_FUNCTOR_CHARS, "redefined_procedure", 2,
 		       PL_CHARS, "active",
@@ -2895,13 +3484,13 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
   Definition def, copy_def;
   ClauseRef cref;
   gen_t generation;
+  int shared;
 
   if ( !get_procedure(A1, &from, 0, GP_NAMEARITY|GP_RESOLVE) )
     fail;
   if ( !isDefinedProcedure(from) )
     trapUndefined(getProcDefinition(from) PASS_LD);
   def = getProcDefinition(from);
-  generation = GD->generation;		/* take a consistent snapshot */
 
   if ( true(def, P_FOREIGN) )
     return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
@@ -2928,7 +3517,8 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
 #endif
   }
 
-  enterDefinition(def);
+  shared = enterDefinition(def);
+  generation = GD->generation;		/* take a consistent snapshot */
   for( cref = def->impl.clauses.first_clause; cref; cref = cref->next )
   { Clause cl = cref->value.clause;
 
@@ -2946,7 +3536,7 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
       assertProcedure(to, copy, CL_END PASS_LD);
     }
   }
-  leaveDefinition(def);
+  leaveDefinition(def, shared);
 
   return TRUE;
 }
@@ -2989,8 +3579,9 @@ listGenerations(Definition def)
     for ( ci=def->impl.clauses.clause_indexes; ci; ci=ci->next )
     { unsigned int i;
 
-      Sdprintf("\nHash %sindex for arg %d (%d dirty)\n",
-	       ci->is_list ? "list-" : "", ci->args[0], ci->dirty);
+      Sdprintf("\nHash %sindex for arg %d%s (%d dirty)\n",
+	       ci->is_list ? "list-" : "", ci->args[0],
+	       ci->args[1] ? " (composite)" : "", ci->dirty);
 
       for(i=0; i<ci->buckets; i++)
       { if ( !ci->entries[i].head &&
@@ -1217,6 +1217,372 @@ PRED_IMPL("reset_pentium_profile", 0, reset_pentium_profile, 0)
 }
 #endif
 
+		 /*******************************
+		 *	  VMI STATISTICS	*
+		 *******************************/
+
+#ifdef O_VMI_STATISTICS
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Runtime VM instruction statistics. If GD->vmi_stat.active is set, every
+instruction calls countVMI(), which counts the instruction and the
+predicate it is executed in. In VMI_STAT_CYCLES mode, every
+VMI_SAMPLE_RATE-th instruction is also timed: the cycles until the next
+instruction starts are added to its record. This includes time spent in
+foreign code and in the kernel functions called by the instruction.
+
+Each thread has its own counters in a vmi_stat_block, so counting needs
+no locking. The blocks are linked in GD->vmi_stat.blocks and summed by
+vmi_profile_data/2. When a thread dies its counters are added to
+GD->vmi_stat.retired. The list is protected by L_MISC. The predicate
+tables are owned by their thread: only the owner adds entries, which
+locks the table, and readers use a TableEnum, which prevents rehashing.
+
+Superinstructions (see mkvmi.c) are reported as the instruction they
+start with. Their remaining components are counted when the super
+jumps into their implementation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define VMI_SAMPLE_RATE 32
+
+typedef struct vmi_stat_block
+{ struct vmi_stat_block *next;		/* Next in GD->vmi_stat.blocks */
+  int64_t	counts[I_HIGHEST];	/* # times executed */
+  int64_t	cycles[I_HIGHEST];	/* Cycles in sampled executions */
+  int64_t	samples[I_HIGHEST];	/* # sampled executions */
+  Table		predicates;		/* Definition --> int64_t* */
+  Definition	last_def;		/* Cache for predicates */
+  int64_t      *last_count;		/* Counter of last_def */
+  unsigned int	sample_count;		/* Counter for sampling */
+  int		pending;		/* Sampling an instruction */
+  vmi		pending_op;		/* Instruction being sampled */
+  int64_t	pending_start;		/* Its start time */
+} vmi_stat_block;
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define vmi_clock() ((int64_t)__builtin_ia32_rdtsc())
+#else
+#define vmi_clock() ((int64_t)(WallTime()*1000000000.0)) /* nanoseconds */
+#endif
+
+static void
+free_count_symbol(Symbol s)
+{ freeHeap(s->value, sizeof(int64_t));
+}
+
+static vmi_stat_block *
+newVMIStatBlock(void)
+{ vmi_stat_block *b = allocHeapOrHalt(sizeof(*b));
+
+  memset(b, 0, sizeof(*b));
+  b->predicates = newHTable(64);
+  b->predicates->free_symbol = free_count_symbol;
+
+  return b;
+}
+
+static void
+freeVMIStatBlock(vmi_stat_block *b)
+{ destroyHTable(b->predicates);
+  freeHeap(b, sizeof(*b));
+}
+
+static int64_t *
+predicate_counter(vmi_stat_block *b, Definition def)
+{ Symbol s;
+
+  if ( (s=lookupHTable(b->predicates, def)) )
+    return s->value;
+  else
+  { int64_t *c = allocHeapOrHalt(sizeof(*c));
+
+    *c = 0;
+    addHTable(b->predicates, def, c);
+    return c;
+  }
+}
+
+
+/* Thread-local predicates execute a private copy of the definition
+   that is destroyed with the thread.  Count these on the shared one.
+*/
+
+static Definition
+shared_definition(Definition def)
+{ if ( true(def, P_DYNAMIC) && false(def, P_THREAD_LOCAL) )
+  { Procedure proc = isCurrentProcedure(def->functor->functor, def->module);
+
+    if ( proc && proc->definition != def &&
+	 true(proc->definition, P_THREAD_LOCAL) )
+      return proc->definition;
+  }
+
+  return def;
+}
+
+
+void
+countVMI(vmi op, LocalFrame fr ARG_LD)
+{ vmi_stat_block *b;
+
+  if ( !(b=LD->vmi_stat) )
+  { b = newVMIStatBlock();
+    PL_LOCK(L_MISC);
+    b->next = GD->vmi_stat.blocks;
+    GD->vmi_stat.blocks = b;
+    PL_UNLOCK(L_MISC);
+    LD->vmi_stat = b;
+  }
+
+  if ( b->pending )
+  { b->cycles[b->pending_op] += vmi_clock() - b->pending_start;
+    b->samples[b->pending_op]++;
+    b->pending = FALSE;
+  }
+
+  b->counts[op]++;
+  if ( fr && fr->predicate )
+  { if ( fr->predicate != b->last_def )
+    { b->last_count = predicate_counter(b, shared_definition(fr->predicate));
+      b->last_def   = fr->predicate;
+    }
+    (*b->last_count)++;
+  }
+
+  if ( GD->vmi_stat.active == VMI_STAT_CYCLES &&
+       ++b->sample_count % VMI_SAMPLE_RATE == 0 )
+  { b->pending = TRUE;
+    b->pending_op = op;
+    b->pending_start = vmi_clock();
+  }
+}
+
+
+static void
+add_vmi_stat_block(vmi_stat_block *to, vmi_stat_block *from)
+{ int i;
+  TableEnum e;
+  Symbol s;
+
+  for(i=0; i<I_HIGHEST; i++)
+  { to->counts[i]  += from->counts[i];
+    to->cycles[i]  += from->cycles[i];
+    to->samples[i] += from->samples[i];
+  }
+
+  e = newTableEnum(from->predicates);
+  while( (s=advanceTableEnum(e)) )
+    *predicate_counter(to, s->name) += *(int64_t*)s->value;
+  freeTableEnum(e);
+}
+
+
+static void
+clear_vmi_stat_block(vmi_stat_block *b)
+{ TableEnum e;
+  Symbol s;
+
+  memset(b->counts,  0, sizeof(b->counts));
+  memset(b->cycles,  0, sizeof(b->cycles));
+  memset(b->samples, 0, sizeof(b->samples));
+
+  e = newTableEnum(b->predicates);
+  while( (s=advanceTableEnum(e)) )
+    *(int64_t*)s->value = 0;
+  freeTableEnum(e);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+freeVMIStatistics() is called when a thread terminates. It moves the
+counters of the thread to GD->vmi_stat.retired.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+freeVMIStatistics(PL_local_data_t *ld)
+{ vmi_stat_block *b, **bp;
+
+  if ( !(b=ld->vmi_stat) )
+    return;
+  ld->vmi_stat = NULL;
+
+  PL_LOCK(L_MISC);
+  for(bp = &GD->vmi_stat.blocks; *bp; bp = &(*bp)->next)
+  { if ( *bp == b )
+    { *bp = b->next;
+      break;
+    }
+  }
+  if ( !GD->vmi_stat.retired )
+    GD->vmi_stat.retired = newVMIStatBlock();
+  add_vmi_stat_block(GD->vmi_stat.retired, b);
+  PL_UNLOCK(L_MISC);
+
+  freeVMIStatBlock(b);
+}
+
+
+/** vmi_profiler(-Old, +New)
+
+Query or change the VMI statistics. The status is one of `false`,
+`true` (count instructions) or `cycles` (also sample cycles). This
+setting applies to all threads.
+*/
+
+static
+PRED_IMPL("vmi_profiler", 2, vmi_profiler, 0)
+{ PRED_LD
+  atom_t a;
+  vmi_stat_status val;
+
+  if ( !PL_unify_atom(A1,
+		      GD->vmi_stat.active == VMI_STAT_INACTIVE ? ATOM_false :
+		      GD->vmi_stat.active == VMI_STAT_COUNT ? ATOM_true :
+		      ATOM_cycles) )
+    return FALSE;
+  if ( !PL_get_atom_ex(A2, &a) )
+    return FALSE;
+
+  switch(a)
+  { case ATOM_false:
+      val = VMI_STAT_INACTIVE;
+      break;
+    case ATOM_true:
+      val = VMI_STAT_COUNT;
+      break;
+    case ATOM_cycles:
+      val = VMI_STAT_CYCLES;
+      break;
+    default:
+      return PL_domain_error("vmi_profile_status", A2);
+  }
+
+  GD->vmi_stat.active = val;
+  if ( val != VMI_STAT_CYCLES && LD->vmi_stat )
+    LD->vmi_stat->pending = FALSE;
+
+  return TRUE;
+}
+
+
+/** reset_vmi_profiler
+
+Stop collecting VMI statistics and clear the counters of all threads.
+*/
+
+static
+PRED_IMPL("reset_vmi_profiler", 0, reset_vmi_profiler, 0)
+{ vmi_stat_block *b;
+
+  GD->vmi_stat.active = VMI_STAT_INACTIVE;
+
+  PL_LOCK(L_MISC);
+  for(b = GD->vmi_stat.blocks; b; b = b->next)
+    clear_vmi_stat_block(b);
+  if ( (b=GD->vmi_stat.retired) )
+    clear_vmi_stat_block(b);
+  PL_UNLOCK(L_MISC);
+
+  return TRUE;
+}
+
+
+/** vmi_profile_data(-Instructions, -Predicates)
+
+Instructions is a list vmi(Name, Count, Cycles) holding the executed
+instructions. Cycles is estimated from the samples and is 0 if no
+samples were taken. Predicates is a list PI-Count, where Count is the
+number of instructions executed in clauses of PI.  Both lists contain
+the sum over all threads and are in no particular order.
+*/
+
+static int
+unify_vmi_data(term_t list, vmi_stat_block *sum ARG_LD)
+{ term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  const super_info *si;
+  int i;
+
+  for(si = superTable; si->code; si++)
+  { sum->counts[si->first]  += sum->counts[si->code];
+    sum->cycles[si->first]  += sum->cycles[si->code];
+    sum->samples[si->first] += sum->samples[si->code];
+    sum->counts[si->code] = 0;
+  }
+
+  for(i=0; i<I_HIGHEST; i++)
+  { int64_t cycles;
+
+    if ( !sum->counts[i] )
+      continue;
+    if ( sum->samples[i] )
+      cycles = (int64_t)((double)sum->cycles[i] *
+			 (double)sum->counts[i] / (double)sum->samples[i]);
+    else
+      cycles = 0;
+
+    if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_term(head, PL_FUNCTOR, FUNCTOR_vmi3,
+			PL_CHARS, codeTable[i].name,
+			PL_INT64, sum->counts[i],
+			PL_INT64, cycles) )
+      return FALSE;
+  }
+
+  return PL_unify_nil(tail);
+}
+
+
+static int
+unify_predicate_data(term_t list, vmi_stat_block *sum ARG_LD)
+{ term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  term_t pi   = PL_new_term_ref();
+  TableEnum e = newTableEnum(sum->predicates);
+  Symbol s;
+  int rc = TRUE;
+
+  while( rc && (s=advanceTableEnum(e)) )
+  { Definition def = s->name;
+
+    PL_put_variable(pi);
+    rc = ( PL_unify_list(tail, head, tail) &&
+	   unify_definition(MODULE_user, pi, def, 0,
+			    GP_QUALIFY|GP_NAMEARITY) &&
+	   PL_unify_term(head, PL_FUNCTOR, FUNCTOR_minus2,
+			 PL_TERM, pi,
+			 PL_INT64, *(int64_t*)s->value) );
+  }
+  freeTableEnum(e);
+
+  return rc && PL_unify_nil(tail);
+}
+
+
+static
+PRED_IMPL("vmi_profile_data", 2, vmi_profile_data, 0)
+{ PRED_LD
+  vmi_stat_block *sum = newVMIStatBlock();
+  vmi_stat_block *b;
+  int rc;
+
+  PL_LOCK(L_MISC);
+  for(b = GD->vmi_stat.blocks; b; b = b->next)
+    add_vmi_stat_block(sum, b);
+  if ( (b=GD->vmi_stat.retired) )
+    add_vmi_stat_block(sum, b);
+  PL_UNLOCK(L_MISC);
+
+  rc = ( unify_vmi_data(A1, sum PASS_LD) &&
+	 unify_predicate_data(A2, sum PASS_LD) );
+  freeVMIStatBlock(sum);
+
+  return rc;
+}
+
+#endif /*O_VMI_STATISTICS*/
+
+
 		 /*******************************
 		 *      PUBLISH PREDICATES	*
 		 *******************************/
@@ -1233,4 +1599,9 @@ BeginPredDefs(profile)
   PRED_DEF("show_pentium_profile", 0, show_pentium_profile, 0)
   PRED_DEF("reset_pentium_profile", 0, reset_pentium_profile, 0)
 #endif
+#ifdef O_VMI_STATISTICS
+  PRED_DEF("vmi_profiler", 2, vmi_profiler, 0)
+  PRED_DEF("reset_vmi_profiler", 0, reset_vmi_profiler, 0)
+  PRED_DEF("vmi_profile_data", 2, vmi_profile_data, 0)
+#endif
 EndPredDefs
@@ -38,4 +38,15 @@ COMMON(void)		profExit(struct call_node *node ARG_LD);
 COMMON(void)		profRedo(struct call_node *node ARG_LD);
 COMMON(void)		profSetHandle(struct call_node *node, void *handle);
 
+#ifdef O_VMI_STATISTICS
+typedef enum
+{ VMI_STAT_INACTIVE = 0,	/* Not counting */
+  VMI_STAT_COUNT,		/* Count instructions */
+  VMI_STAT_CYCLES		/* Also sample cycles per instruction */
+} vmi_stat_status;
+
+COMMON(void)		countVMI(vmi op, LocalFrame fr ARG_LD);
+COMMON(void)		freeVMIStatistics(PL_local_data_t *ld);
+#endif
+
 #endif /*PL_PROF_H_INCLUDED*/
@@ -2877,10 +2877,10 @@ readValHandle(term_t term, Word argp, ReadData _PL_rd ARG_LD)
       setVar(*argp);
       *valTermRef(var->variable) = makeRef(argp);
     } else				/* reference to existing var */
-    { *argp = *valTermRef(var->variable);
+    { setUntrailed(argp, *valTermRef(var->variable));
     }
   } else
-    *argp = w;				/* plain value */
+    setUntrailed(argp, w);		/* plain value */
 
   setVar(*valTermRef(term));
 }
@@ -3730,8 +3730,8 @@ term is to be written.
       return rc;
     argp = gTop;
     gTop += 3;
-    *unRef(*valTermRef(tail)) = consPtr(argp,
-					TAG_COMPOUND|STG_GLOBAL);
+    setUntrailed(unRef(*valTermRef(tail)),
+		 consPtr(argp, TAG_COMPOUND|STG_GLOBAL));
     *argp++ = FUNCTOR_dot2;
     setVar(argp[0]);
     setVar(argp[1]);
@@ -649,6 +649,16 @@ agc_handler(int sig)
 }
 
 
+#ifdef SIG_ATOM_MARK
+static void
+agc_mark_handler(int sig)
+{ (void)sig;
+
+  markAtomsAtSafePoint();
+}
+#endif
+
+
 static void
 gc_handler(int sig)
 { (void)sig;
@@ -726,6 +736,9 @@ initSignals(void)
 #ifdef SIG_ATOM_GC
   PL_signal(SIG_ATOM_GC|PL_SIGSYNC, agc_handler);
 #endif
+#ifdef SIG_ATOM_MARK
+  PL_signal(SIG_ATOM_MARK|PL_SIGSYNC, agc_mark_handler);
+#endif
 #ifdef SIGHUP
   PL_signal(SIGHUP|PL_SIGSYNC, hupHandler);
 #endif
@@ -1197,6 +1210,7 @@ emptyStacks(void)
   emptyStack((Stack)&LD->stacks.argument);
 
   LD->mark_bar          = gTop;
+  LD->gen_bar           = gTop;
   if ( lTop && gTop )
   { int i;
 
@@ -565,8 +565,7 @@ unloadFile(SourceFile sf)
 
 static int
 unloadFile(SourceFile sf)
-{ GET_LD
-  ListCell cell, next;
+{ ListCell cell, next;
   sigset_t set;
   ClauseRef garbage = NULL;
 
@@ -574,19 +573,8 @@ unloadFile(SourceFile sf)
 
   LOCKSRCFILE(sf);
   PL_LOCK(L_PREDICATE);
-  PL_LOCK(L_THREAD);
-  PL_LOCK(L_STOPTHEWORLD);
   blockSignals(&set);
 
-  GD->procedures.active_marked = 0;
-  GD->procedures.reloading = sf;
-  markPredicatesInEnvironments(LD);
-#ifdef O_PLMT
-  forThreadLocalData(markPredicatesInEnvironments,
-		     PL_THREAD_SUSPEND_AFTER_WORK);
-#endif
-  GD->procedures.reloading = NULL;
-
 				      /* remove the clauses */
   for(cell = sf->procedures; cell; cell = cell->next)
   { int deleted;
@@ -613,12 +601,17 @@ unloadFile(SourceFile sf)
     { if ( false(def, P_MULTIFILE|P_DYNAMIC) )
 	clearTriedIndexes(def);
 
-      if ( def->references == 0 )
-      { freeCodesDefinition(def, FALSE);
-	garbage = cleanDefinition(def, garbage);
-      } else if ( false(def, P_DYNAMIC) )
+#ifdef O_EPOCH_RECLAIM
+      if ( true(def, P_DYNAMIC) && true(def, P_SHARED) )
+      { freeCodesDefinition(def, TRUE);	/* see reclaimDefinition() */
+      } else
+#endif
+      if ( false(def, P_DYNAMIC) )	/* see pl_garbage_collect_clauses() */
       { registerDirtyDefinition(def);
 	freeCodesDefinition(def, TRUE);
+      } else if ( def->references == 0 )
+      { freeCodesDefinition(def, FALSE);
+	garbage = cleanDefinition(def, garbage);
       }
     }
 
@@ -626,18 +619,7 @@ unloadFile(SourceFile sf)
     { clear(def, FILE_ASSIGNED);
       clear_meta_declaration(def);
     }
-  }
-
-				      /* unmark the marked predicates */
-  for(cell = sf->procedures; cell; cell = cell->next)
-  { Procedure proc = cell->value;
-    Definition def = proc->definition;
-
-    if ( false(def, P_DYNAMIC) && def->references )
-    { assert(def->references == 1);
-      def->references = 0;
-      GD->procedures.active_marked--;
-    }
+    updateInlineGeneration(def);	/* reloading may redefine it */
   }
 
 				      /* cleanup the procedure list */
@@ -646,16 +628,10 @@ unloadFile(SourceFile sf)
     freeHeap(cell, sizeof(struct list_cell));
   }
   sf->procedures = NULL;
-  assert(GD->procedures.active_marked == 0);
 
-#ifdef O_PLMT
-  resumeThreads();
-#endif
   delAllModulesSourceFile__unlocked(sf);
 
   unblockSignals(&set);
-  PL_UNLOCK(L_STOPTHEWORLD);
-  PL_UNLOCK(L_THREAD);
   PL_UNLOCK(L_PREDICATE);
   UNLOCKSRCFILE(sf);
 
@@ -716,14 +692,9 @@ startConsult(SourceFile sf)
 
 This function is called when starting the consult a file. Its task is to
 remove all clauses that come from this   file  if this is a *reconsult*.
-There are two options.
-
-    * Immediately remove the clauses from any non-referenced predicate.
-    This saves space, but if there are multiple threads it may cause
-    other threads to trap an undefined predicate.
-
-    * Delay until garbage_collect_clauses/0
-    This way other threads can happily keep running.
+The clauses of static predicates  are  erased   and  reclaimed  by  the
+garbage_collect_clauses/0 call at the end of  loading, once no thread can
+reference them anymore. This way other threads can happily keep running.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 void
@@ -260,6 +260,17 @@ multifileSupervisor(Definition def)
 }
 
 
+#ifdef O_FROZEN_INDEX
+static Code
+frozenSupervisor(Definition def)
+{ if ( def->frozen_index )
+    return SUPERVISOR(frozen);
+
+  return NULL;
+}
+#endif
+
+
 static Code
 staticSupervisor(Definition def)
 { (void)def;
@@ -324,6 +335,263 @@ chainMetaPredicateSupervisor(Definition def, Code post)
 }
 
 
+#ifdef O_DET_GUARDS
+
+		 /*******************************
+		 *	 DETERMINISM GUARDS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+markGuardCommits() decides for each clause whether  it  may  cut  the
+clause choicepoint after its guard.  The compiler ends the guard with an
+I_GUARD instruction that holds up to two literals  describing  goals of
+the guard (see guardLiterals() in pl-comp.c). A clause may commit if
+each of the remaining clauses has a literal that cannot be true if some
+literal of this clause is true.  We only use  literals of this clause
+that remain true if the goal is further instantiated  by  the  head of a
+later clause (i.e., not var/1 and \==/2) and literals of later clauses
+that are not preceded by a goal that may raise an exception, such that
+the later clause would have failed without side effects.
+
+The result is stored  as  the  generation  argument  of  I_GUARD.  The
+generation of the predicate changes with each  modification,  after
+which the instruction no longer cuts until the next supervisor is made.
+We assume arithmetic evaluation of the arguments is deterministic.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_GUARD_CLAUSES 8
+
+#define T_VAR		0x01		/* term types for type tests */
+#define T_ATOM		0x02
+#define T_NIL		0x04
+#define T_INTEGER	0x08
+#define T_FLOAT		0x10
+#define T_STRING	0x20
+#define T_COMPOUND	0x40
+#define T_BLOB		0x80
+
+#define R_LT		0x1		/* relations for comparison */
+#define R_EQ		0x2
+#define R_GT		0x4
+#define R_UNORD		0x8		/* NaN */
+
+static int
+guardTypes(int op)
+{ switch(op)
+  { case GL_VAR:      return T_VAR;
+    case GL_NONVAR:   return ~T_VAR;
+    case GL_ATOM:     return T_ATOM;
+    case GL_ATOMIC:   return T_ATOM|T_NIL|T_INTEGER|T_FLOAT|T_STRING|T_BLOB;
+    case GL_NUMBER:   return T_INTEGER|T_FLOAT;
+    case GL_INTEGER:  return T_INTEGER;
+    case GL_FLOAT:    return T_FLOAT;
+    case GL_STRING:   return T_STRING;
+    case GL_COMPOUND: return T_COMPOUND;
+    case GL_IS_LIST:  return T_NIL|T_COMPOUND;
+    default:	      return 0;
+  }
+}
+
+
+static int
+guardRelation(int op)
+{ switch(op)
+  { case GL_AR_LT: return R_LT;
+    case GL_AR_LE: return R_LT|R_EQ;
+    case GL_AR_GT: return R_GT;
+    case GL_AR_GE: return R_GT|R_EQ;
+    case GL_AR_EQ: return R_EQ;
+    case GL_AR_NE: return R_LT|R_GT|R_UNORD;
+    default:	   return 0;
+  }
+}
+
+
+static int
+swapRelation(int r)
+{ return ( (r&(R_EQ|R_UNORD)) |
+	   ((r&R_LT) ? R_GT : 0) |
+	   ((r&R_GT) ? R_LT : 0) );
+}
+
+
+typedef struct
+{ int a;				/* left operand */
+  int b;				/* right operand */
+  int rel;				/* R_* relation */
+} arith_literal;
+
+static int
+arithLiteral(code l, arith_literal *al)
+{ al->a   = GL_ARG1(l);
+  al->b   = GL_ARG2(l);
+  al->rel = guardRelation(GL_OP(l));
+
+  if ( !(al->a&GL_ISARG) )		/* put the argument left */
+  { int tmp = al->a;
+
+    al->a = al->b;
+    al->b = tmp;
+    al->rel = swapRelation(al->rel);
+  }
+
+  return (al->a&GL_ISARG) != 0;
+}
+
+
+/* arithExclusive() is true if li and lj compare the same operands with
+   disjoint relations or compare the same argument with two integers
+   such that no number satisfies both.
+*/
+
+static int
+arithExclusive(code li, code lj)
+{ arith_literal i, j;
+  intptr_t ci, cj;
+  static const int regions[5][2] =	/* rel to lowest and highest */
+  { {R_LT, R_LT}, {R_EQ, R_LT}, {R_GT, R_LT}, {R_GT, R_EQ}, {R_GT, R_GT} };
+  int k;
+
+  if ( !arithLiteral(li, &i) || !arithLiteral(lj, &j) )
+    return FALSE;
+  if ( i.a != j.a )
+  { if ( i.a == j.b && i.b == j.a )
+    { j.b = j.a;
+      j.a = i.a;
+      j.rel = swapRelation(j.rel);
+    } else
+      return FALSE;
+  }
+  if ( i.b == j.b )
+    return (i.rel & j.rel) == 0;
+  if ( (i.b&GL_ISARG) || (j.b&GL_ISARG) )
+    return FALSE;
+
+  ci = GL_INTVAL(i.b);
+  cj = GL_INTVAL(j.b);
+  if ( ci > cj )
+  { arith_literal tmp = i;
+
+    i = j;
+    j = tmp;
+  }
+  for(k=0; k<5; k++)
+  { if ( (i.rel & regions[k][0]) && (j.rel & regions[k][1]) )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static int
+exclusiveLiterals(code li, code lj)
+{ int opi = GL_OP(li);
+  int opj = GL_OP(lj);
+
+  if ( opi <= GL_IS_LIST && opj <= GL_IS_LIST )
+    return ( GL_ARG1(li) == GL_ARG1(lj) &&
+	     (guardTypes(opi) & guardTypes(opj)) == 0 );
+  if ( opi == GL_EQ && opj == GL_NEQ )
+    return ( (GL_ARG1(li) == GL_ARG1(lj) && GL_ARG2(li) == GL_ARG2(lj)) ||
+	     (GL_ARG1(li) == GL_ARG2(lj) && GL_ARG2(li) == GL_ARG1(lj)) );
+  if ( opi >= GL_AR_LT && opj >= GL_AR_LT )
+    return arithExclusive(li, lj);
+
+  return FALSE;
+}
+
+
+/* guardCommits() returns the index (1 or 2) of the literal of gi that
+   excludes the guard gj or 0 if there is no such literal.
+*/
+
+static int
+guardCommits(Code gi, Code gj)
+{ int i, j;
+
+  for(i=1; i<=2; i++)
+  { code li = gi[i];
+
+    if ( !li || GL_OP(li) == GL_VAR || GL_OP(li) == GL_NEQ )
+      continue;
+    for(j=1; j<=2; j++)
+    { code lj = gj[j];
+
+      if ( lj && !(lj&GL_RAISE) && exclusiveLiterals(li, lj) )
+	return i;
+    }
+  }
+
+  return 0;
+}
+
+
+static Code
+findGuard(Clause clause)
+{ Code PC  = clause->codes;
+  Code end = PC + clause->code_size;
+
+  for(; PC < end; PC = stepPC(PC))
+  { if ( fetchop(PC) == I_GUARD )
+      return PC+1;
+  }
+
+  return NULL;
+}
+
+
+static int
+markGuardCommits(Definition def)
+{ ClauseRef cref[MAX_GUARD_CLAUSES];
+  Code guard[MAX_GUARD_CLAUSES];
+  int i, j, n, count = 0;
+
+  if ( true(def, P_FOREIGN|P_DYNAMIC|P_THREAD_LOCAL|P_MULTIFILE) )
+    return 0;
+  n = getClauses(def, cref, MAX_GUARD_CLAUSES);
+  if ( n < 2 || n > MAX_GUARD_CLAUSES )
+    return 0;
+
+  for(i=0; i<n; i++)
+    guard[i] = findGuard(cref[i]->value.clause);
+
+  for(i=0; i<n; i++)
+  { Code g = guard[i];
+    int commit, used = 0;
+
+    if ( !g )
+      continue;
+    commit = (i < n-1);
+    for(j=i+1; commit && j<n; j++)
+    { int l;
+
+      if ( guard[j] && (l=guardCommits(g, guard[j])) )
+	used |= 1<<l;
+      else
+	commit = FALSE;
+    }
+
+    for(j=1; j<=2; j++)
+    { if ( commit && (used & (1<<j)) )
+	g[j] |= GL_USED;
+      else
+	g[j] &= ~(code)GL_USED;
+    }
+    if ( commit )
+    { g[0] = (code)def->inline_generation;
+      count++;
+    } else
+    { g[0] = (code)0;
+    }
+  }
+
+  return count;
+}
+
+#endif /*O_DET_GUARDS*/
+
+
 		 /*******************************
 		 *	      ENTRIES		*
 		 *******************************/
@@ -358,15 +626,41 @@ createSupervisor(Definition def)
 	       (codes = multifileSupervisor(def)) ||
 	       (codes = singleClauseSupervisor(def)) ||
 	       (codes = listSupervisor(def)) ||
+#ifdef O_FROZEN_INDEX
+	       (codes = frozenSupervisor(def)) ||
+#endif
 	       (codes = staticSupervisor(def)));
   assert(has_codes);
   def->codes = chainMetaPredicateSupervisor(def, codes);
+#ifdef O_DET_GUARDS
+  markGuardCommits(def);
+#endif
   PL_UNLOCK(L_PREDICATE);
 
   succeed;
 }
 
 
+#ifdef O_DET_GUARDS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+guardCommitsDefinition() returns the  number  of  clauses  of def that
+cut the clause choicepoint after their guard.   Used  for  the det_guards
+attribute of '$get_predicate_attribute'/3.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+guardCommitsDefinition(Definition def)
+{ int count;
+
+  PL_LOCK(L_PREDICATE);
+  count = markGuardCommits(def);
+  PL_UNLOCK(L_PREDICATE);
+
+  return count;
+}
+#endif
+
+
 		 /*******************************
 		 *	      INFO		*
 		 *******************************/
@@ -417,4 +711,7 @@ initSupervisors(void)
   MAKE_SV1(thread_local, S_THREAD_LOCAL);
   MAKE_SV1(multifile,    S_MULTIFILE);
   MAKE_SV1(staticp,      S_STATIC);
+#ifdef O_FROZEN_INDEX
+  MAKE_SV1(frozen,       S_FROZEN);
+#endif
 }
@@ -0,0 +1,810 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*#define O_DEBUG 1*/
+#include "pl-incl.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+This module provides the tables for  library(tabling). Tables are thread
+local. Each distinct (variant) call to  a   tabled  predicate  owns a
+table that holds the answers found. Both  the call variant and the answers
+are stored as records. Variants are found by hashing the term using
+variantHashValue() and, if the hash matches,  comparing it to a copy of
+the record using is_variant_ptr(), i.e., =@=/2.
+
+The  VM  cannot  capture  continuations  and  therefore  consumers  are
+not suspended.  Instead, a call to an incomplete  table  consumes the
+answers found so far and  the  leader  of  the  strongly  connected
+component (SCC) re-evaluates its goal  until   no  new  answers  are
+found (linear tabling).  The evaluation   state  is a stack of active
+tables:
+
+  - A *fresh* call pushes its table  and   evaluates  the  goal. If it
+    calls an *active* table at depth D, the  table at D is marked as
+    `looped` and the caller depends on D.
+  - When evaluation of a table that depends  on an older table ends, it
+    is added to the *incomplete* list. Calls to it in the same iteration
+    consume its answers.
+  - A table that only depends on itself is an SCC leader.  If it looped
+    and new answers were found, all incomplete tables of the SCC are
+    made fresh again and the goal is re-evaluated.  Otherwise the leader
+    and all incomplete tables above it are complete.
+
+A table is represented in Prolog by a  <table> blob. The table is freed
+if it is abolished and the blob is no longer referenced.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TBL_FRESH	0		/* Needs evaluation */
+#define TBL_ACTIVE	1		/* On the evaluation stack */
+#define TBL_EVALUATED	2		/* Incomplete, done in this iteration */
+#define TBL_COMPLETE	3		/* All answers are known */
+
+typedef struct tbl_answer
+{ Record	record;			/* The answer */
+  unsigned int	hash;			/* variantHashValue() */
+} tbl_answer;
+
+typedef struct tbl_table
+{ Record	variant;		/* Call variant */
+  unsigned int	hash;			/* variantHashValue() */
+  int		status;			/* TBL_* */
+  int		looped;			/* Consumed while active */
+  struct tbl_table *next;		/* Next in variant hash bucket */
+  atom_t	symbol;			/* <table> handle */
+  size_t	depth;			/* Position on the evaluation stack */
+  size_t	leader;			/* Oldest depth we depend on */
+  size_t	mark;			/* Incomplete list top at push */
+  size_t	position;		/* Position in incomplete list */
+  int64_t	iteration;		/* Answer count at start of iteration */
+  tbl_answer   *answers;		/* Answers in order of arrival */
+  size_t	answer_count;		/* # answers */
+  size_t	answer_size;		/* Allocated answers */
+  size_t       *buckets;		/* Open addressing: answer index+1 */
+  size_t	bucket_count;		/* # buckets (power of 2) */
+} tbl_table, *TblTable;
+
+typedef struct tbl_data
+{ TblTable     *variants;		/* Hash table of call variants */
+  size_t	variant_buckets;	/* # buckets (power of 2) */
+  size_t	variant_count;		/* # tables */
+  TblTable     *stack;			/* Evaluation stack */
+  size_t	stack_top;
+  size_t	stack_size;
+  TblTable     *incomplete;		/* Evaluated incomplete tables */
+  size_t	incomplete_top;
+  size_t	incomplete_size;
+  int64_t	answers;		/* # answers added */
+} tbl_data;
+
+
+		 /*******************************
+		 *	      BLOB		*
+		 *******************************/
+
+static void
+free_table(TblTable t)
+{ size_t i;
+
+  for(i=0; i<t->answer_count; i++)
+    freeRecord(t->answers[i].record);
+  if ( t->answers )
+    free(t->answers);
+  if ( t->buckets )
+    free(t->buckets);
+  freeRecord(t->variant);
+  freeHeap(t, sizeof(*t));
+}
+
+
+static int
+release_table(atom_t symbol)
+{ TblTable *ref = PL_blob_data(symbol, NULL, NULL);
+
+  free_table(*ref);
+
+  return TRUE;
+}
+
+
+static int
+write_table(IOSTREAM *s, atom_t symbol, int flags)
+{ TblTable *ref = PL_blob_data(symbol, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<table>(%p)", *ref);
+  return TRUE;
+}
+
+
+static PL_blob_t table_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "table",
+  release_table,
+  NULL,
+  write_table,
+  NULL
+};
+
+
+static int
+get_table(term_t t, TblTable *table)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &table_blob )
+  { *table = *(TblTable*)data;
+    return TRUE;
+  }
+
+  PL_type_error("table", t);
+  return FALSE;
+}
+
+
+static int
+unify_table(term_t t, TblTable table)
+{ GET_LD
+
+  return PL_unify_atom(t, table->symbol);
+}
+
+
+		 /*******************************
+		 *	   THREAD DATA		*
+		 *******************************/
+
+static tbl_data *
+thread_tables(ARG1_LD)
+{ tbl_data *td;
+
+  if ( (td=LD->tabling.data) )
+    return td;
+
+  td = allocHeapOrHalt(sizeof(*td));
+  memset(td, 0, sizeof(*td));
+  td->variant_buckets = 64;
+  td->variants = allocHeapOrHalt(td->variant_buckets*sizeof(TblTable));
+  memset(td->variants, 0, td->variant_buckets*sizeof(TblTable));
+
+  return LD->tabling.data = td;
+}
+
+
+static void
+push_table_ptr(TblTable **base, size_t *top, size_t *size, TblTable t)
+{ if ( *top == *size )
+  { size_t nsize = *size ? *size*2 : 32;
+    TblTable *nbase = realloc(*base, nsize*sizeof(TblTable));
+
+    if ( !nbase )
+      outOfCore();
+    *base = nbase;
+    *size = nsize;
+  }
+
+  (*base)[(*top)++] = t;
+}
+
+
+static void
+abolish_tables(tbl_data *td)
+{ size_t i;
+
+  for(i=0; i<td->variant_buckets; i++)
+  { TblTable t, next;
+
+    for(t=td->variants[i]; t; t=next)
+    { next = t->next;
+      t->next = NULL;
+      PL_unregister_atom(t->symbol);	/* release_table() frees */
+    }
+    td->variants[i] = NULL;
+  }
+  td->variant_count = 0;
+}
+
+
+void
+clearThreadTablingData(PL_local_data_t *ld)
+{ tbl_data *td;
+
+  if ( (td=ld->tabling.data) )
+  { abolish_tables(td);
+    freeHeap(td->variants, td->variant_buckets*sizeof(TblTable));
+    if ( td->stack )
+      free(td->stack);
+    if ( td->incomplete )
+      free(td->incomplete);
+    freeHeap(td, sizeof(*td));
+    ld->tabling.data = NULL;
+  }
+}
+
+
+		 /*******************************
+		 *	  VARIANT TABLE		*
+		 *******************************/
+
+static void
+rehash_variants(tbl_data *td)
+{ size_t nbuckets = td->variant_buckets*2;
+  TblTable *nv = allocHeapOrHalt(nbuckets*sizeof(TblTable));
+  size_t i;
+
+  memset(nv, 0, nbuckets*sizeof(TblTable));
+  for(i=0; i<td->variant_buckets; i++)
+  { TblTable t, next;
+
+    for(t=td->variants[i]; t; t=next)
+    { size_t k = t->hash & (nbuckets-1);
+
+      next = t->next;
+      t->next = nv[k];
+      nv[k] = t;
+    }
+  }
+
+  freeHeap(td->variants, td->variant_buckets*sizeof(TblTable));
+  td->variants = nv;
+  td->variant_buckets = nbuckets;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+is_variant_record() is TRUE if the term  stored in r is a variant of t.
+It returns -1 if an exception was raised.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+is_variant_record(Record r, term_t t ARG_LD)
+{ fid_t fid;
+  term_t tmp;
+  int rc;
+
+  if ( !(fid = PL_open_foreign_frame()) )
+    return -1;
+  tmp = PL_new_term_ref();
+  if ( (rc=copyRecordToGlobal(tmp, r, ALLOW_GC PASS_LD)) < 0 )
+  { raiseStackOverflow(rc);
+    rc = -1;
+  } else if ( (rc=is_variant_ptr(valTermRef(tmp), valTermRef(t)
+				 PASS_LD)) == MEMORY_OVERFLOW )
+  { PL_no_memory();
+    rc = -1;
+  }
+  PL_discard_foreign_frame(fid);
+
+  return rc;
+}
+
+
+static TblTable
+lookup_variant_table(tbl_data *td, term_t variant ARG_LD)
+{ Record r;
+  unsigned int hash;
+  TblTable t;
+  int new;
+
+  if ( !variantHashValue(variant, &hash PASS_LD) )
+    return NULL;
+  for(t=td->variants[hash&(td->variant_buckets-1)]; t; t=t->next)
+  { if ( t->hash == hash )
+    { int rc = is_variant_record(t->variant, variant PASS_LD);
+
+      if ( rc < 0 )
+	return NULL;
+      if ( rc )
+	return t;
+    }
+  }
+
+  if ( !(r = compileTermToHeap(variant, 0)) )
+  { PL_no_memory();
+    return NULL;
+  }
+
+  t = allocHeapOrHalt(sizeof(*t));
+  memset(t, 0, sizeof(*t));
+  t->variant = r;
+  t->hash    = hash;
+  t->status  = TBL_FRESH;
+  t->symbol  = lookupBlob((const char*)&t, sizeof(t), &table_blob, &new);
+
+  if ( ++td->variant_count > 2*td->variant_buckets )
+    rehash_variants(td);
+  t->next = td->variants[hash&(td->variant_buckets-1)];
+  td->variants[hash&(td->variant_buckets-1)] = t;
+
+  return t;
+}
+
+
+		 /*******************************
+		 *	      ANSWERS		*
+		 *******************************/
+
+static void
+rehash_answers(TblTable t)
+{ size_t nbuckets = t->bucket_count ? t->bucket_count*2 : 16;
+  size_t *nb = malloc(nbuckets*sizeof(size_t));
+  size_t i;
+
+  if ( !nb )
+    outOfCore();
+  memset(nb, 0, nbuckets*sizeof(size_t));
+  for(i=0; i<t->answer_count; i++)
+  { size_t k = t->answers[i].hash & (nbuckets-1);
+
+    while( nb[k] )
+      k = (k+1) & (nbuckets-1);
+    nb[k] = i+1;
+  }
+
+  if ( t->buckets )
+    free(t->buckets);
+  t->buckets = nb;
+  t->bucket_count = nbuckets;
+}
+
+
+/* Returns TRUE if the answer is new, FALSE if it is a variant of an
+   existing answer and -1 if an exception was raised
+*/
+
+static int
+add_answer(TblTable t, term_t answer ARG_LD)
+{ Record r;
+  unsigned int hash;
+  size_t k;
+
+  if ( !variantHashValue(answer, &hash PASS_LD) )
+    return -1;
+
+  if ( 2*(t->answer_count+1) > t->bucket_count )
+    rehash_answers(t);
+
+  for(k = hash & (t->bucket_count-1);
+      t->buckets[k];
+      k = (k+1) & (t->bucket_count-1))
+  { tbl_answer *a = &t->answers[t->buckets[k]-1];
+
+    if ( a->hash == hash )
+    { int rc = is_variant_record(a->record, answer PASS_LD);
+
+      if ( rc < 0 )
+	return -1;
+      if ( rc )
+	return FALSE;
+    }
+  }
+
+  if ( !(r = compileTermToHeap(answer, 0)) )
+  { PL_no_memory();
+    return -1;
+  }
+
+  if ( t->answer_count == t->answer_size )
+  { size_t nsize = t->answer_size ? t->answer_size*2 : 8;
+    tbl_answer *na = realloc(t->answers, nsize*sizeof(tbl_answer));
+
+    if ( !na )
+    { freeRecord(r);
+      PL_no_memory();
+      return -1;
+    }
+    t->answers = na;
+    t->answer_size = nsize;
+  }
+
+  t->answers[t->answer_count].record = r;
+  t->answers[t->answer_count].hash   = hash;
+  t->buckets[k] = ++t->answer_count;
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	     EVALUATION		*
+		 *******************************/
+
+static void
+set_status_incomplete(tbl_data *td, size_t from, int status)
+{ size_t i;
+
+  for(i=from; i<td->incomplete_top; i++)
+    td->incomplete[i]->status = status;
+  td->incomplete_top = from;
+}
+
+
+static void
+push_table(tbl_data *td, TblTable t)
+{ t->status    = TBL_ACTIVE;
+  t->looped    = FALSE;
+  t->depth     = td->stack_top;
+  t->leader    = td->stack_top;
+  t->mark      = td->incomplete_top;
+  t->iteration = td->answers;
+  push_table_ptr(&td->stack, &td->stack_top, &td->stack_size, t);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+consume_table() is called if the running  evaluation calls an active or
+evaluated table. An evaluated table is  part   of  the SCC of the newest
+table on the stack that was pushed before it was evaluated.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+consume_table(tbl_data *td, TblTable t)
+{ TblTable top = td->stack[td->stack_top-1];
+  size_t dep;
+
+  if ( t->status == TBL_ACTIVE )
+  { dep = t->depth;
+  } else
+  { for(dep = td->stack_top-1; dep > 0; dep--)
+    { if ( td->stack[dep]->mark <= t->position )
+	break;
+    }
+  }
+
+  td->stack[dep]->looped = TRUE;
+  if ( dep < top->leader )
+    top->leader = dep;
+}
+
+
+static void
+pop_table(tbl_data *td, TblTable t)
+{ assert(td->stack_top > 0 && td->stack[td->stack_top-1] == t);
+
+  td->stack_top--;
+  if ( t->leader < t->depth )
+  { TblTable parent = td->stack[td->stack_top-1];
+
+    t->status   = TBL_EVALUATED;
+    t->position = td->incomplete_top;
+    push_table_ptr(&td->incomplete, &td->incomplete_top,
+		   &td->incomplete_size, t);
+    if ( t->leader < parent->leader )
+      parent->leader = t->leader;
+    if ( t->looped )
+      parent->looped = TRUE;
+  } else
+  { t->status = TBL_COMPLETE;
+    set_status_incomplete(td, t->mark, TBL_COMPLETE);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+abandon_table() cleans  up  after  an   exception.  The  answers  found
+remain valid, but the tables must be evaluated again.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+abandon_table(tbl_data *td, TblTable t)
+{ if ( t->status != TBL_ACTIVE )
+    return;
+
+  while( td->stack_top > t->depth )
+    td->stack[--td->stack_top]->status = TBL_FRESH;
+  set_status_incomplete(td, t->mark, TBL_FRESH);
+}
+
+
+static atom_t
+status_name(TblTable t)
+{ switch(t->status)
+  { case TBL_FRESH:	return ATOM_fresh;
+    case TBL_ACTIVE:	return ATOM_active;
+    case TBL_EVALUATED:	return ATOM_incomplete;
+    case TBL_COMPLETE:	return ATOM_complete;
+    default:		assert(0); return NULL_ATOM;
+  }
+}
+
+
+		 /*******************************
+		 *	PROLOG CONNECTION	*
+		 *******************************/
+
+/** '$tbl_variant_table'(+Variant, -Table, -Status) is det.
+
+Find or create the table for Variant.  Status is one of `fresh`,
+`active`, `incomplete` or `complete`.
+*/
+
+static
+PRED_IMPL("$tbl_variant_table", 3, tbl_variant_table, 0)
+{ PRED_LD
+  TblTable t;
+
+  if ( !(t=lookup_variant_table(thread_tables(PASS_LD1), A1 PASS_LD)) )
+    return FALSE;
+
+  return ( unify_table(A2, t) &&
+	   PL_unify_atom(A3, status_name(t)) );
+}
+
+
+static
+PRED_IMPL("$tbl_push", 1, tbl_push, 0)
+{ PRED_LD
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+  if ( t->status != TBL_FRESH )
+    return PL_permission_error("evaluate", "table", A1);
+
+  push_table(thread_tables(PASS_LD1), t);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$tbl_consume", 1, tbl_consume, 0)
+{ PRED_LD
+  tbl_data *td = thread_tables(PASS_LD1);
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+  if ( !(t->status == TBL_ACTIVE || t->status == TBL_EVALUATED) ||
+       td->stack_top == 0 )
+    return PL_permission_error("consume", "table", A1);
+
+  consume_table(td, t);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$tbl_iteration", 1, tbl_iteration, 0)
+{ PRED_LD
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+
+  t->iteration = thread_tables(PASS_LD1)->answers;
+  return TRUE;
+}
+
+
+/** '$tbl_iterate'(+Table) is semidet.
+
+True if Table is the leader of an  SCC   that  must  be evaluated again.
+Resets the incomplete tables of the SCC to `fresh`.
+*/
+
+static
+PRED_IMPL("$tbl_iterate", 1, tbl_iterate, 0)
+{ PRED_LD
+  tbl_data *td = thread_tables(PASS_LD1);
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+
+  if ( t->status == TBL_ACTIVE &&
+       t->leader == t->depth &&
+       t->looped &&
+       t->iteration != td->answers )
+  { set_status_incomplete(td, t->mark, TBL_FRESH);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+static
+PRED_IMPL("$tbl_pop", 1, tbl_pop, 0)
+{ PRED_LD
+  tbl_data *td = thread_tables(PASS_LD1);
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+  if ( td->stack_top == 0 || td->stack[td->stack_top-1] != t )
+    return PL_permission_error("pop", "table", A1);
+
+  pop_table(td, t);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$tbl_abandon", 1, tbl_abandon, 0)
+{ PRED_LD
+  TblTable t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+
+  abandon_table(thread_tables(PASS_LD1), t);
+  return TRUE;
+}
+
+
+/** '$tbl_add_answer'(+Table, +Answer) is semidet.
+
+Add Answer to Table. Fails if Table already holds a variant of Answer.
+*/
+
+static
+PRED_IMPL("$tbl_add_answer", 2, tbl_add_answer, 0)
+{ PRED_LD
+  TblTable t;
+  int rc;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+  if ( t->status == TBL_COMPLETE )
+    return PL_permission_error("add_answer", "table", A1);
+
+  if ( (rc=add_answer(t, A2 PASS_LD)) == TRUE )
+  { thread_tables(PASS_LD1)->answers++;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/** '$tbl_answer'(+Table, ?Answer) is nondet.
+
+Enumerate the answers in Table in the order they were added.
+*/
+
+static
+PRED_IMPL("$tbl_answer", 2, tbl_answer, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  TblTable t;
+  size_t i;
+  term_t tmp;
+  fid_t fid;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+      i = 0;
+      break;
+    case FRG_REDO:
+      i = CTX_INT;
+      break;
+    case FRG_CUTTED:
+    default:
+      return TRUE;
+  }
+
+  if ( !get_table(A1, &t) ||
+       !(tmp = PL_new_term_ref()) ||
+       !(fid = PL_open_foreign_frame()) )
+    return FALSE;
+
+  for(; i<t->answer_count; i++)
+  { int rc;
+
+    if ( (rc=copyRecordToGlobal(tmp, t->answers[i].record,
+				ALLOW_GC PASS_LD)) < 0 )
+    { PL_close_foreign_frame(fid);
+      return raiseStackOverflow(rc);
+    }
+    if ( PL_unify(A2, tmp) )
+    { PL_close_foreign_frame(fid);
+      if ( i+1 == t->answer_count )
+	return TRUE;
+      ForeignRedoInt(i+1);
+    }
+    if ( PL_exception(0) )
+    { PL_close_foreign_frame(fid);
+      return FALSE;
+    }
+    PL_rewind_foreign_frame(fid);
+  }
+
+  PL_close_foreign_frame(fid);
+  return FALSE;
+}
+
+
+/** '$tbl_table_status'(+Table, -Status, -Variant, -Answers) is det.
+*/
+
+static
+PRED_IMPL("$tbl_table_status", 4, tbl_table_status, 0)
+{ PRED_LD
+  TblTable t;
+  term_t v = PL_new_term_ref();
+
+  return ( get_table(A1, &t) &&
+	   PL_unify_atom(A2, status_name(t)) &&
+	   copyRecordToGlobal(v, t->variant, ALLOW_GC PASS_LD) == TRUE &&
+	   PL_unify(A3, v) &&
+	   PL_unify_int64(A4, t->answer_count) );
+}
+
+
+/** '$tbl_tables'(-Tables) is det.
+
+Tables is a list of all tables of the calling thread.
+*/
+
+static
+PRED_IMPL("$tbl_tables", 1, tbl_tables, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  tbl_data *td = thread_tables(PASS_LD1);
+  size_t i;
+
+  for(i=0; i<td->variant_buckets; i++)
+  { TblTable t;
+
+    for(t=td->variants[i]; t; t=t->next)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !unify_table(head, t) )
+	return FALSE;
+    }
+  }
+
+  return PL_unify_nil(tail);
+}
+
+
+static
+PRED_IMPL("abolish_all_tables", 0, abolish_all_tables, 0)
+{ PRED_LD
+  tbl_data *td = thread_tables(PASS_LD1);
+
+  if ( td->stack_top > 0 )
+    return PL_error("abolish_all_tables", 0, "tabling is in progress",
+		    ERR_PERMISSION, ATOM_abolish, ATOM_table, ATOM_all);
+
+  abolish_tables(td);
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(tabling)
+  PRED_DEF("$tbl_variant_table", 3, tbl_variant_table, 0)
+  PRED_DEF("$tbl_push",		 1, tbl_push,	       0)
+  PRED_DEF("$tbl_consume",	 1, tbl_consume,       0)
+  PRED_DEF("$tbl_iteration",	 1, tbl_iteration,     0)
+  PRED_DEF("$tbl_iterate",	 1, tbl_iterate,       0)
+  PRED_DEF("$tbl_pop",		 1, tbl_pop,	       0)
+  PRED_DEF("$tbl_abandon",	 1, tbl_abandon,       0)
+  PRED_DEF("$tbl_add_answer",	 2, tbl_add_answer,    0)
+  PRED_DEF("$tbl_answer",	 2, tbl_answer,	       PL_FA_NONDETERMINISTIC)
+  PRED_DEF("$tbl_table_status",	 4, tbl_table_status,  0)
+  PRED_DEF("$tbl_tables",	 1, tbl_tables,	       0)
+  PRED_DEF("abolish_all_tables", 0, abolish_all_tables, 0)
+EndPredDefs
@@ -445,30 +445,22 @@ variant_sha1(ac_term_agenda *agenda, sha1_state *state ARG_LD)
 }
 
 
-/** variant_sha1(@Term, -SHA1:string) is det.
-
-Compute an SHA1 hash for Term. The hash  is designed such that two terms
-have the same hash iff variant(T1,T2) is true. This implies that we must
-basically execute numbervars.
-*/
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+term_variant_sha1() computes the hash  for   variant_sha1/2  in  sha1. It
+raises an exception and returns FALSE if   the  term is cyclic or holds
+attributed variables.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-static
-PRED_IMPL("variant_sha1", 2, variant_sha1, 0)
-{ PRED_LD
-  int rc;
+static int
+term_variant_sha1(term_t t, unsigned char *sha1 ARG_LD)
+{ int rc;
   ac_term_agenda agenda;
   sha1_state state;
-  unsigned char sha1[SHA1_DIGEST_SIZE];
-  char hex[SHA1_DIGEST_SIZE*2];
-  const char hexd[] = "0123456789abcdef";
-  char *o;
-  const unsigned char *i;
   Word p;
-  int n;
 
   state.var_count = 0;
   sha1_begin(state.ctx);
-  ac_initTermAgenda(&agenda, valTermRef(A1));
+  ac_initTermAgenda(&agenda, valTermRef(t));
   initSegStack(&state.vars, sizeof(Word),
 	       sizeof(state.vars_first_chunk), state.vars_first_chunk);
   rc = variant_sha1(&agenda, &state PASS_LD);
@@ -476,15 +468,15 @@ PRED_IMPL("variant_sha1", 2, variant_sha1, 0)
   while(popSegStack(&state.vars, &p, Word))
     setVar(*p);
 
-  DEBUG(CHK_SECURE, checkData(valTermRef(A1)));
+  DEBUG(CHK_SECURE, checkData(valTermRef(t)));
 
   switch( rc )
   { case E_ATTVAR:
       return PL_error(NULL, 0, NULL,
-		      ERR_TYPE, ATOM_free_of_attvar, A1);
+		      ERR_TYPE, ATOM_free_of_attvar, t);
     case E_CYCLE:
       return PL_error(NULL, 0, NULL,
-		      ERR_TYPE, ATOM_acyclic_term, A1);
+		      ERR_TYPE, ATOM_acyclic_term, t);
     case E_RESOURCE:
       return PL_error(NULL, 0, NULL,
 		      ERR_RESOURCE, ATOM_memory);
@@ -492,6 +484,48 @@ PRED_IMPL("variant_sha1", 2, variant_sha1, 0)
 
   sha1_end(sha1, state.ctx);
 
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+variantHashValue() computes a hash  for  t   that  is  the  same for all
+variants of t, e.g., for  hashing   variant  terms  that  are compared
+using is_variant_ptr(). Errors are as term_variant_sha1().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+variantHashValue(term_t t, unsigned int *hval ARG_LD)
+{ unsigned char sha1[SHA1_DIGEST_SIZE];
+
+  if ( !term_variant_sha1(t, sha1 PASS_LD) )
+    return FALSE;
+  memcpy(hval, sha1, sizeof(*hval));
+
+  return TRUE;
+}
+
+
+/** variant_sha1(@Term, -SHA1:string) is det.
+
+Compute an SHA1 hash for Term. The hash  is designed such that two terms
+have the same hash iff variant(T1,T2) is true. This implies that we must
+basically execute numbervars.
+*/
+
+static
+PRED_IMPL("variant_sha1", 2, variant_sha1, 0)
+{ PRED_LD
+  unsigned char sha1[SHA1_DIGEST_SIZE];
+  char hex[SHA1_DIGEST_SIZE*2];
+  const char hexd[] = "0123456789abcdef";
+  char *o;
+  const unsigned char *i;
+  int n;
+
+  if ( !term_variant_sha1(A1, sha1 PASS_LD) )
+    return FALSE;
+
   o = hex;
   i = sha1;
   for(n=0; n<SHA1_DIGEST_SIZE; n++,i++)
@@ -39,6 +39,9 @@
 #include <stdio.h>
 #include <math.h>
 #ifdef O_PLMT
+#ifndef __WINDOWS__
+#include <sched.h>
+#endif
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 			   MULTITHREADING SUPPORT
@@ -282,7 +285,9 @@ counting_mutex _PL_mutexes[] =
   COUNT_MUTEX_INITIALIZER("L_STOPTHEWORLD"),
   COUNT_MUTEX_INITIALIZER("L_FOREIGN"),
   COUNT_MUTEX_INITIALIZER("L_OS"),
-  COUNT_MUTEX_INITIALIZER("L_LOCALE")
+  COUNT_MUTEX_INITIALIZER("L_LOCALE"),
+  COUNT_MUTEX_INITIALIZER("L_RECLAIM"),
+  COUNT_MUTEX_INITIALIZER("L_CLAUSEGC")
 #ifdef __WINDOWS__
 , COUNT_MUTEX_INITIALIZER("L_DDE")
 , COUNT_MUTEX_INITIALIZER("L_CSTACK")
@@ -406,6 +411,7 @@ static int	get_message_queue_unlocked__LD(term_t t, message_queue **queue ARG_LD
 static int	get_message_queue__LD(term_t t, message_queue **queue ARG_LD);
 static void	release_message_queue(message_queue *queue);
 static void	initMessageQueues(void);
+static void	initEngines(void);
 static pl_mutex *mutexCreate(atom_t name);
 static void	initMutexRef(void);
 static int	thread_at_exit(term_t goal, PL_local_data_t *ld);
@@ -544,8 +550,12 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
   if ( ld->profile.active )
     activateProfiler(FALSE, ld);
 #endif
+#ifdef O_VMI_STATISTICS
+  freeVMIStatistics(ld);
+#endif
 
   cleanupLocalDefinitions(ld);
+  clearThreadTablingData(ld);
   if ( ld->freed_clauses )
   { GET_LD
 
@@ -588,6 +598,9 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
   if ( info->detached || acknowledge )
     free_thread_info(info);
 
+#ifdef O_EPOCH_RECLAIM
+  freeSharedFrames(ld);
+#endif
   freeHeap(ld, sizeof(*ld));
 
   if ( acknowledge )			/* == canceled */
@@ -778,6 +791,7 @@ initPrologThreads(void)
 
   pthread_atfork(NULL, NULL, reinit_threads_after_fork);
   initMessageQueues();
+  initEngines();
 
   UNLOCK();
 }
@@ -856,7 +870,9 @@ exitPrologThreads(void)
 	  break;
 	}
 	case PL_THREAD_RUNNING:
-	{ info->thread_data->exit_requested = TRUE;
+	{ if ( info->engine )
+	    break;			/* Prolog engine: no OS thread */
+	  info->thread_data->exit_requested = TRUE;
 
 	  if ( info->cancel )
 	  { if ( (*info->cancel)(i) == TRUE )
@@ -4045,6 +4061,37 @@ freeSimpleMutex(counting_mutex *m)
 }
 
 
+#ifdef O_CONCURRENT_APPEND
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+waitAppendDefinition() waits  for  the   lock-free  appends  to  def  in
+progress (see appendClauseDefinition()) while  we   hold  its  mutex. An
+append takes only a few instructions, so   we  spin briefly. If it does
+not finish, the appending thread is   probably  not running and we yield
+the CPU rather than burning our quantum.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define APPEND_SPIN 100
+
+void
+waitAppendDefinition(Definition def)
+{ int spin = 0;
+
+  while ( def->appending )
+  { if ( ++spin < APPEND_SPIN )
+    { MemoryBarrier();
+    } else
+    {
+#ifdef __WINDOWS__
+      Sleep(0);
+#else
+      sched_yield();
+#endif
+    }
+  }
+}
+#endif /*O_CONCURRENT_APPEND*/
+
+
 		 /*******************************
 		 *	    USER MUTEXES	*
 		 *******************************/
@@ -4928,6 +4975,506 @@ PL_destroy_engine(PL_engine_t e)
 }
 
 
+		 /*******************************
+		 *	   PROLOG ENGINES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Prolog engines are Prolog threads without an  OS thread. An engine owns
+its own stacks and runs a single query that   is  opened on creation.
+engine_next/2 attaches the engine to the  OS   thread  of the caller using
+PL_set_engine(), asks for the next answer and  attaches the caller again.
+Answers, exceptions and posted terms are passed between the stacks using
+records.
+
+An engine is identified by an <engine>  blob or, if created with the
+alias(Name) option, its alias. The blob  is registered until the engine
+is destroyed, so engines must be destroyed explicitly.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct engine_data
+{ PL_engine_t	engine;			/* The Prolog engine */
+  atom_t	symbol;			/* <engine> blob or alias */
+  int		anonymous;		/* symbol is a blob */
+  Module	module;			/* Module to run the goal in */
+  qid_t		query;			/* Open query */
+  term_t	argv;			/* Template, Goal on engine stacks */
+  record_t	posted;			/* Term from engine_post/2 */
+} engine_data;
+
+typedef struct engine_ref
+{ engine_data *data;
+} engine_ref;
+
+
+static int
+write_engine_ref(IOSTREAM *s, atom_t eref, int flags)
+{ engine_ref *ref = PL_blob_data(eref, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<engine>(%p)", ref->data);
+  return TRUE;
+}
+
+
+static int
+release_engine_ref(atom_t eref)
+{ engine_ref *ref = PL_blob_data(eref, NULL, NULL);
+
+  assert(!ref->data->engine);
+  freeHeap(ref->data, sizeof(*ref->data));
+
+  return TRUE;
+}
+
+
+static PL_blob_t engine_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "engine",
+  release_engine_ref,
+  NULL,
+  write_engine_ref,
+  NULL,
+  NULL,
+  NULL
+};
+
+
+static int
+get_engine(term_t t, engine_data **edp, int warn ARG_LD)
+{ PL_blob_t *type;
+  void *data;
+
+  if ( PL_get_blob(t, &data, NULL, &type) )
+  { engine_data *ed = NULL;
+
+    if ( type == &engine_blob )
+    { engine_ref *ref = data;
+
+      ed = ref->data;
+    } else if ( (type->flags & PL_BLOB_TEXT) )
+    { PL_thread_info_t *info;
+
+      if ( get_thread_sync(t, &info, FALSE) )
+	ed = info->engine;
+    } else
+      goto type_error;
+
+    if ( ed && ed->engine )
+    { *edp = ed;
+      return TRUE;
+    }
+
+    return warn ? PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_engine, t)
+		: FALSE;
+  }
+
+type_error:
+  return warn ? PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_engine, t)
+	      : FALSE;
+}
+
+
+/* Called in the engine: open the query for Template-Goal */
+
+static int
+open_engine_query(engine_data *ed, record_t r)
+{ GET_LD
+  static predicate_t pred_call1 = NULL;
+  term_t t;
+
+  if ( !pred_call1 )
+    pred_call1 = PL_predicate("call", 1, "system");
+
+  if ( (ed->argv = PL_new_term_refs(2)) &&
+       (t = PL_new_term_ref()) &&
+       PL_recorded(r, t) &&
+       PL_get_arg(1, t, ed->argv+0) &&
+       PL_get_arg(2, t, ed->argv+1) &&
+       (ed->query = PL_open_query(ed->module, PL_Q_CATCH_EXCEPTION,
+				  pred_call1, ed->argv+1)) )
+    return TRUE;
+
+  return FALSE;
+}
+
+
+/* Called in the engine */
+
+static void
+close_engine_query(engine_data *ed)
+{ if ( ed->query )
+  { PL_close_query(ed->query);
+    ed->query = 0;
+  }
+}
+
+
+/* Called in the engine.  If the answer is deterministic the query is
+   closed immediately, such that the next engine_next/2 fails without
+   resuming the engine.
+*/
+
+static int
+next_engine_answer(engine_data *ed, record_t *answer)
+{ GET_LD
+  int rc;
+
+  if ( (rc = PL_next_solution(ed->query)) )
+  { *answer = PL_record(ed->argv+0);
+    if ( true(QueryFromQid(ed->query), PL_Q_DETERMINISTIC) )
+      close_engine_query(ed);
+  } else
+  { term_t ex;
+
+    if ( (ex = PL_exception(ed->query)) )
+      *answer = PL_record(ex);
+    close_engine_query(ed);
+  }
+
+  return rc;
+}
+
+
+static int
+enter_engine(engine_data *ed, PL_engine_t *me, atom_t action, term_t t)
+{ int rc;
+
+  if ( ed->engine->thread.info->has_tid )
+    rc = PL_ENGINE_INUSE;		/* also if we are ed->engine */
+  else
+    rc = PL_set_engine(ed->engine, me);
+
+  switch( rc )
+  { case PL_ENGINE_SET:
+      return TRUE;
+    case PL_ENGINE_INUSE:
+      return PL_error(NULL, 0, "engine is running",
+		      ERR_PERMISSION, action, ATOM_engine, t);
+    default:
+      return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_engine, t);
+  }
+}
+
+
+static const opt_spec make_engine_options[] =
+{ { ATOM_local,		OPT_SIZE },
+  { ATOM_global,	OPT_SIZE },
+  { ATOM_trail,	        OPT_SIZE },
+  { ATOM_alias,		OPT_ATOM },
+  { NULL_ATOM,		0 }
+};
+
+
+static int
+engine_create(term_t templ, term_t goal, term_t engine, term_t options ARG_LD)
+{ PL_thread_attr_t attr;
+  size_t local_size = 0, global_size = 0, trail_size = 0;
+  atom_t alias = NULL_ATOM;
+  Module m = NULL;
+  engine_data *ed;
+  PL_engine_t me;
+  term_t t;
+  record_t r;
+  int rc;
+
+  if ( !scan_options(options, 0, ATOM_engine_option, make_engine_options,
+		     &local_size, &global_size, &trail_size, &alias) )
+    return FALSE;
+  if ( alias && !PL_is_variable(engine) )
+    return PL_error(NULL, 0, NULL, ERR_UNINSTANTIATION, 3, engine);
+  if ( !PL_strip_module(goal, &m, goal) )
+    return FALSE;
+  if ( !PL_is_callable(goal) )
+    return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_callable, goal);
+
+  memset(&attr, 0, sizeof(attr));
+  attr.local_size  = (long)local_size;
+  attr.global_size = (long)global_size;
+  attr.trail_size  = (long)trail_size;
+
+  if ( !(t = PL_new_term_ref()) ||
+       !PL_cons_functor(t, FUNCTOR_minus2, templ, goal) ||
+       !(r = PL_record(t)) )
+    return FALSE;
+
+  ed = allocHeapOrHalt(sizeof(*ed));
+  memset(ed, 0, sizeof(*ed));
+  ed->module = m;
+
+  if ( !(ed->engine = PL_create_engine(&attr)) )
+  { PL_erase(r);
+    freeHeap(ed, sizeof(*ed));
+    return PL_error(NULL, 0, NULL, ERR_RESOURCE, ATOM_threads);
+  }
+  if ( alias && !aliasThread(ed->engine->thread.info->pl_tid, alias) )
+  { PL_erase(r);
+    PL_destroy_engine(ed->engine);
+    freeHeap(ed, sizeof(*ed));
+    return FALSE;
+  }
+
+  PL_set_engine(ed->engine, &me);
+  rc = open_engine_query(ed, r);
+  PL_set_engine(me, NULL);
+  PL_erase(r);
+
+  if ( !rc )
+  { PL_destroy_engine(ed->engine);
+    freeHeap(ed, sizeof(*ed));
+    return PL_no_memory();
+  }
+
+  if ( alias )
+  { ed->symbol = alias;
+  } else
+  { engine_ref ref;
+    int new;
+
+    ref.data = ed;
+    ed->symbol = lookupBlob((void*)&ref, sizeof(ref), &engine_blob, &new);
+    ed->anonymous = TRUE;		/* lookupBlob() registers */
+  }
+  ed->engine->thread.info->engine = ed;
+
+  return PL_unify_atom(engine, ed->symbol);
+}
+
+
+static
+PRED_IMPL("engine_create", 3, engine_create, PL_FA_TRANSPARENT)
+{ PRED_LD
+  term_t options = PL_new_term_ref();
+
+  return ( PL_put_nil(options) &&
+	   engine_create(A1, A2, A3, options PASS_LD) );
+}
+
+
+static
+PRED_IMPL("engine_create", 4, engine_create, PL_FA_TRANSPARENT)
+{ PRED_LD
+
+  return engine_create(A1, A2, A3, A4 PASS_LD);
+}
+
+
+static int
+engine_next(term_t engine, term_t term ARG_LD)
+{ engine_data *ed;
+  PL_engine_t me;
+  record_t answer = 0;
+  int rc;
+
+  if ( !get_engine(engine, &ed, TRUE PASS_LD) )
+    return FALSE;
+  if ( !ed->query )
+    return FALSE;			/* no more answers */
+
+  if ( !enter_engine(ed, &me, ATOM_resume, engine) )
+    return FALSE;
+  rc = next_engine_answer(ed, &answer);
+  PL_set_engine(me, NULL);
+
+  if ( answer )
+  { term_t t = PL_new_term_ref();
+
+    if ( !PL_recorded(answer, t) )
+    { PL_erase(answer);
+      return FALSE;
+    }
+    PL_erase(answer);
+
+    return rc ? PL_unify(term, t) : PL_raise_exception(t);
+  }
+
+  return rc ? PL_no_memory() : FALSE;
+}
+
+
+static int
+engine_post(term_t engine, term_t term ARG_LD)
+{ engine_data *ed;
+
+  if ( !get_engine(engine, &ed, TRUE PASS_LD) )
+    return FALSE;
+  if ( ed->posted )
+    return PL_error(NULL, 0, "engine has pending term",
+		    ERR_PERMISSION, ATOM_post_to, ATOM_engine, engine);
+  if ( !(ed->posted = PL_record(term)) )
+    return PL_no_memory();
+
+  return TRUE;
+}
+
+
+/** engine_next(+Engine, -Term) is semidet.
+
+Ask Engine for its next answer.
+*/
+
+static
+PRED_IMPL("engine_next", 2, engine_next, 0)
+{ PRED_LD
+
+  return engine_next(A1, A2 PASS_LD);
+}
+
+
+/** engine_post(+Engine, +Term) is det.
+    engine_post(+Engine, +Term, -Reply) is semidet.
+
+Make Term available to engine_fetch/1 in Engine.  engine_post/3
+combines engine_post/2 with engine_next/2.
+*/
+
+static
+PRED_IMPL("engine_post", 2, engine_post, 0)
+{ PRED_LD
+
+  return engine_post(A1, A2 PASS_LD);
+}
+
+
+static
+PRED_IMPL("engine_post", 3, engine_post, 0)
+{ PRED_LD
+
+  return ( engine_post(A1, A2 PASS_LD) &&
+	   engine_next(A1, A3 PASS_LD) );
+}
+
+
+/** engine_fetch(-Term) is det.
+
+Fetch the term posted to the calling engine.
+*/
+
+static
+PRED_IMPL("engine_fetch", 1, engine_fetch, 0)
+{ PRED_LD
+  engine_data *ed = LD->thread.info->engine;
+
+  if ( ed && ed->posted )
+  { term_t t = PL_new_term_ref();
+    record_t r = ed->posted;
+
+    ed->posted = 0;
+    if ( PL_recorded(r, t) )
+    { PL_erase(r);
+      return PL_unify(A1, t);
+    }
+    PL_erase(r);
+    return FALSE;
+  }
+
+  if ( ed )
+  { term_t t = PL_new_term_ref();
+
+    return ( PL_put_atom(t, ed->symbol) &&
+	     PL_error(NULL, 0, "no term posted",
+		      ERR_EXISTENCE, ATOM_term, t) );
+  }
+
+  return PL_error(NULL, 0, "not called from an engine",
+		  ERR_PERMISSION, ATOM_access, ATOM_engine, A1);
+}
+
+
+/** engine_destroy(+Engine) is det.
+
+Close the query of Engine and reclaim its stacks.
+*/
+
+static
+PRED_IMPL("engine_destroy", 1, engine_destroy, 0)
+{ PRED_LD
+  engine_data *ed;
+  PL_engine_t me;
+
+  if ( !get_engine(A1, &ed, TRUE PASS_LD) )
+    return FALSE;
+  if ( !enter_engine(ed, &me, ATOM_destroy, A1) )
+    return FALSE;
+  close_engine_query(ed);
+  ed->engine->thread.info->engine = NULL;
+  PL_set_engine(me, NULL);
+
+  PL_destroy_engine(ed->engine);
+  ed->engine = NULL;
+  if ( ed->posted )
+  { PL_erase(ed->posted);
+    ed->posted = 0;
+  }
+
+  if ( ed->anonymous )
+    PL_unregister_atom(ed->symbol);	/* release_engine_ref() frees ed */
+  else
+    freeHeap(ed, sizeof(*ed));
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("engine_self", 1, engine_self, 0)
+{ PRED_LD
+  engine_data *ed = LD->thread.info->engine;
+
+  if ( ed )
+    return PL_unify_atom(A1, ed->symbol);
+
+  return FALSE;
+}
+
+
+static
+PRED_IMPL("is_engine", 1, is_engine, 0)
+{ PRED_LD
+  engine_data *ed;
+
+  return get_engine(A1, &ed, FALSE PASS_LD);
+}
+
+
+static
+PRED_IMPL("current_engine", 1, current_engine, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  int i;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+      i = 1;
+      break;
+    case FRG_REDO:
+      i = (int)CTX_INT;
+      break;
+    case FRG_CUTTED:
+    default:
+      return TRUE;
+  }
+
+  for(; i <= thread_highest_id; i++)
+  { PL_thread_info_t *info = GD->thread.threads[i];
+    engine_data *ed;
+
+    if ( info && (ed = info->engine) && ed->engine &&
+	 PL_unify_atom(A1, ed->symbol) )
+      ForeignRedoInt(i+1);
+  }
+
+  return FALSE;
+}
+
+
+static void
+initEngines(void)
+{ engine_blob.atom_name = ATOM_engine;
+  PL_register_blob_type(&engine_blob);
+}
+
+
 		 /*******************************
 		 *	     STATISTICS		*
 		 *******************************/
@@ -5771,6 +6318,96 @@ forThreadLocalDataUnsuspended(void (*func)(PL_local_data_t *), unsigned flags)
 }
 
 
+#ifdef O_CLAUSEGC
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+markPredicatesThreads() runs markPredicatesInEnvironments() in all other
+threads and returns the oldest generation  they published. The threads
+are not suspended: they continue as soon   as  they have answered. If a
+thread did not answer, the result is 0.  Must  be called with L_THREAD
+and L_STOPTHEWORLD held.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+gen_t
+markPredicatesThreads(void)
+{ int me = PL_thread_self();
+  PL_thread_info_t **th;
+  gen_t oldest = ~(gen_t)0;
+
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+
+    if ( info->thread_data )
+      info->thread_data->clauses.oldest_generation = 0;
+  }
+
+  forThreadLocalData(markPredicatesInEnvironments, 0);
+
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+
+    if ( info->thread_data && info->pl_tid != me &&
+	 ( info->status == PL_THREAD_RUNNING || info->in_exit_hooks ) &&
+	 info->thread_data->clauses.oldest_generation < oldest )
+      oldest = info->thread_data->clauses.oldest_generation;
+  }
+
+  return oldest;
+}
+#endif /*O_CLAUSEGC*/
+
+
+#ifdef O_EPOCH_RECLAIM
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+sharedDynamicFramesThreads() is true if some  thread has a frame running
+the shared dynamic predicate def. See reclaimDefinition().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+sharedFramesOnDefinition(PL_local_data_t *ld, Definition def)
+{ shared_frames *b = &ld->dynamic.frames;
+
+  do
+  { int i;
+
+    for(i=0; i<SHARED_FRAMES_BLOCK; i++)
+    { if ( b->entries[i].definition == def &&
+	   b->entries[i].frames > 0 )
+	return TRUE;
+    }
+  } while( (b=b->next) );
+
+  return FALSE;
+}
+
+
+int
+sharedDynamicFramesThreads(Definition def)
+{ PL_thread_info_t **th;
+  int active = FALSE;
+
+  LOCK();
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+
+    if ( info->thread_data &&
+	 sharedFramesOnDefinition(info->thread_data, def) )
+    { active = TRUE;
+      break;
+    }
+  }
+  UNLOCK();
+
+  return active;
+}
+#endif /*O_EPOCH_RECLAIM*/
+
+
 		 /*******************************
 		 *	 ATOM MARK SUPPORT	*
 		 *******************************/
@@ -5820,6 +6457,190 @@ markAtomsMessageQueues(void)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+markAtomsThreads() marks the atoms referenced   from the stacks of all
+other threads without stopping them. Each   thread is asked to mark its
+own stacks by raising SIG_ATOM_MARK, which   it  handles at the next safe
+point in markAtomsAtSafePoint(). The threads do  so in parallel and keep
+running afterwards. A thread that finishes   sets  its state to DONE and
+signals agc_mark.cond, on which we block while threads are marking.
+
+Threads that do not reach a safe  point within AGC_MARK_WAIT seconds are
+typically blocked in foreign code or waiting for a lock. We claim their
+job and mark their stacks ourselves.  The  claim  uses COMPARE_AND_SWAP()
+on LD->atoms.gc_mark, so exactly one of the two parties marks. Nothing
+stops such a thread from resuming  while   we  mark its stacks. This is
+the same situation as a thread  that   continues  after marking itself,
+which is safe for the reasons given in  the   note  at the start of
+pl-atom.c.  The  old  implementation  marked   all  threads  this  way
+(forThreadLocalDataUnsuspended()).
+
+Must be called by AGC with L_THREAD held, which guarantees the set of
+threads does not change.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define AGC_MARK_WAIT 5000000		/* Max wait for threads to check in (ns) */
+
+static struct
+{ int		initialised;		/* mutex and cond are initialised */
+  simpleMutex	mutex;			/* Protects transitions to DONE */
+#ifdef __WINDOWS__
+  win32_cond_t	cond;			/* Signalled if a thread is DONE */
+#else
+  pthread_cond_t cond;
+#endif
+} agc_mark;
+
+
+/* Wait for agc_mark.cond. Returns ETIMEDOUT if deadline is passed */
+
+static int
+agc_mark_wait(struct timespec *deadline)
+{
+#ifdef __WINDOWS__
+  return win32_cond_wait(&agc_mark.cond, &agc_mark.mutex, deadline);
+#else
+  if ( deadline )
+    return pthread_cond_timedwait(&agc_mark.cond, &agc_mark.mutex, deadline);
+  return pthread_cond_wait(&agc_mark.cond, &agc_mark.mutex);
+#endif
+}
+
+
+void
+markAtomsThreads(void)
+{ int me = PL_thread_self();
+  PL_thread_info_t **th;
+  struct timespec deadline;
+  int claim = FALSE;
+
+  if ( !agc_mark.initialised )
+  { simpleMutexInit(&agc_mark.mutex);
+    cv_init(&agc_mark.cond, NULL);
+    agc_mark.initialised = TRUE;
+  }
+
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+
+    if ( info && info->thread_data && info->pl_tid != me &&
+	 ( info->status == PL_THREAD_RUNNING || info->in_exit_hooks ) )
+    { PL_local_data_t *ld = info->thread_data;
+
+      ld->atoms.gc_mark = AGC_MARK_REQUESTED;
+      MemoryBarrier();
+      raiseSignal(ld, SIG_ATOM_MARK);
+    }
+  }
+
+  get_current_timespec(&deadline);
+  deadline.tv_nsec += AGC_MARK_WAIT;
+  carry_timespec_nanos(&deadline);
+
+  simpleMutexLock(&agc_mark.mutex);
+  for(;;)
+  { int requested = 0;
+    int busy = 0;
+
+    for( th = &GD->thread.threads[1];
+	 th <= &GD->thread.threads[thread_highest_id];
+	 th++ )
+    { PL_thread_info_t *info = *th;
+      PL_local_data_t *ld;
+
+      if ( !info || !(ld=info->thread_data) )
+	continue;
+
+      switch( ld->atoms.gc_mark )
+      { case AGC_MARK_REQUESTED:
+	  if ( claim &&
+	       COMPARE_AND_SWAP(&ld->atoms.gc_mark,
+				AGC_MARK_REQUESTED, AGC_MARK_BUSY) )
+	  { DEBUG(MSG_AGC, Sdprintf("Marking atoms for thread %d\n",
+				    info->pl_tid));
+	    simpleMutexUnlock(&agc_mark.mutex);
+	    markAtomsOnStacks(ld);
+	    simpleMutexLock(&agc_mark.mutex);
+	    ld->atoms.gc_mark = AGC_MARK_DONE;
+	  } else
+	    requested++;
+	  break;
+	case AGC_MARK_BUSY:
+	  busy++;
+	  break;
+      }
+    }
+
+    if ( requested )
+    { if ( agc_mark_wait(&deadline) == ETIMEDOUT )
+	claim = TRUE;
+    } else if ( busy )
+    { agc_mark_wait(NULL);
+    } else
+      break;
+  }
+  simpleMutexUnlock(&agc_mark.mutex);
+
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+
+    if ( info && info->thread_data )
+      info->thread_data->atoms.gc_mark = AGC_MARK_IDLE;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+markAtomsAtSafePoint() is the handler  for   SIG_ATOM_MARK.  If  AGC still
+waits for us, we mark the atoms on our  own stacks and wake up AGC. The
+request may be stale, e.g., AGC  already   claimed  the job or finished,
+in which case we do nothing.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+markAtomsAtSafePoint(void)
+{ GET_LD
+
+  if ( COMPARE_AND_SWAP(&LD->atoms.gc_mark,
+			AGC_MARK_REQUESTED, AGC_MARK_BUSY) )
+  { markAtomsOnStacks(LD);
+    simpleMutexLock(&agc_mark.mutex);
+    LD->atoms.gc_mark = AGC_MARK_DONE;
+    cv_signal(&agc_mark.cond);
+    simpleMutexUnlock(&agc_mark.mutex);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+waitForAtomLookups() waits until no thread  is walking the atom hash-table
+without holding L_ATOM (see  lookupBlob()).   It  is called by AGC after
+setting GD->atoms.gc_active, which prevents new lock-free lookups. Such
+lookups are short, so we simply spin.  Must be called with L_THREAD held.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+waitForAtomLookups(void)
+{ PL_thread_info_t **th;
+
+  for( th = &GD->thread.threads[1];
+       th <= &GD->thread.threads[thread_highest_id];
+       th++ )
+  { PL_thread_info_t *info = *th;
+    PL_local_data_t *ld;
+
+    if ( info && (ld=info->thread_data) )
+    { while( ld->atoms.lookup_active )
+	MemoryBarrier();
+    }
+  }
+}
+
+
 		 /*******************************
 		 *	    PREDICATES		*
 		 *******************************/
@@ -5887,6 +6708,9 @@ localiseDefinition(Definition def)
   clear(local, P_THREAD_LOCAL);		/* remains P_DYNAMIC */
   local->impl.clauses.first_clause = NULL;
   local->impl.clauses.clause_indexes = NULL;
+#ifdef O_CONCURRENT_JIT
+  local->impl.clauses.building = NULL;
+#endif
 
   createSupervisor(local);
   registerLocalDefinition(def);
@@ -6143,5 +6967,16 @@ BeginPredDefs(thread)
   PRED_DEF("mutex_property", 2, mutex_property, PL_FA_NONDETERMINISTIC|PL_FA_ISO)
 
   PRED_DEF("$thread_local_clause_count", 3, thread_local_clause_count, 0)
+
+  PRED_DEF("engine_create",  3, engine_create,  PL_FA_TRANSPARENT)
+  PRED_DEF("engine_create",  4, engine_create,  PL_FA_TRANSPARENT)
+  PRED_DEF("engine_next",    2, engine_next,    0)
+  PRED_DEF("engine_post",    2, engine_post,    0)
+  PRED_DEF("engine_post",    3, engine_post,    0)
+  PRED_DEF("engine_fetch",   1, engine_fetch,   0)
+  PRED_DEF("engine_destroy", 1, engine_destroy, 0)
+  PRED_DEF("engine_self",    1, engine_self,    0)
+  PRED_DEF("is_engine",      1, is_engine,      0)
+  PRED_DEF("current_engine", 1, current_engine, PL_FA_NONDETERMINISTIC)
 #endif
 EndPredDefs
@@ -97,6 +97,7 @@ typedef struct _PL_thread_info_t
   atom_t	    name;		/* Name of the thread */
   ldata_status_t    ldata_status;	/* status of forThreadLocalData() */
   int		    in_exit_hooks;	/* TRUE: running exit hooks */
+  struct engine_data *engine;		/* Prolog engine (engine_create/3) */
 } PL_thread_info_t;
 
 #define QTYPE_THREAD	0
@@ -169,9 +170,11 @@ extern counting_mutex _PL_mutexes[];	/* Prolog mutexes */
 #define L_FOREIGN      22
 #define L_OS	       23
 #define L_LOCALE       24
+#define L_RECLAIM      25
+#define L_CLAUSEGC     26
 #ifdef __WINDOWS__
-#define L_DDE	       25
-#define L_CSTACK       26
+#define L_DDE	       27
+#define L_CSTACK       28
 #endif
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -226,10 +229,26 @@ countingMutexUnlock(counting_mutex *cm)
 #define PL_UNLOCK(id) IF_MT(id, countingMutexUnlock(&_PL_mutexes[id]))
 #endif
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+With O_CONCURRENT_APPEND, assertz/1  may  link   a  clause  to  a  shared
+dynamic predicate without its mutex.  Holding   the  mutex of a dynamic
+predicate therefore also blocks such appends  and waits for those in
+progress.  See appendClauseDefinition() in pl-proc.c.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_CONCURRENT_APPEND
+#define BLOCKAPPEND(def)	blockAppendDefinition(def)
+#define UNBLOCKAPPEND(def)	unblockAppendDefinition(def)
+#else
+#define BLOCKAPPEND(def)	(void)0
+#define UNBLOCKAPPEND(def)	(void)0
+#endif
+
 #define LOCKDEF(def) \
 	if ( GD->thread.enabled ) \
 	{ if ( def->mutex ) \
 	  { countingMutexLock(def->mutex); \
+	    BLOCKAPPEND(def); \
 	  } else if ( false(def, P_DYNAMIC) ) \
 	  { countingMutexLock(&_PL_mutexes[L_PREDICATE]); \
 	  } \
@@ -238,16 +257,23 @@ countingMutexUnlock(counting_mutex *cm)
 #define UNLOCKDEF(def) \
 	if ( GD->thread.enabled ) \
 	{ if ( def->mutex ) \
-	  { countingMutexUnlock(def->mutex); \
+	  { UNBLOCKAPPEND(def); \
+	    countingMutexUnlock(def->mutex); \
 	  } else if ( false(def, P_DYNAMIC) ) \
 	  { countingMutexUnlock(&_PL_mutexes[L_PREDICATE]); \
 	  } \
 	}
 
 #define LOCKDYNDEF(def) \
-	if ( GD->thread.enabled && def->mutex ) countingMutexLock(def->mutex)
+	if ( GD->thread.enabled && def->mutex ) \
+	{ countingMutexLock(def->mutex); \
+	  BLOCKAPPEND(def); \
+	}
 #define UNLOCKDYNDEF(def) \
-	if ( GD->thread.enabled && def->mutex ) countingMutexUnlock(def->mutex)
+	if ( GD->thread.enabled && def->mutex ) \
+	{ UNBLOCKAPPEND(def); \
+	  countingMutexUnlock(def->mutex); \
+	}
 
 #define LOCKMODULE(module)	countingMutexLock((module)->mutex)
 #define UNLOCKMODULE(module)	countingMutexUnlock((module)->mutex)
@@ -360,11 +386,28 @@ COMMON(void)	forThreadLocalData(void (*func)(struct PL_local_data *),
 COMMON(void)	forThreadLocalDataUnsuspended(void (*func)(struct PL_local_data *),
 				   unsigned flags);
 COMMON(void)	resumeThreads(void);
+#ifdef O_CLAUSEGC
+COMMON(gen_t)	markPredicatesThreads(void);
+#endif
+#ifdef O_EPOCH_RECLAIM
+COMMON(int)	sharedDynamicFramesThreads(Definition def);
+#ifdef O_CONCURRENT_APPEND
+COMMON(void)	waitAppendDefinition(Definition def);
+#endif
+#endif
 COMMON(void)	markAtomsMessageQueues(void);
 COMMON(void)	markAtomsThreadMessageQueue(PL_local_data_t *ld);
+COMMON(void)	waitForAtomLookups(void);
+COMMON(void)	markAtomsThreads(void);
+COMMON(void)	markAtomsAtSafePoint(void);
 
 #define PL_THREAD_SUSPEND_AFTER_WORK	0x1 /* forThreadLocalData() */
 
+#define AGC_MARK_IDLE		0	/* LD->atoms.gc_mark values */
+#define AGC_MARK_REQUESTED	1	/* AGC asked the thread to mark */
+#define AGC_MARK_BUSY		2	/* Thread or AGC is marking */
+#define AGC_MARK_DONE		3	/* Stacks are marked */
+
 #else /*O_PLMT, end of threading-stuff */
 
 		 /*******************************
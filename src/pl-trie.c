@@ -0,0 +1,1026 @@
+/*  Part of SWI-Prolog
+
+    Author:        Jan Wielemaker
+    E-mail:        J.Wielemaker@vu.nl
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2016, VU University Amsterdam
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*#define O_DEBUG 1*/
+#include "pl-incl.h"
+#define AC_TERM_WALK 1
+#include "pl-termwalk.c"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+This module implements tries of terms.  A  trie maps terms to a value,
+where two keys are the same if  they   are  variants.  Insert, lookup and
+delete are O(size of the key).
+
+A key is walked in depth-first  order,   as  variant_sha1/2  does.  Each
+cell of the key contributes one word to the path from the root:
+
+  - An atom or small integer is its own key.  Atoms are registered
+    while they are used by the trie.
+  - A compound contributes its functor, followed by the arguments.
+  - The N-th distinct variable contributes (N<<LMASK_BITS)|MARK_MASK,
+    the mark variant_sha1/2 uses to number variables.
+  - An indirect (string, float or big integer) contributes its header,
+    followed by the data words.
+
+Because terms are self-delimiting in this   notation, a node that ends a
+key never has children. Nodes with a single  child point to it directly,
+larger sets of children are stored in a Table.
+
+Tries are shared between threads.  Modifications and traversal are
+guarded by the mutex of the trie.  While  a   thread  is reading a trie
+without holding the lock (copying the value  or enumerating), nodes and
+values that are removed are not freed, but added to the garbage list of
+the trie, which is reclaimed when the last reader is done.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TRIE_MAGIC  0x4bcbcf87
+#define TRIE_CMAGIC 0x4bcbcf88		/* destroyed */
+
+#define TN_ATOM	    0x01		/* Key is a registered atom */
+
+typedef struct trie_node
+{ word			key;		/* Key from the parent */
+  struct trie_node     *parent;		/* Parent node */
+  struct trie_node     *child;		/* Only child */
+  Table			children;	/* Table of children */
+  Record		value;		/* Value if node ends a key */
+  unsigned int		flags;		/* TN_* */
+} trie_node;
+
+typedef struct trie_garbage
+{ struct trie_garbage  *next;		/* Next in list */
+  trie_node	       *node;		/* Free this node */
+  Record		value;		/* Free this value */
+  Table			children;	/* Free this table */
+} trie_garbage;
+
+typedef struct trie
+{ int			magic;		/* TRIE_MAGIC */
+  int			references;	/* # active readers */
+  atom_t		symbol;		/* <trie> handle */
+  size_t		node_count;	/* # nodes */
+  size_t		value_count;	/* # keys with a value */
+  trie_node		root;		/* The root node */
+  trie_garbage	       *garbage;	/* Removed while being read */
+#ifdef O_PLMT
+  simpleMutex		mutex;		/* Guards the trie */
+#endif
+} trie;
+
+#ifdef O_PLMT
+#define LOCK_TRIE(t)	simpleMutexLock(&(t)->mutex)
+#define UNLOCK_TRIE(t)	simpleMutexUnlock(&(t)->mutex)
+#else
+#define LOCK_TRIE(t)	(void)0
+#define UNLOCK_TRIE(t)	(void)0
+#endif
+
+#define TRIE_ERR_ATTVAR	  -1
+#define TRIE_ERR_CYCLE	  -2
+#define TRIE_ERR_RESOURCE -3
+
+
+		 /*******************************
+		 *	       NODES		*
+		 *******************************/
+
+static trie_node *
+new_trie_node(trie *trie, trie_node *parent, word key, unsigned int flags)
+{ trie_node *n = allocHeapOrHalt(sizeof(*n));
+
+  memset(n, 0, sizeof(*n));
+  n->key    = key;
+  n->parent = parent;
+  n->flags  = flags;
+  if ( (flags&TN_ATOM) )
+    PL_register_atom(key);
+  trie->node_count++;
+
+  return n;
+}
+
+
+static void
+free_trie_node(trie_node *n)
+{ if ( (n->flags&TN_ATOM) )
+    PL_unregister_atom(n->key);
+  if ( n->value )
+    freeRecord(n->value);
+  if ( n->children )
+    destroyHTable(n->children);
+  freeHeap(n, sizeof(*n));
+}
+
+
+static void
+add_garbage(trie *trie, trie_node *node, Record value, Table children)
+{ trie_garbage *g = allocHeapOrHalt(sizeof(*g));
+
+  g->node     = node;
+  g->value    = value;
+  g->children = children;
+  g->next     = trie->garbage;
+  trie->garbage = g;
+}
+
+
+static void
+free_garbage(trie *trie)
+{ trie_garbage *g, *next;
+
+  for(g=trie->garbage; g; g=next)
+  { next = g->next;
+    if ( g->node )
+      free_trie_node(g->node);
+    if ( g->value )
+      freeRecord(g->value);
+    if ( g->children )
+      destroyHTable(g->children);
+    freeHeap(g, sizeof(*g));
+  }
+  trie->garbage = NULL;
+}
+
+
+static void
+discard_node(trie *trie, trie_node *n)
+{ trie->node_count--;
+
+  if ( trie->references > 0 )
+    add_garbage(trie, n, NULL, NULL);
+  else
+    free_trie_node(n);
+}
+
+
+static void
+discard_value(trie *trie, trie_node *n)
+{ Record value = n->value;
+
+  n->value = NULL;
+  trie->value_count--;
+
+  if ( trie->references > 0 )
+    add_garbage(trie, NULL, value, NULL);
+  else
+    freeRecord(value);
+}
+
+
+/* Find the child of node with key. If add is TRUE, create it if
+   it does not exist.  Must be called with the trie locked.
+*/
+
+static trie_node *
+follow_node(trie *trie, trie_node *node, word key, int add, unsigned int flags)
+{ trie_node *new;
+
+  if ( node->child )
+  { if ( node->child->key == key )
+      return node->child;
+    if ( !add )
+      return NULL;
+
+    node->children = newHTable(4|TABLE_UNLOCKED);
+    addHTable(node->children, (void*)node->child->key, node->child);
+    node->child = NULL;
+  } else if ( node->children )
+  { Symbol s;
+
+    if ( (s=lookupHTable(node->children, (void*)key)) )
+      return s->value;
+    if ( !add )
+      return NULL;
+  } else if ( !add )
+  { return NULL;
+  }
+
+  new = new_trie_node(trie, node, key, flags);
+  if ( node->children )
+    addHTable(node->children, (void*)key, new);
+  else
+    node->child = new;
+
+  return new;
+}
+
+
+static int
+has_children(trie_node *n)
+{ return n->child || (n->children && n->children->size > 0);
+}
+
+
+/* Remove nodes that neither end a key nor have children, starting at n
+   and walking to the root.
+*/
+
+static void
+prune_node(trie *trie, trie_node *n)
+{ while( n != &trie->root && !n->value && !has_children(n) )
+  { trie_node *parent = n->parent;
+
+    if ( parent->child == n )
+      parent->child = NULL;
+    else
+      deleteHTable(parent->children, (void*)n->key);
+
+    discard_node(trie, n);
+    n = parent;
+  }
+}
+
+
+/* Discard all nodes of the trie without recursion: keys can be very
+   deep, e.g., long lists.
+*/
+
+static void
+clear_trie(trie *trie)
+{ segstack stack;
+  trie_node *first_chunk[64];
+  trie_node *n;
+
+  initSegStack(&stack, sizeof(trie_node*), sizeof(first_chunk), first_chunk);
+
+  n = &trie->root;
+  for(;;)
+  { if ( n->child )
+    { if ( !pushSegStack(&stack, n->child, trie_node*) )
+	outOfCore();
+    } else if ( n->children )
+    { for_unlocked_table(n->children, s,
+			 { trie_node *c = s->value;
+			   if ( !pushSegStack(&stack, c, trie_node*) )
+			     outOfCore();
+			 });
+    }
+
+    if ( n != &trie->root )
+    { if ( n->value )
+	discard_value(trie, n);
+      discard_node(trie, n);		/* children are on the stack */
+    }
+
+    if ( !popSegStack(&stack, &n, trie_node*) )
+      break;
+  }
+
+  trie->root.child = NULL;
+  if ( trie->root.children )
+  { if ( trie->references > 0 )
+      add_garbage(trie, NULL, NULL, trie->root.children);
+    else
+      destroyHTable(trie->root.children);
+    trie->root.children = NULL;
+  }
+}
+
+
+		 /*******************************
+		 *	       KEYS		*
+		 *******************************/
+
+/* Walk the key at k, following (add is FALSE) or creating (add is TRUE)
+   nodes.  Returns TRUE and the node that ends the key in *nodep, FALSE
+   if add is FALSE and the key is not in the trie or one of the
+   TRIE_ERR_* codes.  Must be called with the trie locked.
+*/
+
+static int
+trie_lookup(trie *trie, trie_node **nodep, Word k, int add ARG_LD)
+{ ac_term_agenda agenda;
+  trie_node *node = &trie->root;
+  size_t var_number = 0;
+  segstack vars;
+  Word vars_first_chunk[32];
+  int rc = TRUE;
+  Word p;
+
+  ac_initTermAgenda(&agenda, k);
+  initSegStack(&vars, sizeof(Word),
+	       sizeof(vars_first_chunk), vars_first_chunk);
+
+  while( node && (p=ac_nextTermAgenda(&agenda)) )
+  { word w = *p;
+
+    switch(tag(w))
+    { case TAG_VAR:
+      { if ( isVar(w) )
+	{ if ( !pushSegStack(&vars, p, Word) )
+	  { rc = TRIE_ERR_RESOURCE;
+	    goto out;
+	  }
+	  w = *p = ((word)var_number++<<LMASK_BITS)|MARK_MASK;
+	}
+	node = follow_node(trie, node, w, add, 0);
+	break;
+      }
+      case TAG_ATTVAR:
+	rc = TRIE_ERR_ATTVAR;
+        goto out;
+      case TAG_ATOM:
+	node = follow_node(trie, node, w, add, TN_ATOM);
+	break;
+      case TAG_COMPOUND:
+      { functor_t f;
+
+	switch(ac_pushTermAgenda(&agenda, w, &f))
+	{ case -1:
+	    rc = TRIE_ERR_RESOURCE;
+	    goto out;
+	  case FALSE:
+	    rc = TRIE_ERR_CYCLE;
+	    goto out;
+	}
+	node = follow_node(trie, node, f, add, 0);
+	break;
+      }
+      default:
+      { if ( isIndirect(w) )
+	{ Word d = addressIndirect(w);
+	  size_t i, n = wsizeofInd(*d);
+
+	  node = follow_node(trie, node, *d, add, 0);
+	  for(i=1; node && i<=n; i++)
+	    node = follow_node(trie, node, d[i], add, 0);
+	} else
+	{ node = follow_node(trie, node, w, add, 0);
+	}
+      }
+    }
+  }
+
+out:
+  ac_clearTermAgenda(&agenda);
+  while(popSegStack(&vars, &p, Word))
+    setVar(*p);
+
+  if ( rc == TRUE )
+  { if ( node )
+      *nodep = node;
+    else
+      rc = FALSE;
+  } else if ( add && node )
+  { prune_node(trie, node);
+  }
+
+  return rc;
+}
+
+
+static int
+trie_error(int rc, term_t culprit)
+{ switch(rc)
+  { case TRIE_ERR_ATTVAR:
+      return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_free_of_attvar, culprit);
+    case TRIE_ERR_CYCLE:
+      return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_acyclic_term, culprit);
+    case TRIE_ERR_RESOURCE:
+      return PL_error(NULL, 0, NULL, ERR_RESOURCE, ATOM_memory);
+    default:
+      return FALSE;
+  }
+}
+
+
+/* Rebuild the key that ends in node and unify it with t.  Must be called
+   while the trie has a reader, such that the nodes are not freed.
+*/
+
+static int
+unify_key(term_t t, trie_node *node ARG_LD)
+{ tmp_buffer keys;
+  tmp_buffer slots;
+  tmp_buffer vars;
+  word *kp, *ke;
+  size_t cells = 0;
+  word root = 0;
+  term_t tmp;
+  Word gp;
+  int rc;
+
+  initBuffer(&keys);
+  for(; node->parent; node=node->parent)
+    addBuffer(&keys, node->key, word);
+  kp = baseBuffer(&keys, word);
+  ke = topBuffer(&keys, word);
+
+  for(ke--; ke >= kp; ke--)		/* count cells */
+  { word w = *ke;
+
+    if ( tag(w) == TAG_ATOM && storage(w) == STG_GLOBAL )
+    { cells += 1+arityFunctor(w);
+    } else if ( tag(w) != TAG_VAR && storage(w) == STG_LOCAL )
+    { size_t n = wsizeofInd(w);
+
+      cells += n+2;
+      ke -= n;
+    }
+  }
+
+  if ( !(tmp = PL_new_term_ref()) )
+  { discardBuffer(&keys);
+    return FALSE;
+  }
+  if ( !hasGlobalSpace(cells) &&
+       (rc=ensureGlobalSpace(cells, ALLOW_GC)) != TRUE )
+  { discardBuffer(&keys);
+    return raiseStackOverflow(rc);
+  }
+
+  initBuffer(&slots);
+  initBuffer(&vars);
+  addBuffer(&slots, &root, Word);
+  gp = gTop;
+
+  for(ke = topBuffer(&keys, word)-1; ke >= kp; ke--)
+  { word w = *ke;
+    Word slot = popBuffer(&slots, Word);
+
+    if ( tag(w) == TAG_VAR )
+    { size_t i = w>>LMASK_BITS;
+
+      if ( i == entriesBuffer(&vars, Word) )
+      { setVar(*slot);
+	addBuffer(&vars, slot, Word);
+      } else
+      { *slot = makeRefG(fetchBuffer(&vars, i, Word));
+      }
+    } else if ( tag(w) == TAG_ATOM && storage(w) == STG_GLOBAL )
+    { size_t arity = arityFunctor(w);
+      Word a;
+
+      *slot = consPtr(gp, TAG_COMPOUND|STG_GLOBAL);
+      *gp++ = w;
+      for(a=gp+arity-1; a >= gp; a--)
+	addBuffer(&slots, a, Word);
+      gp += arity;
+    } else if ( storage(w) == STG_LOCAL )
+    { size_t n = wsizeofInd(w);
+
+      *slot = consPtr(gp, tag(w)|STG_GLOBAL);
+      *gp++ = w;
+      while(n-- > 0)
+	*gp++ = *--ke;
+      *gp++ = w;
+    } else
+    { *slot = w;
+    }
+  }
+  gTop = gp;
+
+  discardBuffer(&slots);
+  discardBuffer(&vars);
+  discardBuffer(&keys);
+
+  if ( root )				/* a variable key leaves tmp unbound */
+    *valTermRef(tmp) = root;
+
+  return PL_unify(t, tmp);
+}
+
+
+		 /*******************************
+		 *	      BLOB		*
+		 *******************************/
+
+static int
+release_trie(atom_t symbol)
+{ trie **ref = PL_blob_data(symbol, NULL, NULL);
+  trie *trie = *ref;
+
+  clear_trie(trie);
+  free_garbage(trie);
+#ifdef O_PLMT
+  simpleMutexDelete(&trie->mutex);
+#endif
+  freeHeap(trie, sizeof(*trie));
+
+  return TRUE;
+}
+
+
+static int
+write_trie(IOSTREAM *s, atom_t symbol, int flags)
+{ trie **ref = PL_blob_data(symbol, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<trie>(%p)", *ref);
+  return TRUE;
+}
+
+
+static PL_blob_t trie_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "trie",
+  release_trie,
+  NULL,
+  write_trie,
+  NULL
+};
+
+
+static int
+get_trie(term_t t, trie **tp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &trie_blob )
+  { trie *trie = *(struct trie**)data;
+
+    if ( trie->magic == TRIE_MAGIC )
+    { *tp = trie;
+      return TRUE;
+    }
+
+    PL_existence_error("trie", t);
+  } else
+    PL_type_error("trie", t);
+
+  return FALSE;
+}
+
+
+static void
+acquire_trie(trie *trie)
+{ LOCK_TRIE(trie);
+  trie->references++;
+  UNLOCK_TRIE(trie);
+}
+
+
+static void
+release_trie_reader(trie *trie)
+{ LOCK_TRIE(trie);
+  if ( --trie->references == 0 )
+    free_garbage(trie);
+  UNLOCK_TRIE(trie);
+}
+
+
+		 /*******************************
+		 *	  PROLOG BINDING	*
+		 *******************************/
+
+/** trie_new(-Trie) is det.
+
+Create a new trie.
+*/
+
+static
+PRED_IMPL("trie_new", 1, trie_new, 0)
+{ PRED_LD
+  trie *trie = allocHeapOrHalt(sizeof(*trie));
+  int new;
+
+  memset(trie, 0, sizeof(*trie));
+  trie->magic = TRIE_MAGIC;
+#ifdef O_PLMT
+  simpleMutexInit(&trie->mutex);
+#endif
+  trie->symbol = lookupBlob((const char*)&trie, sizeof(trie), &trie_blob, &new);
+
+  return PL_unify_atom(A1, trie->symbol);
+}
+
+
+/** trie_destroy(+Trie) is det.
+
+Remove all entries from Trie.  Further operations on Trie raise an
+existence error.
+*/
+
+static
+PRED_IMPL("trie_destroy", 1, trie_destroy, 0)
+{ trie *trie;
+
+  if ( !get_trie(A1, &trie) )
+    return FALSE;
+
+  LOCK_TRIE(trie);
+  if ( trie->magic == TRIE_MAGIC )
+  { trie->magic = TRIE_CMAGIC;
+    clear_trie(trie);
+    PL_unregister_atom(trie->symbol);
+  }
+  UNLOCK_TRIE(trie);
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("is_trie", 1, is_trie, 0)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(A1, &data, NULL, &type) && type == &trie_blob )
+  { trie *trie = *(struct trie**)data;
+
+    return trie->magic == TRIE_MAGIC;
+  }
+
+  return FALSE;
+}
+
+
+static int
+trie_insert(term_t Trie, term_t Key, term_t Value, int update ARG_LD)
+{ trie *trie;
+  trie_node *node;
+  Record value;
+  int rc;
+
+  if ( !get_trie(Trie, &trie) )
+    return FALSE;
+  if ( !(value = compileTermToHeap(Value, 0)) )
+    return PL_no_memory();
+
+  LOCK_TRIE(trie);
+  if ( trie->magic != TRIE_MAGIC )
+  { UNLOCK_TRIE(trie);
+    freeRecord(value);
+    return PL_existence_error("trie", Trie);
+  }
+  if ( (rc=trie_lookup(trie, &node, valTermRef(Key), TRUE PASS_LD)) == TRUE )
+  { if ( node->value )
+    { if ( update )
+      { Record old = node->value;
+
+	node->value = value;
+	if ( trie->references > 0 )
+	  add_garbage(trie, NULL, old, NULL);
+	else
+	  freeRecord(old);
+      } else
+      { freeRecord(value);
+	rc = FALSE;
+      }
+    } else
+    { node->value = value;
+      trie->value_count++;
+    }
+  } else
+  { freeRecord(value);
+  }
+  UNLOCK_TRIE(trie);
+
+  return rc == TRUE ? TRUE : trie_error(rc, Key);
+}
+
+
+/** trie_insert(+Trie, +Key, +Value) is semidet.
+
+Insert Key with Value into Trie.  Fails if Trie already contains a
+variant of Key.
+*/
+
+static
+PRED_IMPL("trie_insert", 3, trie_insert, 0)
+{ PRED_LD
+
+  return trie_insert(A1, A2, A3, FALSE PASS_LD);
+}
+
+
+/** trie_update(+Trie, +Key, +Value) is det.
+
+As trie_insert/3, but replaces the value if Key is already in Trie.
+*/
+
+static
+PRED_IMPL("trie_update", 3, trie_update, 0)
+{ PRED_LD
+
+  return trie_insert(A1, A2, A3, TRUE PASS_LD);
+}
+
+
+/** trie_lookup(+Trie, +Key, -Value) is semidet.
+
+True if Trie contains a variant of Key with Value.
+*/
+
+static
+PRED_IMPL("trie_lookup", 3, trie_lookup, 0)
+{ PRED_LD
+  trie *trie;
+  trie_node *node;
+  Record value = NULL;
+  int rc;
+
+  if ( !get_trie(A1, &trie) )
+    return FALSE;
+
+  LOCK_TRIE(trie);
+  if ( (rc=trie_lookup(trie, &node, valTermRef(A2), FALSE PASS_LD)) == TRUE &&
+       (value=node->value) )
+    trie->references++;
+  UNLOCK_TRIE(trie);
+
+  if ( value )
+  { term_t tmp = PL_new_term_ref();
+
+    if ( tmp )
+    { if ( (rc=copyRecordToGlobal(tmp, value, ALLOW_GC PASS_LD)) < 0 )
+	rc = raiseStackOverflow(rc);
+      else
+	rc = PL_unify(A3, tmp);
+    } else
+      rc = FALSE;
+    release_trie_reader(trie);
+    return rc;
+  }
+
+  return rc == TRUE ? FALSE : trie_error(rc, A2);
+}
+
+
+/** trie_delete(+Trie, +Key, ?Value) is semidet.
+
+Remove Key from Trie if its value unifies with Value.
+*/
+
+static
+PRED_IMPL("trie_delete", 3, trie_delete, 0)
+{ PRED_LD
+  trie *trie;
+  trie_node *node;
+  Record value = NULL;
+  int rc;
+
+  if ( !get_trie(A1, &trie) )
+    return FALSE;
+
+  LOCK_TRIE(trie);
+  if ( (rc=trie_lookup(trie, &node, valTermRef(A2), FALSE PASS_LD)) == TRUE &&
+       (value=node->value) )
+    trie->references++;
+  UNLOCK_TRIE(trie);
+
+  if ( value )
+  { term_t tmp = PL_new_term_ref();
+
+    if ( tmp &&
+	 (rc=copyRecordToGlobal(tmp, value, ALLOW_GC PASS_LD)) < 0 )
+    { rc = raiseStackOverflow(rc);
+    } else if ( tmp && PL_unify(A3, tmp) )
+    { LOCK_TRIE(trie);
+      if ( node->value == value )	/* not deleted or updated meanwhile */
+      { discard_value(trie, node);
+	prune_node(trie, node);
+      } else
+	rc = FALSE;
+      UNLOCK_TRIE(trie);
+    } else
+      rc = FALSE;
+
+    release_trie_reader(trie);
+    return rc;
+  }
+
+  return rc == TRUE ? FALSE : trie_error(rc, A2);
+}
+
+
+		 /*******************************
+		 *	    ENUMERATION		*
+		 *******************************/
+
+typedef struct trie_choice
+{ TableEnum	table_enum;		/* Enumerating a Table of children */
+  trie_node    *child;			/* Current child */
+} trie_choice;
+
+typedef struct trie_gen_state
+{ trie	       *trie;			/* Trie we are enumerating */
+  tmp_buffer	choices;		/* Stack of trie_choice */
+} trie_gen_state;
+
+
+static void
+first_child(trie_choice *ch, trie_node *n)
+{ if ( n->children )
+  { Symbol s;
+
+    ch->table_enum = newTableEnum(n->children);
+    s = advanceTableEnum(ch->table_enum);
+    ch->child = s ? s->value : NULL;
+  } else
+  { ch->table_enum = NULL;
+    ch->child = n->child;
+  }
+}
+
+
+static void
+next_child(trie_choice *ch)
+{ if ( ch->table_enum )
+  { Symbol s = advanceTableEnum(ch->table_enum);
+
+    ch->child = s ? s->value : NULL;
+  } else
+  { ch->child = NULL;
+  }
+}
+
+
+static void
+pop_choice(trie_gen_state *state)
+{ trie_choice ch = popBuffer(&state->choices, trie_choice);
+
+  if ( ch.table_enum )
+    freeTableEnum(ch.table_enum);
+}
+
+
+/* Advance to the next node that ends a key.  Must be called with the trie
+   locked.  If advance is TRUE, first skip the current node.
+*/
+
+static trie_node *
+next_key(trie_gen_state *state, int advance)
+{ if ( state->trie->magic != TRIE_MAGIC )
+    return NULL;
+
+  while( !isEmptyBuffer(&state->choices) )
+  { trie_choice *ch = topBuffer(&state->choices, trie_choice)-1;
+    trie_node *n;
+
+    if ( advance )
+    { next_child(ch);
+      advance = FALSE;
+    }
+
+    if ( !(n=ch->child) )
+    { pop_choice(state);
+      advance = TRUE;
+    } else if ( n->value )
+    { return n;
+    } else if ( has_children(n) )
+    { trie_choice new;
+
+      first_child(&new, n);
+      addBuffer(&state->choices, new, trie_choice);
+    } else
+    { advance = TRUE;
+    }
+  }
+
+  return NULL;
+}
+
+
+static void
+free_gen_state(trie_gen_state *state)
+{ trie *trie = state->trie;
+
+  LOCK_TRIE(trie);
+  while( !isEmptyBuffer(&state->choices) )
+    pop_choice(state);
+  UNLOCK_TRIE(trie);
+  discardBuffer(&state->choices);
+  release_trie_reader(trie);
+  freeHeap(state, sizeof(*state));
+}
+
+
+/** trie_gen(+Trie, ?Key, -Value) is nondet.
+
+Enumerate the keys and values of Trie.
+*/
+
+static
+PRED_IMPL("trie_gen", 3, trie_gen, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  trie_gen_state *state;
+  trie_node *n;
+  fid_t fid;
+  int advance;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+    { trie *trie;
+      trie_choice ch;
+
+      if ( !get_trie(A1, &trie) )
+	return FALSE;
+      state = allocHeapOrHalt(sizeof(*state));
+      state->trie = trie;
+      initBuffer(&state->choices);
+      acquire_trie(trie);
+      LOCK_TRIE(trie);
+      first_child(&ch, &trie->root);
+      addBuffer(&state->choices, ch, trie_choice);
+      UNLOCK_TRIE(trie);
+      advance = FALSE;
+      break;
+    }
+    case FRG_REDO:
+      state = CTX_PTR;
+      advance = TRUE;
+      break;
+    case FRG_CUTTED:
+      state = CTX_PTR;
+      free_gen_state(state);
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  if ( !(fid = PL_open_foreign_frame()) )
+  { free_gen_state(state);
+    return FALSE;
+  }
+
+  for(;;)
+  { Record value = NULL;
+    term_t tmp;
+    int rc;
+
+    LOCK_TRIE(state->trie);
+    if ( (n = next_key(state, advance)) )
+      value = n->value;
+    UNLOCK_TRIE(state->trie);
+    advance = TRUE;
+
+    if ( !n )
+      break;
+
+    if ( unify_key(A2, n PASS_LD) &&
+	 (tmp = PL_new_term_ref()) )
+    { if ( (rc=copyRecordToGlobal(tmp, value, ALLOW_GC PASS_LD)) < 0 )
+      { raiseStackOverflow(rc);
+	break;
+      }
+      if ( PL_unify(A3, tmp) )
+      { PL_close_foreign_frame(fid);
+	ForeignRedoPtr(state);
+      }
+    }
+    if ( PL_exception(0) )
+      break;
+    PL_rewind_foreign_frame(fid);
+  }
+
+  PL_close_foreign_frame(fid);
+  free_gen_state(state);
+  return FALSE;
+}
+
+
+/** trie_property(+Trie, ?Property) is nondet.
+
+Properties are node_count(Count) and value_count(Count).
+*/
+
+static
+PRED_IMPL("$trie_property", 3, trie_property, 0)
+{ PRED_LD
+  trie *trie;
+
+  if ( !get_trie(A1, &trie) )
+    return FALSE;
+
+  return ( PL_unify_int64(A2, trie->node_count) &&
+	   PL_unify_int64(A3, trie->value_count) );
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(trie)
+  PRED_DEF("trie_new",	     1, trie_new,      0)
+  PRED_DEF("trie_destroy",   1, trie_destroy,  0)
+  PRED_DEF("is_trie",	     1, is_trie,       0)
+  PRED_DEF("trie_insert",    3, trie_insert,   0)
+  PRED_DEF("trie_update",    3, trie_update,   0)
+  PRED_DEF("trie_lookup",    3, trie_lookup,   0)
+  PRED_DEF("trie_delete",    3, trie_delete,   0)
+  PRED_DEF("trie_gen",	     3, trie_gen,      PL_FA_NONDETERMINISTIC)
+  PRED_DEF("$trie_property", 3, trie_property, 0)
+EndPredDefs
@@ -407,16 +407,19 @@ variant(argPairs *agenda, Buffer buf ARG_LD)
 }
 
 
-static
-PRED_IMPL("=@=", 2, variant, 0)
-{ PRED_LD
-  argPairs agenda;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+is_variant_ptr() is the C interface  to   =@=/2.  It  returns TRUE if the
+terms at p1 and p2 are variants, FALSE  if not and MEMORY_OVERFLOW if we
+ran out of memory.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+is_variant_ptr(Word p1, Word p2 ARG_LD)
+{ argPairs agenda;
   tmp_buffer buf;
   Buffer VARIANT_BUFFER = (Buffer)&buf;
-  bool rval;
+  int rval;
   node *r;
-  Word p1 = valTermRef(A1);
-  Word p2 = valTermRef(A2);
   node new = {NULL, 0, 0, 0};   /* dummy node as 0-th element*/
 
   deRef(p1);
@@ -478,6 +481,15 @@ again:
   if ( !endCritical )
     return FALSE;
 
+  return rval;
+}
+
+
+static
+PRED_IMPL("=@=", 2, variant, 0)
+{ PRED_LD
+  int rval = is_variant_ptr(valTermRef(A1), valTermRef(A2) PASS_LD);
+
   if ( rval >= 0 )
     return rval;
 
@@ -1683,7 +1683,7 @@ retry_continue:
       if ( exception_term )
       { CL = NULL;
 
-	enterDefinition(DEF);
+	enterFrameDefinition(FR, DEF);
 					/* The catch is not yet installed, */
 					/* so we ignore it */
 	if ( FR->predicate == PROCEDURE_catch3->definition )
@@ -1796,7 +1796,7 @@ VMI(I_DEPART, VIF_BREAK, 1, (CA1_PROC))
     }
 
     FR->clause = NULL;			/* for save atom-gc */
-    leaveDefinition(DEF);
+    leaveFrameDefinition(FR, DEF);
     DEF = proc->definition;
     if ( true(DEF, P_TRANSPARENT) )
     { FR->context = contextModule(FR);
@@ -1915,7 +1915,7 @@ VMI(I_EXIT, VIF_BREAK, 0, ())
   if ( (void *)BFR <= (void *)FR )	/* deterministic */
   { leave = true(FR, FR_WATCHED) ? FR : NULL;
     FR->clause = NULL;			/* leaveDefinition() destroys clause */
-    leaveDefinition(DEF);		/* dynamic pred only */
+    leaveFrameDefinition(FR, DEF);	/* dynamic pred only */
     lTop = FR;
     DEBUG(3, Sdprintf("Deterministic exit of %s, lTop = #%ld\n",
 		      predicateName(FR->predicate), loffset(lTop)));
@@ -2115,6 +2115,55 @@ VMI(C_JMP, 0, 1, (CA1_JUMP))
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+I_INLINED proc generation skip starts a call to proc that is inlined  by
+the compiler. It is followed by the  inlined  code,  a C_JMP around the
+normal call and the normal call itself. If proc has  been  changed since
+the clause was compiled  or  we  are  debugging,  we  skip  the inlined
+code. See inlineCalls() in pl-comp.c.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(I_INLINED, 0, 3, (CA1_PROC, CA1_INTEGER, CA1_JUMP))
+{ Procedure proc = (Procedure)*PC++;
+  unsigned int gen = (unsigned int)*PC++;
+  size_t skip = *PC++;
+
+  if ( proc->definition->inline_generation != gen ||
+       debugstatus.debugging )
+    PC += skip;
+
+  NEXT_INSTRUCTION;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+I_GUARD generation literal1 literal2 ends the guard of a clause. If the
+supervisor found the guard to exclude all  remaining  clauses  (see
+markGuardCommits() in pl-supervisor.c), the generation  matches that of
+the predicate and we cut the clause choicepoint.  If head unification
+or the guard bound variables of the call, the arguments that decided the
+commit must not be affected as the remaining clauses  would  see  a
+different goal otherwise (see guardArgsUnbound()).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(I_GUARD, 0, 3, (CA1_INTEGER, CA1_INTEGER, CA1_INTEGER))
+{ unsigned int gen = (unsigned int)PC[0];
+  Code lits = PC+1;
+
+  PC += 3;
+  if ( gen != 0 &&
+       gen == FR->predicate->inline_generation &&
+       BFR->frame == FR &&
+       BFR->type == CHP_CLAUSE &&
+       !debugstatus.debugging &&
+       ( BFR->mark.trailtop == tTop ||
+	 guardArgsUnbound(FR, BFR, lits PASS_LD) ) )
+    VMI_GOTO(I_CUT);
+
+  NEXT_INSTRUCTION;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 C_OR: Create choice-point in the clause.  Argument is the amount to skip
 if the choice-point needs to be activated.
@@ -2597,7 +2646,7 @@ VMI(S_UNDEF, 0, 0, ())
       }
       LOAD_REGISTERS(qid);
 
-      enterDefinition(DEF);		/* will be left in exception code */
+      enterFrameDefinition(FR, DEF);	/* will be left in exception code */
 
       THROW_EXCEPTION;
     }
@@ -2679,6 +2728,46 @@ VMI(S_STATIC, 0, 0, ())
 }
 
 
+#ifdef O_FROZEN_INDEX
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+S_FROZEN: Static predicate with  frozen   indexes  (see freeze_indexes/1).
+Selects the clauses  using  the   first  frozen  index  whose argument is
+instantiated. Otherwise continue as S_STATIC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+VMI(S_FROZEN, 0, 0, ())
+{ ClauseRef cl;
+  struct clause_choice chp;
+
+  ARGP = argFrameP(FR, 0);
+  lTop = (LocalFrame)ARGP+DEF->functor->arity;
+
+  if ( !(cl = firstFrozenClause(ARGP, FR, DEF, &chp PASS_LD)) )
+  { if ( !chp.key )
+      VMI_GOTO(S_STATIC);
+
+    if ( debugstatus.debugging )
+      newChoice(CHP_DEBUG, FR PASS_LD);
+    FRAME_FAILED;
+  }
+
+  PC = cl->value.clause->codes;
+  lTop = (LocalFrame)(ARGP + cl->value.clause->variables);
+  ENSURE_LOCAL_SPACE(LOCAL_MARGIN, THROW_EXCEPTION);
+  CL = cl;
+
+  if ( chp.cref )
+  { Choice ch = newChoice(CHP_CLAUSE, FR PASS_LD);
+    ch->value.clause = chp;
+  } else if ( debugstatus.debugging )
+    newChoice(CHP_DEBUG, FR PASS_LD);
+
+  umode = uread;
+  NEXT_INSTRUCTION;
+}
+#endif
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 S_DYNAMIC: Dynamic predicate. Dynamic predicates   must  use the dynamic
 indexing and need to lock the predicate. This VMI can also handle static
@@ -2686,7 +2775,7 @@ code.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 VMI(S_DYNAMIC, 0, 0, ())
-{ enterDefinition(DEF);
+{ enterFrameDefinition(FR, DEF);
 
   VMI_GOTO(S_STATIC);
 }
@@ -3127,15 +3216,339 @@ END_SHAREDVARS
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 A_ADD: Shorthand for A_FUNC2 pl_ar_add()
+A_MUL: Shorthand for A_FUNC2 ar_mul()
+
+A_FADD, A_FSUB, A_FMUL and A_FDIV implement +, -, * and / if the compiler
+found that at least one of the operands   is  a float expression (see
+isFloatArith() in pl-comp.c).
+
+If the operands on the stack are floats, or one is a float and the other
+a 64-bit integer, the float result is  computed  in  place on the stack
+without calling the generic functions. A_ADD, A_SUB and A_MUL do the
+same if both operands are floats. All other   cases,  as well as results
+that are not finite, are handed  to  the   generic  function,  which also
+raises the appropriate errors.
+
+A_ADD, A_SUB, A_MUL, A_IDIV (//), A_MOD, A_MIN, A_MAX, A_SHR (>>), A_SHL
+(<<), A_AND (/\), A_OR (\/) and A_XOR compute  the result in place if
+both operands are 64-bit integers and the result cannot overflow. The
+A_*_C variants take the right operand from the  instruction  rather than
+from the stack. If the fast path does not apply they push the constant
+and call the generic function.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#ifndef isfinite
+#define isfinite(f) ((f) - (f) == 0.0)	/* false for inf and nan */
+#endif
+
+BEGIN_SHAREDVARS
+  Number fn1;
+  double f1, f2, fr;
+  int64_t i1, i2, ir;
+  int (*ar_f)(Number n1, Number n2, Number r);
+
+#define FLOAT_ARGS() \
+  fn1 = argvArithStack(2 PASS_LD); \
+  if ( fn1[0].type == V_FLOAT ) \
+  { f1 = fn1[0].value.f; \
+    if ( fn1[1].type == V_FLOAT ) \
+      f2 = fn1[1].value.f; \
+    else if ( fn1[1].type == V_INTEGER ) \
+      f2 = (double)fn1[1].value.i; \
+    else \
+      goto a_binary_slow; \
+  } else if ( fn1[0].type == V_INTEGER && fn1[1].type == V_FLOAT ) \
+  { f1 = (double)fn1[0].value.i; \
+    f2 = fn1[1].value.f; \
+  } else \
+    goto a_binary_slow;
+
+#define FLOAT_FLOAT_ARGS() \
+  (fn1 = argvArithStack(2 PASS_LD), \
+   fn1[0].type == V_FLOAT && fn1[1].type == V_FLOAT)
+
+#define INT_ARGS() \
+  fn1 = argvArithStack(2 PASS_LD); \
+  if ( fn1[0].type != V_INTEGER || fn1[1].type != V_INTEGER ) \
+    goto a_binary_slow; \
+  i1 = fn1[0].value.i; \
+  i2 = fn1[1].value.i;
+
+#define INT_CONST_ARG() \
+  i2 = (intptr_t)*PC++; \
+  fn1 = argvArithStack(1 PASS_LD); \
+  if ( fn1[0].type != V_INTEGER ) \
+    goto a_int_c_slow; \
+  i1 = fn1[0].value.i;
+
+					/* overflow of ir = i1+i2, i1-i2 */
+#define ADD_OVERFLOWS() (((i1^ir) & (i2^ir)) < 0)
+#define SUB_OVERFLOWS() (((i1^i2) & (i1^ir)) < 0)
+					/* |i1| and |i2| < 2^31 */
+#define MUL_IS_SAFE() \
+  ( (uint64_t)(i1 + ((int64_t)1<<31)) < ((uint64_t)1<<32) && \
+    (uint64_t)(i2 + ((int64_t)1<<31)) < ((uint64_t)1<<32) )
+
 VMI(A_ADD, 0, 0, ())
-{ Number argv = argvArithStack(2 PASS_LD);
-  int rc;
+{ ar_f = pl_ar_add;
+  if ( FLOAT_FLOAT_ARGS() )
+  { fr = fn1[0].value.f + fn1[1].value.f;
+    goto a_float_out;
+  }
+  INT_ARGS();
+  ir = (int64_t)((uint64_t)i1 + (uint64_t)i2);
+  if ( ADD_OVERFLOWS() )
+    goto a_binary_slow;
+  goto a_int_out;
+}
+
+VMI(A_SUB, 0, 0, ())
+{ ar_f = ar_minus;
+  if ( FLOAT_FLOAT_ARGS() )
+  { fr = fn1[0].value.f - fn1[1].value.f;
+    goto a_float_out;
+  }
+  INT_ARGS();
+  ir = (int64_t)((uint64_t)i1 - (uint64_t)i2);
+  if ( SUB_OVERFLOWS() )
+    goto a_binary_slow;
+  goto a_int_out;
+}
+
+VMI(A_MUL, 0, 0, ())
+{ ar_f = ar_mul;
+  if ( FLOAT_FLOAT_ARGS() )
+  { fr = fn1[0].value.f * fn1[1].value.f;
+    goto a_float_out;
+  }
+  INT_ARGS();
+  if ( !MUL_IS_SAFE() )
+    goto a_binary_slow;
+  ir = i1 * i2;
+  goto a_int_out;
+}
+
+VMI(A_IDIV, 0, 0, ())
+{ ar_f = ar_tdiv;
+  INT_ARGS();
+  if ( i2 == 0 || (i2 == -1 && i1 == PLMININT) )
+    goto a_binary_slow;
+  ir = i1 / i2;
+  goto a_int_out;
+}
+
+VMI(A_MOD, 0, 0, ())
+{ ar_f = ar_mod;
+  INT_ARGS();
+  if ( i2 == 0 || i2 == -1 )
+    goto a_binary_slow;
+  ir = i1 % i2;
+  if ( ir != 0 && (ir<0) != (i2<0) )
+    ir += i2;
+  goto a_int_out;
+}
+
+VMI(A_MIN, 0, 0, ())
+{ ar_f = ar_min;
+  INT_ARGS();
+  ir = (i1 <= i2 ? i1 : i2);
+  goto a_int_out;
+}
+
+VMI(A_MAX, 0, 0, ())
+{ ar_f = ar_max;
+  INT_ARGS();
+  ir = (i1 >= i2 ? i1 : i2);
+  goto a_int_out;
+}
+
+VMI(A_SHR, 0, 0, ())
+{ ar_f = ar_shift_right;
+  INT_ARGS();
+  if ( (uint64_t)i2 >= 64 )
+    goto a_binary_slow;
+  ir = i1 >> i2;
+  goto a_int_out;
+}
+
+VMI(A_SHL, 0, 0, ())
+{ ar_f = ar_shift_left;
+  INT_ARGS();
+  if ( (uint64_t)i2 >= 63 )
+    goto a_binary_slow;
+  ir = (int64_t)((uint64_t)i1 << i2);
+  if ( (ir >> i2) != i1 )
+    goto a_binary_slow;
+  goto a_int_out;
+}
+
+VMI(A_AND, 0, 0, ())
+{ ar_f = ar_conjunct;
+  INT_ARGS();
+  ir = i1 & i2;
+  goto a_int_out;
+}
+
+VMI(A_OR, 0, 0, ())
+{ ar_f = ar_disjunct;
+  INT_ARGS();
+  ir = i1 | i2;
+  goto a_int_out;
+}
+
+VMI(A_XOR, 0, 0, ())
+{ ar_f = ar_xor;
+  INT_ARGS();
+  ir = i1 ^ i2;
+  goto a_int_out;
+}
+
+VMI(A_ADD_C, 0, 1, (CA1_INTEGER))
+{ ar_f = pl_ar_add;
+  INT_CONST_ARG();
+  ir = (int64_t)((uint64_t)i1 + (uint64_t)i2);
+  if ( ADD_OVERFLOWS() )
+    goto a_int_c_slow;
+  goto a_int_c_out;
+}
+
+VMI(A_SUB_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_minus;
+  INT_CONST_ARG();
+  ir = (int64_t)((uint64_t)i1 - (uint64_t)i2);
+  if ( SUB_OVERFLOWS() )
+    goto a_int_c_slow;
+  goto a_int_c_out;
+}
+
+VMI(A_MUL_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_mul;
+  INT_CONST_ARG();
+  if ( !MUL_IS_SAFE() )
+    goto a_int_c_slow;
+  ir = i1 * i2;
+  goto a_int_c_out;
+}
+
+VMI(A_IDIV_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_tdiv;
+  INT_CONST_ARG();
+  if ( i2 == 0 || (i2 == -1 && i1 == PLMININT) )
+    goto a_int_c_slow;
+  ir = i1 / i2;
+  goto a_int_c_out;
+}
+
+VMI(A_MOD_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_mod;
+  INT_CONST_ARG();
+  if ( i2 == 0 || i2 == -1 )
+    goto a_int_c_slow;
+  ir = i1 % i2;
+  if ( ir != 0 && (ir<0) != (i2<0) )
+    ir += i2;
+  goto a_int_c_out;
+}
+
+VMI(A_SHR_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_shift_right;
+  INT_CONST_ARG();
+  if ( (uint64_t)i2 >= 64 )
+    goto a_int_c_slow;
+  ir = i1 >> i2;
+  goto a_int_c_out;
+}
+
+VMI(A_SHL_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_shift_left;
+  INT_CONST_ARG();
+  if ( (uint64_t)i2 >= 63 )
+    goto a_int_c_slow;
+  ir = (int64_t)((uint64_t)i1 << i2);
+  if ( (ir >> i2) != i1 )
+    goto a_int_c_slow;
+  goto a_int_c_out;
+}
+
+VMI(A_AND_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_conjunct;
+  INT_CONST_ARG();
+  ir = i1 & i2;
+  goto a_int_c_out;
+}
+
+VMI(A_OR_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_disjunct;
+  INT_CONST_ARG();
+  ir = i1 | i2;
+  goto a_int_c_out;
+}
+
+VMI(A_XOR_C, 0, 1, (CA1_INTEGER))
+{ ar_f = ar_xor;
+  INT_CONST_ARG();
+  ir = i1 ^ i2;
+  goto a_int_c_out;
+}
+
+VMI(A_FADD, 0, 0, ())
+{ ar_f = pl_ar_add;
+  FLOAT_ARGS();
+  fr = f1 + f2;
+  goto a_float_out;
+}
+
+VMI(A_FSUB, 0, 0, ())
+{ ar_f = ar_minus;
+  FLOAT_ARGS();
+  fr = f1 - f2;
+  goto a_float_out;
+}
+
+VMI(A_FMUL, 0, 0, ())
+{ ar_f = ar_mul;
+  FLOAT_ARGS();
+  fr = f1 * f2;
+  goto a_float_out;
+}
+
+VMI(A_FDIV, 0, 0, ())
+{ int rc;
   number r;
 
+  ar_f = ar_divide;
+  FLOAT_ARGS();
+  if ( f2 == 0.0 )
+    goto a_binary_slow;
+  fr = f1 / f2;
+
+a_float_out:
+  if ( isfinite(fr) )
+  { fn1[0].value.f = fr;
+    fn1[0].type    = V_FLOAT;
+    popArgvArithStack(1 PASS_LD);
+    NEXT_INSTRUCTION;
+  }
+  goto a_binary_slow;
+
+a_int_out:
+  fn1[0].value.i = ir;
+  popArgvArithStack(1 PASS_LD);
+  NEXT_INSTRUCTION;
+
+a_int_c_out:
+  fn1[0].value.i = ir;
+  NEXT_INSTRUCTION;
+
+a_int_c_slow:
+  fn1 = allocArithStack(PASS_LD1);
+  fn1->value.i = i2;
+  fn1->type    = V_INTEGER;
+
+a_binary_slow:
+  fn1 = argvArithStack(2 PASS_LD);
   SAVE_REGISTERS(qid);
-  rc = pl_ar_add(argv, argv+1, &r);
+  rc = (*ar_f)(fn1, fn1+1, &r);
   LOAD_REGISTERS(qid);
   popArgvArithStack(2 PASS_LD);
   if ( rc )
@@ -3146,21 +3559,28 @@ VMI(A_ADD, 0, 0, ())
   resetArithStack(PASS_LD1);
   THROW_EXCEPTION;
 }
+END_SHAREDVARS
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-A_MUL: Shorthand for A_FUNC2 ar_mul()
+A_ABS: Shorthand for A_FUNC1 ar_abs()
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-VMI(A_MUL, 0, 0, ())
-{ Number argv = argvArithStack(2 PASS_LD);
-  int rc;
+VMI(A_ABS, 0, 0, ())
+{ Number n = argvArithStack(1 PASS_LD);
   number r;
+  int rc;
+
+  if ( n->type == V_INTEGER && n->value.i != PLMININT )
+  { if ( n->value.i < 0 )
+      n->value.i = -n->value.i;
+    NEXT_INSTRUCTION;
+  }
 
   SAVE_REGISTERS(qid);
-  rc = ar_mul(argv, argv+1, &r);
+  rc = ar_abs(n, &r);
   LOAD_REGISTERS(qid);
-  popArgvArithStack(2 PASS_LD);
+  popArgvArithStack(1 PASS_LD);
   if ( rc )
   { pushArithStack(&r PASS_LD);
     NEXT_INSTRUCTION;
@@ -3275,7 +3695,9 @@ VMI(A_ADD_FC, VIF_BREAK, 3, (CA1_FVAR, CA1_VAR, CA1_INTEGER))
 Translation of the arithmic comparison predicates (<, >, =<,  >=,  =:=).
 Both sides are pushed on the stack, so we just compare the two values on
 the  top  of  this  stack  and  backtrack  if  they  do  not suffice the
-condition.  Example translation: `a(Y) :- b(X), X > Y'
+condition. CMP_FAST() handles two  numbers  of   the  same  type  and
+comparing a float to a 64-bit integer,  for  which  cmpNumbers()  also
+converts the integer to a double.  Example translation: `a(Y) :- b(X), X > Y'
 
 	I_ENTER
 	B_FIRSTVAR 1	% Link X from B's frame to a new var in A's frame
@@ -3306,6 +3728,12 @@ BEGIN_SHAREDVARS
       default: \
         ; \
     } \
+  } else if ( n1->type == V_FLOAT && n2->type == V_INTEGER ) \
+  { rc = n1->value.f op (double)n2->value.i; \
+    goto a_cmp_out; \
+  } else if ( n1->type == V_INTEGER && n2->type == V_FLOAT ) \
+  { rc = (double)n1->value.i op n2->value.f; \
+    goto a_cmp_out; \
   }
 
 
@@ -4376,6 +4804,7 @@ BEGIN_SHAREDVARS
   functor_t functor;
   int arity;
   Word args;
+  Code cache;				/* call cache of I_USERCALLN */
 
 #ifdef O_CALL_AT_MODULE
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -4476,6 +4905,7 @@ VMI(I_USERCALL0, VIF_BREAK, 0, ())
   Word a;
 
   module = NULL;
+  cache = NULL;
   NFR = lTop;
   a = argFrameP(NFR, 0);		/* get the goal */
   if ( !(a = stripModule(a, &module PASS_LD)) )
@@ -4565,7 +4995,7 @@ atom is referenced by the goal-term anyway.
 #endif
       PC = cl->codes;
 
-      enterDefinition(DEF);
+      enterFrameDefinition(NFR, DEF);
       environment_frame = FR = NFR;
       ARGP = argFrameP(lTop, 0);
 
@@ -4585,25 +5015,31 @@ atom is referenced by the goal-term anyway.
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-I_USERCALLN: translation of call(Goal, Arg1, ...)
+I_USERCALLN: translation of call(Goal, Arg1, ...). The second  argument
+caches the definition of the previous call (see callCacheDefinition()).
+The extra arguments are  already  in  the  frame,  so  the  goal term is
+never built.  If the definition is known, we set functor to 0. Otherwise
+the procedure is resolved and cached after checking the arity.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-VMI(I_USERCALLN, VIF_BREAK, 1, (CA1_INTEGER))
+VMI(I_USERCALLN, VIF_BREAK, 2, (CA1_INTEGER, CA1_INTEGER))
 { Word a;
   int callargs = (int)*PC++;
   word goal;
+  atom_t name;
 
   NFR = lTop;
   a = argFrameP(NFR, 0);		/* get the (now) instantiated */
   deRef(a);			/* variable */
 
   module = NULL;
+  cache = PC++;
   if ( !(a = stripModule(a, &module PASS_LD)) )
     THROW_EXCEPTION;
 
   if ( isTextAtom(goal = *a) )
   { arity   = 0;
-    functor = lookupFunctorDef(goal, callargs);
+    name    = goal;
     args    = NULL;
   } else if ( isTerm(goal) )
   { FunctorDef fdef = valueFunctor(functorTerm(goal));
@@ -4611,12 +5047,20 @@ VMI(I_USERCALLN, VIF_BREAK, 1, (CA1_INTEGER))
     if ( !isTextAtom(fdef->name) )
       goto call_type_error;
     arity   = fdef->arity;
-    functor = lookupFunctorDef(fdef->name, arity + callargs);
+    name    = fdef->name;
     args    = argTermP(goal, 0);
   } else
   { goto call_type_error;
   }
 
+#ifdef O_CALL_CACHE
+  if ( (DEF = callCacheDefinition(cache, name, arity+callargs, module)) )
+  { functor = 0;
+  } else
+#endif
+  { functor = lookupFunctorDef(name, arity + callargs);
+  }
+
   if ( arity != 1 )
   { int i, shift = arity - 1;
 
@@ -4678,7 +5122,13 @@ to be called to get the context module   right. We must build a complete
 environment before we can call trapUndefined() to make shift/GC happy.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  DEF = resolveProcedure(functor, module)->definition;
+  if ( functor )				/* not resolved by I_USERCALLN */
+  { DEF = resolveProcedure(functor, module)->definition;
+#ifdef O_CALL_CACHE
+    if ( cache )
+      updateCallCache(cache, DEF, module);
+#endif
+  }
 
 mcall_cont:
   setNextFrameFlags(NFR, FR);
@@ -40,115 +40,17 @@
 
 static Choice	newChoice(choice_type type, LocalFrame fr ARG_LD);
 
-#if COUNTING
-
+#ifdef O_VMI_STATISTICS
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-The counting code has been added   while investigating the time critical
-WAM  instructions.  The  current  implementation  runs  on  top  of  the
-information  provided  by  code_info   (from    pl-comp.c)   and  should
-automatically addapt to modifications in the VM instruction set.
+Count the executed VM instructions if vmi_profiler/2 is active. The test
+is the only overhead when inactive. The counters are in pl-prof.c.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-typedef struct
-{ code  code;
-  int	times;
-  int  *vartimesptr;
-} count_info;
-
-#define MAXVAR 8
-
-static count_info counting[I_HIGHEST];
-
-static void
-count(code c, Code PC)
-{ const code_info *info = &codeTable[c];
-
-  counting[c].times++;
-  switch(info->argtype)
-  { case CA1_VAR:
-    case CA1_FVAR:
-    case CA1_CHP:
-    { int v = (int)*PC;
-
-      v -= ARGOFFSET/sizeof(word);
-      assert(v>=0);
-      if ( v >= MAXVAR )
-	v = MAXVAR-1;
-
-      if ( !counting[c].vartimesptr )
-      { int bytes = sizeof(int)*MAXVAR;
-
-	counting[c].vartimesptr = allocHeapOrHalt(bytes);
-	memset(counting[c].vartimesptr, 0, bytes);
-      }
-      counting[c].vartimesptr[v]++;
-    }
-  }
-}
-
-
-static void
-countHeader()
-{ int m;
-  int amax = MAXVAR;
-  char last[20];
-
-  Sfprintf(Scurout, "%-13s %8s ", "Instruction", "times");
-  for(m=0; m < amax-1; m++)
-    Sfprintf(Scurout, " %8d", m);
-  Ssprintf(last, ">%d", m);
-  Sfprintf(Scurout, " %8s\n", last);
-  for(m=0; m<(31+amax*8); m++)
-    Sputc('=', Scurout);
-  Sfprintf(Scurout, "\n");
-}
-
-
-static int
-cmpcounts(const void *p1, const void *p2)
-{ const count_info *c1 = p1;
-  const count_info *c2 = p2;
-
-  return c2->times - c1->times;
-}
-
-
-word
-pl_count()
-{ int i;
-  count_info counts[I_HIGHEST];
-  count_info *c;
-
-  countHeader();
-
-  memcpy(counts, counting, sizeof(counts));
-  for(i=0, c=counts; i<I_HIGHEST; i++, c++)
-    c->code = i;
-  qsort(counts, I_HIGHEST, sizeof(count_info), cmpcounts);
-
-  for(c = counts, i=0; i<I_HIGHEST; i++, c++)
-  { const code_info *info = &codeTable[c->code];
-
-    Sfprintf(Scurout, "%-13s %8d ", info->name, c->times);
-    if ( c->vartimesptr )
-    { int n, m=MAXVAR;
-
-      while(m>0 && c->vartimesptr[m-1] == 0 )
-	m--;
-      for(n=0; n<m; n++)
-	Sfprintf(Scurout, " %8d", c->vartimesptr[n]);
-    }
-    Sfprintf(Scurout, "\n");
-  }
-
-  succeed;
-}
-
-#else /* ~COUNTING */
-
+#define count(id, pc)	if ( unlikely(GD->vmi_stat.active) ) \
+			  countVMI(id, FR PASS_LD)
+#else
 #define count(id, pc)			/* no debugging not counting */
-
-#endif /* COUNTING */
+#endif /*O_VMI_STATISTICS*/
 
 		 /*******************************
 		 *	     DEBUGGING		*
@@ -532,6 +434,7 @@ discardForeignFrame(LocalFrame fr ARG_LD)
   context.context = (word)fr->clause;
   context.control = FRG_CUTTED;
   context.engine  = LD;
+  fr->clause = NULL;			/* see markPredicatesInEnvironments() */
 
   fid = PL_open_foreign_frame();
   if ( true(def, P_VARARG) )
@@ -1252,6 +1155,8 @@ __do_undo(mark *m ARG_LD)
   { reclaim_attvars(m->globaltop PASS_LD);
     gTop = m->globaltop;
   }
+  if ( gTop < LD->gen_bar )		/* backtracked into old generation */
+    LD->gen_bar = gTop;
 }
 
 
@@ -1956,11 +1861,11 @@ choice_type last_choice;
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static void
-leaveFrame(LocalFrame fr)
+leaveFrame(LocalFrame fr ARG_LD)
 { Definition def = fr->predicate;
 
   fr->clause = NULL;
-  leaveDefinition(def);
+  leaveFrameDefinition(fr, def);
 }
 
 
@@ -1974,12 +1879,10 @@ discardFrame(LocalFrame fr ARG_LD)
 
   if ( true(def, P_FOREIGN) )
   { if ( fr->clause )
-    { discardForeignFrame(fr PASS_LD);
-      fr->clause = NULL;
-    }
+      discardForeignFrame(fr PASS_LD);
   } else
   { fr->clause = NULL;		/* leaveDefinition() may destroy clauses */
-    leaveDefinition(def);
+    leaveFrameDefinition(fr, def);
   }
 }
 
@@ -2166,6 +2069,93 @@ newChoice(choice_type type, LocalFrame fr ARG_LD)
 }
 
 
+#ifdef O_DET_GUARDS
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+guardArgsUnbound() is used by  I_GUARD  if  head  unification  or  the
+guard bound variables since the clause  choicepoint  was  created.  The
+cut is still safe if the head arguments of the literals that decided the
+commit (GL_USED) are atomic and were  atomic  before,  i.e.,  their
+reference chain does not pass a binding that is on the trail.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+guardArgUnbound(Word p, Choice ch ARG_LD)
+{ for(;;)
+  { TrailEntry te;
+
+    for(te = ch->mark.trailtop; te < tTop; te++)
+    { if ( isTrailVal(te->address) || te->address == p )
+	return FALSE;
+    }
+    if ( !isRef(*p) )
+      return !canBind(*p) && !isTerm(*p);
+    p = unRef(*p);
+  }
+}
+
+
+static int
+guardArgsUnbound(LocalFrame fr, Choice ch, Code lits ARG_LD)
+{ int i;
+
+  for(i=0; i<2; i++)
+  { code l = lits[i];
+
+    if ( (l&GL_USED) )
+    { int a1 = GL_ARG1(l);
+      int a2 = GL_ARG2(l);
+
+      if ( (a1&GL_ISARG) &&
+	   !guardArgUnbound(argFrameP(fr, a1&~GL_ISARG), ch PASS_LD) )
+	return FALSE;
+      if ( GL_OP(l) > GL_IS_LIST && (a2&GL_ISARG) &&
+	   !guardArgUnbound(argFrameP(fr, a2&~GL_ISARG), ch PASS_LD) )
+	return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+#endif /*O_DET_GUARDS*/
+
+
+#ifdef O_CALL_CACHE
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The second argument of I_USERCALLN caches  the  definition  found  for
+the closure at the previous call. As the instruction may be executed by
+multiple threads, the cache is a single word  that  is  validated  by
+comparing the name, arity and module  of  the  definition  against the
+current call. We only cache definitions that  are  defined  in  the
+context module itself because resolveProcedure() finds these before
+looking into the import modules. Definitions of temporary modules are
+not cached as these are reclaimed with the module.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline Definition
+callCacheDefinition(Code cache, atom_t name, int arity, Module module)
+{ Definition def = (Definition)*cache;
+
+  if ( def &&
+       def->module == module &&
+       def->functor->name == name &&
+       def->functor->arity == arity &&
+       ( true(def, PROC_DEFINED) || hasClausesDefinition(def) ) )
+    return def;
+
+  return NULL;
+}
+
+
+static inline void
+updateCallCache(Code cache, Definition def, Module module)
+{ if ( def->module == module &&
+       module->class != ATOM_temporary &&
+       ( true(def, PROC_DEFINED) || hasClausesDefinition(def) ) )
+    *cache = (code)def;
+}
+#endif /*O_CALL_CACHE*/
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Op top of the query frame there are two   local frames. The top one is a
 dummy one, just enough to satisfy stack-walking   and GC. The first real
@@ -2599,6 +2589,16 @@ code thiscode;
 
 #endif /* VMCODE_IS_ADDRESS */
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SUPER_NEXT() ends the first part  of  a superinstruction (see mkvmi.c).
+PC points at the opcode of the next instruction,  which we know and thus
+can skip without dispatching on it.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SUPER_NEXT(n)		do { PC++; \
+				     VMI_GOTO(n); \
+				   } while(0)
+
 #if VMCODE_IS_ADDRESS
   if ( qid == QID_EXPORT_WAM_TABLE )
   { interpreter_jmp_table = jmp_table;	/* make it globally known */
@@ -2692,6 +2692,7 @@ resumebreak:
 #endif
   {
 #include "pl-vmi.c"
+#include "pl-vmi-super.ic"
   }
 
 #ifdef O_ATTVAR
@@ -2899,7 +2900,7 @@ next_choice:
     }
 #endif
 
-    leaveFrame(FR);
+    leaveFrame(FR PASS_LD);
     if ( true(FR, FR_WATCHED) )
     { environment_frame = FR;
       lTop = (LocalFrame)argFrameP(FR, FR->predicate->functor->arity);
@@ -1130,7 +1130,7 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	  const char *ats;
 	  int n = 0;
 
-	  if ( op >= I_HIGHEST )
+	  if ( op >= I_SUPER_FIRST )	/* superinstructions are never saved */
 	    fatalError("Illegal op-code (%d) at %ld", op, Stell(fd));
 
 	  ats = codeTable[op].argtype;
@@ -1246,6 +1246,12 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 			   ats[n], n, codeTable[op].name);
 	    }
 	  }
+	  if ( op == I_INLINED )	/* generations are not saved */
+	    bp[-2] = (code)0;
+	  else if ( op == I_GUARD )
+	    bp[-3] = (code)0;
+	  else if ( op == I_USERCALLN )	/* nor is the call cache */
+	    bp[-1] = (code)0;
 	}
 
 	if ( skip )
@@ -1257,6 +1263,7 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	      exit(1);
 	    }
 	  }
+	  fuseClause(clause);
 	  assertProcedure(proc, clause, CL_END PASS_LD);
 	}
       }
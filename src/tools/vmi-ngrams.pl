@@ -0,0 +1,110 @@
+#!/usr/bin/swipl -q -g main -t halt -s
+
+/** <module> Count VM instruction n-grams
+
+This program loads a workload and counts  the sequences of adjacent VM
+instructions in the clauses of all loaded  predicates. The result is
+printed in the format of the file SUPERVMI,   which  is used by mkvmi to
+generate superinstructions. Usage:
+
+    swipl -q -g main -t halt -s tools/vmi-ngrams.pl -- [-n N] [-top K] [-O] file ...
+
+Only sequences that may be fused are counted:  all but the last
+instruction must be head, body or arithmetic instructions (h_*, b_*,
+a_*), i_enter, c_or or c_ifthenelse, which  fall through to the next
+instruction. mkvmi performs the final  check   on  the  implementation.
+Counts are static: each clause is counted  once.   Use  -O to compile
+arithmetic.
+*/
+
+main :-
+	current_prolog_flag(argv, Argv),
+	options(Argv, N, Top, Files),
+	maplist(load_workload, Files),
+	count_ngrams(N, Counts),
+	report(Counts, Top).
+
+options(['-n', NA|T], N, Top, Files) :- !,
+	atom_number(NA, N),
+	options(T, N, Top, Files).
+options(['-top', KA|T], N, Top, Files) :- !,
+	atom_number(KA, Top),
+	options(T, N, Top, Files).
+options(['-O'|T], N, Top, Files) :- !,
+	set_prolog_flag(optimise, true),
+	options(T, N, Top, Files).
+options(Files, N, Top, Files) :-
+	(   var(N) -> N = 2 ; true ),
+	(   var(Top) -> Top = 20 ; true ).
+
+load_workload(File) :-
+	load_files(user:File, [silent(true)]).
+
+%	count_ngrams(+N, -Counts) is det.
+%
+%	Counts is a list Count-Gram for all N-grams in the loaded clauses.
+
+count_ngrams(N, Counts) :-
+	findall(Gram,
+		( predicate(Head),
+		  nth_clause(Head, _, Clause),
+		  clause_vmis(Clause, VMIs),
+		  ngram(N, VMIs, Gram)
+		), Grams),
+	msort(Grams, Sorted),
+	count_runs(Sorted, Counts).
+
+predicate(M:Head) :-
+	current_predicate(_, M:Head),
+	\+ predicate_property(M:Head, imported_from(_)),
+	\+ predicate_property(M:Head, foreign).
+
+clause_vmis(Clause, VMIs) :-
+	catch(clause_vmis(Clause, 0, VMIs), _, fail).
+
+clause_vmis(Clause, PC, [Name|T]) :-
+	'$fetch_vm'(Clause, PC, NextPC, VMI), !,
+	functor(VMI, Name, _),
+	clause_vmis(Clause, NextPC, T).
+clause_vmis(_, _, []).
+
+ngram(N, VMIs, Gram) :-
+	length(Gram, N),
+	append(_, Tail, VMIs),
+	append(Gram, _, Tail),
+	fusable(Gram).
+
+count_runs([], []).
+count_runs([H|T0], [C-H|T]) :-
+	same(T0, H, 1, C, T1),
+	count_runs(T1, T).
+
+same([H|T0], H, C0, C, T) :- !,
+	C1 is C0+1,
+	same(T0, H, C1, C, T).
+same(T, _, C, C, T).
+
+fusable([_]) :- !.
+fusable([H|T]) :-
+	falls_through(H),
+	fusable(T).
+
+falls_through(c_or) :- !.
+falls_through(c_ifthenelse) :- !.
+falls_through(i_enter) :- !.
+falls_through(Name) :-
+	sub_atom(Name, 0, 2, _, Prefix),
+	memberchk(Prefix, [h_, b_, a_]).
+
+report(Counts, Top) :-
+	keysort(Counts, Sorted),
+	reverse(Sorted, ByCount),
+	length(ByCount, Len),
+	Max is min(Top, Len),
+	length(Best, Max),
+	append(Best, _, ByCount),
+	forall(member(C-Gram, Best),
+	       ( maplist(upcase_atom, Gram, Upper),
+		 atomic_list_concat(Upper, ' ', Line),
+		 format('~w~t~32|# ~D~n', [Line, C])
+	       )).